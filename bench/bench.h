@@ -0,0 +1,34 @@
+#ifndef WUTIL_BENCH_INCLUDED
+#define WUTIL_BENCH_INCLUDED
+
+#include "latency.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+//=============================================================================
+// shared by the benchmark executables, results go to stdout one line each
+//=============================================================================
+
+namespace bench
+{
+	// argument index as a positive count, fallback when missing or invalid
+	inline int count_argument(int argc, char** argv, int index, int fallback)
+	{
+		if (index >= argc)
+			return fallback;
+
+		auto value = std::atoi(argv[index]);
+		return value > 0 ? value : fallback;
+	}
+
+	inline void print(const char* name, const wutil::LatencyHistogram& histogram)
+	{
+		auto us = [&histogram](double q) { return static_cast<double>(histogram.percentile(q).count()) / 1000.0; };
+		std::printf("%-40s n=%-9llu p50=%9.2fus p99=%9.2fus p99.9=%9.2fus max=%9.2fus\n", name,
+			static_cast<unsigned long long>(histogram.count()), us(0.5), us(0.99), us(0.999),
+			static_cast<double>(histogram.max().count()) / 1000.0);
+	}
+}
+
+#endif
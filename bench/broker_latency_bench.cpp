@@ -0,0 +1,113 @@
+#include "shared_seqlock.h"
+#include "bench.h"
+
+#include <thread>
+#include <vector>
+
+//=============================================================================
+// reader latency of the topology broker seqlock. a writer republishes a
+// payload the size of a three monitor topology, readers either poll read()
+// or wait() for each generation. usage: broker_latency_bench [readers]
+// [publishes]
+//=============================================================================
+
+namespace
+{
+	const uint64_t Layout = 0xbe7c;
+	const size_t Payload_Size = 3 * (840 + 104 + 16) + 3 * 64 * 36;
+
+#ifdef OS_WIN
+	const wutil::detail::SharedName Name = TEXT("Local\\wutil_broker_latency_bench");
+#else
+	const wutil::detail::SharedName Name = "/wutil_broker_latency_bench";
+#endif
+
+	uint64_t now_ns()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto reader_count = bench::count_argument(argc, argv, 1, 4);
+	auto publishes = bench::count_argument(argc, argv, 2, 2000);
+
+	wutil::SharedSeqlockWriter::remove(Name);
+	wutil::SharedSeqlockWriter writer(Name, Payload_Size, Layout);
+	if (!writer.is_open())
+	{
+		std::fprintf(stderr, "could not create the shared region\n");
+		return 1;
+	}
+
+	// the first 8 bytes carry the publish time
+	std::vector<unsigned char> payload(Payload_Size);
+	auto publish = [&]()
+	{
+		auto stamp = now_ns();
+		std::memcpy(payload.data(), &stamp, sizeof(stamp));
+		writer.publish(payload.data(), payload.size());
+	};
+	publish();
+
+	wutil::LatencyHistogram read_cost;
+	wutil::LatencyHistogram wake_latency;
+	std::atomic<bool> done{ false };
+	std::atomic<int> ready{ 0 };
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < reader_count; ++i)
+	{
+		// even readers poll, odd readers wait for each generation
+		bool waits = (i & 1) != 0;
+		readers.emplace_back([&, waits]()
+		{
+			wutil::SharedSeqlockReader reader(Name, Layout);
+			std::vector<unsigned char> copy;
+			uint64_t generation = 0;
+			reader.read(copy, &generation);
+			ready.fetch_add(1);
+
+			while (!done.load(std::memory_order_relaxed))
+			{
+				if (waits && !reader.wait(generation, 100))
+					continue;
+
+				auto start = now_ns();
+				if (!reader.read(copy, &generation))
+					continue;
+
+				auto end = now_ns();
+				read_cost.record(std::chrono::nanoseconds(end - start));
+
+				if (waits)
+				{
+					uint64_t stamp = 0;
+					std::memcpy(&stamp, copy.data(), sizeof(stamp));
+					wake_latency.record(std::chrono::nanoseconds(end - stamp));
+				}
+			}
+		});
+	}
+
+	while (ready.load() < reader_count)
+		std::this_thread::yield();
+
+	for (int i = 0; i < publishes; ++i)
+	{
+		publish();
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+
+	done.store(true);
+	for (auto& reader : readers)
+		reader.join();
+	wutil::SharedSeqlockWriter::remove(Name);
+
+	std::printf("%d readers, %d publishes of %zu bytes\n", reader_count, publishes, Payload_Size);
+	bench::print("read", read_cost);
+	bench::print("publish to waiting reader", wake_latency);
+	return 0;
+}
@@ -0,0 +1,41 @@
+# times a clean build of the generated translation units in every mode
+#   cmake -P bench/compile_time/run.cmake [-DMODES=header;library;module] [-DTU_COUNT=200]
+if(NOT MODES)
+	set(MODES header library module)
+endif()
+if(NOT TU_COUNT)
+	set(TU_COUNT 200)
+endif()
+
+get_filename_component(source_dir ${CMAKE_CURRENT_LIST_DIR} ABSOLUTE)
+set(build_root ${source_dir}/../../_compile_time_build)
+
+foreach(mode IN LISTS MODES)
+	set(build_dir ${build_root}/${mode})
+	file(REMOVE_RECURSE ${build_dir})
+	execute_process(
+		COMMAND ${CMAKE_COMMAND} -S ${source_dir} -B ${build_dir}
+			-DWUTIL_COMPILE_MODE=${mode} -DWUTIL_TU_COUNT=${TU_COUNT}
+		RESULT_VARIABLE result OUTPUT_QUIET)
+	if(NOT result EQUAL 0)
+		message(STATUS "${mode}: configure failed")
+		continue()
+	endif()
+
+	# the library itself is built first so only the generated units are timed
+	execute_process(COMMAND ${CMAKE_COMMAND} --build ${build_dir} --target wutil OUTPUT_QUIET ERROR_QUIET)
+
+	string(TIMESTAMP start "%s%f")
+	execute_process(
+		COMMAND ${CMAKE_COMMAND} --build ${build_dir} --target wutil_compile_time --parallel
+		RESULT_VARIABLE result OUTPUT_QUIET)
+	string(TIMESTAMP stop "%s%f")
+
+	if(NOT result EQUAL 0)
+		message(STATUS "${mode}: build failed")
+		continue()
+	endif()
+
+	math(EXPR elapsed_ms "(${stop} - ${start}) / 1000")
+	message(STATUS "${mode}: ${TU_COUNT} translation units in ${elapsed_ms} ms")
+endforeach()
@@ -0,0 +1,80 @@
+#include "coord_transform.h"
+#include "bench.h"
+
+#include <random>
+
+//=============================================================================
+// throughput of the monitor transforms, one point at a time against the
+// batched kernels, for every orientation at 150% scaling. usage:
+// coord_transform_bench [points] [rounds]
+//=============================================================================
+
+namespace
+{
+	const DWORD Orientations[] = { DMDO_DEFAULT, DMDO_90, DMDO_180, DMDO_270 };
+
+	const char* name(DWORD orientation)
+	{
+		return orientation == DMDO_90 ? "90" : orientation == DMDO_180 ? "180" : orientation == DMDO_270 ? "270" : "0";
+	}
+
+	double points_per_us(size_t points, std::chrono::nanoseconds elapsed)
+	{
+		return elapsed.count() == 0 ? 0.0 : static_cast<double>(points) * 1000.0 / static_cast<double>(elapsed.count());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto count = static_cast<size_t>(bench::count_argument(argc, argv, 1, 1 << 16));
+	auto rounds = bench::count_argument(argc, argv, 2, 200);
+
+	MONITORINFOEX mi = {};
+	mi.cbSize = sizeof(mi);
+	mi.rcMonitor = { -2560, 0, 0, 1440 };
+
+	std::mt19937 random(5);
+	std::vector<POINT> physical(count), out(count);
+	for (auto& p : physical)
+		p = POINT{ static_cast<LONG>(random() % 1440), static_cast<LONG>(random() % 1440) };
+
+	long long sink = 0;
+	for (auto orientation : Orientations)
+	{
+		auto transform = wutil::make_monitor_transform(mi, 144, orientation);
+		wutil::LatencyHistogram single, batch, single_back, batch_back;
+
+		for (int r = 0; r < rounds; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < count; ++i)
+				out[i] = transform.to_logical(physical[i]);
+			single.record(std::chrono::steady_clock::now() - start);
+			sink += out[r % count].x;
+
+			start = std::chrono::steady_clock::now();
+			transform.to_logical(physical, out);
+			batch.record(std::chrono::steady_clock::now() - start);
+			sink += out[r % count].y;
+
+			start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < count; ++i)
+				out[i] = transform.to_physical(out[i]);
+			single_back.record(std::chrono::steady_clock::now() - start);
+			sink += out[r % count].x;
+
+			transform.to_logical(physical, out);
+			start = std::chrono::steady_clock::now();
+			transform.to_physical(out, out);
+			batch_back.record(std::chrono::steady_clock::now() - start);
+			sink += out[r % count].y;
+		}
+
+		std::printf("rotation %s, %zu points: to_logical %.0f/us single %.0f/us batched, to_physical %.0f/us single %.0f/us batched\n",
+			name(orientation), count, points_per_us(count, single.percentile(0.5)), points_per_us(count, batch.percentile(0.5)),
+			points_per_us(count, single_back.percentile(0.5)), points_per_us(count, batch_back.percentile(0.5)));
+	}
+
+	std::printf("(%lld)\n", sink % 10);
+	return 0;
+}
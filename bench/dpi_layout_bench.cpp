@@ -0,0 +1,105 @@
+#include "dpi_layout.h"
+#include "fake_display.h"
+#include "bench.h"
+
+//=============================================================================
+// memory and latency of DpiLayoutCache against rescaling on every dpi
+// change. a layout of rects and metrics is kept for the dpis of three
+// simulated monitors, then WM_DPICHANGED, WM_DISPLAYCHANGE and single edits
+// are timed. usage: dpi_layout_bench [elements] [rounds]
+//=============================================================================
+
+namespace
+{
+	const UINT Dpis[] = { 96, 144, 192 };
+
+	std::chrono::nanoseconds since(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	}
+
+	// what a handler without the cache does on every dpi change
+	void rescale(const wutil::DpiLayout& logical, UINT dpi, wutil::DpiLayout& out)
+	{
+		out.dpi = dpi;
+		out.rects.resize(logical.rects.size());
+		for (size_t i = 0; i < logical.rects.size(); ++i)
+			out.rects[i] = wutil::scale_rect(logical.rects[i], dpi);
+
+		out.metrics.resize(logical.metrics.size());
+		for (size_t i = 0; i < logical.metrics.size(); ++i)
+			out.metrics[i] = wutil::scale_value(logical.metrics[i], dpi);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto elements = static_cast<size_t>(bench::count_argument(argc, argv, 1, 2000));
+	auto rounds = bench::count_argument(argc, argv, 2, 2000);
+
+	fake::install();
+	auto second = fake::make_monitor(2, { 2560, 0, 5120, 1440 }, 144);
+	auto third = fake::make_monitor(3, { 5120, 0, 8960, 2160 }, 192);
+	fake::reset({ fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true), second, third });
+
+	std::vector<RECT> rects(elements);
+	std::vector<int> metrics(elements);
+	for (size_t i = 0; i < elements; ++i)
+	{
+		auto x = static_cast<LONG>(i % 40) * 24;
+		auto y = static_cast<LONG>(i / 40) * 18;
+		rects[i] = { x, y, x + 22, y + 16 };
+		metrics[i] = static_cast<int>(i % 17) + 1;
+	}
+
+	wutil::DpiLayoutCache cache(rects, metrics);
+	auto logical_bytes = cache.memory_usage();
+
+	wutil::LatencyHistogram refresh, changed_cached, changed_rescaled, edit_one, rebuild;
+
+	auto start = std::chrono::steady_clock::now();
+	cache.refresh_dpis();
+	refresh.record(since(start));
+	std::printf("%zu elements, %zu layouts, %zu bytes logical, %zu bytes total\n", elements, cache.layout_count(), logical_bytes, cache.memory_usage());
+
+	wutil::DpiLayout scratch;
+	uint64_t sink = 0;
+	for (int i = 0; i < rounds; ++i)
+	{
+		auto dpi = Dpis[i % 3];
+
+		start = std::chrono::steady_clock::now();
+		auto layout = cache.layout(dpi);
+		sink += static_cast<uint64_t>(layout->rects.back().right);
+		changed_cached.record(since(start));
+
+		start = std::chrono::steady_clock::now();
+		rescale(cache.logical(), dpi, scratch);
+		sink += static_cast<uint64_t>(scratch.rects.back().right);
+		changed_rescaled.record(since(start));
+
+		auto index = static_cast<size_t>(i) % elements;
+		start = std::chrono::steady_clock::now();
+		cache.update_rect(index, { 1, 2, 3, 4 });
+		edit_one.record(since(start));
+
+		if (i % 20 == 0)
+		{
+			start = std::chrono::steady_clock::now();
+			cache.set_layout(rects, metrics);
+			rebuild.record(since(start));
+
+			start = std::chrono::steady_clock::now();
+			cache.refresh_dpis();
+			refresh.record(since(start));
+		}
+	}
+
+	bench::print("WM_DPICHANGED, cached layout", changed_cached);
+	bench::print("WM_DPICHANGED, rescaled", changed_rescaled);
+	bench::print("update_rect, every layout", edit_one);
+	bench::print("set_layout, every layout", rebuild);
+	bench::print("refresh_dpis, 3 monitors", refresh);
+	std::printf("hits %zu misses %zu (%llu)\n", cache.hits(), cache.misses(), static_cast<unsigned long long>(sink % 10));
+	return 0;
+}
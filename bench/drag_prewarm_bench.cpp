@@ -0,0 +1,242 @@
+#include "drag_prewarm.h"
+#include "bench.h"
+
+#include <random>
+#include <thread>
+
+//=============================================================================
+// replays recorded style drags across three monitors of mixed dpi through
+// DragPrewarmer: WM_MOVING at mouse rate with bursty timing, WM_DPICHANGED
+// wherever the window changes monitor, and a discard at the end of each
+// drag, all at the recorded pace. font scaling costs a configurable number
+// of microseconds, and each round ends with a WM_DISPLAYCHANGE while a
+// prewarm is still running. the same traces run without lookahead for the
+// scale on the spot baseline.
+// usage: drag_prewarm_bench [rounds] [font_us]
+//=============================================================================
+
+namespace
+{
+	const wutil::PrewarmMonitor Monitors[] = {
+		{ { 0, 0, 1920, 1080 }, 96 },
+		{ { 1920, 0, 4480, 1440 }, 144 },
+		{ { 4480, 0, 8320, 2160 }, 192 }
+	};
+
+	const size_t Font_Count = 8;
+
+	std::chrono::nanoseconds since(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	}
+
+	struct Move
+	{
+		RECT rect;
+		DWORD time_ms;
+	};
+
+	using Trace = std::vector<Move>;
+
+	struct Fonts
+	{
+		std::atomic<uint64_t> created{ 0 };
+		std::atomic<uint64_t> deleted{ 0 };
+	};
+
+	// spins instead of sleeping, sleeps are far coarser than a font
+	struct SimulatedBackend
+	{
+		Fonts* fonts = nullptr;
+		std::chrono::microseconds font_cost{ 300 };
+
+		HFONT scale_font(HFONT, UINT) const
+		{
+			auto start = std::chrono::steady_clock::now();
+			while (std::chrono::steady_clock::now() - start < font_cost)
+				;
+
+			return reinterpret_cast<HFONT>(static_cast<uintptr_t>(++fonts->created));
+		}
+
+		void delete_font(HFONT) const { ++fonts->deleted; }
+
+		std::vector<int> system_metrics(const std::vector<int>& indices, UINT dpi) const
+		{
+			std::vector<int> values;
+			for (auto index : indices)
+				values.push_back(wutil::scale_value(index, dpi));
+
+			return values;
+		}
+	};
+
+	using Prewarmer = wutil::BasicDragPrewarmer<SimulatedBackend>;
+
+	//=========================================================================
+	// a 800x600 window dragged from x to end_x at speed px/ms, optionally
+	// turning back at turn_x. events every 8ms with mouse bursts: now and
+	// then two arrive 1ms apart after a longer gap
+	//=========================================================================
+	Trace record(LONG x, LONG turn_x, LONG end_x, double speed, std::mt19937& random)
+	{
+		Trace trace;
+		DWORD time = 0;
+		double position = static_cast<double>(x);
+		double target = static_cast<double>(turn_x);
+		bool turned = turn_x == end_x;
+
+		for (;;)
+		{
+			auto left = static_cast<LONG>(position);
+			auto top = static_cast<LONG>(200 + random() % 5);
+			trace.push_back(Move{ { left, top, left + 800, top + 600 }, time });
+
+			auto step = random() % 6 == 0 ? 1u : (random() % 4 == 0 ? 15u : 8u);
+			time += step;
+			auto direction = target > position ? 1.0 : -1.0;
+			position += direction * speed * step;
+
+			if ((direction > 0 && position >= target) || (direction < 0 && position <= target))
+			{
+				if (turned)
+					break;
+
+				turned = true;
+				target = static_cast<double>(end_x);
+			}
+		}
+
+		return trace;
+	}
+
+	std::vector<Trace> record_traces()
+	{
+		std::mt19937 random(47);
+		return {
+			// steady drag to the second monitor and back
+			record(200, 2400, 2400, 1.5, random),
+			record(2400, 300, 300, 1.5, random),
+			// flick across all three
+			record(100, 5200, 5200, 6.0, random),
+			// heads for the next monitor, stops short and turns back
+			record(600, 1500, 400, 3.0, random),
+			record(2200, 3900, 2300, 4.0, random),
+			// slow creep over a boundary
+			record(1000, 1500, 1500, 0.3, random)
+		};
+	}
+
+	struct Result
+	{
+		wutil::LatencyHistogram moving, take_hit, take_miss, discard, display_change;
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t prewarms = 0;
+	};
+
+	void replay(const std::vector<Trace>& traces, int rounds, DWORD lookahead_ms, SimulatedBackend backend, Result& result)
+	{
+		std::vector<HFONT> fonts;
+		for (size_t i = 0; i < Font_Count; ++i)
+			fonts.push_back(reinterpret_cast<HFONT>(static_cast<uintptr_t>(0x1000 + i)));
+
+		std::vector<RECT> rects(64, RECT{ 0, 0, 120, 24 });
+		std::vector<int> metrics = { SM_CXBORDER, SM_CYCAPTION, SM_CXVSCROLL, SM_CXICON };
+
+		Prewarmer prewarmer(fonts, rects, metrics, lookahead_ms, backend);
+		prewarmer.set_monitors({ std::begin(Monitors), std::end(Monitors) });
+
+		wutil::DragPredictor monitor_of;
+		monitor_of.set_monitors({ std::begin(Monitors), std::end(Monitors) });
+
+		for (int r = 0; r < rounds; ++r)
+		{
+			for (const auto& trace : traces)
+			{
+				prewarmer.begin_drag(trace.front().rect, trace.front().time_ms);
+				auto monitor = monitor_of.monitor_of(trace.front().rect);
+
+				// at the recorded pace, prewarms get as long as they would in a real drag
+				auto begin = std::chrono::steady_clock::now();
+				for (const auto& move : trace)
+				{
+					std::this_thread::sleep_until(begin + std::chrono::milliseconds(move.time_ms));
+
+					auto start = std::chrono::steady_clock::now();
+					prewarmer.moving(move.rect, move.time_ms);
+					result.moving.record(since(start));
+
+					auto now = monitor_of.monitor_of(move.rect);
+					if (now == monitor || now < 0)
+						continue;
+
+					// WM_DPICHANGED, the window takes its resources and frees the old ones
+					monitor = now;
+					auto hits = prewarmer.hits();
+					start = std::chrono::steady_clock::now();
+					auto resources = prewarmer.take(Monitors[now].dpi);
+					(prewarmer.hits() != hits ? result.take_hit : result.take_miss).record(since(start));
+
+					for (auto hfont : resources.fonts)
+						backend.delete_font(hfont);
+				}
+
+				auto start = std::chrono::steady_clock::now();
+				prewarmer.discard();
+				result.discard.record(since(start));
+			}
+
+			// the flick again without pacing, displays change as soon as a prewarm starts
+			const auto& flick = traces[2];
+			prewarmer.begin_drag(flick.front().rect, flick.front().time_ms);
+			for (const auto& move : flick)
+			{
+				if (!prewarmer.moving(move.rect, move.time_ms))
+					continue;
+
+				auto start = std::chrono::steady_clock::now();
+				prewarmer.handle_message(NULL, WM_DISPLAYCHANGE, 0, 0);
+				result.display_change.record(since(start));
+				break;
+			}
+		}
+
+		result.hits = prewarmer.hits();
+		result.misses = prewarmer.misses();
+		result.prewarms = prewarmer.prewarms();
+	}
+
+	// fonts are counted after the prewarmer and its reaper are gone
+	void print(const char* name, const Result& result, const Fonts& fonts)
+	{
+		std::printf("%s: %zu prewarms, %zu hits, %zu misses, %llu fonts leaked\n", name, result.prewarms, result.hits, result.misses,
+			static_cast<unsigned long long>(fonts.created.load() - fonts.deleted.load()));
+		bench::print("moving", result.moving);
+		bench::print("WM_DPICHANGED, prewarmed", result.take_hit);
+		bench::print("WM_DPICHANGED, scaled on the spot", result.take_miss);
+		bench::print("discard at drag end", result.discard);
+		bench::print("WM_DISPLAYCHANGE, prewarm running", result.display_change);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto rounds = bench::count_argument(argc, argv, 1, 3);
+	auto font_us = bench::count_argument(argc, argv, 2, 300);
+	auto traces = record_traces();
+
+	size_t moves = 0;
+	for (const auto& trace : traces)
+		moves += trace.size();
+	std::printf("%zu traces, %zu moves, %d rounds, %d us per font\n", traces.size(), moves, rounds, font_us);
+
+	Fonts prewarmed_fonts, baseline_fonts;
+	Result prewarmed, baseline;
+	replay(traces, rounds, 150, SimulatedBackend{ &prewarmed_fonts, std::chrono::microseconds(font_us) }, prewarmed);
+	replay(traces, rounds, 0, SimulatedBackend{ &baseline_fonts, std::chrono::microseconds(font_us) }, baseline);
+
+	print("prewarmed, 150ms lookahead", prewarmed, prewarmed_fonts);
+	print("no lookahead", baseline, baseline_fonts);
+	return 0;
+}
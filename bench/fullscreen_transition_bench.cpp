@@ -0,0 +1,106 @@
+#include "fullscreen.h"
+#include "bench.h"
+
+#include <thread>
+
+//=============================================================================
+// cost of fullscreen transitions against a backend that takes a fixed time
+// per call, a modeset far longer than restyling a window. shows what the
+// manager adds and that returning from a focus loss skips the modeset.
+// usage: fullscreen_transition_bench [rounds] [modeset_us]
+//=============================================================================
+
+namespace
+{
+	struct Costs
+	{
+		std::chrono::microseconds modeset{ 20000 };
+		std::chrono::microseconds window{ 200 };
+	};
+
+	// busy waits, sleeping would measure the scheduler
+	void spend(std::chrono::microseconds cost)
+	{
+		auto end = std::chrono::steady_clock::now() + cost;
+		while (std::chrono::steady_clock::now() < end)
+		{
+		}
+	}
+
+	struct TimedBackend
+	{
+		const Costs* costs = nullptr;
+
+		static MONITORINFOEX monitor()
+		{
+			MONITORINFOEX mi = {};
+			mi.cbSize = sizeof(mi);
+			mi.rcMonitor = { 0, 0, 2560, 1440 };
+			lstrcpyn(mi.szDevice, TEXT("\\\\.\\DISPLAY1"), CCHDEVICENAME);
+			return mi;
+		}
+
+		bool monitor_info(HWND, MONITORINFOEX& mi) const { mi = monitor(); return true; }
+		std::optional<MONITORINFOEX> device_info(wutil::tstring_view) const { return monitor(); }
+
+		bool native_mode(wutil::tstring_view, DEVMODE& dm) const
+		{
+			dm = {};
+			dm.dmPelsWidth = 2560;
+			dm.dmPelsHeight = 1440;
+			dm.dmDisplayFrequency = 144;
+			return true;
+		}
+
+		std::optional<wutil::WindowInfo> set_borderless(HWND, const MONITORINFOEX&) const { spend(costs->window); return wutil::WindowInfo{}; }
+		bool restore_window(HWND, const wutil::WindowInfo&) const { spend(costs->window); return true; }
+		std::optional<MONITORINFOEX> change_mode(wutil::tstring_view, DEVMODE&) const { spend(costs->modeset); return monitor(); }
+		bool reset_mode(wutil::tstring_view) const { spend(costs->modeset); return true; }
+		void minimize(HWND) const { spend(costs->window); }
+		void show(HWND) const { spend(costs->window); }
+	};
+}
+
+int main(int argc, char** argv)
+{
+	auto rounds = bench::count_argument(argc, argv, 1, 50);
+	Costs costs;
+	costs.modeset = std::chrono::microseconds(bench::count_argument(argc, argv, 2, 20000));
+
+	DEVMODE native = {};
+	native.dmPelsWidth = 2560;
+	native.dmPelsHeight = 1440;
+	native.dmDisplayFrequency = 144;
+	DEVMODE lower = native;
+	lower.dmPelsWidth = 1280;
+	lower.dmPelsHeight = 720;
+	lower.dmDisplayFrequency = 60;
+
+	wutil::LatencyHistogram enter_borderless, leave_borderless, enter_exclusive, leave_exclusive, suspend, resume;
+	wutil::BasicFullscreenManager<TimedBackend> manager(reinterpret_cast<HWND>(0x1), TimedBackend{ &costs });
+	for (int i = 0; i < rounds; ++i)
+	{
+		manager.enter(&native);
+		enter_borderless.record(manager.stats().last_transition);
+		manager.leave();
+		leave_borderless.record(manager.stats().last_transition);
+
+		manager.enter(&lower);
+		enter_exclusive.record(manager.stats().last_transition);
+		manager.handle_message(WM_ACTIVATEAPP, FALSE, 0);
+		suspend.record(manager.stats().last_transition);
+		manager.handle_message(WM_ACTIVATEAPP, TRUE, 0);
+		resume.record(manager.stats().last_transition);
+		manager.leave();
+		leave_exclusive.record(manager.stats().last_transition);
+	}
+
+	std::printf("modeset %lldus, window call %lldus\n", static_cast<long long>(costs.modeset.count()), static_cast<long long>(costs.window.count()));
+	bench::print("enter borderless", enter_borderless);
+	bench::print("leave borderless", leave_borderless);
+	bench::print("enter exclusive", enter_exclusive);
+	bench::print("focus loss, exclusive", suspend);
+	bench::print("focus return, exclusive", resume);
+	bench::print("leave exclusive", leave_exclusive);
+	return 0;
+}
@@ -0,0 +1,125 @@
+#define WUTIL_DEFINE_ALLOCATION_HOOKS
+#include "alloc_tracker.h"
+#include "tiling.h"
+#include "bench.h"
+
+#include <random>
+
+//=============================================================================
+// solve time of TilingSolver for 10, 200 and by default 1000 windows over
+// three monitors of mixed dpi: a full solve, a monitor re-solve after a
+// work area change, and the two incremental window updates. allocations
+// after reserve and overlapping rects are counted, both should be zero.
+// usage: tiling_bench [windows] [rounds]
+//=============================================================================
+
+namespace
+{
+	const wutil::TileMonitor Monitors[] = {
+		{ { 0, 0, 1920, 1040 }, 96 },
+		{ { 1920, 0, 4480, 1400 }, 144 },
+		{ { 4480, 0, 8320, 2120 }, 192 }
+	};
+
+	std::chrono::nanoseconds since(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	}
+
+	// small minimums so most windows fit, a tenth pinned
+	std::vector<wutil::TileConstraints> make_windows(size_t count, std::mt19937& random)
+	{
+		std::vector<wutil::TileConstraints> windows(count);
+		for (auto& window : windows)
+		{
+			window.min_size = { static_cast<LONG>(random() % 40 + 8), static_cast<LONG>(random() % 30 + 8) };
+			window.weight = static_cast<uint32_t>(random() % 4 + 1);
+			if (random() % 10 == 0)
+				window.pinned_monitor = static_cast<int>(random() % std::size(Monitors));
+		}
+
+		return windows;
+	}
+
+	size_t count_overlaps(const std::vector<RECT>& rects)
+	{
+		size_t overlaps = 0;
+		for (size_t i = 0; i < rects.size(); ++i)
+		{
+			for (size_t j = i + 1; j < rects.size(); ++j)
+			{
+				RECT both;
+				if (IntersectRect(&both, &rects[i], &rects[j]))
+					++overlaps;
+			}
+		}
+
+		return overlaps;
+	}
+
+	void run(size_t count, int rounds)
+	{
+		std::mt19937 random(static_cast<unsigned>(count));
+		auto windows = make_windows(count, random);
+		std::vector<wutil::TileMonitor> monitors(std::begin(Monitors), std::end(Monitors));
+		std::vector<RECT> rects(count);
+
+		wutil::TilingSolver solver;
+		solver.reserve(count, monitors.size());
+		auto unmet = solver.solve(monitors, windows, rects);
+		auto overlaps = count_overlaps(rects);
+
+		wutil::LatencyHistogram solve, resolve, reweigh, repin;
+		auto allocations = wutil::total_allocation_count();
+		for (int r = 0; r < rounds; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			solver.solve(monitors, windows, rects);
+			solve.record(since(start));
+
+			// the taskbar of the middle monitor grows and shrinks
+			monitors[1].work.bottom = Monitors[1].work.bottom - (r % 2 == 0 ? 40 : 0);
+			start = std::chrono::steady_clock::now();
+			solver.resolve_monitor(1, monitors, windows, rects);
+			resolve.record(since(start));
+
+			auto window = static_cast<size_t>(r) % count;
+			windows[window].weight = windows[window].weight % 4 + 1;
+			start = std::chrono::steady_clock::now();
+			solver.update_window(window, monitors, windows, rects);
+			reweigh.record(since(start));
+
+			windows[window].pinned_monitor = (solver.monitor_of(window) + 1) % static_cast<int>(monitors.size());
+			start = std::chrono::steady_clock::now();
+			solver.update_window(window, monitors, windows, rects);
+			repin.record(since(start));
+		}
+		allocations = wutil::total_allocation_count() - allocations;
+
+		std::printf("%zu windows: %zu unmet, %zu overlapping pairs, %llu allocations in %d rounds\n", count, unmet, overlaps,
+			static_cast<unsigned long long>(allocations), rounds);
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "solve, %zu windows", count);
+		bench::print(name, solve);
+		std::snprintf(name, sizeof(name), "resolve_monitor, %zu windows", count);
+		bench::print(name, resolve);
+		std::snprintf(name, sizeof(name), "update_window weight, %zu windows", count);
+		bench::print(name, reweigh);
+		std::snprintf(name, sizeof(name), "update_window pin, %zu windows", count);
+		bench::print(name, repin);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto windows = static_cast<size_t>(bench::count_argument(argc, argv, 1, 1000));
+	auto rounds = bench::count_argument(argc, argv, 2, 2000);
+
+	run(10, rounds);
+	run(200, rounds);
+	if (windows != 10 && windows != 200)
+		run(windows, rounds);
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+#define WUTIL_TRACK_ALLOCATIONS
+#define WUTIL_DEFINE_ALLOCATION_HOOKS
+#include "wutil.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// allocation budgets of the tracked public calls in steady state, driven
+// through the fake DisplayApi. each call runs once to size the caller's
+// vectors, then every further call must stay within its budget and report
+// under its own api name. a call over budget reaches the violation handler
+//=============================================================================
+
+namespace
+{
+	const TCHAR* Name = TEXT("\\\\.\\DISPLAY2");
+
+	std::vector<DISPLAY_DEVICE> devices;
+	std::vector<MONITORINFOEX> monitors;
+	std::vector<DEVMODE> modes;
+
+	struct Budget
+	{
+		const char* api;
+		size_t allocations;
+		void (*call)();
+	};
+
+	// steady state, with the vectors above reused between calls
+	const Budget Budgets[] = {
+		{ "get_monitor_id", 0, [] { wutil::get_monitor_id(Name); } },
+		{ "get_all_display_devices", 0, [] { wutil::get_all_display_devices(devices); } },
+		{ "get_all_monitor_info", 0, [] { wutil::get_all_monitor_info(monitors); } },
+		{ "get_monitor_info", 0, [] { wutil::get_monitor_info(monitors.back().szDevice); } },
+		{ "get_monitor_display_settings", 0, [] { wutil::get_monitor_display_settings(Name, modes); } }
+	};
+
+	const int Rounds = 100;
+
+	struct Violation
+	{
+		const char* api = nullptr;
+		size_t allocations = 0;
+		size_t budget = 0;
+	};
+
+	// written by the handler, which must not allocate either
+	Violation violations[16];
+	size_t violation_count = 0;
+
+	void record_violation(const char* api, size_t allocations, size_t budget)
+	{
+		if (violation_count < std::size(violations))
+			violations[violation_count] = Violation{ api, allocations, budget };
+		++violation_count;
+	}
+
+	void install_monitors()
+	{
+		fake::reset({ fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true), fake::make_monitor(2, { 1920, 0, 4480, 1440 }, 144),
+			fake::make_monitor(3, { 4480, 0, 8320, 2160 }, 192) });
+	}
+
+	void test_steady_state()
+	{
+		install_monitors();
+		for (const auto& budget : Budgets)
+		{
+			budget.call();
+			CHECK(wutil::set_allocation_budget(budget.api, budget.allocations));
+		}
+
+		CHECK(devices.size() == 3 && monitors.size() == 3 && modes.size() == 3);
+
+		wutil::reset_allocation_stats();
+		violation_count = 0;
+		fake::display.calls = {};
+		for (int r = 0; r < Rounds; ++r)
+		{
+			for (const auto& budget : Budgets)
+				budget.call();
+		}
+
+		for (const auto& budget : Budgets)
+		{
+			auto stats = wutil::get_allocation_stats(budget.api);
+			if (!CHECK(stats.has_value()))
+				continue;
+
+			if (!CHECK(stats->calls == Rounds && stats->max_allocations <= budget.allocations && stats->violations == 0))
+			{
+				std::fprintf(stderr, "%s: %llu calls, at most %llu allocations, budget %zu\n", budget.api,
+					static_cast<unsigned long long>(stats->calls), static_cast<unsigned long long>(stats->max_allocations),
+					budget.allocations);
+			}
+		}
+
+		CHECK(violation_count == 0);
+
+		// the calls went through the fake, every round, not a cache
+		CHECK(fake::display.calls.enum_display_devices == Rounds * 5);
+		CHECK(fake::display.calls.enum_display_monitors == Rounds * 2);
+		CHECK(fake::display.calls.enum_display_settings_ex == Rounds * 5);
+	}
+
+	void test_violation_names_the_api()
+	{
+		install_monitors();
+		wutil::set_allocation_budget("get_all_display_devices", 0);
+		wutil::reset_allocation_stats();
+		violation_count = 0;
+
+		// a fresh vector has to grow, the steady state budget cannot hold
+		auto fresh = wutil::get_all_display_devices();
+		CHECK(fresh.size() == 3);
+
+		if (CHECK(violation_count == 1))
+		{
+			CHECK(std::strcmp(violations[0].api, "get_all_display_devices") == 0);
+			CHECK(violations[0].allocations > 0 && violations[0].budget == 0);
+		}
+
+		auto stats = wutil::get_allocation_stats("get_all_display_devices");
+		CHECK(stats && stats->calls == 1 && stats->violations == 1);
+
+		// the enclosing call is charged, nested calls only count toward themselves
+		auto topology = wutil::get_topology();
+		CHECK(topology.monitors.size() == 3);
+		auto id = wutil::get_allocation_stats("get_monitor_id");
+		CHECK(id && id->calls == 3 && id->max_allocations == 0);
+	}
+}
+
+int main()
+{
+	fake::install();
+	wutil::set_allocation_violation_handler(record_violation);
+
+	test_steady_state();
+	test_violation_names_the_api();
+
+	return test::test_result();
+}
@@ -0,0 +1,278 @@
+#include "bitmap_scale.h"
+#include "check.h"
+
+#include <cstdio>
+#include <random>
+
+//=============================================================================
+// every simd level must produce the same pixels as the scalar kernels, over
+// random premultiplied bitmaps of odd sizes and padded strides, both filters,
+// up and down scaling and banded threading. levels the cpu lacks are skipped.
+// ScaledBitmapCache picks its source variant and keeps what it resampled
+//=============================================================================
+
+namespace
+{
+	struct Source
+	{
+		std::vector<uint8_t> pixels;
+		wutil::BitmapView view;
+	};
+
+	// random premultiplied bgra, some fully opaque and fully transparent runs for ringing at hard edges
+	Source make_source(std::mt19937& random, int width, int height, int padding)
+	{
+		Source source;
+		auto stride = static_cast<ptrdiff_t>(width) * 4 + padding;
+		source.pixels.assign(static_cast<size_t>(stride) * height, 0xcd);
+
+		std::uniform_int_distribution<int> byte(0, 255);
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				auto pixel = source.pixels.data() + y * stride + x * 4;
+				int kind = (x / 3 + y / 5) % 4;
+				auto alpha = static_cast<uint8_t>(kind == 0 ? 0 : kind == 1 ? 255 : byte(random));
+				for (int c = 0; c < 3; ++c)
+					pixel[c] = static_cast<uint8_t>(alpha == 0 ? 0 : byte(random) % (alpha + 1));
+				pixel[3] = alpha;
+			}
+		}
+
+		source.view = wutil::BitmapView{ source.pixels.data(), width, height, stride };
+		return source;
+	}
+
+	std::vector<uint8_t> scale(const wutil::BitmapView& source, int width, int height, ptrdiff_t stride, wutil::ResampleFilter filter, wutil::SimdLevel simd, unsigned threads)
+	{
+		// padding bytes keep a marker, no kernel may write past a row
+		std::vector<uint8_t> pixels(static_cast<size_t>(stride) * height, 0xab);
+		wutil::ResampleOptions options;
+		options.filter = filter;
+		options.max_simd = simd;
+		options.threads = threads;
+		CHECK(wutil::scale_bitmap(source, pixels.data(), width, height, stride, options));
+		return pixels;
+	}
+
+	bool premultiplied(const std::vector<uint8_t>& pixels, int width, int height, ptrdiff_t stride)
+	{
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				auto pixel = pixels.data() + y * stride + x * 4;
+				if (pixel[0] > pixel[3] || pixel[1] > pixel[3] || pixel[2] > pixel[3])
+					return false;
+			}
+
+			for (auto i = static_cast<ptrdiff_t>(width) * 4; i < stride; ++i)
+			{
+				if (pixels[static_cast<size_t>(y * stride + i)] != 0xab)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	const char* name(wutil::SimdLevel level)
+	{
+		return level == wutil::SimdLevel::Avx2 ? "avx2" : level == wutil::SimdLevel::Sse41 ? "sse4.1" : "scalar";
+	}
+
+	void test_simd_matches_scalar()
+	{
+		auto supported = wutil::detail::detect_simd_level();
+		std::printf("cpu supports %s\n", name(supported));
+
+		struct Size
+		{
+			int width, height;
+		};
+
+		// odd sizes exercise every simd remainder, 1 pixel edges the nearest fallback
+		const Size sources[] = { { 1, 1 }, { 3, 7 }, { 17, 9 }, { 32, 32 }, { 45, 31 }, { 64, 3 } };
+		const Size targets[] = { { 1, 1 }, { 2, 5 }, { 7, 3 }, { 24, 24 }, { 40, 40 }, { 63, 17 }, { 96, 80 } };
+		const wutil::ResampleFilter filters[] = { wutil::ResampleFilter::Box, wutil::ResampleFilter::Lanczos3 };
+		const wutil::SimdLevel levels[] = { wutil::SimdLevel::Sse41, wutil::SimdLevel::Avx2 };
+
+		std::mt19937 random(1234);
+		int compared = 0;
+		for (auto source_size : sources)
+		{
+			auto source = make_source(random, source_size.width, source_size.height, (source_size.width % 3) * 4);
+			for (auto target : targets)
+			{
+				auto stride = static_cast<ptrdiff_t>(target.width) * 4 + (target.height % 2) * 12;
+				for (auto filter : filters)
+				{
+					auto reference = scale(source.view, target.width, target.height, stride, filter, wutil::SimdLevel::Scalar, 1);
+					CHECK(premultiplied(reference, target.width, target.height, stride));
+
+					for (auto level : levels)
+					{
+						if (level > supported)
+							continue;
+
+						for (unsigned threads : { 1u, 3u })
+						{
+							auto pixels = scale(source.view, target.width, target.height, stride, filter, level, threads);
+							if (!CHECK(pixels == reference))
+								std::fprintf(stderr, "%s differs scaling %dx%d to %dx%d on %u threads\n", name(level),
+									source_size.width, source_size.height, target.width, target.height, threads);
+							++compared;
+						}
+					}
+				}
+			}
+		}
+
+		std::printf("%d simd results compared\n", compared);
+	}
+
+	void test_large_banded()
+	{
+		// past Resample_Parallel_Pixels, the default thread count splits into bands
+		std::mt19937 random(99);
+		auto source = make_source(random, 301, 203, 0);
+		auto reference = scale(source.view, 777, 701, 777 * 4, wutil::ResampleFilter::Lanczos3, wutil::SimdLevel::Scalar, 1);
+		auto pixels = scale(source.view, 777, 701, 777 * 4, wutil::ResampleFilter::Lanczos3, wutil::SimdLevel::Avx2, 0);
+		CHECK(pixels == reference);
+		CHECK(premultiplied(pixels, 777, 701, 777 * 4));
+	}
+
+	void test_flat_colour_is_kept()
+	{
+		// weights of every output pixel sum to exactly one, ringing needs an edge
+		wutil::Bitmap flat(19, 13);
+		for (size_t i = 0; i < flat.pixels.size(); i += 4)
+		{
+			flat.pixels[i + 0] = 10;
+			flat.pixels[i + 1] = 120;
+			flat.pixels[i + 2] = 200;
+			flat.pixels[i + 3] = 200;
+		}
+
+		for (auto level : { wutil::SimdLevel::Scalar, wutil::SimdLevel::Avx2 })
+		{
+			wutil::ResampleOptions options;
+			options.max_simd = level;
+			auto scaled = wutil::scale_bitmap(flat.view(), 144, options);
+			CHECK(scaled.width == 29 && scaled.height == 20);
+
+			bool kept = true;
+			for (size_t i = 0; i < scaled.pixels.size(); i += 4)
+				kept = kept && scaled.pixels[i] == 10 && scaled.pixels[i + 1] == 120 && scaled.pixels[i + 2] == 200 && scaled.pixels[i + 3] == 200;
+			CHECK(kept);
+		}
+	}
+
+	// one flat colour per variant, the colour of a result tells its source
+	wutil::Bitmap make_flat(int size, uint8_t value)
+	{
+		wutil::Bitmap flat(size, size);
+		for (size_t i = 0; i < flat.pixels.size(); i += 4)
+		{
+			flat.pixels[i + 0] = value;
+			flat.pixels[i + 1] = value;
+			flat.pixels[i + 2] = value;
+			flat.pixels[i + 3] = 255;
+		}
+
+		return flat;
+	}
+
+	bool is_flat(const wutil::Bitmap* bitmap, int size, uint8_t value)
+	{
+		if (bitmap == nullptr || bitmap->width != size || bitmap->height != size)
+			return false;
+
+		for (size_t i = 0; i < bitmap->pixels.size(); i += 4)
+		{
+			if (bitmap->pixels[i] != value || bitmap->pixels[i + 3] != 255)
+				return false;
+		}
+
+		return true;
+	}
+
+	void test_cache_picks_nearest_variant()
+	{
+		wutil::ScaledBitmapCache cache;
+		const wutil::ScaledBitmapCache::AssetId Icon = 7;
+		CHECK(cache.get(Icon, 96) == nullptr);
+
+		cache.add_variant(Icon, 96, make_flat(16, 10));
+		cache.add_variant(Icon, 192, make_flat(32, 20));
+
+		// exact variants as they are, others from the nearest at or above, or the largest
+		CHECK(is_flat(cache.get(Icon, 96), 16, 10));
+		CHECK(is_flat(cache.get(Icon, 144), 24, 20));
+		CHECK(is_flat(cache.get(Icon, 120), 20, 20));
+		CHECK(is_flat(cache.get(Icon, 72), 12, 10));
+		CHECK(is_flat(cache.get(Icon, 240), 40, 20));
+
+		// another asset sees none of it
+		CHECK(cache.get(Icon + 1, 96) == nullptr);
+	}
+
+	void test_cache_hit()
+	{
+		wutil::ScaledBitmapCache cache;
+		cache.add_variant(1, 96, make_flat(16, 10));
+
+		auto first = cache.get(1, 144);
+		CHECK(cache.hits() == 0 && cache.misses() == 1);
+		CHECK(cache.get(1, 144) == first);
+		CHECK(cache.get(1, 96) != nullptr);
+		CHECK(cache.hits() == 2 && cache.misses() == 1);
+	}
+
+	void test_variant_at_resampled_dpi()
+	{
+		wutil::ScaledBitmapCache cache;
+		cache.add_variant(1, 96, make_flat(16, 10));
+		cache.add_variant(1, 192, make_flat(32, 20));
+		CHECK(is_flat(cache.get(1, 144), 24, 20));
+		CHECK(is_flat(cache.get(1, 240), 40, 20));
+
+		// drawn for 144 after 144 was resampled: served as added, and the new source of 120
+		cache.add_variant(1, 144, make_flat(24, 30));
+		CHECK(is_flat(cache.get(1, 144), 24, 30));
+		CHECK(is_flat(cache.get(1, 120), 20, 30));
+
+		// resampled bitmaps of the old variants are gone
+		auto misses = cache.misses();
+		CHECK(is_flat(cache.get(1, 240), 40, 20));
+		CHECK(cache.misses() == misses + 1);
+
+		// replacing a variant again keeps it, and every variant stays reachable
+		cache.add_variant(1, 144, make_flat(24, 40));
+		CHECK(is_flat(cache.get(1, 144), 24, 40));
+		CHECK(is_flat(cache.get(1, 96), 16, 10) && is_flat(cache.get(1, 192), 32, 20));
+	}
+
+	void test_invalid_sizes()
+	{
+		wutil::Bitmap bitmap(4, 4);
+		uint8_t pixel[4] = {};
+		CHECK(!wutil::scale_bitmap(bitmap.view(), pixel, 0, 1, 4));
+		CHECK(!wutil::scale_bitmap(wutil::BitmapView{}, pixel, 1, 1, 4));
+		CHECK(wutil::scale_bitmap(bitmap.view(), 0, 3).pixels.empty());
+	}
+}
+
+int main()
+{
+	test_simd_matches_scalar();
+	test_large_banded();
+	test_flat_colour_is_kept();
+	test_invalid_sizes();
+	test_cache_picks_nearest_variant();
+	test_cache_hit();
+	test_variant_at_resampled_dpi();
+
+	return test::test_result();
+}
@@ -0,0 +1,37 @@
+#ifndef WUTIL_TESTS_CHECK_INCLUDED
+#define WUTIL_TESTS_CHECK_INCLUDED
+
+#include <cstdio>
+
+//=============================================================================
+// minimal checks for the test executables, a failed check is reported and
+// counted and the test keeps running, main returns test_result()
+//=============================================================================
+
+namespace test
+{
+	inline int failures = 0;
+
+	inline bool check(bool passed, const char* expression, const char* file, int line)
+	{
+		if (!passed)
+		{
+			std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+			++failures;
+		}
+
+		return passed;
+	}
+
+	inline int test_result()
+	{
+		if (failures > 0)
+			std::fprintf(stderr, "%d check(s) failed\n", failures);
+
+		return failures > 0 ? 1 : 0;
+	}
+}
+
+#define CHECK(expression) test::check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+#endif
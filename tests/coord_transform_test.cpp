@@ -0,0 +1,261 @@
+#include "coord_transform.h"
+#include "fake_display.h"
+#include "check.h"
+
+#include <cmath>
+#include <random>
+
+//=============================================================================
+// properties of the monitor transforms over random monitors and points:
+// exact round trips on the finer grid, bounded error on the coarser one,
+// rotations that permute the panel, batches equal to single points, and the
+// rounding helpers against a floating point reference
+//=============================================================================
+
+namespace
+{
+	const UINT Dpis[] = { 72, 96, 120, 144, 168, 192, 240, 288 };
+	const DWORD Orientations[] = { DMDO_DEFAULT, DMDO_90, DMDO_180, DMDO_270 };
+
+	MONITORINFOEX make_info(LONG left, LONG top, LONG width, LONG height)
+	{
+		MONITORINFOEX mi = {};
+		mi.cbSize = sizeof(mi);
+		mi.rcMonitor = { left, top, left + width, top + height };
+		mi.rcWork = mi.rcMonitor;
+		return mi;
+	}
+
+	struct Case
+	{
+		MONITORINFOEX mi;
+		UINT dpi;
+		DWORD orientation;
+		wutil::MonitorTransform transform;
+	};
+
+	// monitors anywhere on a desktop, including left of and above the primary
+	Case random_case(std::mt19937& random)
+	{
+		std::uniform_int_distribution<LONG> origin(-8000, 8000);
+		std::uniform_int_distribution<LONG> size(1, 4000);
+		Case c;
+		c.mi = make_info(origin(random), origin(random), size(random), size(random));
+		c.dpi = Dpis[random() % std::size(Dpis)];
+		c.orientation = Orientations[random() % std::size(Orientations)];
+		c.transform = wutil::make_monitor_transform(c.mi, c.dpi, c.orientation);
+		return c;
+	}
+
+	POINT random_point(std::mt19937& random, const RECT& rect)
+	{
+		std::uniform_int_distribution<LONG> x(rect.left, rect.right - 1);
+		std::uniform_int_distribution<LONG> y(rect.top, rect.bottom - 1);
+		return POINT{ x(random), y(random) };
+	}
+
+	bool same(POINT a, POINT b)
+	{
+		return a.x == b.x && a.y == b.y;
+	}
+
+	// the logical rect of the monitor, its size divided by the dpi scale
+	RECT logical_rect(const Case& c)
+	{
+		auto width = c.mi.rcMonitor.right - c.mi.rcMonitor.left;
+		auto height = c.mi.rcMonitor.bottom - c.mi.rcMonitor.top;
+		return RECT{ c.mi.rcMonitor.left, c.mi.rcMonitor.top,
+			c.mi.rcMonitor.left + (std::max)(static_cast<LONG>(static_cast<int64_t>(width) * 96 / c.dpi), 1L),
+			c.mi.rcMonitor.top + (std::max)(static_cast<LONG>(static_cast<int64_t>(height) * 96 / c.dpi), 1L) };
+	}
+
+	RECT panel_rect(const Case& c)
+	{
+		return RECT{ 0, 0, c.transform.native_width, c.transform.native_height };
+	}
+
+	void test_rounding_helpers()
+	{
+		std::mt19937 random(7);
+		std::uniform_int_distribution<int64_t> value(-100000, 100000);
+		std::uniform_int_distribution<int64_t> divisor(1, 97);
+		for (int i = 0; i < 100000; ++i)
+		{
+			auto a = value(random);
+			auto b = divisor(random) * (random() % 2 == 0 ? 1 : -1);
+			auto exact = static_cast<double>(a) / static_cast<double>(b);
+			if (!CHECK(wutil::detail::floor_div(a, b) == static_cast<int64_t>(std::floor(exact))) ||
+				!CHECK(wutil::detail::ceil_div(a, b) == static_cast<int64_t>(std::ceil(exact))))
+			{
+				std::fprintf(stderr, "%lld / %lld\n", static_cast<long long>(a), static_cast<long long>(b));
+				return;
+			}
+		}
+	}
+
+	void test_finer_grid_round_trips()
+	{
+		std::mt19937 random(11);
+		int failures = 0;
+		for (int i = 0; i < 2000 && failures == 0; ++i)
+		{
+			auto c = random_case(random);
+			for (int j = 0; j < 200; ++j)
+			{
+				if (c.transform.physical_is_finer())
+				{
+					auto logical = random_point(random, logical_rect(c));
+					if (!same(c.transform.to_logical(c.transform.to_physical(logical)), logical))
+						++failures;
+				}
+				else
+				{
+					auto physical = random_point(random, panel_rect(c));
+					if (!same(c.transform.to_physical(c.transform.to_logical(physical)), physical))
+						++failures;
+				}
+			}
+		}
+
+		CHECK(failures == 0);
+	}
+
+	void test_coarser_grid_error_is_bounded()
+	{
+		// physical to logical and back lands on the same logical pixel, within one logical pixel of physical pixels
+		std::mt19937 random(13);
+		int failures = 0;
+		for (int i = 0; i < 2000; ++i)
+		{
+			auto c = random_case(random);
+			if (!c.transform.physical_is_finer() || c.orientation != DMDO_DEFAULT)
+				continue;
+
+			auto span = static_cast<LONG>((c.dpi + 95) / 96);
+			for (int j = 0; j < 200; ++j)
+			{
+				auto physical = random_point(random, panel_rect(c));
+				auto logical = c.transform.to_logical(physical);
+				auto back = c.transform.to_physical(logical);
+				if (!same(c.transform.to_logical(back), logical) || back.x > physical.x || back.y > physical.y ||
+					physical.x - back.x >= span || physical.y - back.y >= span)
+					++failures;
+			}
+		}
+
+		CHECK(failures == 0);
+	}
+
+	void test_rotations_permute_the_panel()
+	{
+		// at 96 dpi every panel pixel maps to a distinct pixel of the rotated monitor rect
+		for (auto orientation : Orientations)
+		{
+			auto c = make_info(-300, 40, orientation == DMDO_90 || orientation == DMDO_270 ? 7 : 13, orientation == DMDO_90 || orientation == DMDO_270 ? 13 : 7);
+			auto transform = wutil::make_monitor_transform(c, 96, orientation);
+			CHECK(transform.native_width == 13 && transform.native_height == 7);
+
+			std::vector<int> hits(13 * 7, 0);
+			bool inside = true;
+			for (LONG y = 0; y < 7; ++y)
+			{
+				for (LONG x = 0; x < 13; ++x)
+				{
+					auto logical = transform.to_logical(POINT{ x, y });
+					auto lx = logical.x - c.rcMonitor.left;
+					auto ly = logical.y - c.rcMonitor.top;
+					auto width = c.rcMonitor.right - c.rcMonitor.left;
+					if (lx < 0 || ly < 0 || lx >= width || ly >= c.rcMonitor.bottom - c.rcMonitor.top)
+					{
+						inside = false;
+						continue;
+					}
+
+					++hits[static_cast<size_t>(ly * width + lx)];
+					inside = inside && same(transform.to_physical(logical), POINT{ x, y });
+				}
+			}
+
+			CHECK(inside);
+			CHECK(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }));
+		}
+
+		// the panel origin lands in the corner the rotation moves it to
+		auto wide = make_info(0, 0, 1080, 1920);
+		CHECK(same(wutil::make_monitor_transform(wide, 96, DMDO_90).to_logical(POINT{ 0, 0 }), POINT{ 1079, 0 }));
+		CHECK(same(wutil::make_monitor_transform(wide, 96, DMDO_270).to_logical(POINT{ 0, 0 }), POINT{ 0, 1919 }));
+		CHECK(same(wutil::make_monitor_transform(make_info(0, 0, 1920, 1080), 96, DMDO_180).to_logical(POINT{ 0, 0 }), POINT{ 1919, 1079 }));
+	}
+
+	void test_batches_match_single_points()
+	{
+		std::mt19937 random(17);
+		int failures = 0;
+		for (int i = 0; i < 500; ++i)
+		{
+			auto c = random_case(random);
+			std::vector<POINT> physical(64), logical(64), in_place(64);
+			for (auto& p : physical)
+				p = random_point(random, panel_rect(c));
+
+			c.transform.to_logical(physical, logical);
+			in_place = physical;
+			c.transform.to_logical(in_place, in_place);
+			for (size_t j = 0; j < physical.size(); ++j)
+			{
+				if (!same(logical[j], c.transform.to_logical(physical[j])) || !same(in_place[j], logical[j]))
+					++failures;
+			}
+
+			std::vector<POINT> back(64);
+			c.transform.to_physical(logical, back);
+			in_place = logical;
+			c.transform.to_physical(in_place, in_place);
+			for (size_t j = 0; j < logical.size(); ++j)
+			{
+				if (!same(back[j], c.transform.to_physical(logical[j])) || !same(in_place[j], back[j]))
+					++failures;
+			}
+
+			// a shorter output is filled and nothing past it is touched
+			std::vector<POINT> shorter(10, POINT{ -1, -1 });
+			c.transform.to_logical(physical, std::span<POINT>(shorter.data(), 5));
+			if (!same(shorter[4], logical[4]) || !same(shorter[5], POINT{ -1, -1 }))
+				++failures;
+		}
+
+		CHECK(failures == 0);
+	}
+
+	void test_transforms_of_simulated_monitors()
+	{
+		fake::install();
+		auto second = fake::make_monitor(2, { -1080, -400, 0, 1520 }, 144);
+		second.modes[0].dmFields |= DM_DISPLAYORIENTATION;
+		second.modes[0].dmDisplayOrientation = DMDO_90;
+		fake::reset({ fake::make_monitor(1, { 0, 0, 2560, 1440 }, 120, true), second });
+
+		auto transforms = wutil::get_monitor_transforms();
+		if (!CHECK(transforms.size() == 2))
+			return;
+
+		CHECK(transforms[0].dpi == 120 && transforms[0].orientation == DMDO_DEFAULT);
+		CHECK(transforms[1].dpi == 144 && transforms[1].orientation == DMDO_90);
+		CHECK(transforms[1].native_width == 1920 && transforms[1].native_height == 1080);
+		CHECK(wutil::find_monitor_transform(transforms, transforms[1].id) == &transforms[1]);
+		CHECK(wutil::find_monitor_transform(transforms, 0) == nullptr);
+		CHECK(same(transforms[1].to_logical(POINT{ 0, 0 }), POINT{ -1080 + 719, -400 }));
+	}
+}
+
+int main()
+{
+	test_rounding_helpers();
+	test_finer_grid_round_trips();
+	test_coarser_grid_error_is_bounded();
+	test_rotations_permute_the_panel();
+	test_batches_match_single_points();
+	test_transforms_of_simulated_monitors();
+
+	return test::test_result();
+}
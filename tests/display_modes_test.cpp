@@ -0,0 +1,166 @@
+#include "wutil.h"
+#include "fake_display.h"
+#include "check.h"
+
+#include <ranges>
+
+//=============================================================================
+// driver calls made by display_modes on the simulated backend: nothing
+// until iteration, exactly up to the mode the caller stops at, iterators
+// that outlive the range they came from, and a predicate that stops take
+// where std::views::filter enumerates on
+//=============================================================================
+
+namespace
+{
+	static_assert(std::ranges::input_range<wutil::DisplayModeRange>);
+	static_assert(std::ranges::view<wutil::DisplayModeRange>);
+	static_assert(std::ranges::borrowed_range<wutil::DisplayModeRange>);
+
+	const TCHAR* Name = TEXT("\\\\.\\DISPLAY1");
+
+	bool is_144hz(const DEVMODE& dm)
+	{
+		return dm.dmDisplayFrequency == 144;
+	}
+
+	// 144hz modes at 2 and 5 of 7
+	void install_monitor()
+	{
+		auto monitor = fake::make_monitor(1, { 0, 0, 2560, 1440 }, 96, true);
+		monitor.modes = { fake::make_mode(2560, 1440, 60), fake::make_mode(1920, 1080, 60), fake::make_mode(2560, 1440, 144),
+			fake::make_mode(1280, 720, 60), fake::make_mode(2560, 1440, 120), fake::make_mode(1920, 1080, 144),
+			fake::make_mode(2560, 1440, 165) };
+		fake::reset({ monitor });
+	}
+
+	int calls()
+	{
+		return fake::display.calls.enum_display_settings_ex;
+	}
+
+	void test_nothing_before_iteration()
+	{
+		install_monitor();
+		auto range = wutil::display_modes(Name);
+		auto it = range.begin();
+		CHECK(calls() == 0 && it.calls() == 0);
+
+		// incrementing unseen modes only counts them
+		++it;
+		++it;
+		CHECK(calls() == 0);
+		CHECK(it->dmDisplayFrequency == 144 && calls() == 3);
+	}
+
+	void test_find_stops_on_the_match()
+	{
+		install_monitor();
+
+		// the iterator owns the enumeration, the temporary range may go
+		auto it = std::ranges::find_if(wutil::display_modes(Name), is_144hz);
+		if (!CHECK(it != std::default_sentinel))
+			return;
+
+		CHECK(it->dmPelsWidth == 2560 && it->dmDisplayFrequency == 144);
+		CHECK(calls() == 3 && it.calls() == 3);
+
+		++it;
+		CHECK(it->dmPelsWidth == 1280 && calls() == 4);
+	}
+
+	void test_take()
+	{
+		install_monitor();
+		int count = 0;
+		for (const auto& dm : wutil::display_modes(Name) | std::views::take(1))
+			count += dm.dmDisplayFrequency == 60 ? 1 : 0;
+		CHECK(count == 1 && calls() == 1);
+
+		// the predicate in the range stops on the second match
+		fake::display.calls = {};
+		std::vector<DWORD> widths;
+		for (const auto& dm : wutil::display_modes(Name, 0, is_144hz) | std::views::take(2))
+			widths.push_back(dm.dmPelsWidth);
+		CHECK(widths == std::vector<DWORD>({ 2560, 1920 }));
+		CHECK(calls() == 6);
+
+		// std::views::filter looks for a third match once the second is taken
+		fake::display.calls = {};
+		widths.clear();
+		for (const auto& dm : wutil::display_modes(Name) | std::views::filter(is_144hz) | std::views::take(2))
+			widths.push_back(dm.dmPelsWidth);
+		CHECK(widths == std::vector<DWORD>({ 2560, 1920 }));
+		CHECK(calls() > 6);
+	}
+
+	void test_full_enumeration()
+	{
+		install_monitor();
+		auto range = wutil::display_modes(Name);
+
+		// each begin enumerates on its own, one failing call ends it
+		for (int pass = 1; pass <= 2; ++pass)
+		{
+			size_t count = 0;
+			for (const auto& dm : range)
+				count += dm.dmSize == sizeof(DEVMODE) ? 1 : 0;
+			CHECK(count == 7 && calls() == 8 * pass);
+		}
+
+		size_t matches = 0;
+		for (const auto& dm : wutil::display_modes(Name, 0, is_144hz))
+			matches += is_144hz(dm) ? 1 : 0;
+		CHECK(matches == 2 && calls() == 24);
+
+		// ending twice asks the driver once
+		fake::display.calls = {};
+		auto it = range.begin();
+		for (int i = 0; i < 7; ++i)
+			++it;
+		CHECK(it == std::default_sentinel && it == std::default_sentinel);
+		CHECK(calls() == 8);
+	}
+
+	void test_unknown_device()
+	{
+		install_monitor();
+		auto it = wutil::display_modes(TEXT("\\\\.\\DISPLAY9")).begin();
+		CHECK(it == std::default_sentinel && calls() == 1);
+	}
+
+	// the flags reach the enumerator unchanged
+	struct FlagEnumerator
+	{
+		DWORD* seen = nullptr;
+
+		BOOL operator()(const TCHAR*, DWORD index, DEVMODE* dm, DWORD flags) const
+		{
+			*seen |= flags;
+			dm->dmDisplayFrequency = 60;
+			return index < 2;
+		}
+	};
+
+	void test_flags()
+	{
+		DWORD seen = 0;
+		wutil::BasicDisplayModeRange<FlagEnumerator> range(Name, EDS_RAWMODE, FlagEnumerator{ &seen });
+		CHECK(std::ranges::distance(range.begin(), range.end()) == 2);
+		CHECK(seen == EDS_RAWMODE);
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_nothing_before_iteration();
+	test_find_stops_on_the_match();
+	test_take();
+	test_full_enumeration();
+	test_unknown_device();
+	test_flags();
+
+	return test::test_result();
+}
@@ -0,0 +1,165 @@
+#include "latency.h"
+#include "display_trace.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// soak runs over the windows simulated backends. storms hot plug, change
+// dpi and modes of the fake display while every thread enumerates through
+// wutil, then the same workload runs against a replayed trace with the
+// monitors gone. usage: display_soak_test [milliseconds] [threads] [seed]
+//=============================================================================
+
+namespace
+{
+	const UINT Dpis[] = { 96, 120, 144, 168, 192 };
+	const size_t Max_Monitors = 6;
+	const HWND Window = reinterpret_cast<HWND>(0x500);
+
+	bool known_dpi(UINT dpi)
+	{
+		return std::find(std::begin(Dpis), std::end(Dpis), dpi) != std::end(Dpis);
+	}
+
+	// any topology a reader sees has one entry per monitor in every vector
+	bool consistent(const wutil::Topology& topology)
+	{
+		auto count = topology.monitors.size();
+		if (topology.ids.size() != count || topology.dpis.size() != count || topology.modes.size() != count)
+			return false;
+
+		return std::all_of(topology.dpis.begin(), topology.dpis.end(), known_dpi);
+	}
+
+	fake::Monitor random_monitor(int number, wutil::SoakThread& thread)
+	{
+		LONG left = 4000 * (number - 1);
+		auto monitor = fake::make_monitor(number, { left, 0, left + 1920, 1080 }, Dpis[thread.random() % 5], number == 1);
+		monitor.vsync = { 60000 - 60 * static_cast<UINT32>(thread.random() % 2), 1000 };
+		return monitor;
+	}
+
+	void add_readers(wutil::SoakHarness& harness, std::vector<wutil::SystemMetricsCache>& caches)
+	{
+		harness.add("get_topology", 10, [](wutil::SoakThread&)
+		{
+			return consistent(wutil::get_topology());
+		});
+
+		harness.add("get_all_refresh_timing", 4, [](wutil::SoakThread&)
+		{
+			auto monitors = wutil::get_all_monitor_info();
+			return wutil::get_all_refresh_timing(monitors).size() == monitors.size();
+		});
+
+		harness.add("get_dpi window", 10, [](wutil::SoakThread&)
+		{
+			return known_dpi(wutil::get_dpi(Window));
+		});
+
+		// one cache per thread, caches are not shared between threads
+		harness.add("non_client_metrics", 10, [&caches](wutil::SoakThread& thread)
+		{
+			auto dpi = Dpis[thread.random() % 5];
+			const auto& metrics = caches[static_cast<size_t>(thread.index)].non_client_metrics(dpi);
+			return metrics.iCaptionHeight == MulDiv(23, dpi, 96);
+		});
+	}
+
+	void test_fake_display_storm(const wutil::SoakHarness::Options& options)
+	{
+		fake::reset({ fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true) });
+		fake::display.windows = { { Window, 0 } };
+
+		std::vector<wutil::SystemMetricsCache> caches(static_cast<size_t>(options.threads));
+		wutil::SoakHarness harness;
+		add_readers(harness, caches);
+
+		harness.add("hot plug", 1, [](wutil::SoakThread& thread)
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			auto& monitors = fake::display.monitors;
+			if (monitors.size() == Max_Monitors || (monitors.size() > 1 && (thread.random() & 1)))
+				monitors.pop_back();
+			else
+				monitors.push_back(random_monitor(static_cast<int>(monitors.size()) + 1, thread));
+			return true;
+		});
+
+		harness.add("dpi change", 1, [](wutil::SoakThread& thread)
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			auto& monitors = fake::display.monitors;
+			monitors[thread.random() % monitors.size()].dpi = Dpis[thread.random() % 5];
+			return true;
+		});
+
+		harness.add("mode change", 1, [](wutil::SoakThread& thread)
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			auto& modes = fake::display.monitors[thread.random() % fake::display.monitors.size()].modes;
+			std::swap(modes[0], modes[1 + thread.random() % (modes.size() - 1)]);
+			return true;
+		});
+
+		auto report = harness.run(options);
+		report.print();
+		CHECK(report.passed());
+	}
+
+	void test_replayed_trace(const wutil::SoakHarness::Options& options)
+	{
+		auto primary = fake::make_monitor(1, { 0, 0, 2560, 1440 }, 144, true);
+		auto secondary = fake::make_monitor(2, { 2560, 0, 4480, 1080 }, 96);
+		fake::reset({ primary, secondary });
+		fake::display.windows = { { Window, 0 } };
+
+		wutil::Topology recorded;
+		wutil::DisplayTraceReplayer replayer;
+		{
+			wutil::DisplayTraceRecorder recorder;
+			recorded = wutil::get_topology();
+			wutil::get_all_refresh_timing(recorded.monitors);
+			wutil::get_dpi(Window);
+			for (auto dpi : Dpis)
+				wutil::SystemMetricsCache().non_client_metrics(dpi);
+			CHECK(replayer.load(recorder.log()));
+		}
+
+		fake::reset({});
+		replayer.install();
+
+		std::vector<wutil::SystemMetricsCache> caches(static_cast<size_t>(options.threads));
+		wutil::SoakHarness harness;
+		add_readers(harness, caches);
+		harness.add("same topology", 10, [&recorded](wutil::SoakThread&)
+		{
+			auto topology = wutil::get_topology();
+			return topology.ids == recorded.ids && topology.dpis == recorded.dpis;
+		});
+
+		auto report = harness.run(options);
+		replayer.uninstall();
+		report.print();
+
+		CHECK(report.passed());
+		CHECK(replayer.misses() == 0);
+		CHECK(fake::display.calls.total() == 0);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	wutil::SoakHarness::Options options;
+	options.duration = std::chrono::milliseconds(argc > 1 ? std::atoi(argv[1]) : 500);
+	options.threads = argc > 2 ? (std::max)(std::atoi(argv[2]), 1) : 8;
+	options.seed = argc > 3 ? static_cast<uint64_t>(std::atoll(argv[3])) : 1;
+	options.on_abort = [](const wutil::SoakReport& report) { report.print(stderr); };
+
+	fake::install();
+
+	test_fake_display_storm(options);
+	test_replayed_trace(options);
+
+	return test::test_result();
+}
@@ -0,0 +1,171 @@
+#include "display_trace.h"
+#include "mode_probe.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// record a workload against the simulated monitors, then replay it with the
+// monitors gone and compare results, including the display config,
+// SystemParametersInfo and registry calls
+//=============================================================================
+
+namespace
+{
+	const HWND Window = reinterpret_cast<HWND>(0x500);
+
+	struct Results
+	{
+		wutil::Topology topology;
+		std::vector<std::optional<wutil::RefreshTiming>> timings;
+		NONCLIENTMETRICS non_client = {};
+		ICONMETRICS icon = {};
+		UINT window_dpi = 0;
+	};
+
+	Results run_workload()
+	{
+		Results results;
+		results.topology = wutil::get_topology();
+		results.timings = wutil::get_all_refresh_timing(results.topology.monitors);
+
+		wutil::SystemMetricsCache cache;
+		results.non_client = cache.non_client_metrics(144);
+		results.icon = cache.icon_metrics(144);
+
+		results.window_dpi = wutil::get_dpi(Window);
+		return results;
+	}
+
+	bool same_results(const Results& a, const Results& b)
+	{
+		if (a.topology.monitors.size() != b.topology.monitors.size() || a.timings.size() != b.timings.size())
+			return false;
+
+		for (size_t i = 0; i < a.topology.monitors.size(); ++i)
+		{
+			if (std::memcmp(&a.topology.monitors[i], &b.topology.monitors[i], sizeof(MONITORINFOEX)) != 0 ||
+				a.topology.ids[i] != b.topology.ids[i] || a.topology.dpis[i] != b.topology.dpis[i] ||
+				a.topology.modes[i].size() != b.topology.modes[i].size())
+				return false;
+
+			if (a.timings[i].has_value() != b.timings[i].has_value() ||
+				(a.timings[i] && a.timings[i]->vsync_interval_ns != b.timings[i]->vsync_interval_ns))
+				return false;
+		}
+
+		return std::memcmp(&a.non_client, &b.non_client, sizeof(a.non_client)) == 0 &&
+			std::memcmp(&a.icon, &b.icon, sizeof(a.icon)) == 0 &&
+			a.window_dpi == b.window_dpi;
+	}
+
+	void install_monitors()
+	{
+		auto primary = fake::make_monitor(1, { 0, 0, 2560, 1440 }, 144, true);
+		auto secondary = fake::make_monitor(2, { 2560, 0, 4480, 1080 }, 96);
+		secondary.vsync = { 59940, 1000 };
+		fake::reset({ primary, secondary });
+		fake::display.windows = { { Window, 1 } };
+	}
+
+	void test_replay_matches_recording()
+	{
+		install_monitors();
+
+		Results recorded;
+		wutil::DisplayTraceReplayer replayer;
+		{
+			wutil::DisplayTraceRecorder recorder;
+			recorded = run_workload();
+			CHECK(recorder.record_count() > 0);
+			CHECK(replayer.load(recorder.log()));
+		}
+
+		CHECK(recorded.topology.monitors.size() == 2);
+		CHECK(recorded.timings.size() == 2 && recorded.timings[1].has_value());
+		CHECK(fake::display.calls.query_display_config > 0);
+		CHECK(fake::display.calls.display_config_get_device_info > 0);
+		CHECK(fake::display.calls.system_parameters_info_for_dpi > 0);
+
+		// nothing left to answer but the trace
+		fake::reset({});
+		replayer.install();
+		auto replayed = run_workload();
+		replayer.uninstall();
+
+		CHECK(same_results(recorded, replayed));
+		CHECK(replayer.misses() == 0);
+		CHECK(fake::display.calls.total() == 0);
+	}
+
+	void test_unknown_window_counts_as_miss()
+	{
+		install_monitors();
+
+		wutil::DisplayTraceReplayer replayer;
+		{
+			wutil::DisplayTraceRecorder recorder;
+			wutil::get_dpi(Window);
+			CHECK(replayer.load(recorder.log()));
+		}
+
+		replayer.install();
+		CHECK(wutil::get_dpi(Window) == 96);
+		CHECK(replayer.misses() == 0);
+
+		// answered with the recorded window's dpi, but still a miss
+		CHECK(wutil::get_dpi(reinterpret_cast<HWND>(0x600)) == 96);
+		CHECK(replayer.misses() == 1);
+
+		// display config was never recorded, so it fails like an unsupported system
+		MONITORINFOEX mi = {};
+		CHECK(!wutil::get_refresh_timing(mi));
+		CHECK(replayer.misses() == 2);
+		replayer.uninstall();
+	}
+
+	void test_registry_values_replay()
+	{
+		install_monitors();
+		fake::display.drivers = { { TEXT("31.0.15.3713"), TEXT("6-29-2023") } };
+		const TCHAR* Missing = TEXT("System\\CurrentControlSet\\Control\\Video\\{FAKE0009}\\0000");
+
+		uint64_t fingerprint = 0;
+		wutil::DisplayTraceReplayer replayer;
+		{
+			wutil::DisplayTraceRecorder recorder;
+			fingerprint = wutil::get_mode_probe_fingerprint(TEXT("\\\\.\\DISPLAY1"));
+			DWORD size = 0;
+			CHECK(wutil::detail::display_api.reg_get_value(HKEY_LOCAL_MACHINE, Missing, TEXT("DriverVersion"), RRF_RT_REG_SZ, NULL, NULL, &size) == ERROR_FILE_NOT_FOUND);
+			CHECK(replayer.load(recorder.log()));
+		}
+
+		CHECK(fingerprint != 0 && fake::display.calls.reg_get_value > 0);
+
+		// the driver version and date come from the trace, not the registry
+		fake::reset({});
+		replayer.install();
+		CHECK(wutil::get_mode_probe_fingerprint(TEXT("\\\\.\\DISPLAY1")) == fingerprint);
+
+		DWORD size = 0;
+		CHECK(wutil::detail::display_api.reg_get_value(HKEY_LOCAL_MACHINE, Missing, TEXT("DriverVersion"), RRF_RT_REG_SZ, NULL, NULL, &size) == ERROR_FILE_NOT_FOUND);
+		CHECK(replayer.misses() == 0);
+
+		// never recorded
+		CHECK(wutil::detail::display_api.reg_get_value(HKEY_LOCAL_MACHINE, Missing, TEXT("DriverDate"), RRF_RT_REG_SZ, NULL, NULL, &size) == ERROR_FILE_NOT_FOUND);
+		CHECK(replayer.misses() == 1);
+		replayer.uninstall();
+
+		CHECK(fake::display.calls.total() == 0);
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_replay_matches_recording();
+	test_unknown_window_counts_as_miss();
+	test_registry_values_replay();
+
+	return test::test_result();
+}
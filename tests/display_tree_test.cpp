@@ -0,0 +1,157 @@
+#include "display_tree.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// the adapter, source and monitor tree of simulated displays: sources of one
+// adapter grouped into one node, identical adapters and monitors told apart,
+// and monitor ids that do not depend on enumeration order
+//=============================================================================
+
+namespace
+{
+	// DISPLAY1 and DISPLAY2 on one adapter, DISPLAY3 on an identical second one
+	std::vector<fake::Monitor> two_adapters()
+	{
+		auto third = fake::make_monitor(3, { 4480, 0, 6400, 1080 });
+		third.adapter = 1;
+		return { fake::make_monitor(1, { 0, 0, 2560, 1440 }, 144, true), fake::make_monitor(2, { 2560, 0, 4480, 1080 }), third };
+	}
+
+	// two monitors of the same model reporting the same interface path, on connectors 1 and 2
+	std::vector<fake::Monitor> identical_monitors(bool reversed)
+	{
+		auto first = fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true);
+		auto second = fake::make_monitor(2, { 1920, 0, 3840, 1080 });
+		second.interface_path = first.interface_path;
+		if (reversed)
+			return { second, first };
+		return { first, second };
+	}
+
+	const wutil::MonitorNode* on_connector(const wutil::DisplayTree& tree, UINT32 connector)
+	{
+		for (const auto& monitor : tree.monitors())
+		{
+			if (monitor.has_connector && monitor.connector_instance == connector)
+				return &monitor;
+		}
+
+		return nullptr;
+	}
+
+	void test_sources_grouped_by_adapter()
+	{
+		fake::reset(two_adapters());
+		auto tree = wutil::get_display_tree();
+
+		CHECK(tree.sources().size() == 3);
+		CHECK(tree.monitors().size() == 3);
+		if (!CHECK(tree.adapters().size() == 2))
+			return;
+
+		const auto& first = tree.adapters()[0];
+		const auto& second = tree.adapters()[1];
+		CHECK(first.sources == std::vector<size_t>({ 0, 1 }) && first.monitors == std::vector<size_t>({ 0, 1 }));
+		CHECK(second.sources == std::vector<size_t>({ 2 }) && second.monitors == std::vector<size_t>({ 2 }));
+
+		// same pnp id, told apart by the video key
+		CHECK(first.id != second.id);
+		CHECK(tree.find_adapter(first.id) == &first);
+
+		// gdi names resolve to their source, adapter and monitor
+		CHECK(tree.find_adapter(TEXT("\\\\.\\DISPLAY2")) == &first);
+		CHECK(tree.find_adapter(TEXT("\\\\.\\DISPLAY3")) == &second);
+		CHECK(tree.find_source(TEXT("\\\\.\\DISPLAY2")) == &tree.sources()[1]);
+		CHECK(tree.find_adapter(TEXT("\\\\.\\DISPLAY9")) == nullptr);
+
+		auto monitor = tree.find_monitor(TEXT("\\\\.\\DISPLAY3"));
+		CHECK(monitor != nullptr && monitor->adapter == 1 && monitor->source == 2);
+		CHECK(monitor != nullptr && monitor->id == wutil::get_monitor_id(TEXT("\\\\.\\DISPLAY3")));
+		CHECK(monitor != nullptr && tree.find_monitor(monitor->id) == monitor);
+	}
+
+	void test_adapter_ids_are_stable()
+	{
+		fake::reset(two_adapters());
+		auto before = wutil::get_display_tree();
+
+		// unplugging the second monitor removes a source, not the adapter
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			fake::display.monitors.erase(fake::display.monitors.begin() + 1);
+		}
+		auto after = wutil::get_display_tree();
+
+		CHECK(after.adapters().size() == 2);
+		CHECK(after.adapters()[0].id == before.adapters()[0].id);
+		CHECK(after.adapters()[1].id == before.adapters()[1].id);
+	}
+
+	void test_distinct_monitors_skip_display_config()
+	{
+		fake::reset(two_adapters());
+		fake::display.calls = {};
+		auto tree = wutil::get_display_tree();
+
+		CHECK(fake::display.calls.query_display_config == 0);
+		CHECK(fake::display.calls.enum_display_devices == 4 + 3 * 2);
+		for (const auto& monitor : tree.monitors())
+			CHECK(!monitor.has_connector);
+	}
+
+	void test_identical_monitors_by_connector()
+	{
+		fake::reset(identical_monitors(false));
+		auto tree = wutil::get_display_tree();
+		CHECK(fake::display.calls.query_display_config == 1);
+
+		auto first = on_connector(tree, 1);
+		auto second = on_connector(tree, 2);
+		if (!CHECK(first && second))
+			return;
+
+		CHECK(first->id != second->id);
+		CHECK(first->output_technology == DISPLAYCONFIG_OUTPUT_TECHNOLOGY_HDMI);
+
+		// the same monitors enumerated the other way round keep their ids
+		fake::reset(identical_monitors(true));
+		auto reversed = wutil::get_display_tree();
+		auto reversed_first = on_connector(reversed, 1);
+		auto reversed_second = on_connector(reversed, 2);
+		if (!CHECK(reversed_first && reversed_second))
+			return;
+
+		CHECK(reversed_first->id == first->id);
+		CHECK(reversed_second->id == second->id);
+		CHECK(reversed.monitors()[0].id == second->id);
+	}
+
+	void test_identical_monitors_without_display_config()
+	{
+		fake::reset(identical_monitors(false));
+		auto saved = wutil::detail::display_api.query_display_config;
+		wutil::detail::display_api.query_display_config = nullptr;
+		auto tree = wutil::get_display_tree();
+		wutil::detail::display_api.query_display_config = saved;
+
+		// still unique, in enumeration order
+		CHECK(tree.monitors().size() == 2);
+		CHECK(tree.monitors()[0].id != tree.monitors()[1].id);
+		CHECK(tree.monitors()[0].id == wutil::get_monitor_id(TEXT("\\\\.\\DISPLAY1")));
+		CHECK(!tree.monitors()[0].has_connector && !tree.monitors()[1].has_connector);
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_sources_grouped_by_adapter();
+	test_adapter_ids_are_stable();
+	test_distinct_monitors_skip_display_config();
+	test_identical_monitors_by_connector();
+	test_identical_monitors_without_display_config();
+
+	return test::test_result();
+}
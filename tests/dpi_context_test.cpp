@@ -0,0 +1,183 @@
+#include "wutil.h"
+#include "check.h"
+
+//=============================================================================
+// thread dpi context calls against a fake user32 that counts every call.
+// the fake hands out its own thread context handles like user32 does, they
+// differ from the DPI_AWARENESS_CONTEXT_* pseudo handles
+//=============================================================================
+
+namespace
+{
+	struct FakeUser32
+	{
+		DPI_AWARENESS_CONTEXT thread_context = nullptr;
+		int set_calls = 0;
+		int get_calls = 0;
+		int awareness_calls = 0;
+	};
+
+	FakeUser32 fake;
+
+	const DPI_AWARENESS_CONTEXT Unaware_Handle = reinterpret_cast<DPI_AWARENESS_CONTEXT>(0x10);
+	const DPI_AWARENESS_CONTEXT System_Aware_Handle = reinterpret_cast<DPI_AWARENESS_CONTEXT>(0x11);
+	const DPI_AWARENESS_CONTEXT Per_Monitor_Handle = reinterpret_cast<DPI_AWARENESS_CONTEXT>(0x12);
+	const DPI_AWARENESS_CONTEXT Per_Monitor_V2_Handle = reinterpret_cast<DPI_AWARENESS_CONTEXT>(0x22);
+
+	DPI_AWARENESS_CONTEXT thread_handle_for(DPI_AWARENESS_CONTEXT context)
+	{
+		if (context == DPI_AWARENESS_CONTEXT_UNAWARE)
+			return Unaware_Handle;
+		if (context == DPI_AWARENESS_CONTEXT_SYSTEM_AWARE)
+			return System_Aware_Handle;
+		if (context == DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE)
+			return Per_Monitor_Handle;
+		if (context == DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2)
+			return Per_Monitor_V2_Handle;
+
+		// already a thread handle, e.g. a context being restored
+		return context;
+	}
+
+	DPI_AWARENESS_CONTEXT WINAPI fake_set_thread_dpi_awareness_context(DPI_AWARENESS_CONTEXT context)
+	{
+		++fake.set_calls;
+		auto previous = fake.thread_context;
+		fake.thread_context = thread_handle_for(context);
+		return previous;
+	}
+
+	DPI_AWARENESS_CONTEXT WINAPI fake_get_thread_dpi_awareness_context()
+	{
+		++fake.get_calls;
+		return fake.thread_context;
+	}
+
+	DPI_AWARENESS WINAPI fake_get_awareness_from_dpi_awareness_context(DPI_AWARENESS_CONTEXT context)
+	{
+		++fake.awareness_calls;
+		auto handle = thread_handle_for(context);
+		if (handle == Unaware_Handle)
+			return DPI_AWARENESS_UNAWARE;
+		if (handle == System_Aware_Handle)
+			return DPI_AWARENESS_SYSTEM_AWARE;
+		if (handle == Per_Monitor_Handle || handle == Per_Monitor_V2_Handle)
+			return DPI_AWARENESS_PER_MONITOR_AWARE;
+
+		return DPI_AWARENESS_INVALID;
+	}
+
+	void reset_fake(DPI_AWARENESS_CONTEXT thread_context)
+	{
+		fake = {};
+		fake.thread_context = thread_context;
+		wutil::invalidate_dpi_context_cache();
+	}
+
+	void install_fake()
+	{
+		// load first so the static symbol status does not overwrite the fakes later
+		wutil::detail::load_user32_symbols();
+		wutil::detail::set_thread_dpi_awareness_context = fake_set_thread_dpi_awareness_context;
+		wutil::detail::get_thread_dpi_awareness_context = fake_get_thread_dpi_awareness_context;
+		wutil::detail::get_awareness_from_dpi_awareness_context = fake_get_awareness_from_dpi_awareness_context;
+	}
+
+	void test_per_monitor_v2_is_per_monitor_aware()
+	{
+		reset_fake(Unaware_Handle);
+
+		wutil::ScopedDpiContext scoped(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+		CHECK(scoped.applied());
+		CHECK(wutil::is_per_monitor_dpi_aware());
+		CHECK(wutil::is_dpi_aware());
+		CHECK(!wutil::is_system_dpi_aware());
+		CHECK(!wutil::is_dpi_unaware());
+	}
+
+	void test_repeated_queries_only_read_the_thread()
+	{
+		reset_fake(System_Aware_Handle);
+
+		CHECK(wutil::is_system_dpi_aware());
+		CHECK(fake.awareness_calls == 1);
+
+		for (int i = 0; i < 100; ++i)
+		{
+			CHECK(wutil::is_system_dpi_aware());
+			CHECK(wutil::is_dpi_aware());
+		}
+
+		CHECK(fake.set_calls == 0);
+		CHECK(fake.awareness_calls == 1);
+		CHECK(fake.get_calls == 201);
+	}
+
+	void test_repeated_enable_skips_the_transition()
+	{
+		reset_fake(Unaware_Handle);
+
+		CHECK(wutil::enable_per_monitor_dpi_aware());
+		CHECK(fake.set_calls == 1);
+
+		for (int i = 0; i < 100; ++i)
+			CHECK(wutil::enable_per_monitor_dpi_aware());
+
+		CHECK(fake.set_calls == 1);
+		CHECK(wutil::is_per_monitor_dpi_aware());
+		CHECK(fake.awareness_calls == 1);
+	}
+
+	void test_change_outside_the_library_is_noticed()
+	{
+		reset_fake(Unaware_Handle);
+
+		CHECK(wutil::enable_per_monitor_dpi_aware());
+		CHECK(wutil::is_per_monitor_dpi_aware());
+
+		// e.g. a third party library calling SetThreadDpiAwarenessContext directly
+		fake_set_thread_dpi_awareness_context(DPI_AWARENESS_CONTEXT_SYSTEM_AWARE);
+		CHECK(wutil::is_system_dpi_aware());
+		CHECK(!wutil::is_per_monitor_dpi_aware());
+
+		// the cached request no longer matches the thread, so it is applied again
+		auto set_calls = fake.set_calls;
+		CHECK(wutil::enable_per_monitor_dpi_aware());
+		CHECK(fake.set_calls == set_calls + 1);
+		CHECK(wutil::is_per_monitor_dpi_aware());
+	}
+
+	void test_scoped_context_restores_previous()
+	{
+		reset_fake(System_Aware_Handle);
+
+		{
+			wutil::ScopedDpiContext scoped(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE);
+			CHECK(scoped.applied());
+			CHECK(wutil::is_per_monitor_dpi_aware());
+
+			// nested request for the current context costs no transition
+			auto set_calls = fake.set_calls;
+			wutil::ScopedDpiContext nested(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE);
+			CHECK(nested.applied());
+			CHECK(fake.set_calls == set_calls);
+		}
+
+		CHECK(fake.thread_context == System_Aware_Handle);
+		CHECK(wutil::is_system_dpi_aware());
+		CHECK(fake.set_calls == 2);
+	}
+}
+
+int main()
+{
+	install_fake();
+
+	test_per_monitor_v2_is_per_monitor_aware();
+	test_repeated_queries_only_read_the_thread();
+	test_repeated_enable_skips_the_transition();
+	test_change_outside_the_library_is_noticed();
+	test_scoped_context_restores_previous();
+
+	return test::test_result();
+}
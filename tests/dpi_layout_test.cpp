@@ -0,0 +1,143 @@
+#include "dpi_layout.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// DpiLayoutCache against scale_rect and scale_value after every kind of
+// update, pointers that survive a change of connected dpis, and lookups
+// outside the connected set counted as misses. the connected dpis come from
+// the simulated monitors
+//=============================================================================
+
+namespace
+{
+	bool same(const RECT& a, const RECT& b)
+	{
+		return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+	}
+
+	// every entry of every cached layout as scale_rect and scale_value give it
+	bool scaled_exactly(const wutil::DpiLayoutCache& cache, const std::vector<UINT>& dpis)
+	{
+		const auto& logical = cache.logical();
+		for (auto dpi : dpis)
+		{
+			auto layout = cache.find_layout(dpi);
+			if (layout == nullptr || layout->dpi != dpi || layout->rects.size() != logical.rects.size() ||
+				layout->metrics.size() != logical.metrics.size())
+				return false;
+
+			for (size_t i = 0; i < logical.rects.size(); ++i)
+			{
+				if (!same(layout->rects[i], wutil::scale_rect(logical.rects[i], dpi)))
+					return false;
+			}
+
+			for (size_t i = 0; i < logical.metrics.size(); ++i)
+			{
+				if (layout->metrics[i] != wutil::scale_value(logical.metrics[i], dpi))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	// odd sizes and negative coordinates so rounding shows
+	wutil::DpiLayoutCache make_cache()
+	{
+		return wutil::DpiLayoutCache({ { 0, 0, 100, 20 }, { -7, 3, 33, 17 }, { 11, 13, 211, 51 } }, { 1, 7, 13, 18, -5 });
+	}
+
+	void test_scaling_matches()
+	{
+		const std::vector<UINT> Dpis = { 96, 120, 144, 168, 192, 240 };
+		auto cache = make_cache();
+		cache.set_dpis(Dpis);
+		CHECK(cache.layout_count() == Dpis.size());
+		CHECK(scaled_exactly(cache, Dpis));
+
+		CHECK(cache.update_rect(1, { -13, -9, 57, 29 }));
+		CHECK(!cache.update_rect(3, { 0, 0, 1, 1 }));
+		CHECK(cache.update_metric(4, 3));
+		CHECK(!cache.update_metric(5, 3));
+		CHECK(scaled_exactly(cache, Dpis));
+
+		CHECK(cache.add_rect({ 5, 5, 6, 6 }) == 3);
+		CHECK(cache.add_metric(23) == 5);
+		CHECK(scaled_exactly(cache, Dpis));
+
+		cache.set_layout({ { 1, 1, 3, 3 } }, { 9, 10, 11 });
+		CHECK(cache.logical().rects.size() == 1 && cache.logical().metrics.size() == 3);
+		CHECK(scaled_exactly(cache, Dpis));
+
+		cache.set_layout({}, {});
+		CHECK(scaled_exactly(cache, Dpis));
+	}
+
+	void test_set_dpis_keeps_survivors()
+	{
+		auto cache = make_cache();
+		cache.set_dpis({ 144, 96, 192, 144 });
+		CHECK(cache.layout_count() == 3);
+
+		auto at_96 = cache.find_layout(96);
+		auto at_144 = cache.find_layout(144);
+		auto at_192 = cache.find_layout(192);
+		CHECK(at_96 != nullptr && at_144 != nullptr && at_192 != nullptr);
+
+		// 144 goes, 120 and 240 come
+		cache.set_dpis({ 240, 96, 120, 192 });
+		CHECK(cache.layout_count() == 4);
+		CHECK(cache.find_layout(96) == at_96 && cache.find_layout(192) == at_192);
+		CHECK(cache.find_layout(144) == nullptr);
+		CHECK(scaled_exactly(cache, { 96, 120, 192, 240 }));
+
+		// an update reaches the survivors through the pointers handed out before
+		CHECK(cache.update_metric(0, 10));
+		CHECK(at_96->metrics[0] == 10 && at_192->metrics[0] == 20);
+
+		cache.set_dpis(std::vector<UINT>());
+		CHECK(cache.layout_count() == 0 && cache.find_layout(96) == nullptr);
+	}
+
+	void test_lookups_outside_connected_set()
+	{
+		fake::reset({ fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true), fake::make_monitor(2, { 1920, 0, 4480, 1440 }, 144),
+			fake::make_monitor(3, { 4480, 0, 8320, 2160 }, 144) });
+
+		CHECK(wutil::get_connected_dpis() == std::vector<UINT>({ 96, 144 }));
+
+		auto cache = make_cache();
+		cache.refresh_dpis();
+		CHECK(cache.layout_count() == 2);
+
+		CHECK(cache.layout(96) == cache.find_layout(96) && cache.layout(144) == cache.find_layout(144));
+		CHECK(cache.hits() == 2 && cache.misses() == 0);
+
+		// computed on first use, a hit after that
+		CHECK(cache.find_layout(192) == nullptr);
+		auto at_192 = cache.layout(192);
+		CHECK(at_192 != nullptr && at_192->dpi == 192 && cache.misses() == 1);
+		CHECK(cache.layout(192) == at_192 && cache.hits() == 3 && cache.misses() == 1);
+		CHECK(cache.layout(72) != nullptr && cache.misses() == 2);
+		CHECK(scaled_exactly(cache, { 72, 96, 144, 192 }));
+
+		// a monitor at 192 connects, the layout computed on use is kept
+		fake::reset({ fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true), fake::make_monitor(2, { 1920, 0, 5760, 2160 }, 192) });
+		cache.refresh_dpis();
+		CHECK(cache.layout_count() == 2 && cache.find_layout(192) == at_192);
+		CHECK(cache.find_layout(144) == nullptr && cache.find_layout(72) == nullptr);
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_scaling_matches();
+	test_set_dpis_keeps_survivors();
+	test_lookups_outside_connected_set();
+
+	return test::test_result();
+}
@@ -0,0 +1,172 @@
+#include "drag_prewarm.h"
+#include "check.h"
+
+#include <chrono>
+#include <thread>
+
+//=============================================================================
+// DragPrewarmer against a backend whose font scaling blocks until the test
+// opens a gate, so prewarms can be caught still running: discarding must
+// not wait for them and every font they scaled must still be deleted
+//=============================================================================
+
+namespace
+{
+	struct Gate
+	{
+		std::mutex mutex;
+		std::condition_variable opened;
+		bool open = false;
+		std::atomic<int> created{ 0 };
+		std::atomic<int> deleted{ 0 };
+
+		void release()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				open = true;
+			}
+
+			opened.notify_all();
+		}
+	};
+
+	struct GatedBackend
+	{
+		Gate* gate = nullptr;
+
+		HFONT scale_font(HFONT, UINT) const
+		{
+			std::unique_lock<std::mutex> lock(gate->mutex);
+			gate->opened.wait(lock, [this] { return gate->open; });
+			return reinterpret_cast<HFONT>(static_cast<uintptr_t>(++gate->created));
+		}
+
+		void delete_font(HFONT) const { ++gate->deleted; }
+
+		std::vector<int> system_metrics(const std::vector<int>& indices, UINT dpi) const
+		{
+			return std::vector<int>(indices.size(), static_cast<int>(dpi));
+		}
+	};
+
+	using Prewarmer = wutil::BasicDragPrewarmer<GatedBackend>;
+
+	const HFONT Fonts[] = { reinterpret_cast<HFONT>(0x10), reinterpret_cast<HFONT>(0x20) };
+
+	std::vector<wutil::PrewarmMonitor> make_monitors()
+	{
+		return { { { 0, 0, 1000, 1000 }, 96 }, { { 1000, 0, 2000, 1000 }, 144 } };
+	}
+
+	// right towards the second monitor, far enough for the first move to predict it
+	bool start_prewarm(Prewarmer& prewarmer)
+	{
+		prewarmer.begin_drag({ 100, 100, 500, 400 }, 0);
+		return prewarmer.moving({ 200, 100, 600, 400 }, 10);
+	}
+
+	template <typename Done>
+	bool wait_until(Done done)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (!done())
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				return false;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return true;
+	}
+
+	void test_take()
+	{
+		Gate gate;
+		gate.open = true;
+		Prewarmer prewarmer({ std::begin(Fonts), std::end(Fonts) }, { { 0, 0, 10, 10 } }, { SM_CXBORDER }, 150, GatedBackend{ &gate });
+		prewarmer.set_monitors(make_monitors());
+		CHECK(start_prewarm(prewarmer) && prewarmer.prewarms() == 1);
+
+		// the same target again starts nothing
+		CHECK(!prewarmer.moving({ 300, 100, 700, 400 }, 20));
+
+		auto resources = prewarmer.take(144);
+		CHECK(resources.dpi == 144 && resources.fonts.size() == 2);
+		CHECK(resources.rects.size() == 1 && resources.rects[0].right == 15);
+		CHECK(resources.metrics == std::vector<int>({ 144 }));
+		CHECK(prewarmer.hits() == 1 && prewarmer.misses() == 0);
+
+		CHECK(prewarmer.take(192).fonts.size() == 2 && prewarmer.misses() == 1);
+	}
+
+	void test_discard_does_not_wait()
+	{
+		Gate gate;
+		Prewarmer prewarmer({ std::begin(Fonts), std::end(Fonts) }, {}, {}, 150, GatedBackend{ &gate });
+		prewarmer.set_monitors(make_monitors());
+		if (!CHECK(start_prewarm(prewarmer)))
+			return;
+
+		// the prewarm is stuck in scale_font, a blocking discard would never return
+		prewarmer.discard();
+		CHECK(gate.created == 0 && prewarmer.reaped() == 0);
+
+		// nothing pending anymore, the dpi change scales on the spot
+		gate.release();
+		CHECK(prewarmer.take(144).fonts.size() == 2 && prewarmer.misses() == 1);
+
+		CHECK(wait_until([&] { return prewarmer.reaped() == 1; }));
+		CHECK(gate.created == 4 && gate.deleted == 2);
+	}
+
+	void test_destruction_waits_for_reaper()
+	{
+		Gate gate;
+		std::thread opener;
+		{
+			Prewarmer prewarmer({ std::begin(Fonts), std::end(Fonts) }, {}, {}, 150, GatedBackend{ &gate });
+			prewarmer.set_monitors(make_monitors());
+			CHECK(start_prewarm(prewarmer));
+			CHECK(prewarmer.handle_message(NULL, WM_DISPLAYCHANGE, 0, 0));
+
+			opener = std::thread([&gate] {
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				gate.release();
+			});
+		}
+
+		opener.join();
+
+		CHECK(gate.created == 2 && gate.deleted == 2);
+	}
+
+	void test_monitors_without_dpis()
+	{
+		wutil::Topology topology;
+		topology.monitors.resize(2);
+		topology.monitors[0].rcMonitor = { 0, 0, 1920, 1080 };
+		topology.monitors[1].rcMonitor = { 1920, 0, 4480, 1440 };
+		topology.dpis = { 120 };
+
+		auto monitors = wutil::get_prewarm_monitors(topology);
+		if (CHECK(monitors.size() == 2))
+		{
+			CHECK(monitors[0].dpi == 120);
+			CHECK(monitors[1].dpi == 96 && monitors[1].rect.right == 4480);
+		}
+
+		CHECK(wutil::get_prewarm_monitors(wutil::Topology()).empty());
+	}
+}
+
+int main()
+{
+	test_take();
+	test_discard_does_not_wait();
+	test_destruction_waits_for_reaper();
+	test_monitors_without_dpis();
+
+	return test::test_result();
+}
@@ -0,0 +1,707 @@
+#ifndef WUTIL_TESTS_FAKE_DISPLAY_INCLUDED
+#define WUTIL_TESTS_FAKE_DISPLAY_INCLUDED
+
+#include "wutil.h"
+
+#include <cstring>
+#include <vector>
+#include <utility>
+#include <mutex>
+
+//=============================================================================
+// simulated monitors behind detail::display_api for the windows tests.
+// monitor handles, adapter ids and display config ids follow the index in
+// display.monitors and every call is counted. every fake holds mutex, so a
+// storm may change display from another thread while holding it
+//=============================================================================
+
+namespace fake
+{
+	struct Monitor
+	{
+		wutil::tstring device_name;
+		// device interface path, what monitor ids are hashed from
+		wutil::tstring interface_path;
+		RECT rect = {};
+		RECT work = {};
+		UINT dpi = 96;
+		bool primary = false;
+		// modes[0] is the current mode
+		std::vector<DEVMODE> modes;
+		DISPLAYCONFIG_RATIONAL vsync = { 60000, 1000 };
+		// without one the display config path only carries the refresh rational
+		bool has_target_mode = true;
+		// the adapter driving the monitor and the connector it is plugged into
+		int adapter = 0;
+		UINT32 connector = 0;
+		DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY output_technology = DISPLAYCONFIG_OUTPUT_TECHNOLOGY_HDMI;
+		// edid manufacturer and product code reported by display config, invalid when both are 0
+		UINT16 edid_manufacture_id = 0;
+		UINT16 edid_product_code_id = 0;
+	};
+
+	// DriverVersion and DriverDate of an adapter's video key, missing when empty
+	struct Driver
+	{
+		wutil::tstring version;
+		wutil::tstring date;
+	};
+
+	struct Calls
+	{
+		int enum_display_devices = 0;
+		int enum_display_monitors = 0;
+		int get_monitor_info = 0;
+		int enum_display_settings_ex = 0;
+		int change_display_settings_ex = 0;
+		int monitor_from_window = 0;
+		int monitor_from_rect = 0;
+		int monitor_from_point = 0;
+		int system_parameters_info = 0;
+		int system_parameters_info_for_dpi = 0;
+		int get_display_config_buffer_sizes = 0;
+		int query_display_config = 0;
+		int display_config_get_device_info = 0;
+		int get_dpi_for_window = 0;
+		int get_dpi_for_monitor = 0;
+		int reg_get_value = 0;
+
+		int total() const
+		{
+			return enum_display_devices + enum_display_monitors + get_monitor_info + enum_display_settings_ex +
+				change_display_settings_ex + monitor_from_window + monitor_from_rect + monitor_from_point +
+				system_parameters_info + system_parameters_info_for_dpi + get_display_config_buffer_sizes +
+				query_display_config + display_config_get_device_info + get_dpi_for_window + get_dpi_for_monitor +
+				reg_get_value;
+		}
+	};
+
+	struct ModeChange
+	{
+		wutil::tstring device_name;
+		bool has_mode = false;
+		DEVMODE mode = {};
+		DWORD flags = 0;
+	};
+
+	struct Display
+	{
+		std::vector<Monitor> monitors;
+		// windows and the index of the monitor they are on
+		std::vector<std::pair<HWND, size_t>> windows;
+		std::vector<ModeChange> mode_changes;
+		LONG change_result = DISP_CHANGE_SUCCESSFUL;
+		// display config calls fail with ERROR_INSUFFICIENT_BUFFER this many more times
+		int topology_changes_during_query = 0;
+		// indexed by Monitor::adapter
+		std::vector<Driver> drivers;
+		Calls calls;
+	};
+
+	inline Display display;
+	// recursive, enum_display_monitors calls back into the other fakes
+	inline std::recursive_mutex mutex;
+
+	inline DEVMODE make_mode(DWORD width, DWORD height, DWORD frequency, DWORD bits_per_pixel = 32)
+	{
+		DEVMODE dm = {};
+		dm.dmSize = sizeof(dm);
+		dm.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT | DM_BITSPERPEL | DM_DISPLAYFREQUENCY | DM_DISPLAYFLAGS;
+		dm.dmPelsWidth = width;
+		dm.dmPelsHeight = height;
+		dm.dmDisplayFrequency = frequency;
+		dm.dmBitsPerPel = bits_per_pixel;
+		return dm;
+	}
+
+	// DISPLAY<number> at rect, current mode is the rect size at 60hz
+	inline Monitor make_monitor(int number, RECT rect, UINT dpi = 96, bool primary = false)
+	{
+		Monitor monitor;
+		monitor.device_name = TEXT("\\\\.\\DISPLAY") + wutil::tstring(1, static_cast<TCHAR>(TEXT('0') + number));
+		monitor.interface_path = TEXT("\\\\?\\DISPLAY#FAKE000") + wutil::tstring(1, static_cast<TCHAR>(TEXT('0') + number)) + TEXT("#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}");
+		monitor.rect = rect;
+		monitor.work = rect;
+		monitor.work.bottom -= 40;
+		monitor.dpi = dpi;
+		monitor.primary = primary;
+		monitor.connector = static_cast<UINT32>(number);
+
+		auto width = static_cast<DWORD>(rect.right - rect.left);
+		auto height = static_cast<DWORD>(rect.bottom - rect.top);
+		monitor.modes = { make_mode(width, height, 60), make_mode(1280, 720, 60), make_mode(width, height, 30) };
+		monitor.modes[0].dmFields |= DM_POSITION;
+		monitor.modes[0].dmPosition = { rect.left, rect.top };
+		return monitor;
+	}
+
+	inline HMONITOR handle_of(size_t index)
+	{
+		return reinterpret_cast<HMONITOR>(static_cast<uintptr_t>(index + 1));
+	}
+
+	inline Monitor* monitor_of(HMONITOR hmonitor)
+	{
+		auto index = reinterpret_cast<uintptr_t>(hmonitor);
+		if (index == 0 || index > display.monitors.size())
+			return nullptr;
+
+		return &display.monitors[index - 1];
+	}
+
+	inline Monitor* monitor_named(LPCTSTR name)
+	{
+		for (auto& monitor : display.monitors)
+		{
+			if (name != nullptr && monitor.device_name == name)
+				return &monitor;
+		}
+
+		return nullptr;
+	}
+
+	inline HMONITOR fallback_monitor(DWORD flags)
+	{
+		if (flags == MONITOR_DEFAULTTONULL)
+			return NULL;
+
+		for (size_t i = 0; i < display.monitors.size(); ++i)
+		{
+			if (display.monitors[i].primary)
+				return handle_of(i);
+		}
+
+		return display.monitors.empty() ? NULL : handle_of(0);
+	}
+
+	inline LONG squared_distance(const RECT& rect, POINT point)
+	{
+		LONG dx = point.x < rect.left ? rect.left - point.x : (point.x >= rect.right ? point.x - rect.right + 1 : 0);
+		LONG dy = point.y < rect.top ? rect.top - point.y : (point.y >= rect.bottom ? point.y - rect.bottom + 1 : 0);
+		return dx * dx + dy * dy;
+	}
+
+	inline HMONITOR nearest_monitor(POINT point, DWORD flags)
+	{
+		size_t best = SIZE_MAX;
+		LONG best_distance = 0;
+		for (size_t i = 0; i < display.monitors.size(); ++i)
+		{
+			auto distance = squared_distance(display.monitors[i].rect, point);
+			if (distance == 0)
+				return handle_of(i);
+
+			if (best == SIZE_MAX || distance < best_distance)
+			{
+				best = i;
+				best_distance = distance;
+			}
+		}
+
+		if (flags != MONITOR_DEFAULTTONEAREST || best == SIZE_MAX)
+			return fallback_monitor(flags);
+
+		return handle_of(best);
+	}
+
+	// appends to a terminated buffer without allocating, allocation budget
+	// tests count what the fakes allocate along with the code under test
+	inline void append(TCHAR* out, size_t capacity, const TCHAR* text)
+	{
+		size_t length = 0;
+		while (length + 1 < capacity && out[length] != 0)
+			++length;
+		while (length + 1 < capacity && *text != 0)
+			out[length++] = *text++;
+
+		out[length] = 0;
+	}
+
+	inline BOOL WINAPI enum_display_devices(LPCTSTR device, DWORD index, DISPLAY_DEVICE* dd, DWORD flags)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.enum_display_devices;
+		auto cb = dd->cb;
+		*dd = {};
+		dd->cb = cb;
+
+		// adapters, one per monitor
+		if (device == nullptr)
+		{
+			if (index >= display.monitors.size())
+				return FALSE;
+
+			// sources of one adapter share its video key and differ in the last component
+			const auto& monitor = display.monitors[index];
+			int source = 0;
+			for (size_t i = 0; i < index; ++i)
+				source += display.monitors[i].adapter == monitor.adapter ? 1 : 0;
+
+			const TCHAR adapter[] = { static_cast<TCHAR>(TEXT('0') + monitor.adapter), 0 };
+			const TCHAR number[] = { static_cast<TCHAR>(TEXT('0') + source), 0 };
+			append(dd->DeviceKey, 128, TEXT("\\Registry\\Machine\\System\\CurrentControlSet\\Control\\Video\\{FAKE000"));
+			append(dd->DeviceKey, 128, adapter);
+			append(dd->DeviceKey, 128, TEXT("}\\000"));
+			append(dd->DeviceKey, 128, number);
+			lstrcpyn(dd->DeviceName, monitor.device_name.c_str(), 32);
+			lstrcpyn(dd->DeviceString, TEXT("Fake Display Adapter"), 128);
+			lstrcpyn(dd->DeviceID, TEXT("PCI\\VEN_FAKE&DEV_0001"), 128);
+			dd->StateFlags = DISPLAY_DEVICE_ATTACHED_TO_DESKTOP | (monitor.primary ? DISPLAY_DEVICE_PRIMARY_DEVICE : 0);
+			return TRUE;
+		}
+
+		// the monitor attached to an adapter
+		auto monitor = monitor_named(device);
+		if (monitor == nullptr || index > 0)
+			return FALSE;
+
+		append(dd->DeviceName, 32, monitor->device_name.c_str());
+		append(dd->DeviceName, 32, TEXT("\\Monitor0"));
+		lstrcpyn(dd->DeviceString, TEXT("Fake Monitor"), 128);
+		lstrcpyn(dd->DeviceID, (flags & EDD_GET_DEVICE_INTERFACE_NAME) ? monitor->interface_path.c_str() : TEXT("MONITOR\\FAKE0001"), 128);
+		dd->StateFlags = DISPLAY_DEVICE_ACTIVE | DISPLAY_DEVICE_ATTACHED_TO_DESKTOP;
+		return TRUE;
+	}
+
+	inline BOOL WINAPI enum_display_monitors(HDC hdc, LPCRECT, MONITORENUMPROC proc, LPARAM data)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.enum_display_monitors;
+		for (size_t i = 0; i < display.monitors.size(); ++i)
+		{
+			auto rect = display.monitors[i].rect;
+			if (!proc(handle_of(i), hdc, &rect, data))
+				break;
+		}
+
+		return TRUE;
+	}
+
+	inline BOOL WINAPI get_monitor_info(HMONITOR hmonitor, LPMONITORINFO mi)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.get_monitor_info;
+		auto monitor = monitor_of(hmonitor);
+		if (monitor == nullptr)
+			return FALSE;
+
+		mi->rcMonitor = monitor->rect;
+		mi->rcWork = monitor->work;
+		mi->dwFlags = monitor->primary ? MONITORINFOF_PRIMARY : 0;
+		if (mi->cbSize >= sizeof(MONITORINFOEX))
+			lstrcpyn(reinterpret_cast<MONITORINFOEX*>(mi)->szDevice, monitor->device_name.c_str(), CCHDEVICENAME);
+		return TRUE;
+	}
+
+	inline BOOL WINAPI enum_display_settings_ex(LPCTSTR device, DWORD index, DEVMODE* dm, DWORD)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.enum_display_settings_ex;
+		auto monitor = monitor_named(device);
+		if (monitor == nullptr || monitor->modes.empty())
+			return FALSE;
+
+		if (index == ENUM_CURRENT_SETTINGS)
+			index = 0;
+		if (index >= monitor->modes.size())
+			return FALSE;
+
+		*dm = monitor->modes[index];
+		lstrcpyn(dm->dmDeviceName, monitor->device_name.c_str(), CCHDEVICENAME);
+		return TRUE;
+	}
+
+	inline LONG WINAPI change_display_settings_ex(LPCTSTR device, DEVMODE* dm, HWND, DWORD flags, LPVOID)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.change_display_settings_ex;
+		ModeChange change;
+		change.device_name = device != nullptr ? device : TEXT("");
+		change.has_mode = dm != nullptr;
+		if (dm != nullptr)
+			change.mode = *dm;
+		change.flags = flags;
+		display.mode_changes.push_back(change);
+		return display.change_result;
+	}
+
+	inline HMONITOR WINAPI monitor_from_window(HWND hwnd, DWORD flags)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.monitor_from_window;
+		for (const auto& window : display.windows)
+		{
+			if (window.first == hwnd && window.second < display.monitors.size())
+				return handle_of(window.second);
+		}
+
+		return fallback_monitor(flags);
+	}
+
+	inline HMONITOR WINAPI monitor_from_rect(LPCRECT rect, DWORD flags)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.monitor_from_rect;
+		size_t best = SIZE_MAX;
+		LONG best_area = 0;
+		for (size_t i = 0; i < display.monitors.size(); ++i)
+		{
+			const auto& m = display.monitors[i].rect;
+			LONG width = (std::min)(rect->right, m.right) - (std::max)(rect->left, m.left);
+			LONG height = (std::min)(rect->bottom, m.bottom) - (std::max)(rect->top, m.top);
+			if (width > 0 && height > 0 && width * height > best_area)
+			{
+				best = i;
+				best_area = width * height;
+			}
+		}
+
+		if (best != SIZE_MAX)
+			return handle_of(best);
+
+		return nearest_monitor(POINT{ (rect->left + rect->right) / 2, (rect->top + rect->bottom) / 2 }, flags);
+	}
+
+	inline HMONITOR WINAPI monitor_from_point(POINT point, DWORD flags)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.monitor_from_point;
+		return nearest_monitor(point, flags);
+	}
+
+	template <typename LogFont>
+	void fill_font(LogFont& font, UINT dpi)
+	{
+		using Char = std::remove_extent_t<decltype(LogFont::lfFaceName)>;
+		const char* Face = "Segoe UI";
+		font = {};
+		font.lfHeight = -MulDiv(12, dpi, 96);
+		font.lfWeight = 400;
+		for (size_t i = 0; Face[i] != 0; ++i)
+			font.lfFaceName[i] = static_cast<Char>(Face[i]);
+	}
+
+	//=========================================================================
+	// metrics of the 96 dpi system scaled to dpi. SystemParametersInfo takes
+	// the TCHAR structs, SystemParametersInfoForDpi only the W ones, and a
+	// size that does not match fails like it does on windows
+	//=========================================================================
+	template <typename NonClientMetrics, typename IconMetrics, typename LogFont>
+	BOOL fill_system_parameters(UINT action, UINT ui_param, PVOID pv_param, UINT dpi)
+	{
+		switch (action)
+		{
+		case SPI_GETNONCLIENTMETRICS:
+		{
+			auto ncm = static_cast<NonClientMetrics*>(pv_param);
+			if (ui_param != sizeof(NonClientMetrics) || ncm->cbSize != sizeof(NonClientMetrics))
+				return FALSE;
+
+			*ncm = {};
+			ncm->cbSize = sizeof(NonClientMetrics);
+			ncm->iBorderWidth = MulDiv(1, dpi, 96);
+			ncm->iCaptionHeight = MulDiv(23, dpi, 96);
+			ncm->iCaptionWidth = MulDiv(36, dpi, 96);
+			ncm->iMenuHeight = MulDiv(19, dpi, 96);
+			ncm->iPaddedBorderWidth = MulDiv(4, dpi, 96);
+			fill_font(ncm->lfCaptionFont, dpi);
+			return TRUE;
+		}
+		case SPI_GETICONMETRICS:
+		{
+			auto im = static_cast<IconMetrics*>(pv_param);
+			if (ui_param != sizeof(IconMetrics) || im->cbSize != sizeof(IconMetrics))
+				return FALSE;
+
+			*im = {};
+			im->cbSize = sizeof(IconMetrics);
+			im->iHorzSpacing = MulDiv(75, dpi, 96);
+			im->iVertSpacing = MulDiv(75, dpi, 96);
+			fill_font(im->lfFont, dpi);
+			return TRUE;
+		}
+		case SPI_GETICONTITLELOGFONT:
+		{
+			if (ui_param != sizeof(LogFont))
+				return FALSE;
+
+			fill_font(*static_cast<LogFont*>(pv_param), dpi);
+			return TRUE;
+		}
+		default:
+			return FALSE;
+		}
+	}
+
+	inline BOOL WINAPI system_parameters_info(UINT action, UINT ui_param, PVOID pv_param, UINT)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.system_parameters_info;
+		return fill_system_parameters<NONCLIENTMETRICS, ICONMETRICS, LOGFONT>(action, ui_param, pv_param, 96);
+	}
+
+	inline BOOL WINAPI system_parameters_info_for_dpi(UINT action, UINT ui_param, PVOID pv_param, UINT, UINT dpi)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.system_parameters_info_for_dpi;
+		return fill_system_parameters<NONCLIENTMETRICSW, ICONMETRICSW, LOGFONTW>(action, ui_param, pv_param, dpi);
+	}
+
+	//=========================================================================
+	// RegGetValue of the adapter video keys enum_display_devices hands out,
+	// System\CurrentControlSet\Control\Video\{FAKE000<adapter>}\000<n>
+	// under HKEY_LOCAL_MACHINE, answered from display.drivers
+	//=========================================================================
+	inline LONG WINAPI reg_get_value(HKEY key, LPCTSTR subkey, LPCTSTR value, DWORD, LPDWORD type, PVOID data, LPDWORD size)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.reg_get_value;
+
+		wutil::tstring_view path = subkey ? subkey : TEXT("");
+		wutil::tstring_view prefix = TEXT("System\\CurrentControlSet\\Control\\Video\\{FAKE000");
+		if (key != HKEY_LOCAL_MACHINE || path.substr(0, prefix.size()) != prefix || path.size() <= prefix.size())
+			return ERROR_FILE_NOT_FOUND;
+
+		auto adapter = static_cast<size_t>(path[prefix.size()] - TEXT('0'));
+		if (adapter >= display.drivers.size())
+			return ERROR_FILE_NOT_FOUND;
+
+		const auto& driver = display.drivers[adapter];
+		const auto& text = wutil::tstring_view(value) == TEXT("DriverVersion") ? driver.version :
+			wutil::tstring_view(value) == TEXT("DriverDate") ? driver.date : wutil::tstring();
+		if (text.empty())
+			return ERROR_FILE_NOT_FOUND;
+
+		auto needed = static_cast<DWORD>((text.size() + 1) * sizeof(TCHAR));
+		if (type)
+			*type = REG_SZ;
+		if (data == nullptr)
+		{
+			*size = needed;
+			return ERROR_SUCCESS;
+		}
+		if (*size < needed)
+		{
+			*size = needed;
+			return ERROR_MORE_DATA;
+		}
+
+		std::memcpy(data, text.c_str(), needed);
+		*size = needed;
+		return ERROR_SUCCESS;
+	}
+
+	//=========================================================================
+	// GetSystemMetricsForDpi of a default theme, the frame and caption
+	// metrics scale from their 96 dpi values. not behind display_api, so
+	// not counted and not seen by traces
+	//=========================================================================
+	inline int WINAPI get_system_metrics_for_dpi(int index, UINT dpi)
+	{
+		int value = 0;
+		switch (index)
+		{
+		case SM_CXBORDER:
+		case SM_CYBORDER:
+			value = 1;
+			break;
+		case SM_CXFRAME:
+		case SM_CYFRAME:
+		case SM_CXPADDEDBORDER:
+			value = 4;
+			break;
+		case SM_CYCAPTION:
+			value = 23;
+			break;
+		case SM_CXSIZE:
+			value = 36;
+			break;
+		case SM_CYSIZE:
+			value = 22;
+			break;
+		case SM_CXSMICON:
+		case SM_CYSMICON:
+			value = 16;
+			break;
+		case SM_CXICON:
+		case SM_CYICON:
+			value = 32;
+			break;
+		}
+
+		return MulDiv(value, static_cast<int>(dpi), 96);
+	}
+
+	// one path per monitor, its source mode at 2 * index and target mode after it
+	inline LONG WINAPI get_display_config_buffer_sizes(UINT32, UINT32* path_count, UINT32* mode_count)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.get_display_config_buffer_sizes;
+		*path_count = static_cast<UINT32>(display.monitors.size());
+		*mode_count = static_cast<UINT32>(display.monitors.size() * 2);
+		return ERROR_SUCCESS;
+	}
+
+	inline LONG WINAPI query_display_config(UINT32, UINT32* path_count, DISPLAYCONFIG_PATH_INFO* paths,
+		UINT32* mode_count, DISPLAYCONFIG_MODE_INFO* modes, DISPLAYCONFIG_TOPOLOGY_ID*)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.query_display_config;
+		auto count = static_cast<UINT32>(display.monitors.size());
+		if (display.topology_changes_during_query > 0)
+		{
+			--display.topology_changes_during_query;
+			return ERROR_INSUFFICIENT_BUFFER;
+		}
+		if (*path_count < count || *mode_count < count * 2)
+			return ERROR_INSUFFICIENT_BUFFER;
+
+		for (UINT32 i = 0; i < count; ++i)
+		{
+			const auto& monitor = display.monitors[i];
+			const auto& current = monitor.modes.empty() ? DEVMODE{} : monitor.modes[0];
+			LUID adapter = { static_cast<DWORD>(1 + monitor.adapter), 0 };
+
+			paths[i] = {};
+			paths[i].sourceInfo.adapterId = adapter;
+			paths[i].sourceInfo.id = i;
+			paths[i].sourceInfo.modeInfoIdx = i * 2;
+			paths[i].targetInfo.adapterId = adapter;
+			paths[i].targetInfo.id = 0x100 + i;
+			paths[i].targetInfo.modeInfoIdx = monitor.has_target_mode ? i * 2 + 1 : DISPLAYCONFIG_PATH_MODE_IDX_INVALID;
+			paths[i].targetInfo.refreshRate = monitor.vsync;
+			paths[i].targetInfo.targetAvailable = TRUE;
+
+			auto& source = modes[i * 2];
+			source = {};
+			source.infoType = DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE;
+			source.id = i;
+			source.adapterId = adapter;
+			source.sourceMode.width = static_cast<UINT32>(current.dmPelsWidth);
+			source.sourceMode.height = static_cast<UINT32>(current.dmPelsHeight);
+			source.sourceMode.position = { monitor.rect.left, monitor.rect.top };
+
+			auto& target = modes[i * 2 + 1];
+			target = {};
+			target.infoType = DISPLAYCONFIG_MODE_INFO_TYPE_TARGET;
+			target.id = 0x100 + i;
+			target.adapterId = adapter;
+			auto& signal = target.targetMode.targetVideoSignalInfo;
+			signal.vSyncFreq = monitor.vsync;
+			auto width = static_cast<UINT32>(current.dmPelsWidth);
+			auto height = static_cast<UINT32>(current.dmPelsHeight);
+			signal.activeSize = { width, height };
+			signal.totalSize = { width + 160, height + 45 };
+			signal.hSyncFreq = { static_cast<UINT32>(static_cast<UINT64>(monitor.vsync.Numerator) * signal.totalSize.cy), monitor.vsync.Denominator };
+			signal.pixelRate = static_cast<UINT64>(monitor.vsync.Numerator) * signal.totalSize.cx * signal.totalSize.cy / (std::max)(monitor.vsync.Denominator, 1u);
+			signal.scanLineOrdering = DISPLAYCONFIG_SCANLINE_ORDERING_PROGRESSIVE;
+		}
+
+		*path_count = count;
+		*mode_count = count * 2;
+		return ERROR_SUCCESS;
+	}
+
+	inline LONG WINAPI display_config_get_device_info(DISPLAYCONFIG_DEVICE_INFO_HEADER* header)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.display_config_get_device_info;
+		if (header->type == DISPLAYCONFIG_DEVICE_INFO_GET_TARGET_NAME && header->size >= sizeof(DISPLAYCONFIG_TARGET_DEVICE_NAME))
+		{
+			auto index = header->id - 0x100;
+			if (header->id < 0x100 || index >= display.monitors.size())
+				return ERROR_GEN_FAILURE;
+
+			auto target_name = reinterpret_cast<DISPLAYCONFIG_TARGET_DEVICE_NAME*>(header);
+			const auto& monitor = display.monitors[index];
+			target_name->outputTechnology = monitor.output_technology;
+			target_name->connectorInstance = monitor.connector;
+			target_name->flags.edidIdsValid = monitor.edid_manufacture_id != 0 || monitor.edid_product_code_id != 0;
+			target_name->edidManufactureId = monitor.edid_manufacture_id;
+			target_name->edidProductCodeId = monitor.edid_product_code_id;
+			size_t i = 0;
+			for (; i < monitor.interface_path.size() && i + 1 < 128; ++i)
+				target_name->monitorDevicePath[i] = static_cast<WCHAR>(monitor.interface_path[i]);
+			target_name->monitorDevicePath[i] = 0;
+			return ERROR_SUCCESS;
+		}
+
+		if (header->type != DISPLAYCONFIG_DEVICE_INFO_GET_SOURCE_NAME || header->size < sizeof(DISPLAYCONFIG_SOURCE_DEVICE_NAME))
+			return ERROR_NOT_SUPPORTED;
+		if (header->id >= display.monitors.size())
+			return ERROR_GEN_FAILURE;
+
+		// gdi names are reported in utf-16 whatever the character set, a
+		// name of CCHDEVICENAME characters fills the array unterminated
+		auto source_name = reinterpret_cast<DISPLAYCONFIG_SOURCE_DEVICE_NAME*>(header);
+		const auto& name = display.monitors[header->id].device_name;
+		size_t i = 0;
+		for (; i < name.size() && i < CCHDEVICENAME; ++i)
+			source_name->viewGdiDeviceName[i] = static_cast<WCHAR>(name[i]);
+		if (i < CCHDEVICENAME)
+			source_name->viewGdiDeviceName[i] = 0;
+		return ERROR_SUCCESS;
+	}
+
+	inline UINT WINAPI get_dpi_for_window(HWND hwnd)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.get_dpi_for_window;
+		for (const auto& window : display.windows)
+		{
+			if (window.first == hwnd && window.second < display.monitors.size())
+				return display.monitors[window.second].dpi;
+		}
+
+		return 96;
+	}
+
+	inline HRESULT WINAPI get_dpi_for_monitor(HMONITOR hmonitor, MONITOR_DPI_TYPE, UINT* dpi_x, UINT* dpi_y)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		++display.calls.get_dpi_for_monitor;
+		auto monitor = monitor_of(hmonitor);
+		if (monitor == nullptr)
+			return E_INVALIDARG;
+
+		*dpi_x = monitor->dpi;
+		*dpi_y = monitor->dpi;
+		return S_OK;
+	}
+
+	// monitors replace the simulated ones, call counts and mode changes restart
+	inline void reset(std::vector<Monitor> monitors)
+	{
+		std::lock_guard<std::recursive_mutex> lock(mutex);
+		display = {};
+		display.monitors = std::move(monitors);
+	}
+
+	inline void install()
+	{
+		// load first so the static symbol status does not overwrite the fakes later
+		wutil::detail::load_user32_symbols();
+		wutil::detail::load_shcore_symbols();
+
+		auto& api = wutil::detail::display_api;
+		api.enum_display_devices = enum_display_devices;
+		api.enum_display_monitors = enum_display_monitors;
+		api.get_monitor_info = get_monitor_info;
+		api.enum_display_settings_ex = enum_display_settings_ex;
+		api.change_display_settings_ex = change_display_settings_ex;
+		api.monitor_from_window = monitor_from_window;
+		api.monitor_from_rect = monitor_from_rect;
+		api.monitor_from_point = monitor_from_point;
+		api.system_parameters_info = system_parameters_info;
+		api.reg_get_value = reg_get_value;
+		api.system_parameters_info_for_dpi = system_parameters_info_for_dpi;
+		api.get_display_config_buffer_sizes = get_display_config_buffer_sizes;
+		api.query_display_config = query_display_config;
+		api.display_config_get_device_info = display_config_get_device_info;
+		wutil::detail::get_dpi_for_window = get_dpi_for_window;
+		wutil::detail::get_dpi_for_monitor = get_dpi_for_monitor;
+		wutil::detail::get_system_metrics_for_dpi = get_system_metrics_for_dpi;
+	}
+}
+
+#endif
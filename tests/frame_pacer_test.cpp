@@ -0,0 +1,212 @@
+#include "frame_pacer.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// frame pacing on a simulated clock against simulated monitors: deadlines,
+// sleep overshoot, missed frames, retargeting between monitors of different
+// refresh rates and the split between sleeping and spinning
+//=============================================================================
+
+namespace
+{
+	// time only moves when the pacer sleeps or spins. sleeps overshoot by
+	// oversleep, like a scheduler waking the thread late
+	struct SimulatedClock
+	{
+		struct State
+		{
+			std::chrono::nanoseconds now{ 1000000000 };
+			std::chrono::nanoseconds oversleep{ 0 };
+			std::chrono::nanoseconds spin_step{ 1000 };
+			int sleeps = 0;
+			int spins = 0;
+		};
+
+		using duration = std::chrono::nanoseconds;
+		using time_point = std::chrono::steady_clock::time_point;
+
+		State* state = nullptr;
+
+		time_point now() const { return time_point(state->now); }
+
+		void sleep_for(duration d) const
+		{
+			++state->sleeps;
+			state->now += d + state->oversleep;
+		}
+
+		void spin() const
+		{
+			++state->spins;
+			state->now += state->spin_step;
+		}
+
+		void advance(duration d) const { state->now += d; }
+	};
+
+	using Pacer = wutil::BasicFramePacer<SimulatedClock>;
+
+	const HWND Window = reinterpret_cast<HWND>(0x100);
+	const std::chrono::nanoseconds Interval_60{ 16666667 };
+	const std::chrono::nanoseconds Interval_144{ 6944444 };
+
+	void install_monitors()
+	{
+		auto second = fake::make_monitor(2, { 2560, 0, 4480, 1080 });
+		second.vsync = { 144000, 1000 };
+		fake::reset({ fake::make_monitor(1, { 0, 0, 2560, 1440 }, 96, true), second });
+		fake::display.windows = { { Window, 0 } };
+	}
+
+	void move_window(size_t monitor)
+	{
+		fake::display.windows = { { Window, monitor } };
+	}
+
+	void test_initial_target_is_not_a_retarget()
+	{
+		install_monitors();
+		SimulatedClock::State state;
+		Pacer pacer(Window, SimulatedClock{ &state });
+
+		CHECK(pacer.monitor() == fake::handle_of(0));
+		CHECK(pacer.frame_interval() == Interval_60);
+		CHECK(pacer.stats().retargets == 0);
+		CHECK(!pacer.update_monitor());
+		CHECK(pacer.stats().retargets == 0);
+	}
+
+	void test_steady_frames()
+	{
+		install_monitors();
+		SimulatedClock::State state;
+		Pacer pacer(Window, SimulatedClock{ &state });
+
+		auto start = SimulatedClock{ &state }.now();
+		for (int i = 0; i < 100; ++i)
+		{
+			auto lateness = pacer.wait();
+			CHECK(lateness >= std::chrono::nanoseconds(0) && lateness < state.spin_step);
+		}
+
+		// deadlines stay on the grid of the first one, rounding does not accumulate
+		CHECK(pacer.next_deadline() == start + Interval_60 * 101);
+		CHECK(pacer.stats().frames == 100 && pacer.stats().missed_frames == 0);
+		CHECK(pacer.stats().max_jitter < state.spin_step);
+
+		// each frame sleeps once up to the slack then spins the rest of it
+		CHECK(state.sleeps == 100);
+		CHECK(state.spins >= 100 * 2000 && state.spins <= 100 * 2001);
+		CHECK(pacer.stats().cpu_usage() > 0.11 && pacer.stats().cpu_usage() < 0.13);
+	}
+
+	void test_oversleep_past_the_deadline()
+	{
+		install_monitors();
+		SimulatedClock::State state;
+		state.oversleep = std::chrono::milliseconds(3);
+		Pacer pacer(Window, SimulatedClock{ &state });
+
+		// a scheduler waking 3ms late blows through 2ms of slack, 1ms late and no spinning
+		auto lateness = pacer.wait();
+		CHECK(lateness == std::chrono::milliseconds(1));
+		CHECK(state.spins == 0);
+		CHECK(pacer.stats().missed_frames == 0);
+
+		// more slack absorbs it
+		pacer.set_slack(std::chrono::milliseconds(4));
+		state.spins = 0;
+		lateness = pacer.wait();
+		CHECK(lateness < state.spin_step);
+		CHECK(state.spins > 0);
+	}
+
+	void test_missed_frames_are_skipped()
+	{
+		install_monitors();
+		SimulatedClock::State state;
+		SimulatedClock clock{ &state };
+		Pacer pacer(Window, clock);
+
+		pacer.wait();
+		auto deadline = pacer.next_deadline();
+
+		// the frame took three and a half intervals
+		clock.advance(Interval_60 * 3 + Interval_60 / 2);
+		auto lateness = pacer.wait();
+		CHECK(lateness == Interval_60 * 2 + Interval_60 / 2);
+		CHECK(pacer.stats().missed_frames == 2);
+
+		// the next deadline is the next one on the grid, not a burst of catch up frames
+		CHECK(pacer.next_deadline() == deadline + Interval_60 * 3);
+		lateness = pacer.wait();
+		CHECK(lateness < state.spin_step);
+		CHECK(pacer.stats().missed_frames == 2);
+	}
+
+	void test_retarget_to_another_refresh()
+	{
+		install_monitors();
+		SimulatedClock::State state;
+		Pacer pacer(Window, SimulatedClock{ &state });
+
+		pacer.wait();
+		auto frame_start = pacer.next_deadline() - Interval_60;
+
+		// wait notices the move, the frame in flight keeps its phase
+		move_window(1);
+		pacer.wait();
+		CHECK(pacer.monitor() == fake::handle_of(1));
+		CHECK(pacer.frame_interval() == Interval_144);
+		CHECK(pacer.stats().retargets == 1);
+		CHECK(pacer.next_deadline() == frame_start + Interval_144 * 2);
+
+		for (int i = 0; i < 10; ++i)
+			CHECK(pacer.wait() < state.spin_step);
+		CHECK(pacer.stats().retargets == 1);
+
+		// a new refresh on the same monitor needs a forced update
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			fake::display.monitors[1].vsync = { 120000, 1000 };
+		}
+		CHECK(!pacer.update_monitor());
+		CHECK(pacer.update_monitor(true));
+		CHECK(pacer.frame_interval() == std::chrono::nanoseconds(8333333));
+		CHECK(pacer.stats().retargets == 2);
+	}
+
+	void test_fixed_interval_without_window()
+	{
+		fake::reset({});
+		SimulatedClock::State state;
+		Pacer pacer(NULL, SimulatedClock{ &state });
+
+		CHECK(pacer.monitor() == NULL);
+		pacer.set_frame_interval(std::chrono::milliseconds(10));
+		pacer.set_frame_interval(std::chrono::nanoseconds(0));
+		CHECK(pacer.frame_interval() == std::chrono::milliseconds(10));
+
+		auto start = SimulatedClock{ &state }.now();
+		for (int i = 0; i < 5; ++i)
+			pacer.wait();
+		CHECK(pacer.next_deadline() == start + std::chrono::milliseconds(60));
+		CHECK(fake::display.calls.monitor_from_window == 0);
+		CHECK(pacer.stats().retargets == 0);
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_initial_target_is_not_a_retarget();
+	test_steady_frames();
+	test_oversleep_past_the_deadline();
+	test_missed_frames_are_skipped();
+	test_retarget_to_another_refresh();
+	test_fixed_interval_without_window();
+
+	return test::test_result();
+}
@@ -0,0 +1,298 @@
+#include "fullscreen.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+
+//=============================================================================
+// call sequences FullscreenManager makes against a scripted backend:
+// borderless and exclusive transitions, focus loss and return without a
+// modeset, and every failure leaving the window and the mode consistent
+//=============================================================================
+
+namespace
+{
+	using Calls = std::vector<std::string>;
+
+	DEVMODE make_mode(DWORD width, DWORD height, DWORD frequency)
+	{
+		DEVMODE dm = {};
+		dm.dmSize = sizeof(dm);
+		dm.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT | DM_BITSPERPEL | DM_DISPLAYFREQUENCY;
+		dm.dmPelsWidth = width;
+		dm.dmPelsHeight = height;
+		dm.dmBitsPerPel = 32;
+		dm.dmDisplayFrequency = frequency;
+		return dm;
+	}
+
+	// what the backend was asked and how it answers
+	struct Script
+	{
+		Calls calls;
+		DEVMODE native = make_mode(2560, 1440, 144);
+		bool has_native = true;
+		bool monitor_present = true;
+		bool change_succeeds = true;
+		bool borderless_succeeds = true;
+		bool restore_succeeds = true;
+		bool reset_succeeds = true;
+	};
+
+	struct ScriptedBackend
+	{
+		Script* script = nullptr;
+
+		static MONITORINFOEX monitor()
+		{
+			MONITORINFOEX mi = {};
+			mi.cbSize = sizeof(mi);
+			mi.rcMonitor = { 0, 0, 2560, 1440 };
+			mi.rcWork = { 0, 0, 2560, 1400 };
+			lstrcpyn(mi.szDevice, TEXT("\\\\.\\DISPLAY1"), CCHDEVICENAME);
+			return mi;
+		}
+
+		bool monitor_info(HWND, MONITORINFOEX& mi) const
+		{
+			script->calls.push_back("monitor_info");
+			mi = monitor();
+			return script->monitor_present;
+		}
+
+		std::optional<MONITORINFOEX> device_info(wutil::tstring_view) const
+		{
+			script->calls.push_back("device_info");
+			if (!script->monitor_present)
+				return {};
+			return monitor();
+		}
+
+		bool native_mode(wutil::tstring_view, DEVMODE& dm) const
+		{
+			script->calls.push_back("native_mode");
+			dm = script->native;
+			return script->has_native;
+		}
+
+		std::optional<wutil::WindowInfo> set_borderless(HWND, const MONITORINFOEX&) const
+		{
+			script->calls.push_back("set_borderless");
+			if (!script->borderless_succeeds)
+				return {};
+			return wutil::WindowInfo{};
+		}
+
+		bool restore_window(HWND, const wutil::WindowInfo&) const
+		{
+			script->calls.push_back("restore_window");
+			return script->restore_succeeds;
+		}
+
+		std::optional<MONITORINFOEX> change_mode(wutil::tstring_view, DEVMODE&) const
+		{
+			script->calls.push_back("change_mode");
+			if (!script->change_succeeds)
+				return {};
+			return monitor();
+		}
+
+		bool reset_mode(wutil::tstring_view device_name) const
+		{
+			script->calls.push_back("reset_mode");
+			CHECK(device_name == TEXT("\\\\.\\DISPLAY1"));
+			return script->reset_succeeds;
+		}
+
+		void minimize(HWND) const { script->calls.push_back("minimize"); }
+		void show(HWND) const { script->calls.push_back("show"); }
+	};
+
+	using Manager = wutil::BasicFullscreenManager<ScriptedBackend>;
+
+	const HWND Window = reinterpret_cast<HWND>(0x200);
+	const DEVMODE Native = make_mode(2560, 1440, 144);
+	const DEVMODE Lower = make_mode(1280, 720, 60);
+
+	// calls made since the last take
+	Calls take(Script& script)
+	{
+		Calls calls;
+		calls.swap(script.calls);
+		return calls;
+	}
+
+	void test_borderless()
+	{
+		Script script;
+		Manager manager(Window, ScriptedBackend{ &script });
+
+		CHECK(manager.enter(&Native));
+		CHECK(take(script) == Calls({ "monitor_info", "native_mode", "set_borderless" }));
+		CHECK(manager.state() == wutil::FullscreenState::Borderless && !manager.is_exclusive());
+		CHECK(wutil::tstring_view(manager.device_name()) == TEXT("\\\\.\\DISPLAY1"));
+
+		// a hardware default refresh matches the native mode
+		auto any_refresh = Native;
+		any_refresh.dmDisplayFrequency = 0;
+		CHECK(manager.enter(&any_refresh));
+		CHECK(take(script) == Calls({ "restore_window", "monitor_info", "native_mode", "set_borderless" }));
+
+		CHECK(manager.enter());
+		CHECK(take(script) == Calls({ "restore_window", "monitor_info", "set_borderless" }));
+
+		CHECK(manager.leave());
+		CHECK(take(script) == Calls({ "restore_window" }));
+		CHECK(manager.state() == wutil::FullscreenState::Windowed);
+		CHECK(manager.leave());
+		CHECK(take(script).empty());
+
+		CHECK(manager.stats().transitions == 6 && manager.stats().mode_changes == 0 && manager.stats().mode_resets == 0);
+	}
+
+	void test_exclusive()
+	{
+		Script script;
+		Manager manager(Window, ScriptedBackend{ &script });
+
+		CHECK(manager.enter(&Lower));
+		CHECK(take(script) == Calls({ "monitor_info", "native_mode", "change_mode", "set_borderless" }));
+		CHECK(manager.state() == wutil::FullscreenState::Exclusive && manager.is_exclusive());
+
+		CHECK(manager.leave());
+		CHECK(take(script) == Calls({ "reset_mode", "restore_window" }));
+		CHECK(manager.stats().mode_changes == 1 && manager.stats().mode_resets == 1);
+
+		// without a registry mode any requested mode is a mode change
+		script.has_native = false;
+		CHECK(manager.enter(&Native));
+		CHECK(take(script) == Calls({ "monitor_info", "native_mode", "change_mode", "set_borderless" }));
+	}
+
+	void test_enter_failures()
+	{
+		Script script;
+		Manager manager(Window, ScriptedBackend{ &script });
+
+		script.monitor_present = false;
+		CHECK(!manager.enter(&Lower));
+		CHECK(take(script) == Calls({ "monitor_info" }));
+		script.monitor_present = true;
+
+		script.change_succeeds = false;
+		CHECK(!manager.enter(&Lower));
+		CHECK(take(script) == Calls({ "monitor_info", "native_mode", "change_mode" }));
+		script.change_succeeds = true;
+
+		// the mode change is undone when the window can not cover the monitor
+		script.borderless_succeeds = false;
+		CHECK(!manager.enter(&Lower));
+		CHECK(take(script) == Calls({ "monitor_info", "native_mode", "change_mode", "set_borderless", "reset_mode" }));
+		CHECK(manager.state() == wutil::FullscreenState::Windowed && !manager.is_exclusive());
+		CHECK(manager.stats().mode_changes == 1 && manager.stats().mode_resets == 1);
+		CHECK(manager.stats().transitions == 0);
+	}
+
+	void test_focus_loss_keeps_the_mode()
+	{
+		Script script;
+		Manager manager(Window, ScriptedBackend{ &script });
+		manager.enter(&Lower);
+		take(script);
+
+		CHECK(manager.handle_message(WM_ACTIVATEAPP, FALSE, 0));
+		CHECK(take(script) == Calls({ "minimize" }));
+		CHECK(manager.state() == wutil::FullscreenState::Suspended && manager.is_exclusive());
+
+		// deactivating twice does nothing
+		CHECK(!manager.handle_message(WM_ACTIVATEAPP, FALSE, 0));
+		CHECK(!manager.handle_message(WM_SIZE, 0, 0));
+
+		// coming back covers the monitor again without a modeset
+		CHECK(manager.handle_message(WM_ACTIVATEAPP, TRUE, 0));
+		CHECK(take(script) == Calls({ "show", "device_info", "set_borderless" }));
+		CHECK(manager.state() == wutil::FullscreenState::Exclusive);
+		CHECK(manager.stats().mode_changes == 1 && manager.stats().mode_resets == 0);
+		CHECK(!manager.handle_message(WM_ACTIVATEAPP, TRUE, 0));
+
+		// leaving while suspended shows the window before restoring it
+		manager.handle_message(WM_ACTIVATEAPP, FALSE, 0);
+		take(script);
+		CHECK(manager.leave());
+		CHECK(take(script) == Calls({ "reset_mode", "show", "restore_window" }));
+
+		manager.set_minimize_on_deactivate(false);
+		manager.enter(&Native);
+		take(script);
+		CHECK(!manager.handle_message(WM_ACTIVATEAPP, FALSE, 0));
+		CHECK(take(script).empty());
+	}
+
+	void test_resume_failures_leave_fullscreen()
+	{
+		Script script;
+		Manager manager(Window, ScriptedBackend{ &script });
+
+		// the window can not cover the monitor again, it must not report fullscreen
+		manager.enter(&Lower);
+		manager.handle_message(WM_ACTIVATEAPP, FALSE, 0);
+		take(script);
+		script.borderless_succeeds = false;
+		CHECK(manager.handle_message(WM_ACTIVATEAPP, TRUE, 0));
+		CHECK(take(script) == Calls({ "show", "device_info", "set_borderless", "reset_mode", "restore_window" }));
+		CHECK(!manager.is_fullscreen() && !manager.is_exclusive());
+		script.borderless_succeeds = true;
+
+		// the monitor went away while suspended, shown once then restored
+		manager.enter(&Native);
+		manager.handle_message(WM_ACTIVATEAPP, FALSE, 0);
+		take(script);
+		script.monitor_present = false;
+		CHECK(manager.handle_message(WM_ACTIVATEAPP, TRUE, 0));
+		CHECK(take(script) == Calls({ "show", "device_info", "restore_window" }));
+		CHECK(manager.state() == wutil::FullscreenState::Windowed);
+	}
+
+	void test_leave_reports_failures()
+	{
+		Script script;
+		Manager manager(Window, ScriptedBackend{ &script });
+
+		manager.enter(&Lower);
+		script.reset_succeeds = false;
+		CHECK(!manager.leave());
+		CHECK(manager.state() == wutil::FullscreenState::Windowed);
+
+		script.reset_succeeds = true;
+		script.restore_succeeds = false;
+		manager.enter(&Lower);
+		take(script);
+		CHECK(!manager.leave());
+		CHECK(take(script) == Calls({ "reset_mode", "restore_window" }));
+	}
+
+	void test_destructor_leaves()
+	{
+		Script script;
+		{
+			Manager manager(Window, ScriptedBackend{ &script });
+			manager.enter(&Lower);
+			take(script);
+		}
+
+		CHECK(take(script) == Calls({ "reset_mode", "restore_window" }));
+	}
+}
+
+int main()
+{
+	test_borderless();
+	test_exclusive();
+	test_enter_failures();
+	test_focus_loss_keeps_the_mode();
+	test_resume_failures_leave_fullscreen();
+	test_leave_reports_failures();
+	test_destructor_leaves();
+
+	return test::test_result();
+}
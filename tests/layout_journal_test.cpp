@@ -0,0 +1,344 @@
+#include "layout_journal.h"
+#include "check.h"
+
+//=============================================================================
+// LayoutJournal against a simulated desktop: remapping between monitors of
+// different size and dpi, workspace and screen coordinates of the restored
+// position, minimized windows journaled on the monitor they restore to, and
+// the calls one restore makes
+//=============================================================================
+
+namespace
+{
+	struct SimWindow
+	{
+		HWND hwnd = NULL;
+		wutil::WindowInfo info;
+		bool alive = true;
+	};
+
+	struct Calls
+	{
+		int windows = 0;
+		int monitors = 0;
+		int capture = 0;
+		int is_window = 0;
+		int set_styles = 0;
+		int set_placement = 0;
+		int begin_defer = 0;
+		int defer = 0;
+		int end_defer = 0;
+	};
+
+	struct Deferred
+	{
+		HWND hwnd;
+		RECT rect;
+		UINT flags;
+	};
+
+	struct Desktop
+	{
+		std::vector<wutil::JournalMonitor> monitors;
+		std::vector<SimWindow> windows;
+		Calls calls;
+		int defer_capacity = 0;
+		// the defer call that fails, -1 for none
+		int fail_defer = -1;
+		std::vector<std::pair<HWND, WINDOWPLACEMENT>> placed;
+		std::vector<Deferred> deferred;
+
+		SimWindow* find(HWND hwnd)
+		{
+			for (auto& window : windows)
+			{
+				if (window.hwnd == hwnd)
+					return &window;
+			}
+
+			return nullptr;
+		}
+	};
+
+	struct SimulatedBackend
+	{
+		Desktop* desktop = nullptr;
+
+		std::vector<HWND> windows() const
+		{
+			++desktop->calls.windows;
+			std::vector<HWND> windows;
+			for (const auto& window : desktop->windows)
+				windows.push_back(window.hwnd);
+
+			return windows;
+		}
+
+		std::vector<wutil::JournalMonitor> monitors() const
+		{
+			++desktop->calls.monitors;
+			return desktop->monitors;
+		}
+
+		bool capture(HWND hwnd, wutil::WindowInfo& info) const
+		{
+			++desktop->calls.capture;
+			auto window = desktop->find(hwnd);
+			if (window == nullptr || !window->alive)
+				return false;
+
+			info = window->info;
+			return true;
+		}
+
+		bool is_window(HWND hwnd) const
+		{
+			++desktop->calls.is_window;
+			auto window = desktop->find(hwnd);
+			return window != nullptr && window->alive;
+		}
+
+		bool set_styles(HWND hwnd, LONG style, LONG ex_style) const
+		{
+			++desktop->calls.set_styles;
+			auto& info = desktop->find(hwnd)->info;
+			if (info.style == style && info.ex_style == ex_style)
+				return false;
+
+			info.style = style;
+			info.ex_style = ex_style;
+			return true;
+		}
+
+		bool set_placement(HWND hwnd, const WINDOWPLACEMENT& placement) const
+		{
+			++desktop->calls.set_placement;
+			desktop->placed.emplace_back(hwnd, placement);
+			return true;
+		}
+
+		HDWP begin_defer(int count) const
+		{
+			++desktop->calls.begin_defer;
+			desktop->defer_capacity = count;
+			return reinterpret_cast<HDWP>(1);
+		}
+
+		HDWP defer(HDWP hdwp, HWND hwnd, const RECT& rect, UINT flags) const
+		{
+			if (desktop->calls.defer++ == desktop->fail_defer)
+				return NULL;
+
+			desktop->deferred.push_back(Deferred{ hwnd, rect, flags });
+			return hdwp;
+		}
+
+		bool end_defer(HDWP) const
+		{
+			++desktop->calls.end_defer;
+			return true;
+		}
+	};
+
+	using Journal = wutil::BasicLayoutJournal<SimulatedBackend>;
+
+	const HWND Editor = reinterpret_cast<HWND>(0x10);
+	const HWND Viewer = reinterpret_cast<HWND>(0x20);
+	const HWND Maximized = reinterpret_cast<HWND>(0x30);
+	const HWND Minimized = reinterpret_cast<HWND>(0x40);
+	const HWND Closed = reinterpret_cast<HWND>(0x50);
+
+	// primary with the taskbar at the top, workspace coordinates are 40 px up
+	wutil::JournalMonitor primary()
+	{
+		return { 1, { 0, 0, 1920, 1080 }, { 0, 40, 1920, 1080 }, 96, true };
+	}
+
+	wutil::JournalMonitor second_at_144()
+	{
+		return { 2, { 1920, 0, 4480, 1440 }, { 1920, 0, 4480, 1400 }, 144, false };
+	}
+
+	// the second monitor after dropping to 1080p at 100%
+	wutil::JournalMonitor second_at_96()
+	{
+		return { 2, { 1920, 0, 3840, 1080 }, { 1920, 0, 3840, 1040 }, 96, false };
+	}
+
+	bool equal(const RECT& a, const RECT& b)
+	{
+		return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+	}
+
+	wutil::WindowInfo make_info(const RECT& rect, UINT show, const RECT& normal)
+	{
+		wutil::WindowInfo info;
+		info.placement.length = sizeof(info.placement);
+		info.placement.showCmd = show;
+		info.placement.rcNormalPosition = normal;
+		info.rect = rect;
+		info.style = WS_OVERLAPPEDWINDOW | WS_VISIBLE;
+		return info;
+	}
+
+	RECT minimized_rect()
+	{
+		return { -32000, -32000, -31840, -31972 };
+	}
+
+	Desktop make_desktop()
+	{
+		Desktop desktop;
+		desktop.monitors = { primary(), second_at_144() };
+		desktop.windows = {
+			{ Editor, make_info({ 100, 140, 900, 740 }, SW_SHOWNORMAL, { 100, 100, 900, 700 }) },
+			{ Viewer, make_info({ 2020, 100, 2620, 550 }, SW_SHOWNORMAL, { 2020, 60, 2620, 510 }) },
+			{ Maximized, make_info({ -8, 32, 1928, 1088 }, SW_SHOWMAXIMIZED, { 200, 200, 1000, 800 }) },
+			// restores to the same spot as the viewer, on the second monitor
+			{ Minimized, make_info(minimized_rect(), SW_SHOWMINIMIZED, { 2020, 60, 2620, 510 }) },
+			{ Closed, make_info({ 300, 300, 500, 500 }, SW_SHOWNORMAL, { 300, 260, 500, 460 }) }
+		};
+
+		return desktop;
+	}
+
+	void test_remap_window_rect()
+	{
+		// offset from the work area and size scale with the dpi, 2/3 rounded, and back up by 3/2
+		CHECK(equal(wutil::remap_window_rect({ 2020, 100, 2620, 550 }, second_at_144(), second_at_96()), { 1987, 67, 2387, 367 }));
+		CHECK(equal(wutil::remap_window_rect({ 1986, 66, 2386, 366 }, second_at_96(), second_at_144()), { 2019, 99, 2619, 549 }));
+
+		// the same dpi only moves with the work area
+		CHECK(equal(wutil::remap_window_rect({ 100, 140, 900, 740 }, primary(), second_at_96()), { 2020, 100, 2820, 700 }));
+
+		// too big for the new work area: shrunk to it, then shifted inside
+		wutil::JournalMonitor small = { 3, { 0, 0, 800, 600 }, { 0, 0, 800, 560 }, 96, false };
+		CHECK(equal(wutil::remap_window_rect({ 100, 140, 1100, 740 }, primary(), small), { 0, 0, 800, 560 }));
+		CHECK(equal(wutil::remap_window_rect({ 700, 500, 900, 700 }, primary(), small), { 600, 360, 800, 560 }));
+		CHECK(equal(wutil::remap_window_rect({ -50, 40, 150, 240 }, primary(), small), { 0, 0, 200, 200 }));
+	}
+
+	void test_remap_normal_position()
+	{
+		wutil::JournalWindow window;
+		window.hwnd = Minimized;
+		window.info = make_info(minimized_rect(), SW_SHOWMINIMIZED, { 2020, 60, 2620, 510 });
+		window.monitor = 2;
+
+		std::vector<wutil::JournalMonitor> from = { primary(), second_at_144() };
+		auto placements = wutil::remap_layout({ window }, from, { primary(), second_at_96() });
+		if (CHECK(placements.size() == 1))
+		{
+			// workspace to screen is +40, remapped, then back
+			CHECK(placements[0].use_placement);
+			CHECK(equal(placements[0].info.placement.rcNormalPosition, { 1987, 27, 2387, 327 }));
+		}
+
+		// tool windows keep their restored position in screen coordinates
+		window.info.ex_style = WS_EX_TOOLWINDOW;
+		window.info.placement.rcNormalPosition = { 2020, 100, 2620, 550 };
+		placements = wutil::remap_layout({ window }, from, { primary(), second_at_96() });
+		CHECK(placements.size() == 1 && equal(placements[0].info.placement.rcNormalPosition, { 1987, 67, 2387, 367 }));
+
+		// monitor gone, onto the primary work area
+		window.info.ex_style = 0;
+		window.info.placement.rcNormalPosition = { 2020, 60, 2620, 510 };
+		placements = wutil::remap_layout({ window }, from, { primary() });
+		CHECK(placements.size() == 1 && equal(placements[0].info.placement.rcNormalPosition, { 67, 67, 467, 367 }));
+
+		// a window on a monitor the journal never saw is dropped
+		window.monitor = 7;
+		CHECK(wutil::remap_layout({ window }, from, { primary() }).empty());
+	}
+
+	void test_capture()
+	{
+		auto desktop = make_desktop();
+		desktop.windows.back().alive = false;
+		Journal journal(SimulatedBackend{ &desktop });
+		CHECK(journal.capture() == 4);
+		CHECK(desktop.calls.windows == 1 && desktop.calls.monitors == 1 && desktop.calls.capture == 5);
+
+		const auto& windows = journal.windows();
+		if (!CHECK(windows.size() == 4))
+			return;
+
+		CHECK(windows[0].hwnd == Editor && windows[0].monitor == 1);
+		CHECK(windows[1].hwnd == Viewer && windows[1].monitor == 2);
+		CHECK(windows[2].hwnd == Maximized && windows[2].monitor == 1);
+
+		// the -32000 rect touches no monitor, the restored position does
+		CHECK(windows[3].hwnd == Minimized && windows[3].monitor == 2);
+	}
+
+	void test_restore_calls()
+	{
+		auto desktop = make_desktop();
+		Journal journal(SimulatedBackend{ &desktop });
+		CHECK(journal.capture() == 5);
+
+		// the mode change: the second monitor drops to 96 dpi, a window
+		// closes and the shell takes the caption off the viewer
+		desktop.monitors = { primary(), second_at_96() };
+		desktop.windows.back().alive = false;
+		desktop.find(Viewer)->info.style &= ~WS_CAPTION;
+		desktop.calls = {};
+
+		CHECK(journal.restore());
+		CHECK(desktop.calls.monitors == 1 && desktop.calls.is_window == 5);
+		CHECK(desktop.calls.set_styles == 4);
+		CHECK(desktop.calls.set_placement == 2);
+		CHECK(desktop.calls.begin_defer == 1 && desktop.defer_capacity == 2);
+		CHECK(desktop.calls.defer == 2 && desktop.calls.end_defer == 1);
+		CHECK(desktop.calls.windows == 0 && desktop.calls.capture == 0);
+
+		if (CHECK(desktop.deferred.size() == 2))
+		{
+			CHECK(desktop.deferred[0].hwnd == Editor && equal(desktop.deferred[0].rect, { 100, 140, 900, 740 }));
+			CHECK((desktop.deferred[0].flags & SWP_FRAMECHANGED) == 0);
+			CHECK(desktop.deferred[1].hwnd == Viewer && equal(desktop.deferred[1].rect, { 1987, 67, 2387, 367 }));
+			CHECK((desktop.deferred[1].flags & SWP_FRAMECHANGED) != 0);
+			CHECK((desktop.deferred[1].flags & (SWP_NOZORDER | SWP_NOACTIVATE)) == (SWP_NOZORDER | SWP_NOACTIVATE));
+		}
+
+		if (CHECK(desktop.placed.size() == 2))
+		{
+			CHECK(desktop.placed[0].first == Maximized && equal(desktop.placed[0].second.rcNormalPosition, { 200, 200, 1000, 800 }));
+			CHECK(desktop.placed[1].first == Minimized && equal(desktop.placed[1].second.rcNormalPosition, { 1987, 27, 2387, 327 }));
+			CHECK(desktop.placed[1].second.showCmd == SW_SHOWMINIMIZED);
+		}
+	}
+
+	void test_failed_batch()
+	{
+		auto desktop = make_desktop();
+		Journal journal(SimulatedBackend{ &desktop });
+		journal.capture();
+		desktop.calls = {};
+		desktop.fail_defer = 1;
+
+		// the batch is gone, EndDeferWindowPos is not called on it
+		CHECK(!journal.restore());
+		CHECK(desktop.calls.defer == 2 && desktop.calls.end_defer == 0);
+		CHECK(desktop.calls.set_placement == 2);
+
+		// nothing to defer, no batch at all
+		desktop = make_desktop();
+		desktop.windows = { desktop.windows[2], desktop.windows[3] };
+		journal.capture();
+		desktop.calls = {};
+		CHECK(journal.restore());
+		CHECK(desktop.calls.begin_defer == 0 && desktop.calls.set_placement == 2);
+	}
+}
+
+int main()
+{
+	test_remap_window_rect();
+	test_remap_normal_position();
+	test_capture();
+	test_restore_calls();
+	test_failed_batch();
+
+	return test::test_result();
+}
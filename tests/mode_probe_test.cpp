@@ -0,0 +1,230 @@
+#include "mode_probe.h"
+#include "fake_display.h"
+#include "check.h"
+
+#include <chrono>
+#include <thread>
+
+//=============================================================================
+// mode probe fingerprints from the simulated adapters, registry and edid,
+// and ModeProber against a backend that rejects some modes and takes a few
+// milliseconds per CDS_TEST like a real driver
+//=============================================================================
+
+namespace
+{
+	const TCHAR* First = TEXT("\\\\.\\DISPLAY1");
+	const TCHAR* Second = TEXT("\\\\.\\DISPLAY2");
+
+	void install_monitors()
+	{
+		auto first = fake::make_monitor(1, { 0, 0, 2560, 1440 }, 96, true);
+		first.edid_manufacture_id = 0x10ac;
+		first.edid_product_code_id = 0x40f4;
+		fake::reset({ first, fake::make_monitor(2, { 2560, 0, 4480, 1080 }) });
+		fake::display.drivers = { { TEXT("31.0.15.3713"), TEXT("6-29-2023") } };
+	}
+
+	void test_fingerprint_inputs()
+	{
+		install_monitors();
+		auto first = wutil::get_mode_probe_fingerprint(First);
+		CHECK(first != 0 && wutil::get_mode_probe_fingerprint(First) == first);
+		CHECK(wutil::get_mode_probe_fingerprint(Second) != first);
+
+		// version and date are read from the adapter's video key
+		fake::display.calls = {};
+		wutil::get_mode_probe_fingerprint(wutil::get_display_tree(), First, {});
+		CHECK(fake::display.calls.reg_get_value == 4);
+
+		// a driver update
+		fake::display.drivers[0].version = TEXT("31.0.15.4601");
+		auto updated = wutil::get_mode_probe_fingerprint(First);
+		CHECK(updated != first);
+		fake::display.drivers[0].version = TEXT("31.0.15.3713");
+		CHECK(wutil::get_mode_probe_fingerprint(First) == first);
+
+		fake::display.drivers[0].date = TEXT("11-2-2023");
+		CHECK(wutil::get_mode_probe_fingerprint(First) != first);
+		fake::display.drivers[0].date = TEXT("6-29-2023");
+
+		// version and date must not run into each other
+		fake::display.drivers[0] = { TEXT("31.0.15.37136"), TEXT("-29-2023") };
+		CHECK(wutil::get_mode_probe_fingerprint(First) != first);
+		fake::display.drivers[0] = { TEXT("31.0.15.3713"), TEXT("6-29-2023") };
+
+		// another panel model on the same connector reporting the same device path
+		fake::display.monitors[0].edid_product_code_id = 0x40f5;
+		CHECK(wutil::get_mode_probe_fingerprint(First) != first);
+		fake::display.monitors[0].edid_product_code_id = 0x40f4;
+		CHECK(wutil::get_mode_probe_fingerprint(First) == first);
+
+		// without registry values or display config the ids still tell monitors apart
+		fake::display.drivers.clear();
+		auto bare = wutil::get_mode_probe_fingerprint(wutil::get_display_tree(), First, {});
+		CHECK(bare != first && bare != wutil::get_mode_probe_fingerprint(wutil::get_display_tree(), Second, {}));
+	}
+
+	void test_targets()
+	{
+		install_monitors();
+		fake::display.calls = {};
+		auto targets = wutil::get_mode_probe_targets();
+		if (!CHECK(targets.size() == 2))
+			return;
+
+		// one display config query for every monitor
+		CHECK(fake::display.calls.query_display_config == 1);
+		CHECK(targets[0].device_name == First && targets[0].fingerprint == wutil::get_mode_probe_fingerprint(First));
+		CHECK(targets[1].fingerprint == wutil::get_mode_probe_fingerprint(Second));
+		CHECK(targets[0].modes.size() == 3);
+	}
+
+	// shared by the copies of the backend the prober makes
+	struct Probe
+	{
+		std::mutex mutex;
+		std::vector<std::pair<wutil::tstring, DWORD>> calls;
+		std::atomic<int> in_flight{ 0 };
+		std::atomic<int> max_in_flight{ 0 };
+		std::chrono::milliseconds latency{ 2 };
+	};
+
+	// rejects 1280 wide modes and anything over 144hz
+	struct SlowBackend
+	{
+		Probe* probe = nullptr;
+
+		LONG test_mode(wutil::tstring_view device_name, DEVMODE& dm) const
+		{
+			auto in_flight = ++probe->in_flight;
+			auto max = probe->max_in_flight.load();
+			while (in_flight > max && !probe->max_in_flight.compare_exchange_weak(max, in_flight))
+				;
+
+			{
+				std::lock_guard<std::mutex> lock(probe->mutex);
+				probe->calls.emplace_back(wutil::tstring(device_name), dm.dmDisplayFrequency);
+			}
+
+			std::this_thread::sleep_for(probe->latency);
+			--probe->in_flight;
+			return dm.dmPelsWidth == 1280 || dm.dmDisplayFrequency > 144 ? DISP_CHANGE_BADMODE : DISP_CHANGE_SUCCESSFUL;
+		}
+	};
+
+	using Prober = wutil::BasicModeProber<SlowBackend>;
+
+	std::vector<wutil::ModeProbeTarget> make_targets()
+	{
+		wutil::ModeProbeTarget first;
+		first.device_name = First;
+		first.fingerprint = 1;
+		first.modes = { fake::make_mode(2560, 1440, 60), fake::make_mode(2560, 1440, 144), fake::make_mode(2560, 1440, 165),
+			fake::make_mode(1280, 720, 60), fake::make_mode(1920, 1080, 60), fake::make_mode(1920, 1080, 240) };
+
+		wutil::ModeProbeTarget second;
+		second.device_name = Second;
+		second.fingerprint = 2;
+		second.modes = { fake::make_mode(1920, 1080, 60), fake::make_mode(1280, 720, 60), fake::make_mode(1920, 1080, 75) };
+		return { first, second };
+	}
+
+	void test_probes_with_bounded_concurrency()
+	{
+		Probe probe;
+		wutil::ModeProbeCache cache;
+		auto targets = make_targets();
+		{
+			Prober prober(cache, 2, SlowBackend{ &probe });
+			CHECK(prober.start(targets) == 9);
+			prober.wait();
+			CHECK(prober.done() && prober.probed() == 9);
+		}
+
+		CHECK(probe.calls.size() == 9);
+		CHECK(probe.max_in_flight.load() >= 1 && probe.max_in_flight.load() <= 2);
+		CHECK(cache.size() == 9);
+
+		// filtered instantly, in their original order
+		auto good = cache.filter_known_good(1, targets[0].modes);
+		if (CHECK(good.size() == 3))
+		{
+			CHECK(good[0].dmDisplayFrequency == 60 && good[1].dmDisplayFrequency == 144);
+			CHECK(good[2].dmPelsWidth == 1920 && good[2].dmDisplayFrequency == 60);
+		}
+		CHECK(cache.filter_known_good(2, targets[1].modes).size() == 2);
+		CHECK(cache.known_good(1, targets[0].modes[2]) == false);
+		CHECK(cache.known_good(1, targets[0].modes[0]) == true);
+
+		// another fingerprint, e.g. after a driver update, knows nothing yet
+		CHECK(!cache.known_good(3, targets[0].modes[0]).has_value());
+		CHECK(cache.filter_known_good(3, targets[0].modes).empty());
+		CHECK(cache.filter_known_good(3, targets[0].modes, true).size() == targets[0].modes.size());
+
+		// nothing left to test for the same hardware
+		Prober again(cache, 2, SlowBackend{ &probe });
+		CHECK(again.start(targets) == 0);
+		again.wait();
+		CHECK(again.done() && probe.calls.size() == 9);
+
+		targets[1].fingerprint = 3;
+		CHECK(again.start(targets) == 3);
+		again.wait();
+		CHECK(probe.calls.size() == 12);
+	}
+
+	void test_monitors_are_interleaved()
+	{
+		Probe probe;
+		wutil::ModeProbeCache cache;
+		Prober prober(cache, 1, SlowBackend{ &probe });
+		prober.start(make_targets());
+		prober.wait();
+
+		if (!CHECK(probe.calls.size() == 9))
+			return;
+
+		// one mode of each monitor in turn until the shorter list runs out
+		CHECK(probe.calls[0].first == First && probe.calls[1].first == Second);
+		CHECK(probe.calls[2].first == First && probe.calls[3].first == Second);
+		CHECK(probe.calls[4].first == First && probe.calls[5].first == Second);
+		CHECK(probe.calls[6].first == First && probe.calls[7].first == First && probe.calls[8].first == First);
+	}
+
+	void test_cancel()
+	{
+		Probe probe;
+		probe.latency = std::chrono::milliseconds(5);
+		wutil::ModeProbeCache cache;
+
+		wutil::ModeProbeTarget target;
+		target.device_name = First;
+		target.fingerprint = 1;
+		for (DWORD hz = 50; hz < 90; ++hz)
+			target.modes.push_back(fake::make_mode(1920, 1080, hz));
+
+		Prober prober(cache, 1, SlowBackend{ &probe });
+		CHECK(prober.start({ target }) == 40);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		prober.cancel();
+		prober.wait();
+
+		CHECK(prober.done());
+		CHECK(prober.probed() < prober.total());
+		CHECK(cache.size() == prober.probed() && probe.calls.size() == prober.probed());
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_fingerprint_inputs();
+	test_targets();
+	test_probes_with_bounded_concurrency();
+	test_monitors_are_interleaved();
+	test_cancel();
+
+	return test::test_result();
+}
@@ -0,0 +1,182 @@
+#include "mode_select.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// mode selection for 23.976, 59.94 and 24 fps content: truncated ntsc
+// refreshes, panel rates that only look like them, and measured refreshes
+// such as 59940 / 1000 and 143998 / 1000 that are multiples within the
+// cadence tolerance without being an exact ratio
+//=============================================================================
+
+namespace
+{
+	DEVMODE mode(DWORD frequency)
+	{
+		return fake::make_mode(2560, 1440, frequency);
+	}
+
+	bool same(DISPLAYCONFIG_RATIONAL a, UINT32 numerator, UINT32 denominator)
+	{
+		return a.Numerator == numerator && a.Denominator == denominator;
+	}
+
+	void test_ntsc_refreshes()
+	{
+		using wutil::detail::mode_refresh;
+		CHECK(same(mode_refresh(mode(23)), 24000, 1001));
+		CHECK(same(mode_refresh(mode(29)), 30000, 1001));
+		CHECK(same(mode_refresh(mode(47)), 48000, 1001));
+		CHECK(same(mode_refresh(mode(59)), 60000, 1001));
+		CHECK(same(mode_refresh(mode(119)), 120000, 1001));
+
+		// panel rates that are one below a multiple of 24 or 30 are not ntsc
+		CHECK(same(mode_refresh(mode(71)), 71, 1));
+		CHECK(same(mode_refresh(mode(95)), 95, 1));
+		CHECK(same(mode_refresh(mode(143)), 143, 1));
+		CHECK(same(mode_refresh(mode(239)), 239, 1));
+		CHECK(same(mode_refresh(mode(144)), 144, 1));
+		CHECK(same(mode_refresh(mode(1)), 0, 1));
+	}
+
+	void test_content_rates()
+	{
+		auto film = wutil::make_content_rate(23.976);
+		CHECK(film.numerator == 24000 && film.denominator == 1001);
+		auto video = wutil::make_content_rate(59.94);
+		CHECK(video.numerator == 60000 && video.denominator == 1001);
+		auto cinema = wutil::make_content_rate(24.0);
+		CHECK(cinema.numerator == 24 && cinema.denominator == 1);
+	}
+
+	void test_23_976()
+	{
+		auto rate = wutil::make_content_rate(23.976);
+
+		auto choice = wutil::select_mode_for_content({ mode(60), mode(59), mode(23), mode(143), mode(71) }, rate);
+		if (CHECK(choice.has_value()))
+		{
+			CHECK(choice->index == 2 && choice->multiple == 1 && choice->judder_ns == 0);
+			CHECK(same(choice->refresh, 24000, 1001));
+		}
+
+		// 143hz is not 6 * 23.976, it is the least judder of the rest
+		choice = wutil::select_mode_for_content({ mode(60), mode(59), mode(143), mode(71) }, rate);
+		if (CHECK(choice.has_value()))
+		{
+			CHECK(choice->index == 2 && choice->multiple == 0 && choice->judder_ns > 0);
+			CHECK(same(choice->refresh, 143, 1));
+		}
+
+		// the measured refresh of an ntsc mode is a multiple within the tolerance
+		choice = wutil::select_mode_for_content({ mode(119), mode(60) }, rate, {}, DISPLAYCONFIG_RATIONAL{ 119880, 1000 });
+		if (CHECK(choice.has_value()))
+			CHECK(choice->index == 0 && choice->multiple == 5 && choice->judder_ns < 100);
+	}
+
+	void test_59_94()
+	{
+		auto rate = wutil::make_content_rate(59.94);
+
+		// 59940 / 1000 is not 60000 / 1001 exactly, it drifts ~17ns a frame
+		auto choice = wutil::select_mode_for_content({ mode(60), mode(144) }, rate, {}, DISPLAYCONFIG_RATIONAL{ 59940, 1000 });
+		if (CHECK(choice.has_value()))
+		{
+			CHECK(choice->index == 0 && choice->multiple == 1);
+			CHECK(choice->judder_ns > 0 && choice->judder_ns < 100);
+			CHECK(same(choice->refresh, 59940, 1000));
+		}
+
+		// integer 60hz is also within the tolerance but drifts more than the ntsc mode
+		choice = wutil::select_mode_for_content({ mode(60), mode(59) }, rate);
+		if (CHECK(choice.has_value()))
+			CHECK(choice->index == 1 && choice->multiple == 1 && choice->judder_ns == 0);
+
+		choice = wutil::select_mode_for_content({ mode(60), mode(119) }, rate);
+		if (CHECK(choice.has_value()))
+			CHECK(choice->index == 1 && choice->multiple == 2);
+
+		// a refresh more than the tolerance away is not a multiple
+		choice = wutil::select_mode_for_content({ mode(60) }, rate, {}, DISPLAYCONFIG_RATIONAL{ 59800, 1000 });
+		if (CHECK(choice.has_value()))
+			CHECK(choice->multiple == 0 && choice->judder_ns > 0);
+	}
+
+	void test_143_998()
+	{
+		auto rate = wutil::make_content_rate(24.0);
+
+		// 143998 / 1000 is 6 refreshes per frame to within 0.002%
+		auto choice = wutil::select_mode_for_content({ mode(144), mode(60) }, rate, {}, DISPLAYCONFIG_RATIONAL{ 143998, 1000 });
+		if (CHECK(choice.has_value()))
+		{
+			CHECK(choice->index == 0 && choice->multiple == 6);
+			CHECK(choice->judder_ns > 0 && choice->judder_ns < 1000);
+		}
+
+		// an exact multiple still wins over a measured one
+		choice = wutil::select_mode_for_content({ mode(144), mode(120) }, rate, {}, DISPLAYCONFIG_RATIONAL{ 143998, 1000 });
+		if (CHECK(choice.has_value()))
+			CHECK(choice->index == 1 && choice->multiple == 5 && choice->judder_ns == 0);
+
+		choice = wutil::select_mode_for_content({ mode(144) }, wutil::make_content_rate(72.0), {}, DISPLAYCONFIG_RATIONAL{ 143998, 1000 });
+		if (CHECK(choice.has_value()))
+			CHECK(choice->multiple == 2);
+	}
+
+	void test_requirements()
+	{
+		auto rate = wutil::make_content_rate(23.976);
+		auto small = fake::make_mode(1280, 720, 23);
+		auto interlaced = fake::make_mode(1920, 1080, 23);
+		interlaced.dmDisplayFlags = DM_INTERLACED;
+
+		wutil::ModeRequirements requirements;
+		requirements.min_width = 1920;
+		auto choice = wutil::select_mode_for_content({ mode(60), small, interlaced }, rate, requirements);
+		if (CHECK(choice.has_value()))
+			CHECK(choice->index == 0 && choice->multiple == 0);
+
+		requirements.allow_interlaced = true;
+		choice = wutil::select_mode_for_content({ mode(60), small, interlaced }, rate, requirements);
+		if (CHECK(choice.has_value()))
+			CHECK(choice->index == 2 && choice->multiple == 1);
+
+		CHECK(!wutil::select_mode_for_content(std::vector<DEVMODE>{}, rate));
+		CHECK(!wutil::select_mode_for_content({ mode(60) }, wutil::ContentRate{ 0, 1 }));
+	}
+
+	void test_simulated_monitor()
+	{
+		fake::install();
+		auto monitor = fake::make_monitor(1, { 0, 0, 2560, 1440 }, 96, true);
+		monitor.modes = { mode(144), mode(60), mode(23) };
+		monitor.vsync = { 143998, 1000 };
+		fake::reset({ monitor });
+
+		// the current mode gets the exact timing from display config
+		auto choice = wutil::select_mode_for_content(monitor.device_name, wutil::make_content_rate(24.0));
+		if (CHECK(choice.has_value()))
+		{
+			CHECK(choice->index == 0 && choice->multiple == 6);
+			CHECK(same(choice->refresh, 143998, 1000));
+		}
+
+		choice = wutil::select_mode_for_content(monitor.device_name, wutil::make_content_rate(23.976));
+		if (CHECK(choice.has_value()))
+			CHECK(choice->index == 2 && choice->judder_ns == 0);
+	}
+}
+
+int main()
+{
+	test_ntsc_refreshes();
+	test_content_rates();
+	test_23_976();
+	test_59_94();
+	test_143_998();
+	test_requirements();
+	test_simulated_monitor();
+
+	return test::test_result();
+}
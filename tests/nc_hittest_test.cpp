@@ -0,0 +1,121 @@
+#include "nc_hittest.h"
+#include "fake_display.h"
+#include "check.h"
+
+#include <cstdio>
+
+//=============================================================================
+// the precomputed WM_NCHITTEST path against the reference hit test at every
+// standard dpi: each pixel of windows large and small, restored and
+// maximized, plus a ring outside them, with metrics from the simulated
+// GetSystemMetricsForDpi
+//=============================================================================
+
+namespace
+{
+	// 100% to 500% in the steps the display settings offer
+	const UINT Dpis[] = { 96, 120, 144, 168, 192, 216, 240, 288, 336, 384, 432, 480 };
+	// down to windows narrower than their borders and buttons
+	const SIZE Windows[] = { { 640, 480 }, { 300, 100 }, { 120, 40 }, { 30, 20 }, { 1, 1 } };
+
+	// first mismatch of the fast path in and around a window, false if none.
+	// rows below the caption only check the pixels around the side borders
+	bool find_mismatch(wutil::NcHitTester& tester, wutil::SystemMetricsCache& metrics, UINT dpi, SIZE window, bool maximized)
+	{
+		const auto& geometry = tester.geometry(dpi);
+		LONG top_band = geometry.border_y + geometry.caption_height + 2;
+		LONG side_band = geometry.border_x + 2;
+
+		for (LONG y = -2; y < window.cy + 2; ++y)
+		{
+			bool interior = y >= top_band && y < window.cy - geometry.border_y - 2;
+			for (LONG x = -2; x < window.cx + 2; ++x)
+			{
+				if (interior && x == side_band && x < window.cx - side_band)
+					x = window.cx - side_band;
+
+				POINT pt = { x, y };
+				auto fast = tester.hit_test(dpi, pt, window, maximized);
+				auto reference = wutil::nc_hit_test_reference(metrics, dpi, pt, window, maximized);
+				if (fast != reference)
+				{
+					std::fprintf(stderr, "dpi %u window %ldx%ld%s at %ld,%ld: %ld, reference %ld\n", dpi, static_cast<long>(window.cx),
+						static_cast<long>(window.cy), maximized ? " maximized" : "", static_cast<long>(x), static_cast<long>(y),
+						static_cast<long>(fast), static_cast<long>(reference));
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	void test_matches_reference_at_standard_dpis()
+	{
+		wutil::SystemMetricsCache metrics;
+		wutil::NcHitTester tester(metrics);
+		for (auto dpi : Dpis)
+		{
+			for (auto window : Windows)
+			{
+				CHECK(!find_mismatch(tester, metrics, dpi, window, false));
+				CHECK(!find_mismatch(tester, metrics, dpi, window, true));
+			}
+		}
+	}
+
+	void test_geometry()
+	{
+		wutil::SystemMetricsCache metrics;
+		wutil::NcHitTester tester(metrics);
+
+		const auto& normal = tester.geometry(96);
+		CHECK(normal.border_x == 8 && normal.border_y == 8);
+		CHECK(normal.caption_height == 23 && normal.button_width == 36 && normal.button_height == 22);
+
+		const auto& doubled = tester.geometry(192);
+		CHECK(doubled.border_x == 16 && doubled.caption_height == 46 && doubled.button_width == 72);
+
+		SIZE window = { 640, 480 };
+		CHECK(tester.hit_test(96, POINT{ 0, 0 }, window, false) == HTTOPLEFT);
+		CHECK(tester.hit_test(96, POINT{ 0, 0 }, window, true) == HTCLIENT);
+		CHECK(tester.hit_test(96, POINT{ 631, 8 }, window, false) == HTCLOSE);
+		CHECK(tester.hit_test(96, POINT{ 595, 8 }, window, false) == HTMAXBUTTON);
+		CHECK(tester.hit_test(96, POINT{ 631, 30 }, window, false) == HTCAPTION);
+		CHECK(tester.hit_test(96, POINT{ 320, 31 }, window, false) == HTCLIENT);
+		CHECK(tester.hit_test(192, POINT{ 320, 31 }, window, false) == HTCAPTION);
+		CHECK(tester.hit_test(96, POINT{ 640, 0 }, window, false) == HTNOWHERE);
+	}
+
+	void test_geometry_is_computed_once_per_dpi()
+	{
+		wutil::SystemMetricsCache metrics;
+		wutil::NcHitTester tester(metrics);
+
+		const auto* geometry = &tester.geometry(144);
+		for (int i = 0; i < 100; ++i)
+			tester.hit_test(144, POINT{ 10, 10 }, SIZE{ 640, 480 }, false);
+		CHECK(&tester.geometry(144) == geometry);
+
+		// the 100 hit tests did not touch the metrics cache
+		auto lookups_before = metrics.hit_rate();
+		tester.hit_test(144, POINT{ 10, 10 }, SIZE{ 640, 480 }, false);
+		CHECK(metrics.hit_rate() == lookups_before);
+
+		CHECK(!tester.handle_message(WM_DISPLAYCHANGE));
+		CHECK(tester.handle_message(WM_SETTINGCHANGE));
+		CHECK(tester.geometry(144).border_x == 12);
+	}
+}
+
+int main()
+{
+	fake::install();
+	fake::reset({ fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true) });
+
+	test_matches_reference_at_standard_dpis();
+	test_geometry();
+	test_geometry_is_computed_once_per_dpi();
+
+	return test::test_result();
+}
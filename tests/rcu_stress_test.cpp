@@ -0,0 +1,225 @@
+#include "rcu.h"
+#include "latency.h"
+#include "check.h"
+
+#include <latch>
+
+//=============================================================================
+// 16 readers against a writer publishing as fast as it can, like a hot plug
+// storm. readers check every value they pin is whole and never goes back in
+// time, and every value is counted so leaks and double frees show. run it
+// with WUTIL_SANITIZE=thread or address, a reclaim that frees a pinned value
+// shows up there as a race or use after free
+//=============================================================================
+
+namespace
+{
+	const int Reader_Count = 16;
+	const std::chrono::milliseconds Duration{ 1000 };
+
+	std::atomic<int64_t> live_values{ 0 };
+
+	// monitor ids of one topology, the count changes with the generation like monitors coming and going
+	struct Value
+	{
+		uint64_t generation = 0;
+		std::vector<uint64_t> ids;
+		uint64_t checksum = 0;
+
+		explicit Value(uint64_t generation_)
+			: generation(generation_), ids(generation_ % 8 + 1)
+		{
+			for (size_t i = 0; i < ids.size(); ++i)
+			{
+				ids[i] = generation * 0x9e3779b97f4a7c15ull + i;
+				checksum ^= ids[i];
+			}
+
+			live_values.fetch_add(1);
+		}
+
+		Value(Value&& other) noexcept
+			: generation(other.generation), ids(std::move(other.ids)), checksum(other.checksum)
+		{
+			live_values.fetch_add(1);
+		}
+
+		Value(const Value&) = delete;
+		Value& operator=(const Value&) = delete;
+
+		~Value() { live_values.fetch_sub(1); }
+
+		bool whole() const
+		{
+			if (ids.size() != generation % 8 + 1)
+				return false;
+
+			uint64_t sum = 0;
+			for (size_t i = 0; i < ids.size(); ++i)
+			{
+				if (ids[i] != generation * 0x9e3779b97f4a7c15ull + i)
+					return false;
+				sum ^= ids[i];
+			}
+
+			return sum == checksum;
+		}
+	};
+
+	using Publisher = wutil::RcuPublisher<Value>;
+
+	void test_readers_against_a_storm()
+	{
+		std::atomic<bool> stop{ false };
+		std::atomic<uint64_t> torn{ 0 };
+		std::atomic<uint64_t> backwards{ 0 };
+		std::atomic<uint64_t> reads{ 0 };
+		wutil::LatencyHistogram read_latency;
+		uint64_t published = 0;
+
+		{
+			Publisher publisher{ Value(0) };
+
+			std::vector<std::thread> readers;
+			for (int i = 0; i < Reader_Count; ++i)
+			{
+				readers.emplace_back([&, i]()
+				{
+					uint64_t last = 0;
+					uint64_t count = 0;
+					while (!stop.load(std::memory_order_relaxed))
+					{
+						auto start = std::chrono::steady_clock::now();
+						auto guard = publisher.read();
+						read_latency.record(std::chrono::steady_clock::now() - start);
+
+						if (!guard->whole())
+							torn.fetch_add(1, std::memory_order_relaxed);
+						if (guard->generation < last)
+							backwards.fetch_add(1, std::memory_order_relaxed);
+						last = guard->generation;
+
+						// nested reads pin at least as new a value and keep the outer one alive
+						if ((count++ + static_cast<uint64_t>(i)) % 4 == 0)
+						{
+							auto inner = publisher.read();
+							if (!inner->whole() || inner->generation < guard->generation)
+								torn.fetch_add(1, std::memory_order_relaxed);
+						}
+
+						if (!guard->whole())
+							torn.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					reads.fetch_add(count);
+				});
+			}
+
+			size_t max_retired = 0;
+			auto deadline = std::chrono::steady_clock::now() + Duration;
+			while (std::chrono::steady_clock::now() < deadline)
+			{
+				publisher.publish(Value(++published));
+				if (published % 64 == 0)
+					max_retired = (std::max)(max_retired, publisher.reclaim());
+			}
+
+			stop.store(true);
+			for (auto& reader : readers)
+				reader.join();
+
+			// with no readers left everything retired is freed, only the current value lives
+			CHECK(publisher.reclaim() == 0);
+			CHECK(live_values.load() == 1);
+			CHECK(publisher.read()->generation == published);
+
+			std::printf("published %llu, %llu reads, at most %zu retired\n", static_cast<unsigned long long>(published),
+				static_cast<unsigned long long>(reads.load()), max_retired);
+			std::printf("read p50 %lldns p99 %lldns p99.9 %lldns\n", static_cast<long long>(read_latency.percentile(0.5).count()),
+				static_cast<long long>(read_latency.percentile(0.99).count()), static_cast<long long>(read_latency.percentile(0.999).count()));
+		}
+
+		CHECK(torn.load() == 0);
+		CHECK(backwards.load() == 0);
+		CHECK(published > 0 && reads.load() > 0);
+		CHECK(live_values.load() == 0);
+	}
+
+	void test_pinned_value_outlives_publishes()
+	{
+		{
+			Publisher publisher{ Value(0) };
+			std::latch pinned(1);
+			std::latch release(1);
+
+			std::thread reader([&]()
+			{
+				auto guard = publisher.read();
+				pinned.count_down();
+				release.wait();
+				CHECK(guard->generation == 0 && guard->whole());
+			});
+
+			pinned.wait();
+			for (uint64_t i = 1; i <= 100; ++i)
+				publisher.publish(Value(i));
+
+			// the pinned value and everything retired after it stays
+			CHECK(publisher.reclaim() == 100);
+			release.count_down();
+			reader.join();
+			CHECK(publisher.reclaim() == 0);
+			CHECK(live_values.load() == 1);
+		}
+
+		CHECK(live_values.load() == 0);
+	}
+
+	void test_overflow_readers()
+	{
+		// more threads than slots, the overflow readers hold off all reclamation
+		const int thread_count = static_cast<int>(wutil::detail::Max_Rcu_Threads) + 4;
+		{
+			Publisher publisher{ Value(0) };
+			std::latch pinned(thread_count);
+			std::latch release(1);
+			std::atomic<uint64_t> torn{ 0 };
+
+			std::vector<std::thread> readers;
+			for (int i = 0; i < thread_count; ++i)
+			{
+				readers.emplace_back([&]()
+				{
+					auto guard = publisher.read();
+					pinned.count_down();
+					release.wait();
+					if (!guard->whole())
+						torn.fetch_add(1);
+				});
+			}
+
+			pinned.wait();
+			for (uint64_t i = 1; i <= 10; ++i)
+				publisher.publish(Value(i));
+			CHECK(publisher.reclaim() == 10);
+
+			release.count_down();
+			for (auto& reader : readers)
+				reader.join();
+
+			CHECK(torn.load() == 0);
+			CHECK(publisher.reclaim() == 0);
+		}
+
+		CHECK(live_values.load() == 0);
+	}
+}
+
+int main()
+{
+	test_readers_against_a_storm();
+	test_pinned_value_outlives_publishes();
+	test_overflow_readers();
+
+	return test::test_result();
+}
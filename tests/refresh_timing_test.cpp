@@ -0,0 +1,160 @@
+#include "wutil.h"
+#include "fake_display.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+//=============================================================================
+// refresh timing from the simulated display config paths: matching paths to
+// monitors by gdi name, retries when the topology changes mid query, paths
+// without a target mode, and gdi names that fill CCHDEVICENAME
+//=============================================================================
+
+namespace
+{
+	void install_monitors()
+	{
+		auto second = fake::make_monitor(2, { 2560, 0, 4480, 1080 });
+		second.vsync = { 60000, 1001 };
+		fake::reset({ fake::make_monitor(1, { 0, 0, 2560, 1440 }, 144, true), second });
+	}
+
+	MONITORINFOEX monitor_named(const TCHAR* name, size_t length)
+	{
+		MONITORINFOEX mi = {};
+		mi.cbSize = sizeof(mi);
+		std::memcpy(mi.szDevice, name, (std::min)(length, static_cast<size_t>(CCHDEVICENAME)) * sizeof(TCHAR));
+		return mi;
+	}
+
+	void test_timing_per_monitor()
+	{
+		install_monitors();
+		auto timings = wutil::get_all_refresh_timing(wutil::get_all_monitor_info());
+		CHECK(timings.size() == 2);
+		if (!CHECK(timings[0] && timings[1]))
+			return;
+
+		CHECK(timings[0]->vsync_frequency.Numerator == 60000 && timings[0]->vsync_frequency.Denominator == 1000);
+		CHECK(timings[0]->active_size.cx == 2560 && timings[0]->active_size.cy == 1440);
+		CHECK(timings[0]->total_size.cy == 1485 && timings[0]->vblank_lines() == 45);
+		CHECK(timings[0]->vsync_interval_ns == 16666667);
+
+		// 59.94hz keeps its ntsc rational
+		CHECK(timings[1]->vsync_frequency.Numerator == 60000 && timings[1]->vsync_frequency.Denominator == 1001);
+		CHECK(timings[1]->refresh_hz() > 59.93 && timings[1]->refresh_hz() < 59.95);
+		CHECK(timings[1]->vsync_interval_ns == 16683333);
+		CHECK(timings[1]->scanline_interval_ns > 0 && timings[1]->scanline_ordering == DISPLAYCONFIG_SCANLINE_ORDERING_PROGRESSIVE);
+
+		// one query for all monitors, one name lookup per path
+		fake::display.calls = {};
+		wutil::get_all_refresh_timing(wutil::get_all_monitor_info());
+		CHECK(fake::display.calls.query_display_config == 1);
+		CHECK(fake::display.calls.display_config_get_device_info == 2);
+	}
+
+	void test_retries_while_the_topology_changes()
+	{
+		install_monitors();
+		auto monitors = wutil::get_all_monitor_info();
+		fake::display.calls = {};
+		fake::display.topology_changes_during_query = 3;
+
+		auto timings = wutil::get_all_refresh_timing(monitors);
+		CHECK(fake::display.calls.get_display_config_buffer_sizes == 4);
+		CHECK(fake::display.calls.query_display_config == 4);
+		CHECK(timings.size() == 2 && timings[0] && timings[1]);
+	}
+
+	void test_path_without_target_mode()
+	{
+		auto monitor = fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true);
+		monitor.vsync = { 143998, 1000 };
+		monitor.has_target_mode = false;
+		fake::reset({ monitor });
+
+		auto timing = wutil::get_refresh_timing(wutil::get_all_monitor_info().front());
+		if (!CHECK(timing))
+			return;
+
+		// only the refresh rational is known
+		CHECK(timing->vsync_frequency.Numerator == 143998 && timing->vsync_frequency.Denominator == 1000);
+		CHECK(timing->total_size.cx == 0 && timing->scanline_interval_ns == 0);
+		CHECK(timing->vsync_interval_ns == 6944541);
+	}
+
+	void test_unmatched_monitor()
+	{
+		install_monitors();
+		auto mi = monitor_named(TEXT("\\\\.\\DISPLAY9"), 13);
+		CHECK(!wutil::get_refresh_timing(mi));
+
+		// a prefix of a real name is not that name
+		mi = monitor_named(TEXT("\\\\.\\DISPLAY"), 12);
+		CHECK(!wutil::get_refresh_timing(mi));
+	}
+
+	void test_full_length_names()
+	{
+		// 32 characters, neither side has room for a terminator
+		const TCHAR* name = TEXT("\\\\.\\DISPLAY_WITH_A_32_CHAR_NAME1");
+		const TCHAR* other = TEXT("\\\\.\\DISPLAY_WITH_A_32_CHAR_NAME2");
+
+		auto monitor = fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true);
+		monitor.device_name = name;
+		fake::reset({ monitor });
+
+		CHECK(wutil::get_refresh_timing(monitor_named(name, CCHDEVICENAME)));
+		CHECK(!wutil::get_refresh_timing(monitor_named(other, CCHDEVICENAME)));
+
+		// heap buffers of exactly CCHDEVICENAME, a read past the end is caught by the address sanitizer
+		std::vector<WCHAR> wide(CCHDEVICENAME);
+		std::vector<TCHAR> narrow(CCHDEVICENAME);
+		for (int i = 0; i < CCHDEVICENAME; ++i)
+		{
+			wide[i] = static_cast<WCHAR>(name[i]);
+			narrow[i] = name[i];
+		}
+
+		CHECK(wutil::detail::equal_device_name(wide.data(), narrow.data()));
+		narrow[CCHDEVICENAME - 1] = other[CCHDEVICENAME - 1];
+		CHECK(!wutil::detail::equal_device_name(wide.data(), narrow.data()));
+
+		// a shorter name against a full length one
+		narrow.assign(CCHDEVICENAME, 0);
+		narrow[0] = TEXT('A');
+		wide[0] = L'A';
+		CHECK(!wutil::detail::equal_device_name(wide.data(), narrow.data()));
+		wide[1] = 0;
+		CHECK(wutil::detail::equal_device_name(wide.data(), narrow.data()));
+	}
+
+	void test_without_display_config()
+	{
+		install_monitors();
+		auto monitors = wutil::get_all_monitor_info();
+
+		auto saved = wutil::detail::display_api.query_display_config;
+		wutil::detail::display_api.query_display_config = nullptr;
+		auto timings = wutil::get_all_refresh_timing(monitors);
+		wutil::detail::display_api.query_display_config = saved;
+
+		CHECK(timings.size() == 2 && !timings[0] && !timings[1]);
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_timing_per_monitor();
+	test_retries_while_the_topology_changes();
+	test_path_without_target_mode();
+	test_unmatched_monitor();
+	test_full_length_names();
+	test_without_display_config();
+
+	return test::test_result();
+}
@@ -0,0 +1,200 @@
+#include "shared_seqlock.h"
+#include "check.h"
+
+#include <thread>
+#include <vector>
+
+//=============================================================================
+// the seqlock core of the topology broker on the native backend, posix shm
+// on linux and file mappings on windows
+//=============================================================================
+
+namespace
+{
+	const uint64_t Layout = 0x5eed;
+	const size_t Capacity = 4096;
+
+#ifdef OS_WIN
+	const wutil::detail::SharedName Name = TEXT("Local\\wutil_shared_seqlock_test");
+#else
+	const wutil::detail::SharedName Name = "/wutil_shared_seqlock_test";
+#endif
+
+	// every word of a payload holds its generation, a torn read mixes them
+	std::vector<uint64_t> stamped(uint64_t generation, size_t words)
+	{
+		return std::vector<uint64_t>(words, generation);
+	}
+
+	bool consistent(const std::vector<unsigned char>& payload)
+	{
+		if (payload.size() % sizeof(uint64_t) != 0 || payload.empty())
+			return false;
+
+		std::vector<uint64_t> words(payload.size() / sizeof(uint64_t));
+		std::memcpy(words.data(), payload.data(), payload.size());
+		for (auto word : words)
+		{
+			if (word != words[0])
+				return false;
+		}
+
+		return true;
+	}
+
+	void test_publish_and_read()
+	{
+		wutil::SharedSeqlockWriter::remove(Name);
+
+		wutil::SharedSeqlockReader early(Name, Layout);
+		CHECK(!early.open());
+		CHECK(early.generation() == 0);
+
+		wutil::SharedSeqlockWriter writer(Name, Capacity, Layout);
+		CHECK(writer.is_open());
+
+		std::vector<unsigned char> payload;
+		CHECK(!early.read(payload));
+
+		const char message[] = "three monitors";
+		CHECK(writer.publish(message, sizeof(message)));
+		CHECK(writer.generation() == 1);
+
+		uint64_t generation = 0;
+		CHECK(early.read(payload, &generation));
+		CHECK(generation == 1);
+		CHECK(payload.size() == sizeof(message) && std::memcmp(payload.data(), message, sizeof(message)) == 0);
+
+		// shorter payloads do not keep the tail of longer ones
+		CHECK(writer.publish("ab", 2));
+		CHECK(early.read(payload, &generation));
+		CHECK(generation == 2 && payload.size() == 2);
+
+		std::vector<unsigned char> too_big(Capacity + 1);
+		CHECK(!writer.publish(too_big.data(), too_big.size()));
+		CHECK(writer.generation() == 2);
+
+		// another layout never maps the region
+		wutil::SharedSeqlockReader other_layout(Name, Layout + 1);
+		CHECK(!other_layout.open());
+
+		wutil::SharedSeqlockWriter::remove(Name);
+	}
+
+	void test_restarted_writer_keeps_counting()
+	{
+		wutil::SharedSeqlockWriter::remove(Name);
+
+		wutil::SharedSeqlockReader reader(Name, Layout);
+		{
+			wutil::SharedSeqlockWriter writer(Name, Capacity, Layout);
+			CHECK(writer.publish("a", 1));
+			CHECK(writer.publish("b", 1));
+
+			// keeps the region mapped on windows between the two writers
+			CHECK(reader.open());
+		}
+
+		wutil::SharedSeqlockWriter restarted(Name, Capacity, Layout);
+		CHECK(restarted.generation() == 2);
+		CHECK(restarted.publish("c", 1));
+		CHECK(reader.generation() == 3);
+
+		// a writer with another capacity cannot take the region over
+		wutil::SharedSeqlockWriter mismatched(Name, Capacity * 2, Layout);
+		CHECK(!mismatched.is_open());
+
+		wutil::SharedSeqlockWriter::remove(Name);
+	}
+
+	void test_wait()
+	{
+		wutil::SharedSeqlockWriter::remove(Name);
+
+		wutil::SharedSeqlockWriter writer(Name, Capacity, Layout);
+		wutil::SharedSeqlockReader reader(Name, Layout);
+		CHECK(writer.publish("a", 1));
+
+		auto start = std::chrono::steady_clock::now();
+		CHECK(!reader.wait(1, 30));
+		CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(30));
+
+		// several publishes between the check and the wait are not lost
+		CHECK(writer.publish("b", 1));
+		CHECK(writer.publish("c", 1));
+		CHECK(reader.wait(1, 1000));
+		CHECK(reader.wait(2, 1000));
+
+		std::thread publisher([&writer]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			writer.publish("d", 1);
+			writer.publish("e", 1);
+		});
+
+		CHECK(reader.wait(3));
+		publisher.join();
+		CHECK(reader.generation() == 5);
+
+		wutil::SharedSeqlockWriter::remove(Name);
+	}
+
+	void test_readers_never_see_torn_payloads()
+	{
+		wutil::SharedSeqlockWriter::remove(Name);
+
+		const size_t Words = Capacity / sizeof(uint64_t);
+		const uint64_t Publishes = 20000;
+
+		wutil::SharedSeqlockWriter writer(Name, Capacity, Layout);
+		CHECK(writer.publish(stamped(0, Words).data(), Capacity));
+
+		std::atomic<bool> done{ false };
+		std::atomic<int> torn{ 0 };
+		std::vector<std::thread> readers;
+		for (int i = 0; i < 4; ++i)
+		{
+			readers.emplace_back([&]()
+			{
+				wutil::SharedSeqlockReader reader(Name, Layout);
+				std::vector<unsigned char> payload;
+				uint64_t last = 0;
+				while (!done.load(std::memory_order_relaxed))
+				{
+					uint64_t generation = 0;
+					if (!reader.read(payload, &generation))
+						continue;
+
+					if (!consistent(payload) || generation < last)
+						torn.fetch_add(1, std::memory_order_relaxed);
+					last = generation;
+				}
+			});
+		}
+
+		for (uint64_t i = 1; i <= Publishes; ++i)
+		{
+			auto payload = stamped(i, 1 + i % Words);
+			writer.publish(payload.data(), payload.size() * sizeof(uint64_t));
+		}
+
+		done.store(true, std::memory_order_relaxed);
+		for (auto& reader : readers)
+			reader.join();
+
+		CHECK(torn.load() == 0);
+		CHECK(writer.generation() == Publishes + 1);
+
+		wutil::SharedSeqlockWriter::remove(Name);
+	}
+}
+
+int main()
+{
+	test_publish_and_read();
+	test_restarted_writer_keeps_counting();
+	test_wait();
+	test_readers_never_see_torn_payloads();
+
+	return test::test_result();
+}
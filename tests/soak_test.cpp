@@ -0,0 +1,371 @@
+#include "latency.h"
+#include "shared_seqlock.h"
+#include "trace_codec.h"
+#include "bitmap_scale.h"
+#include "check.h"
+
+#include <mutex>
+
+//=============================================================================
+// soak run over the portable simulated backends: a simulated display storms
+// hot plugs, dpi and mode changes through the broker seqlock while readers
+// check every topology they see, and a recorded trace of monitor
+// enumeration and dpi queries is replayed from all threads, which scale
+// bitmaps to the dpis they get back. usage: soak_test [milliseconds] [threads] [seed], build with
+// WUTIL_SANITIZE=thread to run it under the race detector
+//=============================================================================
+
+namespace
+{
+	const uint64_t Layout = 0x50a4;
+	const size_t Max_Monitors = 8;
+	const uint32_t Dpis[] = { 96, 120, 144, 168, 192 };
+
+#ifdef OS_WIN
+	const wutil::detail::SharedName Name = TEXT("Local\\wutil_soak_test");
+#else
+	const wutil::detail::SharedName Name = "/wutil_soak_test";
+#endif
+
+	struct SimulatedMonitor
+	{
+		uint32_t id;
+		uint32_t dpi;
+		uint32_t width;
+		uint32_t height;
+		uint32_t refresh_mhz;
+	};
+
+	// published as the monitors followed by their hash, a torn read fails the hash
+	struct SimulatedDisplay
+	{
+		std::mutex mutex;
+		std::vector<SimulatedMonitor> monitors;
+		uint32_t next_id = 1;
+		std::vector<unsigned char> payload;
+
+		bool publish(wutil::SharedSeqlockWriter& writer)
+		{
+			payload.clear();
+			wutil::detail::append_bytes(payload, monitors.data(), monitors.size());
+			auto hash = wutil::detail::fnv1a(payload.data(), payload.size());
+			wutil::detail::append_bytes(payload, &hash, 1);
+			return writer.publish(payload.data(), payload.size());
+		}
+	};
+
+	size_t capacity()
+	{
+		return Max_Monitors * sizeof(SimulatedMonitor) + sizeof(uint64_t);
+	}
+
+	bool valid_topology(const std::vector<unsigned char>& payload)
+	{
+		if (payload.size() < sizeof(uint64_t) || (payload.size() - sizeof(uint64_t)) % sizeof(SimulatedMonitor) != 0)
+			return false;
+
+		uint64_t hash = 0;
+		auto size = payload.size() - sizeof(hash);
+		std::memcpy(&hash, payload.data() + size, sizeof(hash));
+		return hash == wutil::detail::fnv1a(payload.data(), size) && size / sizeof(SimulatedMonitor) <= Max_Monitors;
+	}
+
+	SimulatedMonitor random_monitor(SimulatedDisplay& display, wutil::SoakThread& thread)
+	{
+		auto pick = [&thread](uint32_t count) { return static_cast<uint32_t>(thread.random() % count); };
+		return SimulatedMonitor{ display.next_id++, Dpis[pick(5)], 1280 + 640 * pick(4), 720 + 360 * pick(4), 59940 + 60 * pick(3) };
+	}
+
+	// dpi and rect of a monitor handle in the recorded trace, side by side
+	uint32_t recorded_dpi(uint64_t handle)
+	{
+		return Dpis[handle % 5];
+	}
+
+	struct RecordedRect
+	{
+		int32_t left;
+		int32_t top;
+		int32_t right;
+		int32_t bottom;
+	};
+
+	RecordedRect recorded_rect(uint64_t handle)
+	{
+		auto left = static_cast<int32_t>((handle - 1) * 2560);
+		return RecordedRect{ left, 0, left + 2560, 1440 };
+	}
+
+	bool same(const RecordedRect& a, const RecordedRect& b)
+	{
+		return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+	}
+
+	wutil::detail::TraceArgs monitor_args(uint64_t handle)
+	{
+		wutil::detail::TraceArgs args;
+		args.add(handle).add(uint32_t(0));
+		return args;
+	}
+
+	std::vector<unsigned char> recorded_trace()
+	{
+		wutil::TraceLog log(Layout);
+		std::vector<uint64_t> handles;
+		for (uint64_t handle = 1; handle <= Max_Monitors; ++handle)
+			handles.push_back(handle);
+		log.append(wutil::TraceCall::Enum_Display_Monitors, wutil::detail::TraceArgs(), 1, wutil::detail::trace_now_ns(), handles.data(),
+			handles.size() * sizeof(uint64_t));
+
+		for (auto handle : handles)
+		{
+			auto rect = recorded_rect(handle);
+			log.append(wutil::TraceCall::Get_Monitor_Info, monitor_args(handle), 1, wutil::detail::trace_now_ns(), &rect, sizeof(rect));
+			log.append(wutil::TraceCall::Get_Dpi_For_Monitor, monitor_args(handle), recorded_dpi(handle), wutil::detail::trace_now_ns(), nullptr, 0);
+		}
+
+		return log.encode();
+	}
+
+	// an opaque 16x16 bitmap of one gray, authored at 96 dpi
+	wutil::Bitmap make_icon()
+	{
+		wutil::Bitmap icon(16, 16);
+		for (size_t i = 0; i < icon.pixels.size(); i += 4)
+		{
+			icon.pixels[i + 0] = 80;
+			icon.pixels[i + 1] = 80;
+			icon.pixels[i + 2] = 80;
+			icon.pixels[i + 3] = 255;
+		}
+
+		return icon;
+	}
+
+	// scaled like scale_value, a flat bitmap stays flat at any size
+	bool scaled_icon(const wutil::Bitmap& scaled, uint32_t dpi)
+	{
+		auto size = static_cast<int>((16 * dpi + 48) / 96);
+		if (scaled.width != size || scaled.height != size)
+			return false;
+
+		for (size_t i = 0; i < scaled.pixels.size(); i += 4)
+		{
+			if (scaled.pixels[i] != 80 || scaled.pixels[i + 3] != 255)
+				return false;
+		}
+
+		return true;
+	}
+
+	void test_display_storm(const wutil::SoakHarness::Options& options)
+	{
+		wutil::SharedSeqlockWriter::remove(Name);
+		wutil::SharedSeqlockWriter writer(Name, capacity(), Layout);
+		CHECK(writer.is_open());
+
+		SimulatedDisplay display;
+		wutil::SoakThread setup;
+		display.monitors.push_back(random_monitor(display, setup));
+		CHECK(display.publish(writer));
+
+		auto trace = recorded_trace();
+		wutil::TraceReplay replay;
+		CHECK(replay.decode(trace.data(), trace.size(), Layout));
+
+		auto icon = make_icon();
+		wutil::ResampleOptions single_thread;
+		single_thread.threads = 1;
+
+		// each thread only touches its own reader and last generation
+		std::vector<std::unique_ptr<wutil::SharedSeqlockReader>> readers(static_cast<size_t>(options.threads));
+		std::vector<uint64_t> last_generation(static_cast<size_t>(options.threads));
+		auto reader_of = [&](wutil::SoakThread& thread) -> wutil::SharedSeqlockReader&
+		{
+			auto& reader = readers[static_cast<size_t>(thread.index)];
+			if (reader == nullptr)
+				reader = std::make_unique<wutil::SharedSeqlockReader>(Name, Layout);
+			return *reader;
+		};
+
+		wutil::SoakHarness harness;
+		harness.add("hot plug", 1, [&](wutil::SoakThread& thread)
+		{
+			std::lock_guard<std::mutex> lock(display.mutex);
+			bool unplug = display.monitors.size() == Max_Monitors || (display.monitors.size() > 1 && (thread.random() & 1));
+			if (unplug)
+				display.monitors.erase(display.monitors.begin() + static_cast<ptrdiff_t>(thread.random() % display.monitors.size()));
+			else
+				display.monitors.push_back(random_monitor(display, thread));
+
+			return display.publish(writer);
+		});
+
+		harness.add("dpi change", 1, [&](wutil::SoakThread& thread)
+		{
+			std::lock_guard<std::mutex> lock(display.mutex);
+			display.monitors[thread.random() % display.monitors.size()].dpi = Dpis[thread.random() % 5];
+			return display.publish(writer);
+		});
+
+		harness.add("mode change", 1, [&](wutil::SoakThread& thread)
+		{
+			std::lock_guard<std::mutex> lock(display.mutex);
+			auto& monitor = display.monitors[thread.random() % display.monitors.size()];
+			auto replacement = random_monitor(display, thread);
+			monitor.width = replacement.width;
+			monitor.height = replacement.height;
+			monitor.refresh_mhz = replacement.refresh_mhz;
+			return display.publish(writer);
+		});
+
+		harness.add("read topology", 20, [&](wutil::SoakThread& thread)
+		{
+			std::vector<unsigned char> payload;
+			uint64_t generation = 0;
+			if (!reader_of(thread).read(payload, &generation))
+				return false;
+
+			// generations never go backwards for one reader
+			auto& last = last_generation[static_cast<size_t>(thread.index)];
+			bool ordered = generation >= last;
+			last = generation;
+			return ordered && valid_topology(payload);
+		});
+
+		harness.add("wait for topology", 2, [&](wutil::SoakThread& thread)
+		{
+			auto& reader = reader_of(thread);
+			auto generation = reader.generation();
+			reader.wait(generation, 2);
+			return reader.generation() >= generation;
+		});
+
+		harness.add("replay dpi", 20, [&](wutil::SoakThread& thread)
+		{
+			uint64_t handle = 1 + thread.random() % Max_Monitors;
+			auto entry = replay.lookup(wutil::TraceCall::Get_Dpi_For_Monitor, monitor_args(handle), false);
+			return entry != nullptr && entry->result == recorded_dpi(handle);
+		});
+
+		harness.add("replay enumeration", 5, [&](wutil::SoakThread&)
+		{
+			auto monitors = replay.lookup(wutil::TraceCall::Enum_Display_Monitors, wutil::detail::TraceArgs(), false);
+			if (monitors == nullptr || monitors->out.size() != Max_Monitors * sizeof(uint64_t))
+				return false;
+
+			for (size_t i = 0; i < Max_Monitors; ++i)
+			{
+				uint64_t handle = 0;
+				std::memcpy(&handle, monitors->out.data() + i * sizeof(handle), sizeof(handle));
+				auto info = replay.lookup(wutil::TraceCall::Get_Monitor_Info, monitor_args(handle), false);
+				RecordedRect rect{};
+				if (info == nullptr || info->out.size() != sizeof(rect))
+					return false;
+
+				std::memcpy(&rect, info->out.data(), sizeof(rect));
+				if (!same(rect, recorded_rect(handle)))
+					return false;
+			}
+
+			return true;
+		});
+
+		harness.add("scale to monitor dpi", 5, [&](wutil::SoakThread& thread)
+		{
+			uint64_t handle = 1 + thread.random() % Max_Monitors;
+			auto entry = replay.lookup(wutil::TraceCall::Get_Dpi_For_Monitor, monitor_args(handle), false);
+			if (entry == nullptr)
+				return false;
+
+			auto dpi = static_cast<uint32_t>(entry->result);
+			return scaled_icon(wutil::scale_bitmap(icon.view(), dpi, single_thread), dpi);
+		});
+
+		harness.add("replay rewind", 1, [&](wutil::SoakThread&)
+		{
+			replay.rewind();
+			return true;
+		});
+
+		auto report = harness.run(options);
+		report.print();
+
+		CHECK(report.passed());
+		for (const auto& action : report.actions)
+			CHECK(action.count > 0);
+		// rewinds keep the count, a miss anywhere in the run shows here
+		CHECK(replay.misses() == 0);
+
+		wutil::SharedSeqlockWriter::remove(Name);
+	}
+
+	void test_no_actions()
+	{
+		wutil::SoakHarness harness;
+		wutil::SoakHarness::Options options;
+		options.duration = std::chrono::milliseconds(5000);
+
+		// no threads start, the watchdog must not wait for them
+		auto start = std::chrono::steady_clock::now();
+		auto report = harness.run(options);
+		CHECK(report.actions.empty() && report.passed());
+		CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000));
+	}
+
+	void test_watchdog_reports_stalls()
+	{
+		wutil::SoakHarness harness;
+		harness.add("quick", 1, [](wutil::SoakThread&) { return true; });
+		harness.add("stuck", 1, [](wutil::SoakThread&)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			return true;
+		}, true);
+
+		wutil::SoakHarness::Options options;
+		options.threads = 2;
+		options.duration = std::chrono::milliseconds(2000);
+		options.stall_timeout = std::chrono::milliseconds(40);
+
+		auto start = std::chrono::steady_clock::now();
+		auto report = harness.run(options);
+		CHECK(report.stalled);
+		CHECK(report.stalled_action == "stuck");
+		CHECK(!report.passed());
+
+		// the stall ended the run early
+		CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000));
+	}
+
+	void test_inconsistent_results_are_failures()
+	{
+		wutil::SoakHarness harness;
+		harness.add("flaky", 1, [](wutil::SoakThread& thread) { return thread.random() % 4 != 0; });
+
+		wutil::SoakHarness::Options options;
+		options.threads = 2;
+		options.duration = std::chrono::milliseconds(20);
+
+		auto report = harness.run(options);
+		CHECK(!report.stalled);
+		CHECK(report.failures() > 0 && report.failures() < report.actions[0].count);
+		CHECK(!report.passed());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	wutil::SoakHarness::Options options;
+	options.duration = std::chrono::milliseconds(argc > 1 ? std::atoi(argv[1]) : 500);
+	options.threads = argc > 2 ? (std::max)(std::atoi(argv[2]), 1) : 8;
+	options.seed = argc > 3 ? static_cast<uint64_t>(std::atoll(argv[3])) : 1;
+	options.on_abort = [](const wutil::SoakReport& report) { report.print(stderr); };
+
+	test_display_storm(options);
+	test_no_actions();
+	test_watchdog_reports_stalls();
+	test_inconsistent_results_are_failures();
+
+	return test::test_result();
+}
@@ -0,0 +1,129 @@
+#include "wutil.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// SystemMetricsCache on the simulated backend: entries filled per dpi from
+// SystemParametersInfoForDpi through its W structs, the scaled fallback
+// when the dpi aware calls are missing, WM_SETTINGCHANGE dropping every
+// entry, and the hit rate
+//=============================================================================
+
+namespace
+{
+	bool segoe(const LOGFONT& font)
+	{
+		return wutil::tstring_view(font.lfFaceName) == TEXT("Segoe UI");
+	}
+
+	UINT system_dpi()
+	{
+		HDC screen_dc = GetDC(NULL);
+		UINT dpi = screen_dc ? GetDeviceCaps(screen_dc, LOGPIXELSY) : 96;
+		ReleaseDC(NULL, screen_dc);
+		return dpi == 0 ? 96 : dpi;
+	}
+
+	void test_fill_per_dpi()
+	{
+		fake::reset({});
+		wutil::SystemMetricsCache cache;
+
+		const auto& ncm = cache.non_client_metrics(144);
+		CHECK(fake::display.calls.system_parameters_info_for_dpi == 3 && fake::display.calls.system_parameters_info == 0);
+		CHECK(ncm.cbSize == sizeof(NONCLIENTMETRICS));
+		CHECK(ncm.iCaptionHeight == MulDiv(23, 144, 96) && ncm.iPaddedBorderWidth == MulDiv(4, 144, 96));
+		CHECK(ncm.lfCaptionFont.lfHeight == -MulDiv(12, 144, 96) && ncm.lfCaptionFont.lfWeight == 400 && segoe(ncm.lfCaptionFont));
+
+		const auto& icon = cache.icon_metrics(144);
+		CHECK(icon.cbSize == sizeof(ICONMETRICS) && icon.iHorzSpacing == MulDiv(75, 144, 96) && segoe(icon.lfFont));
+		CHECK(cache.icon_title_font(144).lfHeight == -MulDiv(12, 144, 96) && segoe(cache.icon_title_font(144)));
+
+		CHECK(cache.system_metric(SM_CYCAPTION, 144) == fake::get_system_metrics_for_dpi(SM_CYCAPTION, 144));
+		CHECK(cache.system_metric(SM_CXICON, 192) == fake::get_system_metrics_for_dpi(SM_CXICON, 192));
+
+		// each dpi is its own entry, filled once
+		CHECK(cache.non_client_metrics(96).iCaptionHeight == 23);
+		CHECK(cache.non_client_metrics(144).iCaptionHeight == MulDiv(23, 144, 96));
+		CHECK(fake::display.calls.system_parameters_info_for_dpi == 9);
+	}
+
+	void test_fallback_without_for_dpi()
+	{
+		fake::reset({});
+		auto& api = wutil::detail::display_api;
+		auto for_dpi = api.system_parameters_info_for_dpi;
+		api.system_parameters_info_for_dpi = nullptr;
+
+		// the system dpi metrics scaled from the system dpi
+		auto base = system_dpi();
+		wutil::SystemMetricsCache cache;
+		const auto& ncm = cache.non_client_metrics(192);
+		CHECK(fake::display.calls.system_parameters_info == 3 && fake::display.calls.system_parameters_info_for_dpi == 0);
+		CHECK(ncm.iCaptionHeight == MulDiv(23, 192, base) && ncm.iBorderWidth == MulDiv(1, 192, base));
+		CHECK(ncm.lfCaptionFont.lfHeight == MulDiv(-12, 192, base) && segoe(ncm.lfCaptionFont));
+		CHECK(cache.icon_metrics(192).iVertSpacing == MulDiv(75, 192, base));
+		CHECK(cache.system_metric(SM_CYCAPTION, 192) == MulDiv(GetSystemMetrics(SM_CYCAPTION), 192, base));
+
+		// not scaled with dpi, passed through
+		CHECK(cache.system_metric(SM_CXSCREEN, 192) == GetSystemMetrics(SM_CXSCREEN));
+
+		api.system_parameters_info_for_dpi = for_dpi;
+	}
+
+	void test_setting_change_invalidates()
+	{
+		fake::reset({});
+		wutil::SystemMetricsCache cache;
+		cache.non_client_metrics(96);
+		cache.non_client_metrics(144);
+		CHECK(fake::display.calls.system_parameters_info_for_dpi == 6);
+
+		CHECK(!cache.handle_message(WM_DISPLAYCHANGE));
+		cache.non_client_metrics(96);
+		CHECK(fake::display.calls.system_parameters_info_for_dpi == 6);
+
+		// both dpis are asked for again
+		CHECK(cache.handle_message(WM_SETTINGCHANGE));
+		cache.non_client_metrics(96);
+		cache.icon_metrics(144);
+		CHECK(fake::display.calls.system_parameters_info_for_dpi == 12);
+		CHECK(cache.misses() == 4);
+	}
+
+	void test_hit_rate()
+	{
+		fake::reset({});
+		wutil::SystemMetricsCache cache;
+		CHECK(cache.hit_rate() == 0.0);
+
+		cache.non_client_metrics(120);
+		CHECK(cache.hits() == 0 && cache.misses() == 1 && cache.hit_rate() == 0.0);
+
+		cache.icon_metrics(120);
+		cache.icon_title_font(120);
+		cache.system_metric(SM_CXBORDER, 120);
+		CHECK(cache.hits() == 3 && cache.hit_rate() == 0.75);
+
+		// indices past SM_CMETRICS bypass the cache and count as neither
+		cache.system_metric(SM_CMETRICS + 1, 120);
+		CHECK(cache.hits() == 3 && cache.misses() == 1);
+
+		// invalidation keeps the counts
+		cache.invalidate();
+		cache.non_client_metrics(120);
+		CHECK(cache.hits() == 3 && cache.misses() == 2 && cache.hit_rate() == 0.6);
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_fill_per_dpi();
+	test_fallback_without_for_dpi();
+	test_setting_change_invalidates();
+	test_hit_rate();
+
+	return test::test_result();
+}
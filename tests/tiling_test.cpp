@@ -0,0 +1,193 @@
+#include "tiling.h"
+#include "check.h"
+
+#include <random>
+
+//=============================================================================
+// TilingSolver layouts over three monitors of mixed dpi with offset work
+// areas: cells never overlap and stay inside the work area of the monitor
+// they were placed on, pins hold, minimums are met or counted as unmet, and
+// the incremental updates land where a full solve would
+//=============================================================================
+
+namespace
+{
+	const wutil::TileMonitor Monitors[] = {
+		{ { 0, 40, 1920, 1080 }, 96 },
+		{ { 1920, 0, 4480, 1400 }, 144 },
+		{ { -3840, -200, 0, 1920 }, 192 }
+	};
+
+	const int Monitor_Count = static_cast<int>(std::size(Monitors));
+
+	bool overlap(const RECT& a, const RECT& b)
+	{
+		return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+	}
+
+	bool inside(const RECT& rect, const RECT& work)
+	{
+		return rect.left >= work.left && rect.top >= work.top && rect.right <= work.right && rect.bottom <= work.bottom &&
+			rect.left < rect.right && rect.top < rect.bottom;
+	}
+
+	bool same(const std::vector<RECT>& a, const std::vector<RECT>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i].left != b[i].left || a[i].top != b[i].top || a[i].right != b[i].right || a[i].bottom != b[i].bottom)
+				return false;
+		}
+
+		return true;
+	}
+
+	std::vector<wutil::TileConstraints> make_windows(size_t count, std::mt19937& random, bool pin_all)
+	{
+		std::vector<wutil::TileConstraints> windows(count);
+		for (auto& window : windows)
+		{
+			window.min_size = { static_cast<LONG>(random() % 40 + 8), static_cast<LONG>(random() % 30 + 8) };
+			window.weight = static_cast<uint32_t>(random() % 4);
+			if (pin_all || random() % 4 == 0)
+				window.pinned_monitor = static_cast<int>(random() % std::size(Monitors));
+		}
+
+		return windows;
+	}
+
+	// every window inside its monitor's work area, pins kept and no two cells overlapping
+	bool valid_layout(const wutil::TilingSolver& solver, const std::vector<wutil::TileConstraints>& windows, const std::vector<RECT>& rects)
+	{
+		for (size_t i = 0; i < windows.size(); ++i)
+		{
+			auto monitor = solver.monitor_of(i);
+			if (monitor < 0 || monitor >= Monitor_Count || !inside(rects[i], Monitors[monitor].work))
+				return false;
+
+			int pinned = windows[i].pinned_monitor;
+			if (pinned >= 0 && pinned < Monitor_Count && pinned != monitor)
+				return false;
+
+			for (size_t j = i + 1; j < windows.size(); ++j)
+			{
+				if (overlap(rects[i], rects[j]))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	void test_layouts_are_valid()
+	{
+		std::mt19937 random(42);
+		wutil::TilingSolver solver;
+		for (size_t count : { 1, 2, 3, 7, 20, 64, 200 })
+		{
+			auto windows = make_windows(count, random, false);
+			std::vector<RECT> rects(count);
+			CHECK(solver.solve(Monitors, windows, rects) == 0);
+			CHECK(valid_layout(solver, windows, rects));
+
+			// room for everyone, so every cell is at least its minimum at its monitor's dpi
+			for (size_t i = 0; i < count; ++i)
+			{
+				auto dpi = Monitors[solver.monitor_of(i)].dpi;
+				CHECK(rects[i].right - rects[i].left >= wutil::scale_value(windows[i].min_size.cx, dpi));
+				CHECK(rects[i].bottom - rects[i].top >= wutil::scale_value(windows[i].min_size.cy, dpi));
+			}
+		}
+	}
+
+	void test_pins()
+	{
+		std::vector<wutil::TileConstraints> windows(9);
+		windows[0].pinned_monitor = 2;
+		windows[1].pinned_monitor = 2;
+		windows[2].pinned_monitor = 0;
+		// out of range pins let the solver choose
+		windows[3].pinned_monitor = 7;
+
+		std::vector<RECT> rects(windows.size());
+		wutil::TilingSolver solver;
+		CHECK(solver.solve(Monitors, windows, rects) == 0);
+		CHECK(valid_layout(solver, windows, rects));
+		CHECK(solver.monitor_of(0) == 2 && solver.monitor_of(1) == 2 && solver.monitor_of(2) == 0);
+		CHECK(solver.monitor_of(3) >= 0 && solver.monitor_of(3) < Monitor_Count);
+		CHECK(solver.monitor_of(windows.size()) == -1);
+	}
+
+	void test_unmet_minimums()
+	{
+		const wutil::TileMonitor Small[] = { { { 0, 0, 800, 600 }, 96 } };
+		std::vector<RECT> rects(4);
+		wutil::TilingSolver solver;
+
+		// a 2x2 grid of 300x200 cells fits
+		std::vector<wutil::TileConstraints> windows(4);
+		for (auto& window : windows)
+			window.min_size = { 300, 200 };
+		CHECK(solver.solve(Small, windows, rects) == 0);
+
+		// one window too wide for its row, both cells of the row shrink below their minimum
+		windows[0].min_size.cx = 600;
+		CHECK(solver.solve(Small, windows, rects) == 2);
+
+		// and too tall, both rows shrink as well
+		windows[0].min_size.cy = 500;
+		CHECK(solver.solve(Small, windows, rects) == 4);
+
+		// shrunk cells still share the work area without overlapping
+		for (size_t i = 0; i < rects.size(); ++i)
+		{
+			CHECK(inside(rects[i], Small[0].work));
+			for (size_t j = i + 1; j < rects.size(); ++j)
+				CHECK(!overlap(rects[i], rects[j]));
+		}
+	}
+
+	void test_updates_match_full_solve()
+	{
+		std::mt19937 random(7);
+		auto windows = make_windows(40, random, true);
+		std::vector<RECT> rects(windows.size());
+		std::vector<RECT> expected(windows.size());
+
+		wutil::TilingSolver solver;
+		solver.solve(Monitors, windows, rects);
+
+		// re-pin to another monitor, both monitors are laid out again
+		for (size_t window : { 0, 13, 39 })
+		{
+			windows[window].pinned_monitor = (windows[window].pinned_monitor + 1) % Monitor_Count;
+			solver.update_window(window, Monitors, windows, rects);
+
+			wutil::TilingSolver full;
+			full.solve(Monitors, windows, expected);
+			CHECK(same(rects, expected));
+			CHECK(solver.monitor_of(window) == windows[window].pinned_monitor);
+			CHECK(valid_layout(solver, windows, rects));
+		}
+
+		// a new minimum on the same monitor
+		windows[5].min_size = { 400, 300 };
+		solver.update_window(5, Monitors, windows, rects);
+		wutil::TilingSolver full;
+		full.solve(Monitors, windows, expected);
+		CHECK(same(rects, expected));
+	}
+}
+
+int main()
+{
+	test_layouts_are_valid();
+	test_pins();
+	test_unmet_minimums();
+	test_updates_match_full_solve();
+
+	return test::test_result();
+}
@@ -0,0 +1,69 @@
+#include "topology_broker.h"
+#include "fake_display.h"
+#include "check.h"
+
+//=============================================================================
+// a simulated topology through the broker and back, the seqlock underneath
+// is covered by shared_seqlock_test
+//=============================================================================
+
+namespace
+{
+	const wutil::tstring Name = TEXT("Local\\wutil_topology_broker_test");
+
+	wutil::Topology simulated_topology()
+	{
+		fake::reset({ fake::make_monitor(1, { 0, 0, 2560, 1440 }, 144, true), fake::make_monitor(2, { 2560, 0, 4480, 1080 }) });
+		return wutil::get_topology();
+	}
+
+	void test_round_trip()
+	{
+		auto topology = simulated_topology();
+		wutil::TopologyBroker broker(Name);
+		wutil::TopologyBrokerReader reader(Name);
+		CHECK(broker.is_open());
+		CHECK(broker.publish(topology));
+
+		wutil::Topology read;
+		uint64_t generation = 0;
+		CHECK(reader.read(read, &generation));
+		CHECK(generation == 1);
+		CHECK(read.devices.size() == topology.devices.size());
+		CHECK(read.monitors.size() == 2 && read.ids == topology.ids && read.dpis == topology.dpis);
+		if (CHECK(read.modes.size() == 2 && read.modes[1].size() == topology.modes[1].size()))
+			CHECK(read.modes[0][0].dmPelsWidth == 2560 && lstrcmp(read.modes[0][0].dmDeviceName, TEXT("\\\\.\\DISPLAY1")) == 0);
+	}
+
+	void test_mismatched_topology_is_rejected()
+	{
+		auto topology = simulated_topology();
+		wutil::TopologyBroker broker(Name);
+		CHECK(broker.publish(topology));
+		auto generation = broker.generation();
+
+		auto missing_ids = topology;
+		missing_ids.ids.pop_back();
+		CHECK(!broker.publish(missing_ids));
+
+		auto missing_dpis = topology;
+		missing_dpis.dpis.clear();
+		CHECK(!broker.publish(missing_dpis));
+
+		auto missing_modes = topology;
+		missing_modes.modes.pop_back();
+		CHECK(!broker.publish(missing_modes));
+
+		CHECK(broker.generation() == generation);
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_round_trip();
+	test_mismatched_topology_is_rejected();
+
+	return test::test_result();
+}
@@ -0,0 +1,159 @@
+#include "topology_diff.h"
+#include "fake_display.h"
+#include "check.h"
+
+#include <algorithm>
+
+//=============================================================================
+// diffs of simulated topologies and the windows they name, in particular two
+// monitors of identical hardware sharing an id where only one changes
+//=============================================================================
+
+namespace
+{
+	const HWND Left = reinterpret_cast<HWND>(0x10);
+	const HWND Right = reinterpret_cast<HWND>(0x20);
+	const HWND By_Id = reinterpret_cast<HWND>(0x30);
+
+	// two monitors of the same model without serial numbers, one window on each
+	void install_identical_monitors()
+	{
+		auto left = fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true);
+		auto right = fake::make_monitor(2, { 1920, 0, 3840, 1080 });
+		right.interface_path = left.interface_path;
+		fake::reset({ left, right });
+		fake::display.windows = { { Left, 0 }, { Right, 1 }, { By_Id, 1 } };
+	}
+
+	std::vector<HWND> sorted(std::vector<HWND> windows)
+	{
+		std::sort(windows.begin(), windows.end());
+		return windows;
+	}
+
+	void test_flags()
+	{
+		fake::reset({ fake::make_monitor(1, { 0, 0, 1920, 1080 }, 96, true), fake::make_monitor(2, { 1920, 0, 3840, 1080 }) });
+		auto previous = wutil::get_topology();
+		CHECK(wutil::diff_topology(previous, previous).empty());
+
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			auto& second = fake::display.monitors[1];
+			second.dpi = 144;
+			second.work.bottom -= 20;
+			second.primary = true;
+			fake::display.monitors[0].primary = false;
+			fake::display.monitors.push_back(fake::make_monitor(3, { 3840, 0, 5760, 1080 }));
+		}
+		auto current = wutil::get_topology();
+		auto diff = wutil::diff_topology(previous, current);
+
+		auto first = diff.find(previous.ids[0]);
+		auto second = diff.find(previous.ids[1]);
+		auto third = diff.find(current.ids[2]);
+		if (!CHECK(first && second && third))
+			return;
+
+		CHECK(first->flags == wutil::Monitor_Primary_Changed);
+		CHECK(second->flags == (wutil::Monitor_Dpi_Changed | wutil::Monitor_Work_Area_Changed | wutil::Monitor_Primary_Changed));
+		CHECK(third->flags == wutil::Monitor_Added && third->previous_index == SIZE_MAX && third->current_index == 2);
+
+		// removing a monitor
+		diff = wutil::diff_topology(current, previous);
+		auto removed = diff.find(current.ids[2]);
+		CHECK(removed != nullptr && removed->flags == wutil::Monitor_Removed && removed->previous_index == 2);
+	}
+
+	void test_identical_monitors_pair_in_order()
+	{
+		install_identical_monitors();
+		auto previous = wutil::get_topology();
+		CHECK(previous.ids[0] == previous.ids[1]);
+
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			fake::display.monitors[1].dpi = 144;
+		}
+		auto diff = wutil::diff_topology(previous, wutil::get_topology());
+		if (!CHECK(diff.changes.size() == 1))
+			return;
+
+		CHECK(diff.changes[0].previous_index == 1 && diff.changes[0].flags == wutil::Monitor_Dpi_Changed);
+		CHECK(diff.find(previous.ids[0], 0) == nullptr);
+		CHECK(diff.find(previous.ids[0], 1) == &diff.changes[0]);
+	}
+
+	void test_affected_windows_of_identical_monitors()
+	{
+		install_identical_monitors();
+		auto previous = wutil::get_topology();
+
+		wutil::WindowRegistry registry;
+		registry.add(Left, previous);
+		registry.add(Right, previous);
+		registry.add(By_Id);
+		CHECK(registry.size() == 3);
+		CHECK(registry.monitor(Left) == previous.ids[0] && registry.monitor(Right) == previous.ids[1]);
+
+		// only the right monitor changes dpi, the left window shares its id but is not affected
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			fake::display.monitors[1].dpi = 144;
+		}
+		auto current = wutil::get_topology();
+		auto diff = wutil::diff_topology(previous, current);
+		CHECK(sorted(registry.affected(diff)) == sorted({ Right, By_Id }));
+
+		// both change in different ways, each window sees its own monitor's flags
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			fake::display.monitors[0].work.bottom -= 30;
+		}
+		current = wutil::get_topology();
+		diff = wutil::diff_topology(previous, current);
+		CHECK(diff.changes.size() == 2);
+		CHECK(sorted(registry.affected(diff, wutil::Monitor_Dpi_Changed)) == sorted({ Right, By_Id }));
+		CHECK(sorted(registry.affected(diff, wutil::Monitor_Work_Area_Changed)) == sorted({ Left, By_Id }));
+		CHECK(registry.affected(diff, wutil::Monitor_Moved).empty());
+	}
+
+	void test_update_between_identical_monitors()
+	{
+		install_identical_monitors();
+		auto topology = wutil::get_topology();
+
+		wutil::WindowRegistry registry;
+		registry.add(Left, topology);
+		CHECK(!registry.update(Left, topology));
+
+		// moving to the other monitor keeps the id, only the topology shows the move
+		fake::display.windows = { { Left, 1 } };
+		CHECK(!registry.update(Left));
+		CHECK(registry.update(Left, topology));
+		CHECK(!registry.update(Left, topology));
+
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			fake::display.monitors[0].dpi = 144;
+		}
+		auto diff = wutil::diff_topology(topology, wutil::get_topology());
+		CHECK(registry.affected(diff).empty());
+
+		registry.remove(Left);
+		CHECK(registry.size() == 0 && !registry.monitor(Left));
+		CHECK(!registry.update(Left));
+	}
+}
+
+int main()
+{
+	fake::install();
+
+	test_flags();
+	test_identical_monitors_pair_in_order();
+	test_affected_windows_of_identical_monitors();
+	test_update_between_identical_monitors();
+
+	return test::test_result();
+}
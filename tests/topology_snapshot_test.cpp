@@ -0,0 +1,225 @@
+#include "topology_snapshot.h"
+#include "fake_display.h"
+#include "check.h"
+
+#include <filesystem>
+#include <fstream>
+
+//=============================================================================
+// snapshots of simulated monitors: cold and warm starts, stale and corrupt
+// files, and the dpi context of the background validation
+//=============================================================================
+
+namespace
+{
+	const wutil::tstring Path = TEXT("wutil_topology_snapshot_test.bin");
+
+	const DPI_AWARENESS_CONTEXT Unaware_Handle = reinterpret_cast<DPI_AWARENESS_CONTEXT>(0x10);
+	const DPI_AWARENESS_CONTEXT Per_Monitor_Handle = reinterpret_cast<DPI_AWARENESS_CONTEXT>(0x12);
+
+	// thread dpi contexts as user32 keeps them, threads start unaware. and
+	// the context enumeration last ran in
+	thread_local DPI_AWARENESS_CONTEXT thread_context = nullptr;
+	DPI_AWARENESS_CONTEXT enumerated_context = nullptr;
+
+	DPI_AWARENESS_CONTEXT WINAPI fake_get_thread_dpi_awareness_context()
+	{
+		return thread_context != nullptr ? thread_context : Unaware_Handle;
+	}
+
+	DPI_AWARENESS_CONTEXT WINAPI fake_set_thread_dpi_awareness_context(DPI_AWARENESS_CONTEXT context)
+	{
+		auto previous = fake_get_thread_dpi_awareness_context();
+		thread_context = context == DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE ? Per_Monitor_Handle : context;
+		return previous;
+	}
+
+	DPI_AWARENESS WINAPI fake_get_awareness_from_dpi_awareness_context(DPI_AWARENESS_CONTEXT context)
+	{
+		return context == Per_Monitor_Handle ? DPI_AWARENESS_PER_MONITOR_AWARE : DPI_AWARENESS_UNAWARE;
+	}
+
+	BOOL WINAPI recording_enum_display_monitors(HDC hdc, LPCRECT clip, MONITORENUMPROC proc, LPARAM data)
+	{
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			enumerated_context = fake_get_thread_dpi_awareness_context();
+		}
+
+		return fake::enum_display_monitors(hdc, clip, proc, data);
+	}
+
+	void install_monitors()
+	{
+		fake::reset({ fake::make_monitor(1, { 0, 0, 2560, 1440 }, 144, true), fake::make_monitor(2, { 2560, 0, 4480, 1080 }) });
+	}
+
+	bool same(const wutil::Topology& a, const wutil::Topology& b)
+	{
+		// like windows, the write fails while any view of Path is open
+		if (!wutil::write_topology_snapshot(Path, 1, a))
+			return false;
+
+		wutil::TopologySnapshotView view;
+		return view.open(Path, 1) == wutil::SnapshotStatus::Loaded && view.matches(b);
+	}
+
+	void overwrite_byte(std::streamoff offset, char value)
+	{
+		std::fstream file(std::filesystem::path(Path), std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(offset);
+		file.put(value);
+	}
+
+	void test_cold_then_warm()
+	{
+		std::filesystem::remove(std::filesystem::path(Path));
+		install_monitors();
+
+		auto cold = wutil::load_topology_warm(Path);
+		CHECK(cold.status == wutil::SnapshotStatus::Missing);
+		CHECK(!cold.validation.valid());
+		CHECK(cold.topology.monitors.size() == 2);
+		CHECK(fake::display.calls.enum_display_settings_ex > 0);
+
+		// the warm path reads the snapshot and only enumerates adapters for the fingerprint
+		fake::display.calls = {};
+		{
+			wutil::TopologySnapshotView view;
+			CHECK(view.open(Path, wutil::get_display_fingerprint()) == wutil::SnapshotStatus::Loaded);
+			CHECK(fake::display.calls.total() == fake::display.calls.enum_display_devices);
+			CHECK(view.monitors().size() == 2 && view.dpi(0) == 144 && view.id(1) == cold.topology.ids[1]);
+			CHECK(view.modes(1).size() == 3 && view.mode(1, 0).dmPelsWidth == 1920);
+			CHECK(view.matches(cold.topology));
+		}
+
+		auto warm = wutil::load_topology_warm(Path);
+		CHECK(warm.status == wutil::SnapshotStatus::Loaded);
+		CHECK(warm.validation.valid());
+		CHECK(!warm.validation.get().has_value());
+		CHECK(same(warm.topology, cold.topology));
+	}
+
+	void test_changed_mode_is_revalidated()
+	{
+		std::filesystem::remove(std::filesystem::path(Path));
+		install_monitors();
+		wutil::load_topology_warm(Path);
+
+		// same hardware, so the same fingerprint, but another current mode
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			std::swap(fake::display.monitors[1].modes[0], fake::display.monitors[1].modes[1]);
+		}
+
+		auto warm = wutil::load_topology_warm(Path);
+		CHECK(warm.status == wutil::SnapshotStatus::Loaded);
+		auto fresh = warm.validation.get();
+		CHECK(fresh.has_value() && fresh->modes[1][0].dmPelsWidth == 1280);
+
+		// the fresh topology replaced the snapshot
+		wutil::TopologySnapshotView view;
+		CHECK(view.open(Path, wutil::get_display_fingerprint()) == wutil::SnapshotStatus::Loaded);
+		CHECK(fresh.has_value() && view.matches(*fresh));
+	}
+
+	void test_stale_fingerprint()
+	{
+		std::filesystem::remove(std::filesystem::path(Path));
+		install_monitors();
+		wutil::load_topology_warm(Path);
+		auto old_fingerprint = wutil::get_display_fingerprint();
+
+		// a third monitor is new hardware
+		{
+			std::lock_guard<std::recursive_mutex> lock(fake::mutex);
+			fake::display.monitors.push_back(fake::make_monitor(3, { 4480, 0, 6400, 1080 }));
+		}
+
+		auto fingerprint = wutil::get_display_fingerprint();
+		CHECK(fingerprint != old_fingerprint);
+
+		wutil::TopologySnapshotView view;
+		CHECK(view.open(Path, fingerprint) == wutil::SnapshotStatus::Stale);
+		CHECK(!view.is_open());
+
+		auto warm = wutil::load_topology_warm(Path);
+		CHECK(warm.status == wutil::SnapshotStatus::Stale);
+		CHECK(warm.topology.monitors.size() == 3);
+		CHECK(view.open(Path, fingerprint) == wutil::SnapshotStatus::Loaded);
+	}
+
+	void test_corrupt_files()
+	{
+		install_monitors();
+		auto fingerprint = wutil::get_display_fingerprint();
+		auto topology = wutil::get_topology();
+		wutil::TopologySnapshotView view;
+
+		// truncated
+		CHECK(wutil::write_topology_snapshot(Path, fingerprint, topology));
+		auto size = std::filesystem::file_size(std::filesystem::path(Path));
+		std::filesystem::resize_file(std::filesystem::path(Path), size - 1);
+		CHECK(view.open(Path, fingerprint) == wutil::SnapshotStatus::Corrupt);
+
+		// shorter than a header
+		std::filesystem::resize_file(std::filesystem::path(Path), sizeof(wutil::detail::SnapshotHeader) - 1);
+		CHECK(view.open(Path, fingerprint) == wutil::SnapshotStatus::Corrupt);
+
+		// a flipped payload byte fails the hash
+		CHECK(wutil::write_topology_snapshot(Path, fingerprint, topology));
+		overwrite_byte(static_cast<std::streamoff>(size - 1), 0x5a);
+		CHECK(view.open(Path, fingerprint) == wutil::SnapshotStatus::Corrupt);
+
+		// not a snapshot
+		CHECK(wutil::write_topology_snapshot(Path, fingerprint, topology));
+		overwrite_byte(0, 'X');
+		CHECK(view.open(Path, fingerprint) == wutil::SnapshotStatus::Corrupt);
+		CHECK(!view.is_open());
+
+		// a warm start rebuilds and rewrites a corrupt snapshot
+		auto warm = wutil::load_topology_warm(Path);
+		CHECK(warm.status == wutil::SnapshotStatus::Corrupt);
+		CHECK(warm.topology.monitors.size() == 2);
+		CHECK(view.open(Path, fingerprint) == wutil::SnapshotStatus::Loaded);
+
+		std::filesystem::remove(std::filesystem::path(Path));
+		CHECK(view.open(Path, fingerprint) == wutil::SnapshotStatus::Missing);
+	}
+
+	void test_validation_uses_the_callers_dpi_context()
+	{
+		std::filesystem::remove(std::filesystem::path(Path));
+		install_monitors();
+		wutil::load_topology_warm(Path);
+
+		// worker threads start unaware, the caller is per monitor aware
+		wutil::ScopedDpiContext scoped(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE);
+		CHECK(wutil::get_thread_dpi_context() == Per_Monitor_Handle);
+
+		enumerated_context = nullptr;
+		auto warm = wutil::load_topology_warm(Path);
+		CHECK(warm.validation.valid());
+		warm.validation.get();
+		CHECK(enumerated_context == Per_Monitor_Handle);
+
+		std::filesystem::remove(std::filesystem::path(Path));
+	}
+}
+
+int main()
+{
+	fake::install();
+	wutil::detail::set_thread_dpi_awareness_context = fake_set_thread_dpi_awareness_context;
+	wutil::detail::get_thread_dpi_awareness_context = fake_get_thread_dpi_awareness_context;
+	wutil::detail::get_awareness_from_dpi_awareness_context = fake_get_awareness_from_dpi_awareness_context;
+	wutil::detail::display_api.enum_display_monitors = recording_enum_display_monitors;
+
+	test_cold_then_warm();
+	test_changed_mode_is_revalidated();
+	test_stale_fingerprint();
+	test_corrupt_files();
+	test_validation_uses_the_callers_dpi_context();
+
+	return test::test_result();
+}
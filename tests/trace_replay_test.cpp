@@ -0,0 +1,140 @@
+#include "trace_codec.h"
+#include "check.h"
+
+#include <cstdio>
+
+//=============================================================================
+// trace encoding, decoding and replay matching, no windows needed
+//=============================================================================
+
+namespace
+{
+	const uint64_t Layout = 0x1234;
+
+	wutil::detail::TraceArgs dpi_args(uint32_t dpi)
+	{
+		wutil::detail::TraceArgs args;
+		args.add(uint32_t(0x29)).add(uint32_t(0)).add(dpi);
+		return args;
+	}
+
+	void record(wutil::TraceLog& log)
+	{
+		auto start = wutil::detail::trace_now_ns();
+
+		// the same call three times with different results, then one with output
+		log.append(wutil::TraceCall::Monitor_From_Point, dpi_args(96), 1, start, nullptr, 0);
+		log.append(wutil::TraceCall::Monitor_From_Point, dpi_args(96), 2, start, nullptr, 0);
+		log.append(wutil::TraceCall::Monitor_From_Point, dpi_args(96), 3, start, nullptr, 0);
+
+		const uint32_t counts[] = { 2, 4 };
+		log.append(wutil::TraceCall::Get_Display_Config_Buffer_Sizes, dpi_args(144), 0, start, counts, sizeof(counts));
+
+		wutil::detail::TraceArgs window;
+		window.add_handle(reinterpret_cast<void*>(0x1000));
+		log.append(wutil::TraceCall::Get_Dpi_For_Window, window, 120, start, nullptr, 0);
+	}
+
+	std::vector<unsigned char> encoded_trace()
+	{
+		wutil::TraceLog log(Layout);
+		record(log);
+		return log.encode();
+	}
+
+	void test_sequences_replay_in_order()
+	{
+		auto bytes = encoded_trace();
+		wutil::TraceReplay replay;
+		CHECK(replay.decode(bytes.data(), bytes.size(), Layout));
+		CHECK(replay.record_count() == 5);
+
+		for (int64_t expected : { 1, 2, 3, 3, 3 })
+		{
+			auto entry = replay.lookup(wutil::TraceCall::Monitor_From_Point, dpi_args(96), false);
+			CHECK(entry != nullptr && entry->result == expected);
+		}
+
+		auto sizes = replay.lookup(wutil::TraceCall::Get_Display_Config_Buffer_Sizes, dpi_args(144), false);
+		CHECK(sizes != nullptr && sizes->out.size() == 2 * sizeof(uint32_t));
+		CHECK(replay.misses() == 0);
+
+		replay.rewind();
+		auto first = replay.lookup(wutil::TraceCall::Monitor_From_Point, dpi_args(96), false);
+		CHECK(first != nullptr && first->result == 1);
+	}
+
+	void test_unknown_calls_are_misses()
+	{
+		auto bytes = encoded_trace();
+		wutil::TraceReplay replay;
+		CHECK(replay.decode(bytes.data(), bytes.size(), Layout));
+
+		// same function, other arguments
+		CHECK(replay.lookup(wutil::TraceCall::Monitor_From_Point, dpi_args(120), false) == nullptr);
+		CHECK(replay.misses() == 1);
+
+		// a fallback answers with the first recorded result and is still a miss
+		wutil::detail::TraceArgs other_window;
+		other_window.add_handle(reinterpret_cast<void*>(0x2000));
+		auto entry = replay.lookup(wutil::TraceCall::Get_Dpi_For_Window, other_window, true);
+		CHECK(entry != nullptr && entry->result == 120);
+		CHECK(replay.misses() == 2);
+
+		// never recorded, nothing to fall back on
+		CHECK(replay.lookup(wutil::TraceCall::Query_Display_Config, other_window, true) == nullptr);
+		CHECK(replay.misses() == 3);
+
+		// a rewind restarts the sequences, only a new decode forgets the misses
+		replay.rewind();
+		CHECK(replay.misses() == 3);
+		CHECK(replay.decode(bytes.data(), bytes.size(), Layout) && replay.misses() == 0);
+	}
+
+	void test_damaged_traces_are_rejected()
+	{
+		auto bytes = encoded_trace();
+		wutil::TraceReplay replay;
+
+		CHECK(!replay.decode(bytes.data(), bytes.size(), Layout + 1));
+		CHECK(!replay.decode(bytes.data(), bytes.size() - 1, Layout));
+		CHECK(!replay.decode(bytes.data(), sizeof(wutil::detail::TraceHeader) - 1, Layout));
+
+		auto flipped = bytes;
+		flipped.back() ^= 0xff;
+		CHECK(!replay.decode(flipped.data(), flipped.size(), Layout));
+
+		auto extended = bytes;
+		extended.push_back(0);
+		CHECK(!replay.decode(extended.data(), extended.size(), Layout));
+
+		CHECK(replay.decode(bytes.data(), bytes.size(), Layout));
+	}
+
+	void test_save_and_load()
+	{
+		auto path = std::filesystem::temp_directory_path() / "wutil_trace_replay_test.trace";
+		wutil::TraceLog log(Layout);
+		record(log);
+		CHECK(log.save(path));
+		CHECK(!std::filesystem::exists(path.string() + ".tmp"));
+
+		wutil::TraceReplay replay;
+		CHECK(replay.load(path, Layout));
+		CHECK(replay.record_count() == log.record_count());
+
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		CHECK(!replay.load(path, Layout));
+	}
+}
+
+int main()
+{
+	test_sequences_replay_in_order();
+	test_unknown_calls_are_misses();
+	test_damaged_traces_are_rejected();
+	test_save_and_load();
+
+	return test::test_result();
+}
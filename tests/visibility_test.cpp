@@ -0,0 +1,274 @@
+#include "visibility.h"
+#include "check.h"
+
+#include <vector>
+
+//=============================================================================
+// render budgets from a scripted desktop: windows in z order with their
+// rects, visibility, minimized and cloaked states, monitors that come and
+// go and display power. occlusion runs the same z order walk as the win32
+// backend, cloaked windows must neither cover nor be visible
+//=============================================================================
+
+namespace
+{
+	struct Window
+	{
+		HWND hwnd = NULL;
+		RECT rect = {};
+		bool visible = true;
+		bool minimized = false;
+		bool cloaked = false;
+		// index into Desktop::monitors, -1 when MonitorFromWindow finds none
+		int monitor = 0;
+	};
+
+	struct Desktop
+	{
+		// topmost first
+		std::vector<Window> windows;
+		std::vector<RECT> monitors = { { 0, 0, 1000, 1000 } };
+
+		Window& operator[](HWND hwnd)
+		{
+			for (auto& window : windows)
+			{
+				if (window.hwnd == hwnd)
+					return window;
+			}
+
+			windows.push_back(Window{ hwnd });
+			return windows.back();
+		}
+
+		const Window* find(HWND hwnd) const
+		{
+			for (const auto& window : windows)
+			{
+				if (window.hwnd == hwnd)
+					return &window;
+			}
+
+			return nullptr;
+		}
+	};
+
+	struct ScriptedBackend
+	{
+		Desktop* desktop = nullptr;
+
+		bool is_visible(HWND hwnd) const { auto w = desktop->find(hwnd); return w && w->visible; }
+		bool is_minimized(HWND hwnd) const { auto w = desktop->find(hwnd); return w && w->minimized; }
+		bool is_cloaked(HWND hwnd) const { auto w = desktop->find(hwnd); return w && w->cloaked; }
+
+		HMONITOR monitor(HWND hwnd) const
+		{
+			auto w = desktop->find(hwnd);
+			if (!w || w->monitor < 0 || static_cast<size_t>(w->monitor) >= desktop->monitors.size())
+				return NULL;
+
+			return reinterpret_cast<HMONITOR>(static_cast<uintptr_t>(w->monitor + 1));
+		}
+
+		bool window_rect(HWND hwnd, RECT& rect) const
+		{
+			auto w = desktop->find(hwnd);
+			if (!w)
+				return false;
+
+			rect = w->rect;
+			return true;
+		}
+
+		HWND above(HWND hwnd) const
+		{
+			for (size_t i = 1; i < desktop->windows.size(); ++i)
+			{
+				if (desktop->windows[i].hwnd == hwnd)
+					return desktop->windows[i - 1].hwnd;
+			}
+
+			return NULL;
+		}
+
+		int visible_percent(HWND hwnd, HMONITOR hmonitor) const
+		{
+			auto index = reinterpret_cast<uintptr_t>(hmonitor) - 1;
+			return wutil::detail::visible_percent(*this, hwnd, desktop->monitors[index]);
+		}
+	};
+
+	using Tracker = wutil::BasicVisibilityTracker<ScriptedBackend>;
+
+	const HWND Game = reinterpret_cast<HWND>(0x100);
+	const HWND Browser = reinterpret_cast<HWND>(0x200);
+	const HWND Chat = reinterpret_cast<HWND>(0x300);
+
+	// the tracked window at the bottom of the z order, covers added above it
+	Desktop make_desktop()
+	{
+		Desktop desktop;
+		desktop[Browser].rect = { 0, 0, 1000, 1000 };
+		desktop[Browser].visible = false;
+		desktop[Chat].rect = { 0, 0, 500, 1000 };
+		desktop[Chat].visible = false;
+		desktop[Game].rect = { 0, 0, 1000, 1000 };
+		return desktop;
+	}
+
+	void test_uncovered_and_covered()
+	{
+		auto desktop = make_desktop();
+		Tracker tracker(4, ScriptedBackend{ &desktop });
+		auto slot = tracker.add(Game);
+		if (!CHECK(slot != Tracker::No_Slot))
+			return;
+
+		CHECK(tracker.state(slot).visible_percent == 100);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Full);
+
+		desktop[Browser].visible = true;
+		tracker.update();
+		CHECK(tracker.state(slot).visible_percent == 0);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Paused);
+
+		// minimized or hidden windows above cover nothing
+		desktop[Browser].minimized = true;
+		tracker.update();
+		CHECK(tracker.state(slot).visible_percent == 100);
+
+		desktop[Browser].minimized = false;
+		desktop[Browser].rect = { 0, 0, 1000, 800 };
+		tracker.update();
+		CHECK(tracker.state(slot).visible_percent == 20);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Reduced);
+
+		tracker.set_reduced_below(10);
+		tracker.update();
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Full);
+	}
+
+	void test_cloaked_windows_cover_nothing()
+	{
+		auto desktop = make_desktop();
+		Tracker tracker(4, ScriptedBackend{ &desktop });
+		auto slot = tracker.add(Game);
+
+		// a maximized browser on another virtual desktop is visible but cloaked
+		desktop[Browser].visible = true;
+		desktop[Browser].cloaked = true;
+		tracker.update();
+		CHECK(tracker.state(slot).visible_percent == 100);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Full);
+
+		// an uncloaked chat window still covers the left half
+		desktop[Chat].visible = true;
+		tracker.update();
+		CHECK(tracker.state(slot).visible_percent == 50);
+
+		// back on this desktop the browser covers everything
+		desktop[Browser].cloaked = false;
+		tracker.update();
+		CHECK(tracker.state(slot).visible_percent == 0);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Paused);
+	}
+
+	void test_cloaked_window_is_not_visible()
+	{
+		auto desktop = make_desktop();
+		Tracker tracker(4, ScriptedBackend{ &desktop });
+		auto slot = tracker.add(Game);
+
+		// the game moved to another virtual desktop, IsWindowVisible still says yes
+		desktop[Game].cloaked = true;
+		tracker.update();
+		CHECK(tracker.state(slot).visible && tracker.state(slot).visible_percent == 0);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Paused);
+
+		desktop[Game].cloaked = false;
+		tracker.update();
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Full);
+	}
+
+	void test_clipped_to_monitor()
+	{
+		auto desktop = make_desktop();
+		desktop.monitors.push_back({ 1000, 0, 2000, 1000 });
+		desktop[Game].rect = { 500, 0, 1500, 1000 };
+		desktop[Game].monitor = 1;
+		Tracker tracker(4, ScriptedBackend{ &desktop });
+		auto slot = tracker.add(Game);
+
+		// only the half on the second monitor counts, the browser covers the other half
+		desktop[Browser].visible = true;
+		tracker.update();
+		CHECK(tracker.state(slot).visible_percent == 100);
+
+		desktop[Browser].rect = { 1000, 0, 1250, 1000 };
+		tracker.update();
+		CHECK(tracker.state(slot).visible_percent == 50);
+	}
+
+	void test_window_and_monitor_states()
+	{
+		auto desktop = make_desktop();
+		Tracker tracker(2, ScriptedBackend{ &desktop });
+		auto slot = tracker.add(Game);
+
+		desktop[Game].minimized = true;
+		tracker.update();
+		CHECK(tracker.state(slot).minimized && tracker.budget(slot) == wutil::RenderBudget::Paused);
+		desktop[Game].minimized = false;
+
+		desktop[Game].visible = false;
+		tracker.update();
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Paused);
+		desktop[Game].visible = true;
+
+		// monitor disconnected
+		desktop[Game].monitor = -1;
+		CHECK(tracker.handle_message(WM_DISPLAYCHANGE, 0, 0));
+		CHECK(!tracker.state(slot).on_monitor && tracker.budget(slot) == wutil::RenderBudget::Paused);
+		desktop[Game].monitor = 0;
+
+		tracker.set_display_power(wutil::DisplayPower::Dimmed);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Reduced);
+		tracker.set_display_power(wutil::DisplayPower::Off);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Paused && tracker.state(slot).visible_percent == 0);
+		tracker.set_display_power(wutil::DisplayPower::On);
+		CHECK(tracker.budget(slot) == wutil::RenderBudget::Full);
+
+		CHECK(!tracker.handle_message(WM_PAINT, 0, 0));
+	}
+
+	void test_slots()
+	{
+		auto desktop = make_desktop();
+		Tracker tracker(2, ScriptedBackend{ &desktop });
+
+		auto game = tracker.add(Game);
+		CHECK(tracker.add(Game) == game);
+		auto chat = tracker.add(Chat);
+		CHECK(chat != Tracker::No_Slot && chat != game);
+		CHECK(tracker.add(Browser) == Tracker::No_Slot);
+
+		// the hidden chat window is paused, once removed its slot reads full again
+		CHECK(tracker.budget(chat) == wutil::RenderBudget::Paused);
+		tracker.remove(Chat);
+		CHECK(tracker.find(Chat) == Tracker::No_Slot && tracker.budget(chat) == wutil::RenderBudget::Full);
+		CHECK(tracker.add(Browser) == chat);
+		CHECK(tracker.budget(Tracker::No_Slot) == wutil::RenderBudget::Full);
+	}
+}
+
+int main()
+{
+	test_uncovered_and_covered();
+	test_cloaked_windows_cover_nothing();
+	test_cloaked_window_is_not_visible();
+	test_clipped_to_monitor();
+	test_window_and_monitor_states();
+	test_slots();
+
+	return test::test_result();
+}
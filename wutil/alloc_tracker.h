@@ -0,0 +1,305 @@
+#ifndef WUTIL_ALLOC_TRACKER_INCLUDED
+#define WUTIL_ALLOC_TRACKER_INCLUDED
+
+//=============================================================================
+// opt-in allocation tracking. define WUTIL_TRACK_ALLOCATIONS for the whole
+// build, wutil.h then includes this header and public calls open a
+// WUTIL_ALLOC_SCOPE. define WUTIL_DEFINE_ALLOCATION_HOOKS in exactly one
+// translation unit before including it to replace global operator new and
+// delete with counting versions. nothing here allocates, so tracking never
+// disturbs the counts it takes
+//=============================================================================
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+namespace wutil
+{
+	struct AllocationStats
+	{
+		const char* api = nullptr;
+		uint64_t calls = 0;
+		uint64_t allocations = 0;
+		uint64_t max_allocations = 0;
+		uint64_t violations = 0;
+		// SIZE_MAX when no budget is set
+		size_t budget = SIZE_MAX;
+	};
+
+	using AllocationViolationHandler = void (*)(const char* api, size_t allocations, size_t budget);
+
+	namespace detail
+	{
+		static const size_t Max_Tracked_Apis = 64;
+
+		inline thread_local uint64_t thread_allocations = 0;
+		inline std::atomic<uint64_t> total_allocations{ 0 };
+		inline std::atomic<uint64_t> total_deallocations{ 0 };
+
+		inline void note_allocation()
+		{
+			++thread_allocations;
+			total_allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		inline void note_deallocation()
+		{
+			total_deallocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		//=====================================================================
+		// fixed table of apis keyed by name, filled on first use. stats are
+		// plain counters, read them once the tracked threads are idle
+		//=====================================================================
+		struct AllocationTable
+		{
+			std::atomic<size_t> count{ 0 };
+			AllocationStats entries[Max_Tracked_Apis];
+			std::atomic<AllocationViolationHandler> handler{ nullptr };
+			std::atomic_flag lock = ATOMIC_FLAG_INIT;
+		};
+
+		inline AllocationTable allocation_table;
+
+		class AllocationTableLock
+		{
+		public:
+			AllocationTableLock()
+			{
+				while (allocation_table.lock.test_and_set(std::memory_order_acquire))
+					;
+			}
+
+			~AllocationTableLock()
+			{
+				allocation_table.lock.clear(std::memory_order_release);
+			}
+		};
+
+		// null when the table is full
+		inline AllocationStats* find_allocation_stats(const char* api, bool add)
+		{
+			auto count = allocation_table.count.load(std::memory_order_acquire);
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (std::strcmp(allocation_table.entries[i].api, api) == 0)
+					return &allocation_table.entries[i];
+			}
+
+			if (!add || count >= Max_Tracked_Apis)
+				return nullptr;
+
+			auto& entry = allocation_table.entries[count];
+			entry = AllocationStats();
+			entry.api = api;
+			allocation_table.count.store(count + 1, std::memory_order_release);
+			return &entry;
+		}
+	}
+
+	//=========================================================================
+	// allocations made by this thread since it started
+	//=========================================================================
+	inline uint64_t thread_allocation_count()
+	{
+		return detail::thread_allocations;
+	}
+
+	inline uint64_t total_allocation_count() { return detail::total_allocations.load(std::memory_order_relaxed); }
+	inline uint64_t total_deallocation_count() { return detail::total_deallocations.load(std::memory_order_relaxed); }
+
+	//=========================================================================
+	// most allocations one call of api may make, api must be a string with
+	// static storage. returns false when the table is full
+	//=========================================================================
+	inline bool set_allocation_budget(const char* api, size_t budget)
+	{
+		detail::AllocationTableLock lock;
+		auto stats = detail::find_allocation_stats(api, true);
+		if (stats == nullptr)
+			return false;
+
+		stats->budget = budget;
+		return true;
+	}
+
+	// called on the offending thread for each call over budget
+	inline void set_allocation_violation_handler(AllocationViolationHandler handler)
+	{
+		detail::allocation_table.handler.store(handler);
+	}
+
+	inline std::optional<AllocationStats> get_allocation_stats(const char* api)
+	{
+		detail::AllocationTableLock lock;
+		auto stats = detail::find_allocation_stats(api, false);
+		if (stats == nullptr)
+			return {};
+
+		return *stats;
+	}
+
+	// copies up to capacity entries, returns how many apis are tracked
+	inline size_t get_all_allocation_stats(AllocationStats* out, size_t capacity)
+	{
+		detail::AllocationTableLock lock;
+		auto count = detail::allocation_table.count.load();
+		for (size_t i = 0; i < count && i < capacity; ++i)
+			out[i] = detail::allocation_table.entries[i];
+
+		return count;
+	}
+
+	// clears counters, budgets are kept
+	inline void reset_allocation_stats()
+	{
+		detail::AllocationTableLock lock;
+		auto count = detail::allocation_table.count.load();
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto& entry = detail::allocation_table.entries[i];
+			entry.calls = 0;
+			entry.allocations = 0;
+			entry.max_allocations = 0;
+			entry.violations = 0;
+		}
+	}
+
+	//=========================================================================
+	// counts allocations of the current thread between construction and
+	// destruction against api, nested scopes count toward each enclosing one
+	//=========================================================================
+	class AllocationScope
+	{
+	public:
+		explicit AllocationScope(const char* api)
+			: api_(api), start_(detail::thread_allocations)
+		{
+		}
+
+		~AllocationScope()
+		{
+			auto allocations = static_cast<size_t>(detail::thread_allocations - start_);
+
+			AllocationViolationHandler handler = nullptr;
+			size_t budget = SIZE_MAX;
+			{
+				detail::AllocationTableLock lock;
+				auto stats = detail::find_allocation_stats(api_, true);
+				if (stats == nullptr)
+					return;
+
+				++stats->calls;
+				stats->allocations += allocations;
+				if (allocations > stats->max_allocations)
+					stats->max_allocations = allocations;
+
+				if (allocations > stats->budget)
+				{
+					++stats->violations;
+					budget = stats->budget;
+					handler = detail::allocation_table.handler.load();
+				}
+			}
+
+			if (handler != nullptr)
+				handler(api_, allocations, budget);
+		}
+
+		AllocationScope(const AllocationScope&) = delete;
+		AllocationScope& operator=(const AllocationScope&) = delete;
+
+	private:
+		const char* api_;
+		uint64_t start_;
+	};
+}
+
+// scopes compile away unless tracking is enabled for the build
+#ifdef WUTIL_TRACK_ALLOCATIONS
+#define WUTIL_ALLOC_SCOPE_CONCAT_(a, b) a##b
+#define WUTIL_ALLOC_SCOPE_NAME_(line) WUTIL_ALLOC_SCOPE_CONCAT_(wutil_alloc_scope_, line)
+#define WUTIL_ALLOC_SCOPE(api) ::wutil::AllocationScope WUTIL_ALLOC_SCOPE_NAME_(__LINE__)(api)
+#elif !defined(WUTIL_ALLOC_SCOPE)
+#define WUTIL_ALLOC_SCOPE(api)
+#endif
+
+#ifdef WUTIL_DEFINE_ALLOCATION_HOOKS
+
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+void* operator new(std::size_t size)
+{
+	wutil::detail::note_allocation();
+	if (void* p = std::malloc(size == 0 ? 1 : size))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	wutil::detail::note_allocation();
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	wutil::detail::note_allocation();
+	if (void* p = _aligned_malloc(size == 0 ? 1 : size, static_cast<size_t>(alignment)))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void operator delete(void* p) noexcept
+{
+	if (p == nullptr)
+		return;
+
+	wutil::detail::note_deallocation();
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	if (p == nullptr)
+		return;
+
+	wutil::detail::note_deallocation();
+	_aligned_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+
+#endif
+
+#endif
@@ -0,0 +1,615 @@
+#ifndef WUTIL_BITMAP_SCALE_INCLUDED
+#define WUTIL_BITMAP_SCALE_INCLUDED
+
+// no windows dependencies, the resampler builds and runs anywhere
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WUTIL_BITMAP_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define WUTIL_TARGET_SSE41
+#define WUTIL_TARGET_AVX2
+#else
+#define WUTIL_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define WUTIL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace wutil
+{
+	// premultiplied 32 bit bgra pixels, rows may be padded
+	struct BitmapView
+	{
+		const uint8_t* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+		ptrdiff_t stride = 0;
+	};
+
+	struct Bitmap
+	{
+		std::vector<uint8_t> pixels;
+		int width = 0;
+		int height = 0;
+
+		Bitmap() = default;
+		Bitmap(int w, int h) : pixels(static_cast<size_t>(w) * h * 4), width(w), height(h) {}
+
+		ptrdiff_t stride() const { return static_cast<ptrdiff_t>(width) * 4; }
+		BitmapView view() const { return BitmapView{ pixels.data(), width, height, stride() }; }
+	};
+
+	enum class ResampleFilter
+	{
+		Box,
+		Lanczos3
+	};
+
+	enum class SimdLevel
+	{
+		Scalar,
+		Sse41,
+		Avx2
+	};
+
+	struct ResampleOptions
+	{
+		ResampleFilter filter = ResampleFilter::Lanczos3;
+		// highest instruction set to use, lowered to what the cpu supports.
+		// every level produces identical pixels
+		SimdLevel max_simd = SimdLevel::Avx2;
+		// 0 picks a thread count from image size and hardware concurrency
+		unsigned threads = 0;
+	};
+
+	namespace detail
+	{
+		static const int Resample_Weight_Bits = 14;
+		// extra fraction bits carried in the 16 bit intermediate between passes
+		static const int Resample_Intermediate_Bits = 6;
+		static const int Resample_Horizontal_Shift = Resample_Weight_Bits - Resample_Intermediate_Bits;
+		static const int Resample_Vertical_Shift = Resample_Weight_Bits + Resample_Intermediate_Bits;
+		static const size_t Resample_Parallel_Pixels = 512 * 512;
+		static const unsigned Resample_Max_Threads = 8;
+		static const unsigned Bitmap_Default_DPI = 96;
+
+		struct ResampleTaps
+		{
+			int first;
+			int count;
+			size_t offset;
+		};
+
+		// fixed point weights, every output coordinate's weights sum to exactly 1 << Resample_Weight_Bits
+		struct ResampleWeights
+		{
+			std::vector<ResampleTaps> taps;
+			std::vector<int16_t> weights;
+		};
+
+		inline double sinc(double x)
+		{
+			if (x == 0.0)
+				return 1.0;
+
+			const double pi = 3.14159265358979323846;
+			return std::sin(pi * x) / (pi * x);
+		}
+
+		inline double resample_kernel(ResampleFilter filter, double x)
+		{
+			if (filter == ResampleFilter::Box)
+				return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+
+			if (x <= -3.0 || x >= 3.0)
+				return 0.0;
+
+			return sinc(x) * sinc(x / 3.0);
+		}
+
+		inline ResampleWeights make_resample_weights(int src_size, int dst_size, ResampleFilter filter)
+		{
+			ResampleWeights result;
+			result.taps.reserve(dst_size);
+
+			double scale = static_cast<double>(dst_size) / src_size;
+			// stretch the kernel over more source pixels when minifying
+			double filter_scale = (std::min)(scale, 1.0);
+			double radius = (filter == ResampleFilter::Box ? 0.5 : 3.0) / filter_scale;
+
+			std::vector<double> real_weights;
+			for (int x = 0; x < dst_size; ++x)
+			{
+				double center = (x + 0.5) / scale - 0.5;
+				int first = (std::max)(static_cast<int>(std::ceil(center - radius)), 0);
+				int last = (std::min)(static_cast<int>(std::floor(center + radius)), src_size - 1);
+
+				real_weights.clear();
+				double sum = 0.0;
+				for (int i = first; i <= last; ++i)
+				{
+					real_weights.push_back(resample_kernel(filter, (i - center) * filter_scale));
+					sum += real_weights.back();
+				}
+
+				if (sum == 0.0)
+				{
+					// kernel missed every sample, fall back to nearest
+					first = (std::min)((std::max)(static_cast<int>(std::lround(center)), 0), src_size - 1);
+					real_weights.assign(1, 1.0);
+					sum = 1.0;
+				}
+
+				ResampleTaps taps{ first, static_cast<int>(real_weights.size()), result.weights.size() };
+
+				// quantize, then push the rounding error into the largest weight
+				int total = 0;
+				size_t largest = taps.offset;
+				for (auto w : real_weights)
+				{
+					auto q = static_cast<int16_t>(std::lround(w / sum * (1 << Resample_Weight_Bits)));
+					result.weights.push_back(q);
+					total += q;
+					if (q > result.weights[largest])
+						largest = result.weights.size() - 1;
+				}
+				result.weights[largest] = static_cast<int16_t>(result.weights[largest] + (1 << Resample_Weight_Bits) - total);
+
+				result.taps.push_back(taps);
+			}
+
+			return result;
+		}
+
+		inline int16_t clamp_int16(int32_t value)
+		{
+			return static_cast<int16_t>((std::min)((std::max)(value, -32768), 32767));
+		}
+
+		inline uint8_t clamp_uint8(int32_t value)
+		{
+			return static_cast<uint8_t>((std::min)((std::max)(value, 0), 255));
+		}
+
+		//=====================================================================
+		// scalar kernels, the reference every simd path must match exactly
+		//=====================================================================
+		inline void resample_row_horizontal_scalar(const uint8_t* src, int16_t* dst, const ResampleWeights& rw)
+		{
+			const int32_t round = 1 << (Resample_Horizontal_Shift - 1);
+			for (const auto& taps : rw.taps)
+			{
+				int32_t acc[4] = {};
+				const uint8_t* pixel = src + static_cast<size_t>(taps.first) * 4;
+				const int16_t* weight = rw.weights.data() + taps.offset;
+
+				for (int t = 0; t < taps.count; ++t, pixel += 4)
+				{
+					for (int c = 0; c < 4; ++c)
+						acc[c] += weight[t] * pixel[c];
+				}
+
+				for (int c = 0; c < 4; ++c)
+					*dst++ = clamp_int16((acc[c] + round) >> Resample_Horizontal_Shift);
+			}
+		}
+
+		inline void resample_row_vertical_scalar(const int16_t* const* rows, const int16_t* weight, int count, uint8_t* dst, size_t begin, size_t end)
+		{
+			const int32_t round = 1 << (Resample_Vertical_Shift - 1);
+			for (size_t i = begin; i < end; ++i)
+			{
+				int32_t acc = 0;
+				for (int t = 0; t < count; ++t)
+					acc += weight[t] * rows[t][i];
+
+				dst[i] = clamp_uint8((acc + round) >> Resample_Vertical_Shift);
+			}
+		}
+
+		// ringing can push colour above alpha, which is invalid when premultiplied
+		inline void clamp_premultiplied_scalar(uint8_t* pixels, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i += 4)
+			{
+				auto alpha = pixels[i + 3];
+				for (int c = 0; c < 3; ++c)
+					pixels[i + c] = (std::min)(pixels[i + c], alpha);
+			}
+		}
+
+#if defined(WUTIL_BITMAP_X86)
+		//=====================================================================
+		// sse4.1 kernels, taps are consumed in pairs through pmaddwd
+		//=====================================================================
+		WUTIL_TARGET_SSE41 inline void resample_row_horizontal_sse41(const uint8_t* src, int16_t* dst, const ResampleWeights& rw)
+		{
+			// interleave two bgra pixels to b0 b1 g0 g1 r0 r1 a0 a1
+			const __m128i interleave = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+			const __m128i round = _mm_set1_epi32(1 << (Resample_Horizontal_Shift - 1));
+
+			for (const auto& taps : rw.taps)
+			{
+				__m128i acc = _mm_setzero_si128();
+				const uint8_t* pixel = src + static_cast<size_t>(taps.first) * 4;
+				const int16_t* weight = rw.weights.data() + taps.offset;
+
+				int t = 0;
+				for (; t + 1 < taps.count; t += 2, pixel += 8)
+				{
+					__m128i pair = _mm_cvtepu8_epi16(_mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixel)), interleave));
+					__m128i weights = _mm_set1_epi32(static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(weight[t + 1])) << 16) | static_cast<uint16_t>(weight[t])));
+					acc = _mm_add_epi32(acc, _mm_madd_epi16(pair, weights));
+				}
+
+				if (t < taps.count)
+				{
+					int32_t last;
+					std::memcpy(&last, pixel, sizeof(last));
+					__m128i single = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(last));
+					acc = _mm_add_epi32(acc, _mm_mullo_epi32(single, _mm_set1_epi32(weight[t])));
+				}
+
+				acc = _mm_srai_epi32(_mm_add_epi32(acc, round), Resample_Horizontal_Shift);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packs_epi32(acc, acc));
+				dst += 4;
+			}
+		}
+
+		WUTIL_TARGET_SSE41 inline size_t resample_row_vertical_sse41(const int16_t* const* rows, const int16_t* weight, int count, uint8_t* dst, size_t begin, size_t end)
+		{
+			const __m128i round = _mm_set1_epi32(1 << (Resample_Vertical_Shift - 1));
+
+			size_t i = begin;
+			for (; i + 8 <= end; i += 8)
+			{
+				__m128i acc_lo = _mm_setzero_si128();
+				__m128i acc_hi = _mm_setzero_si128();
+
+				for (int t = 0; t < count; t += 2)
+				{
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t] + i));
+					__m128i b = t + 1 < count ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t + 1] + i)) : _mm_setzero_si128();
+					int16_t weight_b = t + 1 < count ? weight[t + 1] : 0;
+					__m128i weights = _mm_set1_epi32(static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(weight_b)) << 16) | static_cast<uint16_t>(weight[t])));
+
+					acc_lo = _mm_add_epi32(acc_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights));
+					acc_hi = _mm_add_epi32(acc_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights));
+				}
+
+				acc_lo = _mm_srai_epi32(_mm_add_epi32(acc_lo, round), Resample_Vertical_Shift);
+				acc_hi = _mm_srai_epi32(_mm_add_epi32(acc_hi, round), Resample_Vertical_Shift);
+				__m128i words = _mm_packs_epi32(acc_lo, acc_hi);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+			}
+
+			return i;
+		}
+
+		WUTIL_TARGET_SSE41 inline size_t clamp_premultiplied_sse41(uint8_t* pixels, size_t begin, size_t end)
+		{
+			const __m128i alpha_mask = _mm_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+
+			size_t i = begin;
+			for (; i + 16 <= end; i += 16)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), _mm_min_epu8(v, _mm_shuffle_epi8(v, alpha_mask)));
+			}
+
+			return i;
+		}
+
+		//=====================================================================
+		// avx2 vertical kernel, sixteen values per step. unpack and pack both
+		// work within 128 bit lanes so results come back in order except for
+		// the final byte pack, fixed with a cross lane permute
+		//=====================================================================
+		WUTIL_TARGET_AVX2 inline size_t resample_row_vertical_avx2(const int16_t* const* rows, const int16_t* weight, int count, uint8_t* dst, size_t begin, size_t end)
+		{
+			const __m256i round = _mm256_set1_epi32(1 << (Resample_Vertical_Shift - 1));
+
+			size_t i = begin;
+			for (; i + 16 <= end; i += 16)
+			{
+				__m256i acc_lo = _mm256_setzero_si256();
+				__m256i acc_hi = _mm256_setzero_si256();
+
+				for (int t = 0; t < count; t += 2)
+				{
+					__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[t] + i));
+					__m256i b = t + 1 < count ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[t + 1] + i)) : _mm256_setzero_si256();
+					int16_t weight_b = t + 1 < count ? weight[t + 1] : 0;
+					__m256i weights = _mm256_set1_epi32(static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(weight_b)) << 16) | static_cast<uint16_t>(weight[t])));
+
+					acc_lo = _mm256_add_epi32(acc_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weights));
+					acc_hi = _mm256_add_epi32(acc_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weights));
+				}
+
+				acc_lo = _mm256_srai_epi32(_mm256_add_epi32(acc_lo, round), Resample_Vertical_Shift);
+				acc_hi = _mm256_srai_epi32(_mm256_add_epi32(acc_hi, round), Resample_Vertical_Shift);
+				__m256i words = _mm256_packs_epi32(acc_lo, acc_hi);
+				__m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(bytes));
+			}
+
+			return i;
+		}
+
+		inline SimdLevel detect_simd_level()
+		{
+			static const SimdLevel level = []()
+			{
+#if defined(_MSC_VER)
+				int regs[4];
+				__cpuid(regs, 1);
+				bool sse41 = (regs[2] & (1 << 19)) != 0;
+				bool avx = (regs[2] & (1 << 28)) != 0 && (regs[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+				__cpuidex(regs, 7, 0);
+				bool avx2 = avx && (regs[1] & (1 << 5)) != 0;
+#else
+				bool sse41 = __builtin_cpu_supports("sse4.1");
+				bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+				return avx2 ? SimdLevel::Avx2 : sse41 ? SimdLevel::Sse41 : SimdLevel::Scalar;
+			}();
+
+			return level;
+		}
+#else
+		inline SimdLevel detect_simd_level()
+		{
+			return SimdLevel::Scalar;
+		}
+#endif
+
+		//=====================================================================
+		// run fn over [0, count) split into one contiguous band per thread
+		//=====================================================================
+		template <typename Fn>
+		void run_bands(int count, unsigned threads, Fn fn)
+		{
+			if (threads <= 1 || count < 2)
+			{
+				fn(0, count);
+				return;
+			}
+
+			threads = (std::min)(threads, static_cast<unsigned>(count));
+			std::vector<std::thread> workers;
+			workers.reserve(threads - 1);
+
+			int band = (count + threads - 1) / threads;
+			for (unsigned i = 1; i < threads; ++i)
+			{
+				int begin = (std::min)(count, static_cast<int>(i) * band);
+				int end = (std::min)(count, begin + band);
+				if (begin < end)
+					workers.emplace_back(fn, begin, end);
+			}
+
+			fn(0, (std::min)(count, band));
+			for (auto& worker : workers)
+				worker.join();
+		}
+	}
+
+	//=========================================================================
+	// resample premultiplied bgra into dst, separable two pass filter with
+	// 14 bit fixed point weights. large images are split into row bands
+	// across threads. returns false for empty or invalid sizes
+	//=========================================================================
+	inline bool scale_bitmap(const BitmapView& src, uint8_t* dst, int dst_width, int dst_height, ptrdiff_t dst_stride, const ResampleOptions& options = {})
+	{
+		if (src.pixels == nullptr || dst == nullptr || src.width <= 0 || src.height <= 0 || dst_width <= 0 || dst_height <= 0)
+			return false;
+
+		auto simd = (std::min)(options.max_simd, detail::detect_simd_level());
+
+		unsigned threads = options.threads;
+		if (threads == 0)
+		{
+			auto pixels = static_cast<size_t>(dst_width) * dst_height;
+			threads = pixels < detail::Resample_Parallel_Pixels ? 1 : (std::min)((std::max)(std::thread::hardware_concurrency(), 1u), detail::Resample_Max_Threads);
+		}
+
+		auto horizontal = detail::make_resample_weights(src.width, dst_width, options.filter);
+		auto vertical = detail::make_resample_weights(src.height, dst_height, options.filter);
+
+		size_t row_values = static_cast<size_t>(dst_width) * 4;
+		std::vector<int16_t> intermediate(row_values * src.height);
+
+		detail::run_bands(src.height, threads, [&](int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				const uint8_t* src_row = src.pixels + y * src.stride;
+				int16_t* dst_row = intermediate.data() + row_values * y;
+#if defined(WUTIL_BITMAP_X86)
+				if (simd >= SimdLevel::Sse41)
+				{
+					detail::resample_row_horizontal_sse41(src_row, dst_row, horizontal);
+					continue;
+				}
+#endif
+				detail::resample_row_horizontal_scalar(src_row, dst_row, horizontal);
+			}
+		});
+
+		detail::run_bands(dst_height, threads, [&](int begin, int end)
+		{
+			std::vector<const int16_t*> rows;
+			for (int y = begin; y < end; ++y)
+			{
+				const auto& taps = vertical.taps[y];
+				const int16_t* weight = vertical.weights.data() + taps.offset;
+				uint8_t* dst_row = dst + y * dst_stride;
+
+				rows.clear();
+				for (int t = 0; t < taps.count; ++t)
+					rows.push_back(intermediate.data() + row_values * (taps.first + t));
+
+				size_t done = 0;
+#if defined(WUTIL_BITMAP_X86)
+				if (simd >= SimdLevel::Avx2)
+					done = detail::resample_row_vertical_avx2(rows.data(), weight, taps.count, dst_row, done, row_values);
+				if (simd >= SimdLevel::Sse41)
+					done = detail::resample_row_vertical_sse41(rows.data(), weight, taps.count, dst_row, done, row_values);
+#endif
+				detail::resample_row_vertical_scalar(rows.data(), weight, taps.count, dst_row, done, row_values);
+
+				done = 0;
+#if defined(WUTIL_BITMAP_X86)
+				if (simd >= SimdLevel::Sse41)
+					done = detail::clamp_premultiplied_sse41(dst_row, done, row_values);
+#endif
+				detail::clamp_premultiplied_scalar(dst_row, done, row_values);
+			}
+		});
+
+		return true;
+	}
+
+	inline Bitmap scale_bitmap(const BitmapView& src, int dst_width, int dst_height, const ResampleOptions& options = {})
+	{
+		Bitmap scaled(dst_width, dst_height);
+		if (!scale_bitmap(src, scaled.pixels.data(), dst_width, dst_height, scaled.stride(), options))
+			return Bitmap{};
+
+		return scaled;
+	}
+
+	//=========================================================================
+	// scale bitmap authored at 96 dpi to dpi, like scale_value
+	//=========================================================================
+	inline Bitmap scale_bitmap(const BitmapView& src, unsigned dpi, const ResampleOptions& options = {})
+	{
+		auto half = detail::Bitmap_Default_DPI / 2;
+		int width = static_cast<int>((static_cast<unsigned>(src.width) * dpi + half) / detail::Bitmap_Default_DPI);
+		int height = static_cast<int>((static_cast<unsigned>(src.height) * dpi + half) / detail::Bitmap_Default_DPI);
+
+		return scale_bitmap(src, (std::max)(width, 1), (std::max)(height, 1), options);
+	}
+
+	//=========================================================================
+	// per asset, per dpi bitmap cache. pre-rendered variants are served
+	// as is, other dpis are resampled from the nearest variant at or above
+	// the requested dpi, or the largest one, and kept for later requests
+	//=========================================================================
+	class ScaledBitmapCache
+	{
+	public:
+		using AssetId = uint32_t;
+
+		explicit ScaledBitmapCache(ResampleOptions options = {}) : options_(options) {}
+
+		// bitmap drawn for dpi, replaces any earlier variant at that dpi
+		void add_variant(AssetId asset, unsigned dpi, Bitmap bitmap)
+		{
+			// resampled bitmaps came from the old variants, one may sit at dpi
+			drop_resampled(asset);
+
+			auto& variants = variants_[asset];
+			variants.erase(std::remove_if(variants.begin(), variants.end(), [dpi](unsigned d) { return d == dpi; }), variants.end());
+			variants.push_back(dpi);
+			std::sort(variants.begin(), variants.end());
+
+			bitmaps_[key(asset, dpi)] = std::make_unique<Bitmap>(std::move(bitmap));
+		}
+
+		// null if asset has no variants, pointer stays valid until the asset changes or clear
+		const Bitmap* get(AssetId asset, unsigned dpi)
+		{
+			auto cached = bitmaps_.find(key(asset, dpi));
+			if (cached != bitmaps_.end())
+			{
+				++hits_;
+				return cached->second.get();
+			}
+
+			++misses_;
+			auto found = variants_.find(asset);
+			if (found == variants_.end() || found->second.empty())
+				return nullptr;
+
+			const auto& variants = found->second;
+			auto source_dpi = variants.back();
+			for (auto variant_dpi : variants)
+			{
+				if (variant_dpi >= dpi)
+				{
+					source_dpi = variant_dpi;
+					break;
+				}
+			}
+
+			auto variant = bitmaps_.find(key(asset, source_dpi));
+			if (variant == bitmaps_.end() || !variant->second)
+				return nullptr;
+
+			const auto& source = *variant->second;
+			int width = (std::max)(static_cast<int>((static_cast<uint64_t>(source.width) * dpi + source_dpi / 2) / source_dpi), 1);
+			int height = (std::max)(static_cast<int>((static_cast<uint64_t>(source.height) * dpi + source_dpi / 2) / source_dpi), 1);
+
+			auto& slot = bitmaps_[key(asset, dpi)];
+			slot = std::make_unique<Bitmap>(scale_bitmap(source.view(), width, height, options_));
+			resampled_.push_back(key(asset, dpi));
+
+			return slot.get();
+		}
+
+		void clear()
+		{
+			variants_.clear();
+			bitmaps_.clear();
+			resampled_.clear();
+		}
+
+		size_t hits() const { return hits_; }
+		size_t misses() const { return misses_; }
+
+	private:
+		static uint64_t key(AssetId asset, unsigned dpi)
+		{
+			return (static_cast<uint64_t>(asset) << 32) | dpi;
+		}
+
+		void drop_resampled(AssetId asset)
+		{
+			auto found = variants_.find(asset);
+			auto keep = std::remove_if(resampled_.begin(), resampled_.end(), [this, asset, found](uint64_t k)
+			{
+				if ((k >> 32) != asset)
+					return false;
+
+				// a variant added at a resampled dpi owns the key now
+				auto dpi = static_cast<unsigned>(k & 0xffffffff);
+				bool variant = found != variants_.end() && std::find(found->second.begin(), found->second.end(), dpi) != found->second.end();
+				if (!variant)
+					bitmaps_.erase(k);
+				return true;
+			});
+			resampled_.erase(keep, resampled_.end());
+		}
+
+		ResampleOptions options_;
+		std::unordered_map<AssetId, std::vector<unsigned>> variants_;
+		std::unordered_map<uint64_t, std::unique_ptr<Bitmap>> bitmaps_;
+		std::vector<uint64_t> resampled_;
+		size_t hits_ = 0;
+		size_t misses_ = 0;
+	};
+}
+
+#endif
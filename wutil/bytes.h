@@ -0,0 +1,41 @@
+#ifndef WUTIL_BYTES_INCLUDED
+#define WUTIL_BYTES_INCLUDED
+
+// no windows dependencies, shared by the windows headers and the portable ones
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace wutil
+{
+	namespace detail
+	{
+		//======================================================
+		// 64 bit fnv-1a hash, used for fingerprints and ids
+		//======================================================
+		static const uint64_t Fnv_Offset_Basis = 14695981039346656037ull;
+		static const uint64_t Fnv_Prime = 1099511628211ull;
+
+		inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = Fnv_Offset_Basis)
+		{
+			auto bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= bytes[i];
+				hash *= Fnv_Prime;
+			}
+
+			return hash;
+		}
+
+		template <typename T>
+		void append_bytes(std::vector<unsigned char>& buffer, const T* items, size_t count)
+		{
+			auto bytes = reinterpret_cast<const unsigned char*>(items);
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(T) * count);
+		}
+	}
+}
+
+#endif
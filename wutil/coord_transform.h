@@ -0,0 +1,236 @@
+#ifndef WUTIL_COORD_TRANSFORM_INCLUDED
+#define WUTIL_COORD_TRANSFORM_INCLUDED
+
+#include "wutil.h"
+
+#include <span>
+#include <numeric>
+
+namespace wutil
+{
+	namespace detail
+	{
+		inline int64_t floor_div(int64_t a, int64_t b)
+		{
+			auto q = a / b;
+			return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+		}
+
+		inline int64_t ceil_div(int64_t a, int64_t b)
+		{
+			auto q = a / b;
+			return (a % b != 0 && (a < 0) == (b < 0)) ? q + 1 : q;
+		}
+	}
+
+	//=========================================================================
+	// maps one monitor between physical panel pixels and logical desktop
+	// coordinates. physical points are relative to the unrotated panel,
+	// logical points are desktop coordinates with the monitor origin kept
+	// and sizes divided by the dpi scale. dmDisplayOrientation is measured
+	// clockwise like DMDO_90. rounding is floor one way and ceil the other,
+	// so points on the finer grid survive a round trip exactly
+	//=========================================================================
+	struct MonitorTransform
+	{
+		DisplayId id = 0;
+		POINT origin = {};
+		// panel size before rotation
+		LONG native_width = 0;
+		LONG native_height = 0;
+		DWORD orientation = DMDO_DEFAULT;
+		UINT dpi = detail::Default_DPI;
+
+		POINT to_logical(POINT physical) const
+		{
+			auto local = rotate(physical);
+			return POINT{ static_cast<LONG>(origin.x + unscale(local.x)), static_cast<LONG>(origin.y + unscale(local.y)) };
+		}
+
+		POINT to_physical(POINT logical) const
+		{
+			POINT local{ static_cast<LONG>(scale(static_cast<int64_t>(logical.x) - origin.x)),
+				static_cast<LONG>(scale(static_cast<int64_t>(logical.y) - origin.y)) };
+			return unrotate(local);
+		}
+
+		//==================================================================
+		// batched kernels, out must be at least as long as in. in and out
+		// may be the same span
+		//==================================================================
+		void to_logical(std::span<const POINT> in, std::span<POINT> out) const
+		{
+			switch (orientation)
+			{
+			case DMDO_90: to_logical_batch<DMDO_90>(in, out); break;
+			case DMDO_180: to_logical_batch<DMDO_180>(in, out); break;
+			case DMDO_270: to_logical_batch<DMDO_270>(in, out); break;
+			default: to_logical_batch<DMDO_DEFAULT>(in, out); break;
+			}
+		}
+
+		void to_physical(std::span<const POINT> in, std::span<POINT> out) const
+		{
+			switch (orientation)
+			{
+			case DMDO_90: to_physical_batch<DMDO_90>(in, out); break;
+			case DMDO_180: to_physical_batch<DMDO_180>(in, out); break;
+			case DMDO_270: to_physical_batch<DMDO_270>(in, out); break;
+			default: to_physical_batch<DMDO_DEFAULT>(in, out); break;
+			}
+		}
+
+		// physical is the finer grid, logical points round trip exactly
+		bool physical_is_finer() const { return dpi >= detail::Default_DPI; }
+
+	private:
+		friend MonitorTransform make_monitor_transform(const MONITORINFOEX& mi, UINT dpi, DWORD orientation, DisplayId id);
+
+		// rotated into desktop orientation, relative to the monitor origin
+		template <DWORD Orientation>
+		static POINT rotate(POINT p, LONG w, LONG h)
+		{
+			switch (Orientation)
+			{
+			case DMDO_90: return POINT{ h - 1 - p.y, p.x };
+			case DMDO_180: return POINT{ w - 1 - p.x, h - 1 - p.y };
+			case DMDO_270: return POINT{ p.y, w - 1 - p.x };
+			default: return p;
+			}
+		}
+
+		template <DWORD Orientation>
+		static POINT unrotate(POINT p, LONG w, LONG h)
+		{
+			switch (Orientation)
+			{
+			case DMDO_90: return POINT{ p.y, h - 1 - p.x };
+			case DMDO_180: return POINT{ w - 1 - p.x, h - 1 - p.y };
+			case DMDO_270: return POINT{ w - 1 - p.y, p.x };
+			default: return p;
+			}
+		}
+
+		POINT rotate(POINT p) const
+		{
+			switch (orientation)
+			{
+			case DMDO_90: return rotate<DMDO_90>(p, native_width, native_height);
+			case DMDO_180: return rotate<DMDO_180>(p, native_width, native_height);
+			case DMDO_270: return rotate<DMDO_270>(p, native_width, native_height);
+			default: return p;
+			}
+		}
+
+		POINT unrotate(POINT p) const
+		{
+			switch (orientation)
+			{
+			case DMDO_90: return unrotate<DMDO_90>(p, native_width, native_height);
+			case DMDO_180: return unrotate<DMDO_180>(p, native_width, native_height);
+			case DMDO_270: return unrotate<DMDO_270>(p, native_width, native_height);
+			default: return p;
+			}
+		}
+
+		// physical to logical length, floor when logical is the coarser grid, ceil otherwise
+		int64_t unscale(int64_t value) const
+		{
+			auto scaled = value * scale_den_;
+			return physical_is_finer() ? detail::floor_div(scaled, scale_num_) : detail::ceil_div(scaled, scale_num_);
+		}
+
+		// logical to physical length, ceil when physical is the finer grid, floor otherwise
+		int64_t scale(int64_t value) const
+		{
+			auto scaled = value * scale_num_;
+			return physical_is_finer() ? detail::ceil_div(scaled, scale_den_) : detail::floor_div(scaled, scale_den_);
+		}
+
+		template <DWORD Orientation>
+		void to_logical_batch(std::span<const POINT> in, std::span<POINT> out) const
+		{
+			auto count = (std::min)(in.size(), out.size());
+			for (size_t i = 0; i < count; ++i)
+			{
+				auto local = rotate<Orientation>(in[i], native_width, native_height);
+				out[i] = POINT{ static_cast<LONG>(origin.x + unscale(local.x)), static_cast<LONG>(origin.y + unscale(local.y)) };
+			}
+		}
+
+		template <DWORD Orientation>
+		void to_physical_batch(std::span<const POINT> in, std::span<POINT> out) const
+		{
+			auto count = (std::min)(in.size(), out.size());
+			for (size_t i = 0; i < count; ++i)
+			{
+				POINT local{ static_cast<LONG>(scale(static_cast<int64_t>(in[i].x) - origin.x)),
+					static_cast<LONG>(scale(static_cast<int64_t>(in[i].y) - origin.y)) };
+				out[i] = unrotate<Orientation>(local, native_width, native_height);
+			}
+		}
+
+		// dpi / 96 reduced
+		int64_t scale_num_ = 1;
+		int64_t scale_den_ = 1;
+	};
+
+	//=========================================================================
+	// transform for monitor at dpi, orientation is dmDisplayOrientation
+	//=========================================================================
+	inline MonitorTransform make_monitor_transform(const MONITORINFOEX& mi, UINT dpi, DWORD orientation, DisplayId id = 0)
+	{
+		MonitorTransform transform;
+		transform.id = id;
+		transform.origin = POINT{ mi.rcMonitor.left, mi.rcMonitor.top };
+		transform.orientation = orientation;
+		transform.dpi = dpi == 0 ? detail::Default_DPI : dpi;
+
+		LONG width = mi.rcMonitor.right - mi.rcMonitor.left;
+		LONG height = mi.rcMonitor.bottom - mi.rcMonitor.top;
+		bool swapped = orientation == DMDO_90 || orientation == DMDO_270;
+		transform.native_width = swapped ? height : width;
+		transform.native_height = swapped ? width : height;
+
+		auto divisor = std::gcd(static_cast<int64_t>(transform.dpi), static_cast<int64_t>(detail::Default_DPI));
+		transform.scale_num_ = transform.dpi / divisor;
+		transform.scale_den_ = detail::Default_DPI / divisor;
+
+		return transform;
+	}
+
+	//=========================================================================
+	// transforms for every monitor, indexed like get_all_monitor_info
+	//=========================================================================
+	inline std::vector<MonitorTransform> get_monitor_transforms()
+	{
+		std::vector<MonitorTransform> transforms;
+		for (const auto& mi : get_all_monitor_info())
+		{
+			DEVMODE dm;
+			dm.dmSize = sizeof(dm);
+			dm.dmDriverExtra = 0;
+			DWORD orientation = DMDO_DEFAULT;
+			if (detail::display_api.enum_display_settings_ex(mi.szDevice, ENUM_CURRENT_SETTINGS, &dm, 0))
+				orientation = dm.dmDisplayOrientation;
+
+			auto dpi = get_dpi(detail::display_api.monitor_from_rect(&mi.rcMonitor, MONITOR_DEFAULTTONEAREST));
+			transforms.push_back(make_monitor_transform(mi, dpi, orientation, get_monitor_id(mi.szDevice)));
+		}
+
+		return transforms;
+	}
+
+	inline const MonitorTransform* find_monitor_transform(const std::vector<MonitorTransform>& transforms, DisplayId id)
+	{
+		for (const auto& transform : transforms)
+		{
+			if (transform.id == id)
+				return &transform;
+		}
+
+		return nullptr;
+	}
+}
+
+#endif
@@ -0,0 +1,714 @@
+#ifndef WUTIL_DISPLAY_TRACE_INCLUDED
+#define WUTIL_DISPLAY_TRACE_INCLUDED
+
+#include "wutil.h"
+#include "topology_snapshot.h"
+#include "trace_codec.h"
+
+namespace wutil
+{
+	namespace detail
+	{
+		// monitor handed to an EnumDisplayMonitors callback
+		struct TraceMonitor
+		{
+			uint64_t hmonitor;
+			RECT rect;
+		};
+
+		// a trace only replays in a build with the same struct layouts
+		inline uint64_t trace_layout_hash()
+		{
+			const uint32_t sizes[] = {
+				sizeof(TCHAR), sizeof(void*), sizeof(DISPLAY_DEVICE), sizeof(MONITORINFOEX), sizeof(DEVMODE),
+				sizeof(DISPLAYCONFIG_PATH_INFO), sizeof(DISPLAYCONFIG_MODE_INFO), sizeof(NONCLIENTMETRICS),
+				sizeof(ICONMETRICS), sizeof(LOGFONT)
+			};
+			return fnv1a(sizes, sizeof(sizes));
+		}
+
+		// the fields EnumDisplaySettingsEx fills and mode changes read
+		inline TraceArgs& add_trace_mode(TraceArgs& args, const DEVMODE* dm)
+		{
+			if (dm == nullptr)
+				return args.add(uint8_t(0));
+
+			args.add(uint8_t(1));
+			return args.add(to_snapshot_mode(*dm));
+		}
+
+		// the registry value asked for, and whether there was room for its data
+		inline TraceArgs& add_trace_reg_value(TraceArgs& args, HKEY key, LPCTSTR subkey, LPCTSTR value, DWORD flags, LPDWORD type, PVOID data, LPDWORD size)
+		{
+			args.add_handle(key).add_string(subkey).add_string(value).add(flags);
+			return args.add(uint8_t(type != nullptr)).add(uint8_t(data != nullptr)).add(size ? *size : DWORD(0));
+		}
+
+		// bytes of pvParam filled by the SystemParametersInfo queries this library makes
+		inline UINT spi_output_size(UINT action, UINT ui_param)
+		{
+			switch (action)
+			{
+			case SPI_GETNONCLIENTMETRICS:
+			case SPI_GETICONMETRICS:
+			case SPI_GETICONTITLELOGFONT:
+				return ui_param;
+			default:
+				return 0;
+			}
+		}
+	}
+
+	//=========================================================================
+	// records every call routed through detail::display_api plus the dpi
+	// queries, with arguments, results, output and duration, while alive.
+	// one recorder or replayer may be installed at a time
+	//=========================================================================
+	class DisplayTraceRecorder
+	{
+	public:
+		DisplayTraceRecorder() : log_(detail::trace_layout_hash())
+		{
+			// resolve the dpi and display config functions first so the real ones get wrapped
+			detail::load_user32_symbols();
+			detail::load_shcore_symbols();
+
+			api_ = detail::display_api;
+			get_dpi_for_window_ = detail::get_dpi_for_window;
+			get_dpi_for_monitor_ = detail::get_dpi_for_monitor;
+			active() = this;
+
+			auto& api = detail::display_api;
+			api.enum_display_devices = enum_display_devices;
+			api.enum_display_monitors = enum_display_monitors;
+			api.get_monitor_info = get_monitor_info;
+			api.enum_display_settings_ex = enum_display_settings_ex;
+			api.change_display_settings_ex = change_display_settings_ex;
+			api.monitor_from_window = monitor_from_window;
+			api.monitor_from_rect = monitor_from_rect;
+			api.monitor_from_point = monitor_from_point;
+			api.system_parameters_info = system_parameters_info;
+			api.reg_get_value = reg_get_value;
+			if (api_.system_parameters_info_for_dpi != nullptr)
+				api.system_parameters_info_for_dpi = system_parameters_info_for_dpi;
+			if (api_.get_display_config_buffer_sizes != nullptr)
+				api.get_display_config_buffer_sizes = get_display_config_buffer_sizes;
+			if (api_.query_display_config != nullptr)
+				api.query_display_config = query_display_config;
+			if (api_.display_config_get_device_info != nullptr)
+				api.display_config_get_device_info = display_config_get_device_info;
+			if (get_dpi_for_window_ != nullptr)
+				detail::get_dpi_for_window = get_dpi_for_window;
+			if (get_dpi_for_monitor_ != nullptr)
+				detail::get_dpi_for_monitor = get_dpi_for_monitor;
+		}
+
+		~DisplayTraceRecorder()
+		{
+			detail::display_api = api_;
+			detail::get_dpi_for_window = get_dpi_for_window_;
+			detail::get_dpi_for_monitor = get_dpi_for_monitor_;
+			active() = nullptr;
+		}
+
+		DisplayTraceRecorder(const DisplayTraceRecorder&) = delete;
+		DisplayTraceRecorder& operator=(const DisplayTraceRecorder&) = delete;
+
+		size_t record_count() const { return log_.record_count(); }
+
+		// the recorded trace, replays anywhere with TraceReplay
+		const TraceLog& log() const { return log_; }
+
+		bool save(const tstring& path) const { return log_.save(path); }
+
+	private:
+		static DisplayTraceRecorder*& active()
+		{
+			static DisplayTraceRecorder* recorder = nullptr;
+			return recorder;
+		}
+
+		static BOOL WINAPI enum_display_devices(LPCTSTR device, DWORD index, DISPLAY_DEVICE* dd, DWORD flags)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.enum_display_devices(device, index, dd, flags);
+
+			detail::TraceArgs args;
+			args.add_string(device).add(index).add(flags);
+			self->log_.append(TraceCall::Enum_Display_Devices, args, result, start, dd, result ? sizeof(DISPLAY_DEVICE) : 0);
+			return result;
+		}
+
+		struct MonitorEnumRecording
+		{
+			MONITORENUMPROC proc;
+			LPARAM data;
+			std::vector<detail::TraceMonitor> monitors;
+		};
+
+		static BOOL CALLBACK record_monitor_proc(HMONITOR hmonitor, HDC hdc, LPRECT rect, LPARAM data)
+		{
+			auto recording = reinterpret_cast<MonitorEnumRecording*>(data);
+			recording->monitors.push_back(detail::TraceMonitor{ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(hmonitor)), rect ? *rect : RECT{} });
+			return recording->proc(hmonitor, hdc, rect, recording->data);
+		}
+
+		// duration includes the time spent in the callback
+		static BOOL WINAPI enum_display_monitors(HDC hdc, LPCRECT clip, MONITORENUMPROC proc, LPARAM data)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			MonitorEnumRecording recording{ proc, data, {} };
+			auto result = self->api_.enum_display_monitors(hdc, clip, record_monitor_proc, reinterpret_cast<LPARAM>(&recording));
+
+			detail::TraceArgs args;
+			args.add_handle(hdc).add(clip ? *clip : RECT{}).add(uint8_t(clip != nullptr));
+			self->log_.append(TraceCall::Enum_Display_Monitors, args, result, start, recording.monitors.data(), recording.monitors.size() * sizeof(detail::TraceMonitor));
+			return result;
+		}
+
+		static BOOL WINAPI get_monitor_info(HMONITOR hmonitor, LPMONITORINFO mi)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			DWORD size = mi->cbSize;
+			auto result = self->api_.get_monitor_info(hmonitor, mi);
+
+			detail::TraceArgs args;
+			args.add_handle(hmonitor).add(size);
+			self->log_.append(TraceCall::Get_Monitor_Info, args, result, start, mi, result ? size : 0);
+			return result;
+		}
+
+		static BOOL WINAPI enum_display_settings_ex(LPCTSTR device, DWORD index, DEVMODE* dm, DWORD flags)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.enum_display_settings_ex(device, index, dm, flags);
+
+			detail::TraceArgs args;
+			args.add_string(device).add(index).add(flags);
+			self->log_.append(TraceCall::Enum_Display_Settings_Ex, args, result, start, dm, result ? sizeof(DEVMODE) : 0);
+			return result;
+		}
+
+		static LONG WINAPI change_display_settings_ex(LPCTSTR device, DEVMODE* dm, HWND hwnd, DWORD flags, LPVOID param)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.change_display_settings_ex(device, dm, hwnd, flags, param);
+
+			detail::TraceArgs args;
+			detail::add_trace_mode(args.add_string(device), dm).add(flags);
+			self->log_.append(TraceCall::Change_Display_Settings_Ex, args, result, start, nullptr, 0);
+			return result;
+		}
+
+		static HMONITOR WINAPI monitor_from_window(HWND hwnd, DWORD flags)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.monitor_from_window(hwnd, flags);
+
+			detail::TraceArgs args;
+			args.add_handle(hwnd).add(flags);
+			self->log_.append(TraceCall::Monitor_From_Window, args, reinterpret_cast<intptr_t>(result), start, nullptr, 0);
+			return result;
+		}
+
+		static HMONITOR WINAPI monitor_from_rect(LPCRECT rect, DWORD flags)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.monitor_from_rect(rect, flags);
+
+			detail::TraceArgs args;
+			args.add(*rect).add(flags);
+			self->log_.append(TraceCall::Monitor_From_Rect, args, reinterpret_cast<intptr_t>(result), start, nullptr, 0);
+			return result;
+		}
+
+		static HMONITOR WINAPI monitor_from_point(POINT point, DWORD flags)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.monitor_from_point(point, flags);
+
+			detail::TraceArgs args;
+			args.add(point).add(flags);
+			self->log_.append(TraceCall::Monitor_From_Point, args, reinterpret_cast<intptr_t>(result), start, nullptr, 0);
+			return result;
+		}
+
+		static BOOL WINAPI system_parameters_info(UINT action, UINT ui_param, PVOID pv_param, UINT win_ini)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.system_parameters_info(action, ui_param, pv_param, win_ini);
+
+			detail::TraceArgs args;
+			args.add(action).add(ui_param).add(win_ini);
+			self->log_.append(TraceCall::System_Parameters_Info, args, result, start, pv_param, result ? detail::spi_output_size(action, ui_param) : 0);
+			return result;
+		}
+
+		static BOOL WINAPI system_parameters_info_for_dpi(UINT action, UINT ui_param, PVOID pv_param, UINT win_ini, UINT dpi)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.system_parameters_info_for_dpi(action, ui_param, pv_param, win_ini, dpi);
+
+			detail::TraceArgs args;
+			args.add(action).add(ui_param).add(win_ini).add(dpi);
+			self->log_.append(TraceCall::System_Parameters_Info_For_Dpi, args, result, start, pv_param, result ? detail::spi_output_size(action, ui_param) : 0);
+			return result;
+		}
+
+		// output is the type and size reported, followed by the data when it was read
+		static LONG WINAPI reg_get_value(HKEY key, LPCTSTR subkey, LPCTSTR value, DWORD flags, LPDWORD type, PVOID data, LPDWORD size)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			detail::TraceArgs args;
+			detail::add_trace_reg_value(args, key, subkey, value, flags, type, data, size);
+			auto result = self->api_.reg_get_value(key, subkey, value, flags, type, data, size);
+
+			std::vector<unsigned char> out;
+			if (result == ERROR_SUCCESS || result == ERROR_MORE_DATA)
+			{
+				DWORD reported[] = { type ? *type : DWORD(REG_NONE), size ? *size : DWORD(0) };
+				detail::append_bytes(out, reported, 2);
+				if (result == ERROR_SUCCESS && data != nullptr && size != nullptr)
+					detail::append_bytes(out, static_cast<const unsigned char*>(data), *size);
+			}
+
+			self->log_.append(TraceCall::Reg_Get_Value, args, result, start, out.data(), out.size());
+			return result;
+		}
+
+		static LONG WINAPI get_display_config_buffer_sizes(UINT32 flags, UINT32* path_count, UINT32* mode_count)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->api_.get_display_config_buffer_sizes(flags, path_count, mode_count);
+
+			UINT32 counts[] = { *path_count, *mode_count };
+			detail::TraceArgs args;
+			args.add(flags);
+			self->log_.append(TraceCall::Get_Display_Config_Buffer_Sizes, args, result, start, counts, result == ERROR_SUCCESS ? sizeof(counts) : 0);
+			return result;
+		}
+
+		// output is both counts followed by the paths, the modes and the topology id if asked for
+		static LONG WINAPI query_display_config(UINT32 flags, UINT32* path_count, DISPLAYCONFIG_PATH_INFO* paths,
+			UINT32* mode_count, DISPLAYCONFIG_MODE_INFO* modes, DISPLAYCONFIG_TOPOLOGY_ID* topology)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			UINT32 capacities[] = { *path_count, *mode_count };
+			auto result = self->api_.query_display_config(flags, path_count, paths, mode_count, modes, topology);
+
+			std::vector<unsigned char> out;
+			if (result == ERROR_SUCCESS)
+			{
+				UINT32 counts[] = { *path_count, *mode_count };
+				detail::append_bytes(out, counts, 2);
+				detail::append_bytes(out, paths, *path_count);
+				detail::append_bytes(out, modes, *mode_count);
+				if (topology != nullptr)
+					detail::append_bytes(out, topology, 1);
+			}
+
+			detail::TraceArgs args;
+			args.add(flags).add(capacities).add(uint8_t(topology != nullptr));
+			self->log_.append(TraceCall::Query_Display_Config, args, result, start, out.data(), out.size());
+			return result;
+		}
+
+		static LONG WINAPI display_config_get_device_info(DISPLAYCONFIG_DEVICE_INFO_HEADER* header)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto request = *header;
+			auto result = self->api_.display_config_get_device_info(header);
+
+			detail::TraceArgs args;
+			args.add(static_cast<int32_t>(request.type)).add(request.size).add(request.adapterId).add(request.id);
+			self->log_.append(TraceCall::Display_Config_Get_Device_Info, args, result, start, header, result == ERROR_SUCCESS ? request.size : 0);
+			return result;
+		}
+
+		static UINT WINAPI get_dpi_for_window(HWND hwnd)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->get_dpi_for_window_(hwnd);
+
+			detail::TraceArgs args;
+			args.add_handle(hwnd);
+			self->log_.append(TraceCall::Get_Dpi_For_Window, args, result, start, nullptr, 0);
+			return result;
+		}
+
+		static HRESULT WINAPI get_dpi_for_monitor(HMONITOR hmonitor, MONITOR_DPI_TYPE type, UINT* dpi_x, UINT* dpi_y)
+		{
+			auto self = active();
+			auto start = detail::trace_now_ns();
+			auto result = self->get_dpi_for_monitor_(hmonitor, type, dpi_x, dpi_y);
+
+			UINT dpis[] = { *dpi_x, *dpi_y };
+			detail::TraceArgs args;
+			args.add_handle(hmonitor).add(static_cast<int32_t>(type));
+			self->log_.append(TraceCall::Get_Dpi_For_Monitor, args, result, start, dpis, sizeof(dpis));
+			return result;
+		}
+
+		detail::DisplayApi api_;
+		detail::GetDpiForWindowProc get_dpi_for_window_ = nullptr;
+		detail::GetDpiForMonitorProc get_dpi_for_monitor_ = nullptr;
+		TraceLog log_;
+	};
+
+	//=========================================================================
+	// answers display calls from a recorded trace instead of the system, see
+	// TraceReplay for how calls are matched. calls naming windows fall back
+	// to the first recorded result since window handles differ between runs
+	// and count as misses, anything else not in the trace fails like the
+	// real call would and counts as a miss
+	//=========================================================================
+	class DisplayTraceReplayer
+	{
+	public:
+		DisplayTraceReplayer() = default;
+
+		~DisplayTraceReplayer()
+		{
+			uninstall();
+		}
+
+		DisplayTraceReplayer(const DisplayTraceReplayer&) = delete;
+		DisplayTraceReplayer& operator=(const DisplayTraceReplayer&) = delete;
+
+		// false if missing, corrupt or recorded by a build with other layouts
+		bool load(const tstring& path)
+		{
+			return replay_.load(path, detail::trace_layout_hash());
+		}
+
+		bool load(const TraceLog& log)
+		{
+			auto bytes = log.encode();
+			return replay_.decode(bytes.data(), bytes.size(), detail::trace_layout_hash());
+		}
+
+		//==================================================================
+		// route display calls to the trace. with replay_timings each call
+		// takes as long as it did when recorded, for benchmarks
+		//==================================================================
+		void install(bool replay_timings = false)
+		{
+			if (installed_)
+				return;
+
+			detail::load_user32_symbols();
+			detail::load_shcore_symbols();
+
+			api_ = detail::display_api;
+			get_dpi_for_window_ = detail::get_dpi_for_window;
+			get_dpi_for_monitor_ = detail::get_dpi_for_monitor;
+			replay_.set_replay_timings(replay_timings);
+			active() = this;
+			installed_ = true;
+
+			auto& api = detail::display_api;
+			api.enum_display_devices = enum_display_devices;
+			api.enum_display_monitors = enum_display_monitors;
+			api.get_monitor_info = get_monitor_info;
+			api.enum_display_settings_ex = enum_display_settings_ex;
+			api.change_display_settings_ex = change_display_settings_ex;
+			api.monitor_from_window = monitor_from_window;
+			api.monitor_from_rect = monitor_from_rect;
+			api.monitor_from_point = monitor_from_point;
+			api.system_parameters_info = system_parameters_info;
+			api.system_parameters_info_for_dpi = system_parameters_info_for_dpi;
+			api.reg_get_value = reg_get_value;
+			api.get_display_config_buffer_sizes = get_display_config_buffer_sizes;
+			api.query_display_config = query_display_config;
+			api.display_config_get_device_info = display_config_get_device_info;
+			detail::get_dpi_for_window = get_dpi_for_window;
+			detail::get_dpi_for_monitor = get_dpi_for_monitor;
+		}
+
+		void uninstall()
+		{
+			if (!installed_)
+				return;
+
+			detail::display_api = api_;
+			detail::get_dpi_for_window = get_dpi_for_window_;
+			detail::get_dpi_for_monitor = get_dpi_for_monitor_;
+			active() = nullptr;
+			installed_ = false;
+		}
+
+		// restart every call sequence from its first recorded result
+		void rewind() { replay_.rewind(); }
+
+		size_t record_count() const { return replay_.record_count(); }
+		size_t misses() const { return replay_.misses(); }
+
+	private:
+		static DisplayTraceReplayer*& active()
+		{
+			static DisplayTraceReplayer* replayer = nullptr;
+			return replayer;
+		}
+
+		// null on a miss, entries are never modified once loaded
+		static const TraceReplay::Entry* lookup(TraceCall call, const detail::TraceArgs& args, bool fall_back)
+		{
+			return active()->replay_.lookup(call, args, fall_back);
+		}
+
+		static BOOL WINAPI enum_display_devices(LPCTSTR device, DWORD index, DISPLAY_DEVICE* dd, DWORD flags)
+		{
+			detail::TraceArgs args;
+			args.add_string(device).add(index).add(flags);
+			auto entry = lookup(TraceCall::Enum_Display_Devices, args, false);
+			if (entry == nullptr || entry->out.size() != sizeof(DISPLAY_DEVICE))
+				return FALSE;
+
+			std::memcpy(dd, entry->out.data(), sizeof(DISPLAY_DEVICE));
+			return static_cast<BOOL>(entry->result);
+		}
+
+		static BOOL WINAPI enum_display_monitors(HDC hdc, LPCRECT clip, MONITORENUMPROC proc, LPARAM data)
+		{
+			detail::TraceArgs args;
+			args.add_handle(hdc).add(clip ? *clip : RECT{}).add(uint8_t(clip != nullptr));
+			auto entry = lookup(TraceCall::Enum_Display_Monitors, args, false);
+			if (entry == nullptr)
+				return FALSE;
+
+			for (size_t offset = 0; offset + sizeof(detail::TraceMonitor) <= entry->out.size(); offset += sizeof(detail::TraceMonitor))
+			{
+				detail::TraceMonitor monitor;
+				std::memcpy(&monitor, entry->out.data() + offset, sizeof(monitor));
+				if (!proc(reinterpret_cast<HMONITOR>(static_cast<uintptr_t>(monitor.hmonitor)), hdc, &monitor.rect, data))
+					break;
+			}
+
+			return static_cast<BOOL>(entry->result);
+		}
+
+		static BOOL WINAPI get_monitor_info(HMONITOR hmonitor, LPMONITORINFO mi)
+		{
+			DWORD size = mi->cbSize;
+			detail::TraceArgs args;
+			args.add_handle(hmonitor).add(size);
+			auto entry = lookup(TraceCall::Get_Monitor_Info, args, false);
+			if (entry == nullptr || entry->out.size() != size)
+				return FALSE;
+
+			std::memcpy(mi, entry->out.data(), size);
+			return static_cast<BOOL>(entry->result);
+		}
+
+		static BOOL WINAPI enum_display_settings_ex(LPCTSTR device, DWORD index, DEVMODE* dm, DWORD flags)
+		{
+			detail::TraceArgs args;
+			args.add_string(device).add(index).add(flags);
+			auto entry = lookup(TraceCall::Enum_Display_Settings_Ex, args, false);
+			if (entry == nullptr || entry->out.size() != sizeof(DEVMODE))
+				return FALSE;
+
+			std::memcpy(dm, entry->out.data(), sizeof(DEVMODE));
+			return static_cast<BOOL>(entry->result);
+		}
+
+		static LONG WINAPI change_display_settings_ex(LPCTSTR device, DEVMODE* dm, HWND, DWORD flags, LPVOID)
+		{
+			detail::TraceArgs args;
+			detail::add_trace_mode(args.add_string(device), dm).add(flags);
+			auto entry = lookup(TraceCall::Change_Display_Settings_Ex, args, false);
+			return entry == nullptr ? DISP_CHANGE_FAILED : static_cast<LONG>(entry->result);
+		}
+
+		static HMONITOR WINAPI monitor_from_window(HWND hwnd, DWORD flags)
+		{
+			detail::TraceArgs args;
+			args.add_handle(hwnd).add(flags);
+			auto entry = lookup(TraceCall::Monitor_From_Window, args, true);
+			return entry == nullptr ? NULL : reinterpret_cast<HMONITOR>(static_cast<intptr_t>(entry->result));
+		}
+
+		static HMONITOR WINAPI monitor_from_rect(LPCRECT rect, DWORD flags)
+		{
+			detail::TraceArgs args;
+			args.add(*rect).add(flags);
+			auto entry = lookup(TraceCall::Monitor_From_Rect, args, false);
+			return entry == nullptr ? NULL : reinterpret_cast<HMONITOR>(static_cast<intptr_t>(entry->result));
+		}
+
+		static HMONITOR WINAPI monitor_from_point(POINT point, DWORD flags)
+		{
+			detail::TraceArgs args;
+			args.add(point).add(flags);
+			auto entry = lookup(TraceCall::Monitor_From_Point, args, false);
+			return entry == nullptr ? NULL : reinterpret_cast<HMONITOR>(static_cast<intptr_t>(entry->result));
+		}
+
+		static BOOL copy_spi_output(const TraceReplay::Entry* entry, UINT action, UINT ui_param, PVOID pv_param)
+		{
+			if (entry == nullptr || entry->out.size() != (entry->result ? detail::spi_output_size(action, ui_param) : 0))
+				return FALSE;
+
+			if (!entry->out.empty())
+				std::memcpy(pv_param, entry->out.data(), entry->out.size());
+			return static_cast<BOOL>(entry->result);
+		}
+
+		static BOOL WINAPI system_parameters_info(UINT action, UINT ui_param, PVOID pv_param, UINT win_ini)
+		{
+			detail::TraceArgs args;
+			args.add(action).add(ui_param).add(win_ini);
+			return copy_spi_output(lookup(TraceCall::System_Parameters_Info, args, false), action, ui_param, pv_param);
+		}
+
+		static BOOL WINAPI system_parameters_info_for_dpi(UINT action, UINT ui_param, PVOID pv_param, UINT win_ini, UINT dpi)
+		{
+			detail::TraceArgs args;
+			args.add(action).add(ui_param).add(win_ini).add(dpi);
+			return copy_spi_output(lookup(TraceCall::System_Parameters_Info_For_Dpi, args, false), action, ui_param, pv_param);
+		}
+
+		// a value not in the trace is missing, like a key that does not exist
+		static LONG WINAPI reg_get_value(HKEY key, LPCTSTR subkey, LPCTSTR value, DWORD flags, LPDWORD type, PVOID data, LPDWORD size)
+		{
+			detail::TraceArgs args;
+			detail::add_trace_reg_value(args, key, subkey, value, flags, type, data, size);
+			auto entry = lookup(TraceCall::Reg_Get_Value, args, false);
+			if (entry == nullptr)
+				return ERROR_FILE_NOT_FOUND;
+			if (entry->result != ERROR_SUCCESS && entry->result != ERROR_MORE_DATA)
+				return static_cast<LONG>(entry->result);
+
+			DWORD reported[2] = {};
+			if (entry->out.size() < sizeof(reported))
+				return ERROR_FILE_NOT_FOUND;
+
+			std::memcpy(reported, entry->out.data(), sizeof(reported));
+			auto data_size = entry->out.size() - sizeof(reported);
+			if (data_size != 0 && (data == nullptr || size == nullptr || data_size > *size))
+				return ERROR_FILE_NOT_FOUND;
+
+			if (data_size != 0)
+				std::memcpy(data, entry->out.data() + sizeof(reported), data_size);
+			if (type != nullptr)
+				*type = reported[0];
+			if (size != nullptr)
+				*size = reported[1];
+			return static_cast<LONG>(entry->result);
+		}
+
+		static LONG WINAPI get_display_config_buffer_sizes(UINT32 flags, UINT32* path_count, UINT32* mode_count)
+		{
+			detail::TraceArgs args;
+			args.add(flags);
+			auto entry = lookup(TraceCall::Get_Display_Config_Buffer_Sizes, args, false);
+			if (entry == nullptr)
+				return ERROR_GEN_FAILURE;
+
+			UINT32 counts[2] = {};
+			if (entry->out.size() == sizeof(counts))
+			{
+				std::memcpy(counts, entry->out.data(), sizeof(counts));
+				*path_count = counts[0];
+				*mode_count = counts[1];
+			}
+			return static_cast<LONG>(entry->result);
+		}
+
+		static LONG WINAPI query_display_config(UINT32 flags, UINT32* path_count, DISPLAYCONFIG_PATH_INFO* paths,
+			UINT32* mode_count, DISPLAYCONFIG_MODE_INFO* modes, DISPLAYCONFIG_TOPOLOGY_ID* topology)
+		{
+			UINT32 capacities[] = { *path_count, *mode_count };
+			detail::TraceArgs args;
+			args.add(flags).add(capacities).add(uint8_t(topology != nullptr));
+			auto entry = lookup(TraceCall::Query_Display_Config, args, false);
+			if (entry == nullptr)
+				return ERROR_GEN_FAILURE;
+			if (entry->result != ERROR_SUCCESS)
+				return static_cast<LONG>(entry->result);
+
+			UINT32 counts[2] = {};
+			if (entry->out.size() < sizeof(counts))
+				return ERROR_GEN_FAILURE;
+
+			std::memcpy(counts, entry->out.data(), sizeof(counts));
+			auto paths_size = counts[0] * sizeof(DISPLAYCONFIG_PATH_INFO);
+			auto modes_size = counts[1] * sizeof(DISPLAYCONFIG_MODE_INFO);
+			auto topology_size = topology != nullptr ? sizeof(DISPLAYCONFIG_TOPOLOGY_ID) : 0;
+			if (counts[0] > capacities[0] || counts[1] > capacities[1] || entry->out.size() != sizeof(counts) + paths_size + modes_size + topology_size)
+				return ERROR_GEN_FAILURE;
+
+			auto out = entry->out.data() + sizeof(counts);
+			std::memcpy(paths, out, paths_size);
+			std::memcpy(modes, out + paths_size, modes_size);
+			if (topology != nullptr)
+				std::memcpy(topology, out + paths_size + modes_size, topology_size);
+
+			*path_count = counts[0];
+			*mode_count = counts[1];
+			return ERROR_SUCCESS;
+		}
+
+		static LONG WINAPI display_config_get_device_info(DISPLAYCONFIG_DEVICE_INFO_HEADER* header)
+		{
+			detail::TraceArgs args;
+			args.add(static_cast<int32_t>(header->type)).add(header->size).add(header->adapterId).add(header->id);
+			auto entry = lookup(TraceCall::Display_Config_Get_Device_Info, args, false);
+			if (entry == nullptr)
+				return ERROR_GEN_FAILURE;
+			if (entry->result != ERROR_SUCCESS)
+				return static_cast<LONG>(entry->result);
+			if (entry->out.size() != header->size)
+				return ERROR_GEN_FAILURE;
+
+			std::memcpy(header, entry->out.data(), header->size);
+			return ERROR_SUCCESS;
+		}
+
+		static UINT WINAPI get_dpi_for_window(HWND hwnd)
+		{
+			detail::TraceArgs args;
+			args.add_handle(hwnd);
+			auto entry = lookup(TraceCall::Get_Dpi_For_Window, args, true);
+			return entry == nullptr ? detail::Default_DPI : static_cast<UINT>(entry->result);
+		}
+
+		static HRESULT WINAPI get_dpi_for_monitor(HMONITOR hmonitor, MONITOR_DPI_TYPE type, UINT* dpi_x, UINT* dpi_y)
+		{
+			detail::TraceArgs args;
+			args.add_handle(hmonitor).add(static_cast<int32_t>(type));
+			auto entry = lookup(TraceCall::Get_Dpi_For_Monitor, args, false);
+			UINT dpis[2] = {};
+			if (entry == nullptr || entry->out.size() != sizeof(dpis))
+				return E_INVALIDARG;
+
+			std::memcpy(dpis, entry->out.data(), sizeof(dpis));
+			*dpi_x = dpis[0];
+			*dpi_y = dpis[1];
+			return static_cast<HRESULT>(entry->result);
+		}
+
+		detail::DisplayApi api_;
+		detail::GetDpiForWindowProc get_dpi_for_window_ = nullptr;
+		detail::GetDpiForMonitorProc get_dpi_for_monitor_ = nullptr;
+		bool installed_ = false;
+		TraceReplay replay_;
+	};
+}
+
+#endif
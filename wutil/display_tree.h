@@ -0,0 +1,303 @@
+#ifndef WUTIL_DISPLAY_TREE_INCLUDED
+#define WUTIL_DISPLAY_TREE_INCLUDED
+
+#include "wutil.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <string>
+#include <unordered_map>
+
+namespace wutil
+{
+	struct MonitorNode
+	{
+		DisplayId id = 0;
+		// DeviceID holds the device interface path the id is derived from
+		DISPLAY_DEVICE device = {};
+		size_t adapter = 0;
+		size_t source = 0;
+		// the connector from display config, looked up for monitors that hash alike while on an active path
+		bool has_connector = false;
+		DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY output_technology = {};
+		UINT32 connector_instance = 0;
+	};
+
+	//=========================================================================
+	// a gdi source, one output of an adapter. DeviceName is the name shared
+	// with MONITORINFOEX::szDevice
+	//=========================================================================
+	struct SourceNode
+	{
+		DISPLAY_DEVICE device = {};
+		size_t adapter = 0;
+		std::vector<size_t> monitors;
+	};
+
+	struct AdapterNode
+	{
+		DisplayId id = 0;
+		// the first source of the adapter, DeviceID and DeviceString describe the adapter
+		DISPLAY_DEVICE device = {};
+		std::vector<size_t> sources;
+		std::vector<size_t> monitors;
+	};
+
+	namespace detail
+	{
+		struct DisplayTarget
+		{
+			std::wstring source_name;
+			std::wstring device_path;
+			DISPLAYCONFIG_VIDEO_OUTPUT_TECHNOLOGY output_technology = {};
+			UINT32 connector_instance = 0;
+			// manufacturer and product code from the monitor's edid
+			bool edid_ids_valid = false;
+			UINT16 edid_manufacture_id = 0;
+			UINT16 edid_product_code_id = 0;
+		};
+
+		// gdi source and monitor device path of every active display config target
+		inline std::vector<DisplayTarget> get_display_targets()
+		{
+			std::vector<DisplayTarget> targets;
+			std::vector<DISPLAYCONFIG_PATH_INFO> paths;
+			std::vector<DISPLAYCONFIG_MODE_INFO> modes;
+			if (!query_active_display_paths(paths, modes))
+				return targets;
+
+			for (const auto& path : paths)
+			{
+				DISPLAYCONFIG_SOURCE_DEVICE_NAME source_name = {};
+				source_name.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_SOURCE_NAME;
+				source_name.header.size = sizeof(source_name);
+				source_name.header.adapterId = path.sourceInfo.adapterId;
+				source_name.header.id = path.sourceInfo.id;
+
+				DISPLAYCONFIG_TARGET_DEVICE_NAME target_name = {};
+				target_name.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_TARGET_NAME;
+				target_name.header.size = sizeof(target_name);
+				target_name.header.adapterId = path.targetInfo.adapterId;
+				target_name.header.id = path.targetInfo.id;
+
+				if (display_api.display_config_get_device_info(&source_name.header) != ERROR_SUCCESS ||
+					display_api.display_config_get_device_info(&target_name.header) != ERROR_SUCCESS)
+					continue;
+
+				DisplayTarget target;
+				target.source_name.assign(source_name.viewGdiDeviceName, std::find(std::begin(source_name.viewGdiDeviceName), std::end(source_name.viewGdiDeviceName), 0));
+				target.device_path.assign(target_name.monitorDevicePath, std::find(std::begin(target_name.monitorDevicePath), std::end(target_name.monitorDevicePath), 0));
+				target.output_technology = target_name.outputTechnology;
+				target.connector_instance = target_name.connectorInstance;
+				target.edid_ids_valid = target_name.flags.edidIdsValid != 0;
+				target.edid_manufacture_id = target_name.edidManufactureId;
+				target.edid_product_code_id = target_name.edidProductCodeId;
+				targets.push_back(std::move(target));
+			}
+
+			return targets;
+		}
+
+		// display config reports names in utf-16 regardless of the character set, compared without case like pnp paths
+		inline bool equal_display_path(const std::wstring& wide, tstring_view name)
+		{
+			if (wide.size() != name.size())
+				return false;
+
+			for (size_t i = 0; i < wide.size(); ++i)
+			{
+				auto a = wide[i];
+				auto b = static_cast<WCHAR>(static_cast<std::make_unsigned_t<TCHAR>>(name[i]));
+				if (a != b && std::towlower(a) != std::towlower(b))
+					return false;
+			}
+
+			return true;
+		}
+
+		// the video key of a source minus its last component, shared by all sources of an adapter
+		inline tstring_view adapter_key(const DISPLAY_DEVICE& source)
+		{
+			tstring_view key = source.DeviceKey;
+			auto slash = key.find_last_of(TEXT('\\'));
+			return slash == tstring_view::npos ? key : key.substr(0, slash);
+		}
+	}
+
+	//=========================================================================
+	// adapters, their gdi sources and the monitors attached to them with
+	// stable ids, built from one pass of nested EnumDisplayDevices calls.
+	// EnumDisplayDevices(NULL, i) enumerates sources, the sources of one
+	// adapter are grouped by their video key
+	//=========================================================================
+	class DisplayTree
+	{
+	public:
+		const std::vector<AdapterNode>& adapters() const { return adapters_; }
+		const std::vector<SourceNode>& sources() const { return sources_; }
+		const std::vector<MonitorNode>& monitors() const { return monitors_; }
+
+		const AdapterNode* find_adapter(DisplayId id) const
+		{
+			auto it = adapter_index_.find(id);
+			return it == adapter_index_.end() ? nullptr : &adapters_[it->second];
+		}
+
+		const MonitorNode* find_monitor(DisplayId id) const
+		{
+			auto it = monitor_index_.find(id);
+			return it == monitor_index_.end() ? nullptr : &monitors_[it->second];
+		}
+
+		// lookup by gdi name, e.g. MONITORINFOEX::szDevice
+		const SourceNode* find_source(tstring_view device_name) const
+		{
+			for (const auto& source : sources_)
+			{
+				if (device_name == source.device.DeviceName)
+					return &source;
+			}
+
+			return nullptr;
+		}
+
+		// adapter driving gdi name
+		const AdapterNode* find_adapter(tstring_view device_name) const
+		{
+			auto source = find_source(device_name);
+			return source == nullptr ? nullptr : &adapters_[source->adapter];
+		}
+
+		// first monitor attached to gdi name, matches get_monitor_id unless two monitors hash alike
+		const MonitorNode* find_monitor(tstring_view device_name) const
+		{
+			auto source = find_source(device_name);
+			if (source == nullptr || source->monitors.empty())
+				return nullptr;
+
+			return &monitors_[source->monitors.front()];
+		}
+
+	private:
+		friend DisplayTree get_display_tree();
+
+		// last resort for ids still alike, rehash deterministically in enumeration order
+		template <typename Index>
+		static DisplayId unique_id(DisplayId id, const Index& index)
+		{
+			while (index.count(id) != 0)
+				id = detail::fnv1a(&id, sizeof(id));
+
+			return id;
+		}
+
+		std::vector<AdapterNode> adapters_;
+		std::vector<SourceNode> sources_;
+		std::vector<MonitorNode> monitors_;
+		std::unordered_map<DisplayId, size_t> adapter_index_;
+		std::unordered_map<DisplayId, size_t> monitor_index_;
+	};
+
+	//=========================================================================
+	// build the adapter to source to monitor tree. adapter ids come from the
+	// pnp id and video key, monitor ids from the monitor device interface
+	// path. monitors of identical hardware that hash alike are told apart by
+	// their adapter and display config connector, which does not depend on
+	// enumeration order. monitors without an active path have no connector,
+	// those alike are rehashed in enumeration order and may swap ids when
+	// the order changes
+	//=========================================================================
+	inline DisplayTree get_display_tree()
+	{
+		DisplayTree tree;
+		std::vector<DisplayId> monitor_ids;
+		std::unordered_map<DisplayId, size_t> adapter_by_key;
+
+		DISPLAY_DEVICE source;
+		source.cb = sizeof(source);
+		for (DWORD i = 0; detail::display_api.enum_display_devices(NULL, i, &source, 0); ++i)
+		{
+			auto key = detail::make_display_id(detail::adapter_key(source), detail::make_display_id(source.DeviceID));
+			auto found = adapter_by_key.find(key);
+			if (found == adapter_by_key.end())
+			{
+				AdapterNode adapter_node;
+				adapter_node.device = source;
+				adapter_node.id = DisplayTree::unique_id(key, tree.adapter_index_);
+				tree.adapter_index_.emplace(adapter_node.id, tree.adapters_.size());
+				found = adapter_by_key.emplace(key, tree.adapters_.size()).first;
+				tree.adapters_.push_back(std::move(adapter_node));
+			}
+
+			SourceNode source_node;
+			source_node.device = source;
+			source_node.adapter = found->second;
+			tree.adapters_[found->second].sources.push_back(tree.sources_.size());
+
+			DISPLAY_DEVICE monitor;
+			monitor.cb = sizeof(monitor);
+			for (DWORD j = 0; detail::display_api.enum_display_devices(source.DeviceName, j, &monitor, EDD_GET_DEVICE_INTERFACE_NAME); ++j)
+			{
+				MonitorNode monitor_node;
+				monitor_node.device = monitor;
+				monitor_node.adapter = found->second;
+				monitor_node.source = tree.sources_.size();
+
+				source_node.monitors.push_back(tree.monitors_.size());
+				tree.adapters_[found->second].monitors.push_back(tree.monitors_.size());
+				monitor_ids.push_back(detail::make_display_id(monitor.DeviceID[0] != 0 ? monitor.DeviceID : monitor.DeviceName));
+				tree.monitors_.push_back(monitor_node);
+			}
+
+			tree.sources_.push_back(std::move(source_node));
+		}
+
+		std::unordered_map<DisplayId, int> id_count;
+		for (auto id : monitor_ids)
+			++id_count[id];
+
+		std::vector<detail::DisplayTarget> targets;
+		if (std::any_of(id_count.begin(), id_count.end(), [](const auto& count) { return count.second > 1; }))
+			targets = detail::get_display_targets();
+
+		for (size_t i = 0; i < tree.monitors_.size(); ++i)
+		{
+			auto& monitor_node = tree.monitors_[i];
+			const auto& source_node = tree.sources_[monitor_node.source];
+			auto id = monitor_ids[i];
+
+			if (id_count[id] > 1)
+			{
+				// a path matches when it is the only one from this source to this device
+				const detail::DisplayTarget* match = nullptr;
+				int matches = 0;
+				for (const auto& target : targets)
+				{
+					if (detail::equal_display_path(target.source_name, source_node.device.DeviceName) &&
+						detail::equal_display_path(target.device_path, monitor_node.device.DeviceID))
+					{
+						match = &target;
+						++matches;
+					}
+				}
+
+				if (matches == 1)
+				{
+					monitor_node.has_connector = true;
+					monitor_node.output_technology = match->output_technology;
+					monitor_node.connector_instance = match->connector_instance;
+
+					uint32_t connector[] = { static_cast<uint32_t>(match->output_technology), match->connector_instance };
+					id = detail::fnv1a(connector, sizeof(connector), detail::fnv1a(&tree.adapters_[monitor_node.adapter].id, sizeof(DisplayId), id));
+				}
+			}
+
+			monitor_node.id = DisplayTree::unique_id(id, tree.monitor_index_);
+			tree.monitor_index_.emplace(monitor_node.id, i);
+		}
+
+		return tree;
+	}
+}
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef WUTIL_DPI_LAYOUT_INCLUDED
+#define WUTIL_DPI_LAYOUT_INCLUDED
+
+#include "wutil.h"
+
+namespace wutil
+{
+	//=========================================================================
+	// distinct dpis of all connected monitors, sorted
+	//=========================================================================
+	inline std::vector<UINT> get_connected_dpis()
+	{
+		std::vector<UINT> dpis;
+		for (const auto& mi : get_all_monitor_info())
+			dpis.push_back(get_dpi(detail::display_api.monitor_from_rect(&mi.rcMonitor, MONITOR_DEFAULTTONEAREST)));
+
+		std::sort(dpis.begin(), dpis.end());
+		dpis.erase(std::unique(dpis.begin(), dpis.end()), dpis.end());
+		return dpis;
+	}
+
+	// physical layout for one dpi, indexed like the logical layout
+	struct DpiLayout
+	{
+		UINT dpi = detail::Default_DPI;
+		std::vector<RECT> rects;
+		std::vector<int> metrics;
+	};
+
+	//=========================================================================
+	// logical 96 dpi layout kept scaled for every connected dpi, so handling
+	// WM_DPICHANGED is a lookup instead of rescaling. scaling matches
+	// scale_rect and scale_value exactly. layouts are not thread safe
+	//=========================================================================
+	class DpiLayoutCache
+	{
+	public:
+		DpiLayoutCache(std::vector<RECT> rects, std::vector<int> metrics)
+		{
+			logical_.rects = std::move(rects);
+			logical_.metrics = std::move(metrics);
+		}
+
+		const DpiLayout& logical() const { return logical_; }
+
+		//==================================================================
+		// keep layouts for exactly these dpis, existing ones are reused and
+		// their pointers stay valid
+		//==================================================================
+		void set_dpis(std::vector<UINT> dpis)
+		{
+			std::sort(dpis.begin(), dpis.end());
+			dpis.erase(std::unique(dpis.begin(), dpis.end()), dpis.end());
+
+			// both sides are sorted, walk them together
+			std::vector<std::unique_ptr<DpiLayout>> layouts;
+			layouts.reserve(dpis.size());
+			auto it = layouts_.begin();
+			for (auto dpi : dpis)
+			{
+				while (it != layouts_.end() && (*it)->dpi < dpi)
+					++it;
+
+				if (it != layouts_.end() && (*it)->dpi == dpi)
+					layouts.push_back(std::move(*it++));
+				else
+					layouts.push_back(make_layout(dpi));
+			}
+
+			layouts_ = std::move(layouts);
+		}
+
+		void set_dpis(const Topology& topology)
+		{
+			set_dpis(topology.dpis);
+		}
+
+		// precompute for monitors currently connected, call on WM_DISPLAYCHANGE
+		void refresh_dpis()
+		{
+			set_dpis(get_connected_dpis());
+		}
+
+		//==================================================================
+		// physical layout for dpi. dpis outside the connected set are
+		// computed and kept on first use
+		//==================================================================
+		const DpiLayout* layout(UINT dpi)
+		{
+			auto it = find(dpi);
+			if (it != layouts_.end() && (*it)->dpi == dpi)
+			{
+				++hits_;
+				return it->get();
+			}
+
+			++misses_;
+			return layouts_.insert(it, make_layout(dpi))->get();
+		}
+
+		// precomputed layout or null, never computes
+		const DpiLayout* find_layout(UINT dpi) const
+		{
+			auto it = std::lower_bound(layouts_.begin(), layouts_.end(), dpi, [](const std::unique_ptr<DpiLayout>& layout, UINT d) { return layout->dpi < d; });
+			return it != layouts_.end() && (*it)->dpi == dpi ? it->get() : nullptr;
+		}
+
+		//==================================================================
+		// incremental updates, only the changed entry is rescaled in each
+		// physical layout
+		//==================================================================
+		bool update_rect(size_t index, const RECT& rect)
+		{
+			if (index >= logical_.rects.size())
+				return false;
+
+			logical_.rects[index] = rect;
+			for (auto& layout : layouts_)
+				layout->rects[index] = scale_rect(rect, layout->dpi);
+
+			return true;
+		}
+
+		bool update_metric(size_t index, int metric)
+		{
+			if (index >= logical_.metrics.size())
+				return false;
+
+			logical_.metrics[index] = metric;
+			for (auto& layout : layouts_)
+				layout->metrics[index] = scale_value(metric, layout->dpi);
+
+			return true;
+		}
+
+		// append to the layout, returns the new index
+		size_t add_rect(const RECT& rect)
+		{
+			logical_.rects.push_back(rect);
+			for (auto& layout : layouts_)
+				layout->rects.push_back(scale_rect(rect, layout->dpi));
+
+			return logical_.rects.size() - 1;
+		}
+
+		size_t add_metric(int metric)
+		{
+			logical_.metrics.push_back(metric);
+			for (auto& layout : layouts_)
+				layout->metrics.push_back(scale_value(metric, layout->dpi));
+
+			return logical_.metrics.size() - 1;
+		}
+
+		// replace whole layout, every physical layout is rebuilt in place
+		void set_layout(std::vector<RECT> rects, std::vector<int> metrics)
+		{
+			logical_.rects = std::move(rects);
+			logical_.metrics = std::move(metrics);
+			for (auto& layout : layouts_)
+				scale_into(*layout);
+		}
+
+		size_t layout_count() const { return layouts_.size(); }
+
+		// bytes held by logical and physical layouts
+		size_t memory_usage() const
+		{
+			auto bytes = [](const DpiLayout& layout)
+			{
+				return sizeof(DpiLayout) + layout.rects.capacity() * sizeof(RECT) + layout.metrics.capacity() * sizeof(int);
+			};
+
+			size_t total = bytes(logical_);
+			for (const auto& layout : layouts_)
+				total += bytes(*layout);
+
+			return total;
+		}
+
+		size_t hits() const { return hits_; }
+		size_t misses() const { return misses_; }
+
+	private:
+		std::vector<std::unique_ptr<DpiLayout>>::iterator find(UINT dpi)
+		{
+			return std::lower_bound(layouts_.begin(), layouts_.end(), dpi, [](const std::unique_ptr<DpiLayout>& layout, UINT d) { return layout->dpi < d; });
+		}
+
+		std::unique_ptr<DpiLayout> make_layout(UINT dpi) const
+		{
+			auto layout = std::make_unique<DpiLayout>();
+			layout->dpi = dpi;
+			scale_into(*layout);
+			return layout;
+		}
+
+		void scale_into(DpiLayout& layout) const
+		{
+			layout.rects.resize(logical_.rects.size());
+			for (size_t i = 0; i < logical_.rects.size(); ++i)
+				layout.rects[i] = scale_rect(logical_.rects[i], layout.dpi);
+
+			layout.metrics.resize(logical_.metrics.size());
+			for (size_t i = 0; i < logical_.metrics.size(); ++i)
+				layout.metrics[i] = scale_value(logical_.metrics[i], layout.dpi);
+		}
+
+		DpiLayout logical_;
+		// sorted by dpi, boxed so pointers survive insertion
+		std::vector<std::unique_ptr<DpiLayout>> layouts_;
+		size_t hits_ = 0;
+		size_t misses_ = 0;
+	};
+}
+
+#endif
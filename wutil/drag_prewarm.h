@@ -0,0 +1,414 @@
+#ifndef WUTIL_DRAG_PREWARM_INCLUDED
+#define WUTIL_DRAG_PREWARM_INCLUDED
+
+#include "wutil.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace wutil
+{
+	struct PrewarmMonitor
+	{
+		RECT rect = {};
+		UINT dpi = detail::Default_DPI;
+	};
+
+	// monitors without a dpi, e.g. in a topology put together by hand, get 96
+	inline std::vector<PrewarmMonitor> get_prewarm_monitors(const Topology& topology)
+	{
+		std::vector<PrewarmMonitor> monitors;
+		for (size_t i = 0; i < topology.monitors.size(); ++i)
+		{
+			auto dpi = i < topology.dpis.size() ? topology.dpis[i] : detail::Default_DPI;
+			monitors.push_back(PrewarmMonitor{ topology.monitors[i].rcMonitor, dpi });
+		}
+
+		return monitors;
+	}
+
+	//=========================================================================
+	// predicts which monitor a dragged window is about to land on. windows
+	// take the dpi of the monitor holding most of their area, so the rect
+	// is extrapolated along its recent velocity and tested the same way
+	//=========================================================================
+	class DragPredictor
+	{
+	public:
+		explicit DragPredictor(DWORD lookahead_ms = 150) : lookahead_ms_(lookahead_ms) {}
+
+		void set_monitors(std::vector<PrewarmMonitor> monitors) { monitors_ = std::move(monitors); }
+		const std::vector<PrewarmMonitor>& monitors() const { return monitors_; }
+
+		void begin(const RECT& rect, DWORD time_ms)
+		{
+			last_ = rect;
+			last_time_ = time_ms;
+			velocity_x_ = 0.0;
+			velocity_y_ = 0.0;
+		}
+
+		//==================================================================
+		// feed each WM_MOVING rect, returns the monitor the window will be
+		// on after the lookahead when that differs from the current one,
+		// -1 otherwise
+		//==================================================================
+		int update(const RECT& rect, DWORD time_ms)
+		{
+			auto elapsed = time_ms - last_time_;
+			if (elapsed > 0)
+			{
+				// smoothed pixels per ms, mouse input arrives in bursts
+				double vx = static_cast<double>(rect.left - last_.left) / elapsed;
+				double vy = static_cast<double>(rect.top - last_.top) / elapsed;
+				velocity_x_ += (vx - velocity_x_) * Velocity_Smoothing;
+				velocity_y_ += (vy - velocity_y_) * Velocity_Smoothing;
+			}
+
+			last_ = rect;
+			last_time_ = time_ms;
+
+			auto dx = static_cast<LONG>(velocity_x_ * lookahead_ms_);
+			auto dy = static_cast<LONG>(velocity_y_ * lookahead_ms_);
+			RECT projected = { rect.left + dx, rect.top + dy, rect.right + dx, rect.bottom + dy };
+
+			int current = monitor_of(rect);
+			int target = monitor_of(projected);
+			return target != current ? target : -1;
+		}
+
+		// monitor holding most of rect, -1 if it touches none
+		int monitor_of(const RECT& rect) const
+		{
+			int best = -1;
+			int64_t best_area = 0;
+			for (size_t i = 0; i < monitors_.size(); ++i)
+			{
+				RECT overlap;
+				if (!IntersectRect(&overlap, &rect, &monitors_[i].rect))
+					continue;
+
+				auto area = static_cast<int64_t>(overlap.right - overlap.left) * (overlap.bottom - overlap.top);
+				if (area > best_area)
+				{
+					best = static_cast<int>(i);
+					best_area = area;
+				}
+			}
+
+			return best;
+		}
+
+	private:
+		static constexpr double Velocity_Smoothing = 0.5;
+
+		std::vector<PrewarmMonitor> monitors_;
+		DWORD lookahead_ms_ = 150;
+		RECT last_ = {};
+		DWORD last_time_ = 0;
+		double velocity_x_ = 0.0;
+		double velocity_y_ = 0.0;
+	};
+
+	//=========================================================================
+	// resources scaled for one dpi, fonts belong to whoever takes them
+	//=========================================================================
+	struct PrewarmedResources
+	{
+		UINT dpi = detail::Default_DPI;
+		std::vector<HFONT> fonts;
+		std::vector<RECT> rects;
+		std::vector<int> metrics;
+	};
+
+	//=========================================================================
+	// win32 calls made by DragPrewarmer, always called from a background
+	// thread. tests can substitute a backend with the same members
+	//=========================================================================
+	struct Win32PrewarmBackend
+	{
+		HFONT scale_font(HFONT hfont, UINT dpi) const { return wutil::scale_font(hfont, dpi); }
+		void delete_font(HFONT hfont) const { DeleteObject(hfont); }
+
+		std::vector<int> system_metrics(const std::vector<int>& indices, UINT dpi) const
+		{
+			SystemMetricsCache metrics;
+			std::vector<int> values;
+			for (auto index : indices)
+				values.push_back(metrics.system_metric(index, dpi));
+
+			return values;
+		}
+	};
+
+	namespace detail
+	{
+		//=====================================================================
+		// waits for discarded prewarms still running on a thread of its own
+		// and deletes their fonts, so discarding never blocks the thread
+		// handling the drag. the thread starts with the first prewarm handed
+		// over, destruction waits for the rest
+		//=====================================================================
+		template <typename Backend>
+		class PrewarmReaper
+		{
+		public:
+			explicit PrewarmReaper(Backend backend) : backend_(backend) {}
+
+			~PrewarmReaper()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					stopping_ = true;
+				}
+
+				wake_.notify_one();
+				if (thread_.joinable())
+					thread_.join();
+			}
+
+			PrewarmReaper(const PrewarmReaper&) = delete;
+			PrewarmReaper& operator=(const PrewarmReaper&) = delete;
+
+			void reap(std::future<PrewarmedResources> resources)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					queue_.push_back(std::move(resources));
+					if (!thread_.joinable())
+						thread_ = std::thread([this] { run(); });
+				}
+
+				wake_.notify_one();
+			}
+
+			// prewarms handed over so far whose fonts are deleted
+			size_t reaped() const { return reaped_.load(); }
+
+		private:
+			void run()
+			{
+				for (;;)
+				{
+					std::future<PrewarmedResources> resources;
+					{
+						std::unique_lock<std::mutex> lock(mutex_);
+						wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+						if (queue_.empty())
+							return;
+
+						resources = std::move(queue_.front());
+						queue_.pop_front();
+					}
+
+					for (auto hfont : resources.get().fonts)
+						backend_.delete_font(hfont);
+					++reaped_;
+				}
+			}
+
+			Backend backend_;
+			std::mutex mutex_;
+			std::condition_variable wake_;
+			std::deque<std::future<PrewarmedResources>> queue_;
+			std::thread thread_;
+			std::atomic<size_t> reaped_{ 0 };
+			bool stopping_ = false;
+		};
+	}
+
+	//=========================================================================
+	// scales fonts, rects and system metrics for the dpi of the monitor a
+	// drag is heading to before WM_DPICHANGED arrives. forward the drag
+	// messages to handle_message and call take() in the WM_DPICHANGED
+	// handler, it hands over prewarmed resources or scales them on the spot.
+	// base fonts and rects are at 96 dpi and must outlive the prewarmer,
+	// destruction waits for discarded prewarms still running
+	//=========================================================================
+	template <typename Backend = Win32PrewarmBackend>
+	class BasicDragPrewarmer
+	{
+	public:
+		BasicDragPrewarmer(std::vector<HFONT> fonts, std::vector<RECT> rects, std::vector<int> metric_indices,
+			DWORD lookahead_ms = 150, Backend backend = Backend())
+			: fonts_(std::move(fonts)), rects_(std::move(rects)), metric_indices_(std::move(metric_indices)),
+			predictor_(lookahead_ms), backend_(backend), reaper_(backend)
+		{
+			// resolved here, the lazy load is not safe to race from workers
+			detail::load_user32_symbols();
+		}
+
+		~BasicDragPrewarmer()
+		{
+			discard();
+		}
+
+		BasicDragPrewarmer(const BasicDragPrewarmer&) = delete;
+		BasicDragPrewarmer& operator=(const BasicDragPrewarmer&) = delete;
+
+		void set_monitors(std::vector<PrewarmMonitor> monitors) { predictor_.set_monitors(std::move(monitors)); }
+		void set_monitors(const Topology& topology) { predictor_.set_monitors(get_prewarm_monitors(topology)); }
+
+		void begin_drag(const RECT& rect, DWORD time_ms)
+		{
+			predictor_.begin(rect, time_ms);
+			current_dpi_ = dpi_of(predictor_.monitor_of(rect));
+		}
+
+		//==================================================================
+		// feed a WM_MOVING rect, returns true if a prewarm was started
+		//==================================================================
+		bool moving(const RECT& rect, DWORD time_ms)
+		{
+			int target = predictor_.update(rect, time_ms);
+			if (target < 0)
+				return false;
+
+			auto dpi = dpi_of(target);
+			if (dpi == current_dpi_ || find(dpi) != pending_.end())
+				return false;
+
+			++prewarms_;
+			pending_.push_back(Pending{ dpi, std::async(std::launch::async, [this, dpi] { return scale(dpi); }) });
+			return true;
+		}
+
+		//==================================================================
+		// forward window messages, time_ms is e.g. GetMessageTime()
+		//==================================================================
+		bool handle_message(HWND hwnd, UINT msg, LPARAM lparam, DWORD time_ms)
+		{
+			switch (msg)
+			{
+			case WM_ENTERSIZEMOVE:
+			{
+				RECT rect;
+				if (!GetWindowRect(hwnd, &rect))
+					return false;
+
+				begin_drag(rect, time_ms);
+				return true;
+			}
+			case WM_MOVING:
+			{
+				auto rect = reinterpret_cast<const RECT*>(lparam);
+				return rect != nullptr && moving(*rect, time_ms);
+			}
+			case WM_SETTINGCHANGE:
+			case WM_DISPLAYCHANGE:
+				discard();
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		//==================================================================
+		// resources for dpi, waits for a prewarm still running. scales on
+		// the calling thread when nothing was prewarmed for dpi
+		//==================================================================
+		PrewarmedResources take(UINT dpi)
+		{
+			current_dpi_ = dpi;
+
+			auto it = find(dpi);
+			if (it == pending_.end())
+			{
+				++misses_;
+				return scale(dpi);
+			}
+
+			++hits_;
+			auto resources = it->resources.get();
+			pending_.erase(it);
+			return resources;
+		}
+
+		//==================================================================
+		// drop prewarmed resources nobody took, e.g. after a wrong
+		// prediction. finished prewarms are freed here, running ones are
+		// left to the reaper instead of waited for
+		//==================================================================
+		void discard()
+		{
+			for (auto& pending : pending_)
+			{
+				if (pending.resources.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				{
+					reaper_.reap(std::move(pending.resources));
+					continue;
+				}
+
+				for (auto hfont : pending.resources.get().fonts)
+					backend_.delete_font(hfont);
+			}
+
+			pending_.clear();
+		}
+
+		size_t hits() const { return hits_; }
+		size_t misses() const { return misses_; }
+		size_t prewarms() const { return prewarms_; }
+		size_t reaped() const { return reaper_.reaped(); }
+
+		double hit_rate() const
+		{
+			auto total = hits_ + misses_;
+			return total == 0 ? 0.0 : static_cast<double>(hits_) / static_cast<double>(total);
+		}
+
+	private:
+		struct Pending
+		{
+			UINT dpi;
+			std::future<PrewarmedResources> resources;
+		};
+
+		typename std::vector<Pending>::iterator find(UINT dpi)
+		{
+			return std::find_if(pending_.begin(), pending_.end(), [dpi](const Pending& pending) { return pending.dpi == dpi; });
+		}
+
+		UINT dpi_of(int monitor) const
+		{
+			const auto& monitors = predictor_.monitors();
+			return monitor < 0 || static_cast<size_t>(monitor) >= monitors.size() ? 0 : monitors[monitor].dpi;
+		}
+
+		PrewarmedResources scale(UINT dpi) const
+		{
+			PrewarmedResources resources;
+			resources.dpi = dpi;
+
+			for (auto hfont : fonts_)
+				resources.fonts.push_back(backend_.scale_font(hfont, dpi));
+			for (const auto& rect : rects_)
+				resources.rects.push_back(scale_rect(rect, dpi));
+			resources.metrics = backend_.system_metrics(metric_indices_, dpi);
+
+			return resources;
+		}
+
+		std::vector<HFONT> fonts_;
+		std::vector<RECT> rects_;
+		std::vector<int> metric_indices_;
+		DragPredictor predictor_;
+		Backend backend_;
+		std::vector<Pending> pending_;
+		UINT current_dpi_ = 0;
+		size_t hits_ = 0;
+		size_t misses_ = 0;
+		size_t prewarms_ = 0;
+		// last, prewarms it still waits for read the members above
+		detail::PrewarmReaper<Backend> reaper_;
+	};
+
+	using DragPrewarmer = BasicDragPrewarmer<>;
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef WUTIL_FRAME_PACER_INCLUDED
+#define WUTIL_FRAME_PACER_INCLUDED
+
+#include "wutil.h"
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+namespace wutil
+{
+	//=========================================================================
+	// default clock for frame pacing, tests can substitute a simulated clock
+	// providing the same members
+	//=========================================================================
+	struct SteadyPacerClock
+	{
+		using duration = std::chrono::nanoseconds;
+		using time_point = std::chrono::steady_clock::time_point;
+
+		time_point now() const { return std::chrono::steady_clock::now(); }
+		void sleep_for(duration d) const { std::this_thread::sleep_for(d); }
+		void spin() const { YieldProcessor(); }
+	};
+
+	struct FramePacerStats
+	{
+		uint64_t frames = 0;
+		uint64_t missed_frames = 0;
+		uint64_t retargets = 0;
+		std::chrono::nanoseconds total_jitter{ 0 };
+		std::chrono::nanoseconds max_jitter{ 0 };
+		std::chrono::nanoseconds sleep_time{ 0 };
+		std::chrono::nanoseconds spin_time{ 0 };
+
+		std::chrono::nanoseconds mean_jitter() const
+		{
+			return frames == 0 ? std::chrono::nanoseconds(0) : total_jitter / static_cast<int64_t>(frames);
+		}
+
+		// fraction of waiting spent busy spinning rather than sleeping
+		double cpu_usage() const
+		{
+			auto waited = sleep_time + spin_time;
+			return waited.count() == 0 ? 0.0 : static_cast<double>(spin_time.count()) / static_cast<double>(waited.count());
+		}
+	};
+
+	namespace detail
+	{
+		static const int64_t Default_Frame_Interval_Ns = 16666667;
+
+		//=====================================================================
+		// vsync interval of monitor, exact when display config is available,
+		// otherwise from the integer frequency of the current mode
+		//=====================================================================
+		inline std::chrono::nanoseconds monitor_frame_interval(HMONITOR hmonitor)
+		{
+			MONITORINFOEX mi{};
+			mi.cbSize = sizeof(mi);
+			if (hmonitor == NULL || detail::display_api.get_monitor_info(hmonitor, &mi) == 0)
+				return std::chrono::nanoseconds(Default_Frame_Interval_Ns);
+
+			auto timing = get_refresh_timing(mi);
+			if (timing && timing->vsync_interval_ns > 0)
+				return std::chrono::nanoseconds(timing->vsync_interval_ns);
+
+			DEVMODE dm;
+			dm.dmSize = sizeof(dm);
+			dm.dmDriverExtra = 0;
+			// frequencies of 0 and 1 mean hardware default
+			if (detail::display_api.enum_display_settings_ex(mi.szDevice, ENUM_CURRENT_SETTINGS, &dm, 0) && dm.dmDisplayFrequency > 1)
+				return std::chrono::nanoseconds(1000000000ll / dm.dmDisplayFrequency);
+
+			return std::chrono::nanoseconds(Default_Frame_Interval_Ns);
+		}
+	}
+
+	//=========================================================================
+	// paces frames to the refresh of the monitor a window is on. wait()
+	// sleeps until slack before the deadline then spins the rest, and
+	// retargets when the window has moved to another monitor
+	//=========================================================================
+	template <typename Clock = SteadyPacerClock>
+	class BasicFramePacer
+	{
+	public:
+		using duration = typename Clock::duration;
+		using time_point = typename Clock::time_point;
+
+		// hwnd may be null to pace at a fixed interval set through set_frame_interval
+		explicit BasicFramePacer(HWND hwnd, Clock clock = Clock())
+			: hwnd_(hwnd), clock_(clock)
+		{
+			// the initial target is not a retarget
+			if (hwnd_ != NULL)
+				target(detail::display_api.monitor_from_window(hwnd_, MONITOR_DEFAULTTONEAREST));
+		}
+
+		void set_slack(duration slack) { slack_ = slack; }
+		duration slack() const { return slack_; }
+
+		// phase of the current frame is kept, new interval applies from the next deadline
+		void set_frame_interval(duration interval)
+		{
+			if (interval <= duration::zero())
+				return;
+
+			if (has_deadline_)
+				next_deadline_ = next_deadline_ - interval_ + interval;
+
+			interval_ = interval;
+		}
+
+		duration frame_interval() const { return interval_; }
+		HMONITOR monitor() const { return hmonitor_; }
+		time_point next_deadline() const { return next_deadline_; }
+
+		//==================================================================
+		// check which monitor the window is on, returns true if the
+		// pacer was retargeted. called by wait, call on WM_DISPLAYCHANGE
+		// with force set to pick up a new refresh on the same monitor
+		//==================================================================
+		bool update_monitor(bool force = false)
+		{
+			if (hwnd_ == NULL)
+				return false;
+
+			auto hmonitor = detail::display_api.monitor_from_window(hwnd_, MONITOR_DEFAULTTONEAREST);
+			if (hmonitor == hmonitor_ && !force)
+				return false;
+
+			target(hmonitor);
+			++stats_.retargets;
+			return true;
+		}
+
+		//==================================================================
+		// block until the next frame deadline, returns how late the wake
+		// up was. frames missed entirely are skipped, not caught up
+		//==================================================================
+		duration wait()
+		{
+			update_monitor();
+
+			auto now = clock_.now();
+			if (!has_deadline_)
+			{
+				next_deadline_ = now + interval_;
+				has_deadline_ = true;
+			}
+
+			auto deadline = next_deadline_;
+			if (deadline - now > slack_)
+			{
+				clock_.sleep_for(deadline - now - slack_);
+				auto woke = clock_.now();
+				stats_.sleep_time += std::chrono::duration_cast<std::chrono::nanoseconds>(woke - now);
+				now = woke;
+			}
+
+			auto spin_start = now;
+			while (now < deadline)
+			{
+				clock_.spin();
+				now = clock_.now();
+			}
+			stats_.spin_time += std::chrono::duration_cast<std::chrono::nanoseconds>(now - spin_start);
+
+			auto lateness = now - deadline;
+			auto jitter = std::chrono::duration_cast<std::chrono::nanoseconds>(lateness);
+			++stats_.frames;
+			stats_.total_jitter += jitter;
+			stats_.max_jitter = (std::max)(stats_.max_jitter, jitter);
+
+			next_deadline_ = deadline + interval_;
+			if (next_deadline_ <= now)
+			{
+				auto missed = (now - deadline) / interval_;
+				stats_.missed_frames += static_cast<uint64_t>(missed);
+				next_deadline_ = deadline + interval_ * (missed + 1);
+			}
+
+			return lateness;
+		}
+
+		const FramePacerStats& stats() const { return stats_; }
+		void reset_stats() { stats_ = FramePacerStats{}; }
+
+	private:
+		void target(HMONITOR hmonitor)
+		{
+			hmonitor_ = hmonitor;
+			set_frame_interval(std::chrono::duration_cast<duration>(detail::monitor_frame_interval(hmonitor)));
+		}
+
+		HWND hwnd_ = NULL;
+		HMONITOR hmonitor_ = NULL;
+		Clock clock_;
+		duration interval_ = std::chrono::duration_cast<duration>(std::chrono::nanoseconds(detail::Default_Frame_Interval_Ns));
+		duration slack_ = std::chrono::duration_cast<duration>(std::chrono::milliseconds(2));
+		time_point next_deadline_ = {};
+		bool has_deadline_ = false;
+		FramePacerStats stats_;
+	};
+
+	using FramePacer = BasicFramePacer<>;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef WUTIL_FULLSCREEN_INCLUDED
+#define WUTIL_FULLSCREEN_INCLUDED
+
+#include "wutil.h"
+
+#include <chrono>
+
+namespace wutil
+{
+	//=========================================================================
+	// win32 calls made by FullscreenManager, tests can substitute a backend
+	// recording the call sequence by providing the same members
+	//=========================================================================
+	struct Win32FullscreenBackend
+	{
+		bool monitor_info(HWND hwnd, MONITORINFOEX& mi) const
+		{
+			mi.cbSize = sizeof(mi);
+			return detail::display_api.get_monitor_info(detail::display_api.monitor_from_window(hwnd, MONITOR_DEFAULTTONEAREST), &mi) != 0;
+		}
+
+		std::optional<MONITORINFOEX> device_info(tstring_view device_name) const { return get_monitor_info(device_name); }
+
+		// mode the desktop is configured to use, stored in the registry
+		bool native_mode(tstring_view device_name, DEVMODE& dm) const
+		{
+			detail::DeviceNameBuffer name(device_name);
+			dm.dmSize = sizeof(dm);
+			dm.dmDriverExtra = 0;
+			return detail::display_api.enum_display_settings_ex(name.c_str(), ENUM_REGISTRY_SETTINGS, &dm, 0) != 0;
+		}
+
+		std::optional<WindowInfo> set_borderless(HWND hwnd, const MONITORINFOEX& mi) const { return set_window_fullscreen(hwnd, mi); }
+		bool restore_window(HWND hwnd, const WindowInfo& wi) const { return set_window_to(hwnd, wi); }
+		std::optional<MONITORINFOEX> change_mode(tstring_view device_name, DEVMODE& dm) const { return changes_display_settings_fullscreen(device_name, dm); }
+		bool reset_mode(tstring_view device_name) const { return reset_display_settings_fullscreen(device_name); }
+		void minimize(HWND hwnd) const { ShowWindow(hwnd, SW_MINIMIZE); }
+		void show(HWND hwnd) const { ShowWindow(hwnd, SW_RESTORE); }
+	};
+
+	struct FullscreenStats
+	{
+		uint64_t transitions = 0;
+		uint64_t mode_changes = 0;
+		uint64_t mode_resets = 0;
+		std::chrono::nanoseconds last_transition{ 0 };
+		std::chrono::nanoseconds total_transition{ 0 };
+	};
+
+	enum class FullscreenState
+	{
+		Windowed,
+		Borderless,
+		Exclusive,
+		// fullscreen but minimized after losing focus, mode left as is
+		Suspended
+	};
+
+	namespace detail
+	{
+		// frequencies of 0 and 1 mean hardware default and match anything
+		inline bool same_resolution_mode(const DEVMODE& a, const DEVMODE& b)
+		{
+			if (a.dmPelsWidth != b.dmPelsWidth || a.dmPelsHeight != b.dmPelsHeight)
+				return false;
+
+			if ((a.dmFields & DM_BITSPERPEL) && (b.dmFields & DM_BITSPERPEL) && a.dmBitsPerPel != b.dmBitsPerPel)
+				return false;
+
+			if (a.dmDisplayFrequency > 1 && b.dmDisplayFrequency > 1 && a.dmDisplayFrequency != b.dmDisplayFrequency)
+				return false;
+
+			return true;
+		}
+	}
+
+	//=========================================================================
+	// fullscreen for one window. borderless when the requested mode is the
+	// monitor's native mode, otherwise a mode change on the monitor the
+	// window is on and no other. losing focus minimizes the window without
+	// resetting the mode so switching back costs no modeset
+	//=========================================================================
+	template <typename Backend = Win32FullscreenBackend>
+	class BasicFullscreenManager
+	{
+	public:
+		explicit BasicFullscreenManager(HWND hwnd, Backend backend = Backend())
+			: hwnd_(hwnd), backend_(backend)
+		{
+		}
+
+		~BasicFullscreenManager()
+		{
+			leave();
+		}
+
+		BasicFullscreenManager(const BasicFullscreenManager&) = delete;
+		BasicFullscreenManager& operator=(const BasicFullscreenManager&) = delete;
+
+		FullscreenState state() const { return state_; }
+		bool is_fullscreen() const { return state_ != FullscreenState::Windowed; }
+		bool is_exclusive() const { return mode_changed_; }
+		const TCHAR* device_name() const { return device_name_; }
+
+		// minimize on WM_ACTIVATEAPP focus loss, on by default
+		void set_minimize_on_deactivate(bool minimize) { minimize_on_deactivate_ = minimize; }
+
+		//==================================================================
+		// go fullscreen on the window's monitor, null mode keeps the native
+		// mode. already fullscreen windows leave first
+		//==================================================================
+		bool enter(const DEVMODE* mode = nullptr)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			if (is_fullscreen())
+				leave();
+
+			MONITORINFOEX mi;
+			if (!backend_.monitor_info(hwnd_, mi))
+				return false;
+
+			bool exclusive = false;
+			if (mode != nullptr)
+			{
+				DEVMODE native;
+				exclusive = !backend_.native_mode(mi.szDevice, native) || !detail::same_resolution_mode(*mode, native);
+			}
+
+			if (exclusive)
+			{
+				DEVMODE dm = *mode;
+				auto changed_mi = backend_.change_mode(mi.szDevice, dm);
+				if (!changed_mi)
+					return false;
+
+				mi = *changed_mi;
+				++stats_.mode_changes;
+			}
+
+			auto saved = backend_.set_borderless(hwnd_, mi);
+			if (!saved)
+			{
+				if (exclusive)
+				{
+					backend_.reset_mode(mi.szDevice);
+					++stats_.mode_resets;
+				}
+				return false;
+			}
+
+			saved_window_info_ = *saved;
+			save_device_name(mi.szDevice);
+			mode_changed_ = exclusive;
+			state_ = exclusive ? FullscreenState::Exclusive : FullscreenState::Borderless;
+
+			record_transition(start);
+			return true;
+		}
+
+		//==================================================================
+		// back to the saved window, only the owning device is reset
+		//==================================================================
+		bool leave()
+		{
+			if (!is_fullscreen())
+				return true;
+
+			auto start = std::chrono::steady_clock::now();
+
+			bool res = true;
+			if (mode_changed_)
+			{
+				res = backend_.reset_mode(device_name_);
+				++stats_.mode_resets;
+			}
+
+			if (state_ == FullscreenState::Suspended)
+				backend_.show(hwnd_);
+
+			res = backend_.restore_window(hwnd_, saved_window_info_) && res;
+			mode_changed_ = false;
+			state_ = FullscreenState::Windowed;
+
+			record_transition(start);
+			return res;
+		}
+
+		//==================================================================
+		// forward window messages, returns true when the message changed
+		// state. handles WM_ACTIVATEAPP only
+		//==================================================================
+		bool handle_message(UINT msg, WPARAM wparam, LPARAM lparam)
+		{
+			(void)lparam;
+			if (msg != WM_ACTIVATEAPP)
+				return false;
+
+			if (wparam == FALSE)
+				return suspend();
+			else
+				return resume();
+		}
+
+		const FullscreenStats& stats() const { return stats_; }
+		void reset_stats() { stats_ = FullscreenStats{}; }
+
+	private:
+		bool suspend()
+		{
+			if (!minimize_on_deactivate_ || (state_ != FullscreenState::Borderless && state_ != FullscreenState::Exclusive))
+				return false;
+
+			auto start = std::chrono::steady_clock::now();
+			suspended_from_ = state_;
+			backend_.minimize(hwnd_);
+			state_ = FullscreenState::Suspended;
+
+			record_transition(start);
+			return true;
+		}
+
+		//==================================================================
+		// cover the owning monitor again, saved window info from enter is
+		// kept. if the monitor went away while suspended or the window can
+		// not cover it the window leaves fullscreen instead
+		//==================================================================
+		bool resume()
+		{
+			if (state_ != FullscreenState::Suspended)
+				return false;
+
+			auto start = std::chrono::steady_clock::now();
+			backend_.show(hwnd_);
+			state_ = suspended_from_;
+
+			auto mi = backend_.device_info(device_name_);
+			if (!mi || !backend_.set_borderless(hwnd_, *mi))
+			{
+				leave();
+				return true;
+			}
+
+			record_transition(start);
+			return true;
+		}
+
+		void save_device_name(const TCHAR* device_name)
+		{
+			size_t i = 0;
+			for (; i + 1 < CCHDEVICENAME && device_name[i] != 0; ++i)
+				device_name_[i] = device_name[i];
+			device_name_[i] = 0;
+		}
+
+		void record_transition(std::chrono::steady_clock::time_point start)
+		{
+			stats_.last_transition = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+			stats_.total_transition += stats_.last_transition;
+			++stats_.transitions;
+		}
+
+		HWND hwnd_ = NULL;
+		Backend backend_;
+		FullscreenState state_ = FullscreenState::Windowed;
+		FullscreenState suspended_from_ = FullscreenState::Windowed;
+		WindowInfo saved_window_info_;
+		TCHAR device_name_[CCHDEVICENAME] = {};
+		bool mode_changed_ = false;
+		bool minimize_on_deactivate_ = true;
+		FullscreenStats stats_;
+	};
+
+	using FullscreenManager = BasicFullscreenManager<>;
+}
+
+#endif
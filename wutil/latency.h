@@ -0,0 +1,366 @@
+#ifndef WUTIL_LATENCY_INCLUDED
+#define WUTIL_LATENCY_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wutil
+{
+	//=========================================================================
+	// lock free log-linear latency histogram, any thread may record. each
+	// power of two range is split into Sub_Buckets, so percentiles are
+	// within about 6% of the true value
+	//=========================================================================
+	class LatencyHistogram
+	{
+	public:
+		static const int Sub_Bucket_Bits = 4;
+		static const int Sub_Buckets = 1 << Sub_Bucket_Bits;
+		static const int Bucket_Count = (64 - Sub_Bucket_Bits + 1) * Sub_Buckets;
+
+		void record(std::chrono::nanoseconds latency)
+		{
+			auto ns = static_cast<uint64_t>((std::max)(latency.count(), static_cast<int64_t>(0)));
+			buckets_[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+			count_.fetch_add(1, std::memory_order_relaxed);
+
+			auto max = max_.load(std::memory_order_relaxed);
+			while (ns > max && !max_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+		std::chrono::nanoseconds max() const { return std::chrono::nanoseconds(max_.load(std::memory_order_relaxed)); }
+
+		//==================================================================
+		// upper bound of the bucket holding quantile q in [0, 1], e.g.
+		// 0.5, 0.99, 0.999. concurrent records may or may not be counted
+		//==================================================================
+		std::chrono::nanoseconds percentile(double q) const
+		{
+			auto total = count();
+			if (total == 0)
+				return std::chrono::nanoseconds(0);
+
+			auto rank = static_cast<uint64_t>(q * static_cast<double>(total) + 0.5);
+			rank = (std::min)((std::max)(rank, static_cast<uint64_t>(1)), total);
+
+			uint64_t seen = 0;
+			for (int i = 0; i < Bucket_Count; ++i)
+			{
+				seen += buckets_[i].load(std::memory_order_relaxed);
+				if (seen >= rank)
+					return std::chrono::nanoseconds((std::min)(bucket_upper_bound(i), max_.load(std::memory_order_relaxed)));
+			}
+
+			return max();
+		}
+
+		// not atomic with respect to concurrent records
+		void reset()
+		{
+			for (auto& bucket : buckets_)
+				bucket.store(0, std::memory_order_relaxed);
+			count_.store(0, std::memory_order_relaxed);
+			max_.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+		static int bucket_index(uint64_t ns)
+		{
+			if (ns < Sub_Buckets)
+				return static_cast<int>(ns);
+
+			int msb = 63;
+			while ((ns >> msb) == 0)
+				--msb;
+
+			int shift = msb - Sub_Bucket_Bits;
+			int sub = static_cast<int>((ns >> shift) & (Sub_Buckets - 1));
+			return (shift + 1) * Sub_Buckets + sub;
+		}
+
+		static uint64_t bucket_upper_bound(int index)
+		{
+			if (index < Sub_Buckets)
+				return static_cast<uint64_t>(index);
+
+			int shift = index / Sub_Buckets - 1;
+			uint64_t sub = static_cast<uint64_t>(index % Sub_Buckets) | Sub_Buckets;
+			return ((sub + 1) << shift) - 1;
+		}
+
+		std::atomic<uint64_t> buckets_[Bucket_Count] = {};
+		std::atomic<uint64_t> count_{ 0 };
+		std::atomic<uint64_t> max_{ 0 };
+	};
+
+	//=========================================================================
+	// time a scope into a histogram, e.g. around get_topology during
+	// WM_DISPLAYCHANGE to catch stalls while docking
+	//=========================================================================
+	class ScopedLatency
+	{
+	public:
+		explicit ScopedLatency(LatencyHistogram& histogram)
+			: histogram_(histogram), start_(std::chrono::steady_clock::now())
+		{
+		}
+
+		~ScopedLatency()
+		{
+			histogram_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_));
+		}
+
+		ScopedLatency(const ScopedLatency&) = delete;
+		ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+	private:
+		LatencyHistogram& histogram_;
+		std::chrono::steady_clock::time_point start_;
+	};
+
+	struct SoakThread
+	{
+		int index = 0;
+		// seeded from the run seed and the thread index, runs are repeatable up to scheduling
+		std::mt19937_64 random;
+	};
+
+	struct SoakActionReport
+	{
+		std::string name;
+		uint64_t count = 0;
+		// calls that returned false, an inconsistent state was observed
+		uint64_t failures = 0;
+		std::chrono::nanoseconds p50{ 0 };
+		std::chrono::nanoseconds p99{ 0 };
+		std::chrono::nanoseconds p999{ 0 };
+		std::chrono::nanoseconds max{ 0 };
+	};
+
+	struct SoakReport
+	{
+		std::vector<SoakActionReport> actions;
+		// the watchdog saw a thread stuck in one action past stall_timeout
+		bool stalled = false;
+		std::string stalled_action;
+
+		uint64_t failures() const
+		{
+			uint64_t failures = 0;
+			for (const auto& action : actions)
+				failures += action.failures;
+			return failures;
+		}
+
+		bool passed() const { return !stalled && failures() == 0; }
+
+		void print(FILE* out = stdout) const
+		{
+			auto us = [](std::chrono::nanoseconds ns) { return static_cast<double>(ns.count()) / 1000.0; };
+			for (const auto& action : actions)
+			{
+				std::fprintf(out, "%-32s n=%-9llu failed=%-6llu p50=%9.2fus p99=%9.2fus p99.9=%9.2fus max=%9.2fus\n", action.name.c_str(),
+					static_cast<unsigned long long>(action.count), static_cast<unsigned long long>(action.failures),
+					us(action.p50), us(action.p99), us(action.p999), us(action.max));
+			}
+
+			if (stalled)
+				std::fprintf(out, "stalled in %s\n", stalled_action.c_str());
+		}
+	};
+
+	//=========================================================================
+	// randomized soak run. every thread picks weighted actions at random
+	// until the duration ends, e.g. hot plugs, dpi and mode changes mixed
+	// with readers, each action timed into its own histogram.
+	// an action returns false when it observed an inconsistent state, a
+	// torn topology or a result that does not match what was published,
+	// which is how races surface besides running under a race detector.
+	// exclusive actions never run on two threads at once, for single
+	// writer apis. a watchdog reports a thread stuck in one action longer
+	// than stall_timeout as a deadlock and stops the run; if the stuck
+	// thread still has not returned 10 stall timeouts later the process
+	// aborts, there is no way to return past it. nothing is printed, the
+	// caller prints the report, or the one on_abort gets before aborting
+	//=========================================================================
+	class SoakHarness
+	{
+	public:
+		using Action = std::function<bool(SoakThread&)>;
+
+		struct Options
+		{
+			int threads = 4;
+			std::chrono::milliseconds duration{ 1000 };
+			std::chrono::milliseconds stall_timeout{ 5000 };
+			uint64_t seed = 1;
+			// last chance to print the stalled report before the abort
+			std::function<void(const SoakReport&)> on_abort;
+		};
+
+		void add(std::string name, unsigned weight, Action action, bool exclusive = false)
+		{
+			auto state = std::make_unique<ActionState>();
+			state->name = std::move(name);
+			state->weight = weight;
+			state->action = std::move(action);
+			state->exclusive = exclusive;
+			actions_.push_back(std::move(state));
+		}
+
+		SoakReport run(const Options& options)
+		{
+			for (auto& action : actions_)
+			{
+				action->histogram.reset();
+				action->failures.store(0);
+			}
+
+			std::vector<unsigned> weights;
+			for (const auto& action : actions_)
+				weights.push_back(action->weight);
+
+			SoakReport report;
+			if (actions_.empty())
+				return report;
+
+			auto thread_count = (std::max)(options.threads, 1);
+			std::vector<ThreadSlot> slots(static_cast<size_t>(thread_count));
+			std::atomic<bool> stop{ false };
+			std::atomic<int> running{ 0 };
+
+			std::vector<std::thread> threads;
+			for (int i = 0; i < thread_count; ++i)
+			{
+				running.fetch_add(1);
+				threads.emplace_back([&, i]()
+				{
+					SoakThread thread;
+					thread.index = i;
+					thread.random.seed(options.seed * 0x9e3779b97f4a7c15ull + static_cast<uint64_t>(i));
+					std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+					auto& slot = slots[static_cast<size_t>(i)];
+
+					while (!stop.load(std::memory_order_relaxed))
+					{
+						auto& action = *actions_[pick(thread.random)];
+						bool expected = false;
+						if (action.exclusive && !action.busy.compare_exchange_strong(expected, true))
+							continue;
+
+						slot.action.store(&action, std::memory_order_relaxed);
+						auto start = std::chrono::steady_clock::now();
+						slot.started_ns.store(since_epoch_ns(start), std::memory_order_release);
+
+						if (!action.action(thread))
+							action.failures.fetch_add(1, std::memory_order_relaxed);
+
+						auto end = std::chrono::steady_clock::now();
+						slot.started_ns.store(0, std::memory_order_release);
+						action.histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start));
+						if (action.exclusive)
+							action.busy.store(false);
+					}
+
+					running.fetch_sub(1);
+				});
+			}
+
+			auto deadline = std::chrono::steady_clock::now() + options.duration;
+			auto stall_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(options.stall_timeout).count());
+			auto poll = (std::max)(std::chrono::milliseconds(1), (std::min)(options.stall_timeout / 10, std::chrono::milliseconds(100)));
+			while (running.load() > 0)
+			{
+				auto now = std::chrono::steady_clock::now();
+				if (now >= deadline)
+					stop.store(true);
+
+				if (!report.stalled)
+				{
+					auto now_ns = since_epoch_ns(now);
+					for (const auto& slot : slots)
+					{
+						// an action may have started after now was taken
+						auto started = slot.started_ns.load(std::memory_order_acquire);
+						if (started != 0 && started <= now_ns && now_ns - started > stall_ns)
+						{
+							auto action = slot.action.load(std::memory_order_relaxed);
+							report.stalled = true;
+							report.stalled_action = action != nullptr ? action->name : std::string();
+							stop.store(true);
+							deadline = now + options.stall_timeout * 10;
+							break;
+						}
+					}
+				}
+				else if (now >= deadline)
+				{
+					if (options.on_abort)
+						options.on_abort(report);
+					std::abort();
+				}
+
+				std::this_thread::sleep_for(poll);
+			}
+
+			for (auto& thread : threads)
+				thread.join();
+
+			for (const auto& action : actions_)
+			{
+				SoakActionReport action_report;
+				action_report.name = action->name;
+				action_report.count = action->histogram.count();
+				action_report.failures = action->failures.load();
+				action_report.p50 = action->histogram.percentile(0.5);
+				action_report.p99 = action->histogram.percentile(0.99);
+				action_report.p999 = action->histogram.percentile(0.999);
+				action_report.max = action->histogram.max();
+				report.actions.push_back(std::move(action_report));
+			}
+
+			return report;
+		}
+
+	private:
+		struct ActionState
+		{
+			std::string name;
+			unsigned weight = 1;
+			Action action;
+			bool exclusive = false;
+			std::atomic<bool> busy{ false };
+			std::atomic<uint64_t> failures{ 0 };
+			LatencyHistogram histogram;
+		};
+
+		// what a thread is running and since when, 0 between actions
+		struct ThreadSlot
+		{
+			std::atomic<const ActionState*> action{ nullptr };
+			std::atomic<uint64_t> started_ns{ 0 };
+		};
+
+		static uint64_t since_epoch_ns(std::chrono::steady_clock::time_point time)
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+		}
+
+		std::vector<std::unique_ptr<ActionState>> actions_;
+	};
+}
+
+#endif
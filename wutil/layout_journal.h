@@ -0,0 +1,341 @@
+#ifndef WUTIL_LAYOUT_JOURNAL_INCLUDED
+#define WUTIL_LAYOUT_JOURNAL_INCLUDED
+
+#include "wutil.h"
+
+namespace wutil
+{
+	struct JournalMonitor
+	{
+		DisplayId id = 0;
+		RECT monitor = {};
+		RECT work = {};
+		UINT dpi = detail::Default_DPI;
+		bool primary = false;
+	};
+
+	struct JournalWindow
+	{
+		HWND hwnd = NULL;
+		WindowInfo info;
+		DisplayId monitor = 0;
+	};
+
+	// where a journaled window goes once remapped
+	struct JournalPlacement
+	{
+		HWND hwnd = NULL;
+		WindowInfo info;
+		bool use_placement = false;
+	};
+
+	//=========================================================================
+	// map a screen rect from one monitor to another. the offset from the
+	// work area origin and the size follow the dpi change, the result is
+	// then shrunk and shifted to fit inside the new work area
+	//=========================================================================
+	inline RECT remap_window_rect(const RECT& rect, const JournalMonitor& from, const JournalMonitor& to)
+	{
+		auto scale = [&](LONG value) { return static_cast<LONG>(MulDiv(value, to.dpi, from.dpi)); };
+
+		LONG work_width = to.work.right - to.work.left;
+		LONG work_height = to.work.bottom - to.work.top;
+		LONG width = (std::min)(scale(rect.right - rect.left), work_width);
+		LONG height = (std::min)(scale(rect.bottom - rect.top), work_height);
+		LONG x = std::clamp(scale(rect.left - from.work.left), static_cast<LONG>(0), work_width - width);
+		LONG y = std::clamp(scale(rect.top - from.work.top), static_cast<LONG>(0), work_height - height);
+
+		return RECT{ to.work.left + x, to.work.top + y, to.work.left + x + width, to.work.top + y + height };
+	}
+
+	namespace detail
+	{
+		// workspace coordinates are screen coordinates offset by the primary work area
+		inline POINT workspace_offset(const std::vector<JournalMonitor>& monitors)
+		{
+			for (const auto& monitor : monitors)
+			{
+				if (monitor.primary)
+					return POINT{ monitor.work.left - monitor.monitor.left, monitor.work.top - monitor.monitor.top };
+			}
+
+			return POINT{ 0, 0 };
+		}
+
+		inline RECT offset_rect(RECT rect, POINT offset)
+		{
+			return RECT{ rect.left + offset.x, rect.top + offset.y, rect.right + offset.x, rect.bottom + offset.y };
+		}
+
+		// rcNormalPosition is in workspace coordinates, for tool windows in screen coordinates
+		inline POINT normal_position_offset(const WindowInfo& info, const std::vector<JournalMonitor>& monitors)
+		{
+			return (info.ex_style & WS_EX_TOOLWINDOW) != 0 ? POINT{ 0, 0 } : workspace_offset(monitors);
+		}
+
+		inline bool is_minimized(const WindowInfo& info)
+		{
+			auto show = info.placement.showCmd;
+			return show == SW_SHOWMINIMIZED || show == SW_MINIMIZE || show == SW_SHOWMINNOACTIVE;
+		}
+
+		inline const JournalMonitor* find_journal_monitor(const std::vector<JournalMonitor>& monitors, DisplayId id)
+		{
+			for (const auto& monitor : monitors)
+			{
+				if (monitor.id == id)
+					return &monitor;
+			}
+
+			return nullptr;
+		}
+
+		// same monitor when it survived, else primary, else any
+		inline const JournalMonitor* match_journal_monitor(const std::vector<JournalMonitor>& monitors, DisplayId id)
+		{
+			if (auto monitor = find_journal_monitor(monitors, id))
+				return monitor;
+
+			for (const auto& monitor : monitors)
+			{
+				if (monitor.primary)
+					return &monitor;
+			}
+
+			return monitors.empty() ? nullptr : &monitors.front();
+		}
+
+		inline BOOL CALLBACK journal_enum_proc(HWND hwnd, LPARAM lparam)
+		{
+			auto windows = reinterpret_cast<std::vector<HWND>*>(lparam);
+			DWORD pid = 0;
+			GetWindowThreadProcessId(hwnd, &pid);
+			if (pid == GetCurrentProcessId() && IsWindowVisible(hwnd))
+				windows->push_back(hwnd);
+
+			return TRUE;
+		}
+	}
+
+	//=========================================================================
+	// remap every journaled window onto monitors, windows whose monitor is
+	// gone move to the primary monitor. maximized and minimized windows get
+	// a remapped placement, the rest a remapped window rect
+	//=========================================================================
+	inline std::vector<JournalPlacement> remap_layout(const std::vector<JournalWindow>& windows,
+		const std::vector<JournalMonitor>& from, const std::vector<JournalMonitor>& to)
+	{
+		std::vector<JournalPlacement> placements;
+		for (const auto& window : windows)
+		{
+			auto source = detail::find_journal_monitor(from, window.monitor);
+			auto target = detail::match_journal_monitor(to, window.monitor);
+			if (source == nullptr || target == nullptr)
+				continue;
+
+			JournalPlacement placement;
+			placement.hwnd = window.hwnd;
+			placement.info = window.info;
+			placement.info.rect = remap_window_rect(window.info.rect, *source, *target);
+
+			auto from_offset = detail::normal_position_offset(window.info, from);
+			auto to_offset = detail::normal_position_offset(window.info, to);
+			auto& normal = placement.info.placement.rcNormalPosition;
+			auto screen_normal = detail::offset_rect(normal, from_offset);
+			normal = detail::offset_rect(remap_window_rect(screen_normal, *source, *target), POINT{ -to_offset.x, -to_offset.y });
+
+			placement.use_placement = window.info.placement.showCmd == SW_SHOWMAXIMIZED || detail::is_minimized(window.info);
+			placements.push_back(placement);
+		}
+
+		return placements;
+	}
+
+	//=========================================================================
+	// win32 calls made by LayoutJournal, tests can substitute a backend
+	// simulating windows and monitors with the same members
+	//=========================================================================
+	struct Win32LayoutJournalBackend
+	{
+		// visible top level windows of this process in z order
+		std::vector<HWND> windows() const
+		{
+			std::vector<HWND> windows;
+			EnumWindows(detail::journal_enum_proc, reinterpret_cast<LPARAM>(&windows));
+			return windows;
+		}
+
+		std::vector<JournalMonitor> monitors() const
+		{
+			std::vector<JournalMonitor> monitors;
+			for (const auto& mi : get_all_monitor_info())
+			{
+				JournalMonitor monitor;
+				monitor.id = get_monitor_id(mi.szDevice);
+				monitor.monitor = mi.rcMonitor;
+				monitor.work = mi.rcWork;
+				monitor.dpi = get_dpi(detail::display_api.monitor_from_rect(&mi.rcMonitor, MONITOR_DEFAULTTONEAREST));
+				monitor.primary = (mi.dwFlags & MONITORINFOF_PRIMARY) != 0;
+				monitors.push_back(monitor);
+			}
+
+			return monitors;
+		}
+
+		bool capture(HWND hwnd, WindowInfo& info) const
+		{
+			info.placement.length = sizeof(info.placement);
+			info.style = GetWindowLong(hwnd, GWL_STYLE);
+			info.ex_style = GetWindowLong(hwnd, GWL_EXSTYLE);
+			return GetWindowPlacement(hwnd, &info.placement) && GetWindowRect(hwnd, &info.rect);
+		}
+
+		bool is_window(HWND hwnd) const { return IsWindow(hwnd) != FALSE; }
+
+		// false when style and ex_style were already set
+		bool set_styles(HWND hwnd, LONG style, LONG ex_style) const
+		{
+			if (GetWindowLong(hwnd, GWL_STYLE) == style && GetWindowLong(hwnd, GWL_EXSTYLE) == ex_style)
+				return false;
+
+			SetWindowLong(hwnd, GWL_STYLE, style);
+			SetWindowLong(hwnd, GWL_EXSTYLE, ex_style);
+			return true;
+		}
+
+		bool set_placement(HWND hwnd, const WINDOWPLACEMENT& placement) const { return SetWindowPlacement(hwnd, &placement) != FALSE; }
+
+		HDWP begin_defer(int count) const { return BeginDeferWindowPos(count); }
+
+		HDWP defer(HDWP hdwp, HWND hwnd, const RECT& rect, UINT flags) const
+		{
+			return DeferWindowPos(hdwp, hwnd, NULL, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top, flags);
+		}
+
+		bool end_defer(HDWP hdwp) const { return EndDeferWindowPos(hdwp) != FALSE; }
+	};
+
+	//=========================================================================
+	// snapshot of all top level windows of this process and the monitors
+	// they were on, taken before a mode change and restored after it in one
+	// DeferWindowPos batch so windows move together instead of one by one
+	//=========================================================================
+	template <typename Backend = Win32LayoutJournalBackend>
+	class BasicLayoutJournal
+	{
+	public:
+		explicit BasicLayoutJournal(Backend backend = Backend()) : backend_(backend) {}
+
+		//==================================================================
+		// journal the current layout, returns the number of windows
+		//==================================================================
+		size_t capture()
+		{
+			windows_.clear();
+			monitors_ = backend_.monitors();
+
+			for (auto hwnd : backend_.windows())
+			{
+				JournalWindow window;
+				window.hwnd = hwnd;
+				if (!backend_.capture(hwnd, window.info))
+					continue;
+
+				// minimized windows sit at -32000, the restored position tells their monitor
+				auto rect = window.info.rect;
+				if (detail::is_minimized(window.info))
+					rect = detail::offset_rect(window.info.placement.rcNormalPosition, detail::normal_position_offset(window.info, monitors_));
+
+				window.monitor = monitor_id(rect);
+				windows_.push_back(window);
+			}
+
+			return windows_.size();
+		}
+
+		//==================================================================
+		// remap onto the current monitors and restore, returns false if
+		// the batch failed. windows destroyed since capture are skipped
+		//==================================================================
+		bool restore()
+		{
+			return restore(backend_.monitors());
+		}
+
+		bool restore(const std::vector<JournalMonitor>& monitors)
+		{
+			auto placements = remap_layout(windows_, monitors_, monitors);
+			placements.erase(std::remove_if(placements.begin(), placements.end(),
+				[this](const JournalPlacement& placement) { return !backend_.is_window(placement.hwnd); }), placements.end());
+
+			// styles are not deferrable, set them first so the batch applies the new frames
+			std::vector<bool> frame_changed(placements.size());
+			for (size_t i = 0; i < placements.size(); ++i)
+				frame_changed[i] = backend_.set_styles(placements[i].hwnd, placements[i].info.style, placements[i].info.ex_style);
+
+			bool ok = true;
+			int deferred = 0;
+			for (const auto& placement : placements)
+			{
+				if (placement.use_placement)
+					ok = backend_.set_placement(placement.hwnd, placement.info.placement) && ok;
+				else
+					++deferred;
+			}
+
+			if (deferred == 0)
+				return ok;
+
+			HDWP hdwp = backend_.begin_defer(deferred);
+			for (size_t i = 0; i < placements.size() && hdwp != NULL; ++i)
+			{
+				if (placements[i].use_placement)
+					continue;
+
+				UINT flags = SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE | (frame_changed[i] ? SWP_FRAMECHANGED : 0);
+				hdwp = backend_.defer(hdwp, placements[i].hwnd, placements[i].info.rect, flags);
+			}
+
+			// a failed DeferWindowPos discards the whole batch
+			return hdwp != NULL && backend_.end_defer(hdwp) && ok;
+		}
+
+		void clear()
+		{
+			windows_.clear();
+			monitors_.clear();
+		}
+
+		const std::vector<JournalWindow>& windows() const { return windows_; }
+		const std::vector<JournalMonitor>& monitors() const { return monitors_; }
+
+	private:
+		// monitor holding most of rect, as MonitorFromRect would pick
+		DisplayId monitor_id(const RECT& rect) const
+		{
+			DisplayId best = 0;
+			int64_t best_area = -1;
+			for (const auto& monitor : monitors_)
+			{
+				RECT overlap;
+				int64_t area = IntersectRect(&overlap, &rect, &monitor.monitor) ?
+					static_cast<int64_t>(overlap.right - overlap.left) * (overlap.bottom - overlap.top) : 0;
+				if (area > best_area || (area == best_area && monitor.primary))
+				{
+					best = monitor.id;
+					best_area = area;
+				}
+			}
+
+			return best;
+		}
+
+		Backend backend_;
+		std::vector<JournalWindow> windows_;
+		std::vector<JournalMonitor> monitors_;
+	};
+
+	using LayoutJournal = BasicLayoutJournal<>;
+}
+
+#endif
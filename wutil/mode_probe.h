@@ -0,0 +1,417 @@
+#ifndef WUTIL_MODE_PROBE_INCLUDED
+#define WUTIL_MODE_PROBE_INCLUDED
+
+#include "wutil.h"
+#include "display_tree.h"
+#include "topology_snapshot.h"
+
+#include <atomic>
+#include <cstring>
+#include <cwctype>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace wutil
+{
+	namespace detail
+	{
+		static const uint32_t Mode_Probe_Magic = 0x504d5557; // "WUMP"
+		// 2 mixes the driver version and date and the edid ids into fingerprints
+		static const uint32_t Mode_Probe_Version = 2;
+
+		struct ModeProbeHeader
+		{
+			uint32_t magic = Mode_Probe_Magic;
+			uint32_t version = Mode_Probe_Version;
+			uint64_t record_count = 0;
+			uint64_t payload_hash = 0;
+		};
+
+		struct ModeProbeRecord
+		{
+			uint64_t fingerprint = 0;
+			uint64_t mode = 0;
+			int32_t result = 0;
+			uint32_t reserved = 0;
+		};
+
+		// fields ChangeDisplaySettingsEx validates, position and orientation excluded
+		inline uint64_t mode_probe_key(const DEVMODE& dm)
+		{
+			uint32_t fields[] = { dm.dmPelsWidth, dm.dmPelsHeight, dm.dmBitsPerPel, dm.dmDisplayFrequency, dm.dmDisplayFlags };
+			return fnv1a(fields, sizeof(fields));
+		}
+
+		// HKEY_LOCAL_MACHINE relative path of a kernel key such as DISPLAY_DEVICE::DeviceKey, empty if it is not one
+		inline tstring_view machine_subkey(tstring_view key)
+		{
+			tstring_view prefix = TEXT("\\Registry\\Machine\\");
+			if (key.size() <= prefix.size())
+				return {};
+
+			for (size_t i = 0; i < prefix.size(); ++i)
+			{
+				if (std::towlower(static_cast<WCHAR>(static_cast<std::make_unsigned_t<TCHAR>>(key[i]))) != std::towlower(static_cast<WCHAR>(prefix[i])))
+					return {};
+			}
+
+			return key.substr(prefix.size());
+		}
+
+		// string value under HKEY_LOCAL_MACHINE, empty when missing
+		inline tstring read_machine_string(tstring_view subkey, const TCHAR* value)
+		{
+			tstring path(subkey);
+			DWORD size = 0;
+			if (path.empty() || display_api.reg_get_value(HKEY_LOCAL_MACHINE, path.c_str(), value, RRF_RT_REG_SZ, NULL, NULL, &size) != ERROR_SUCCESS || size == 0)
+				return {};
+
+			tstring text(size / sizeof(TCHAR), 0);
+			if (display_api.reg_get_value(HKEY_LOCAL_MACHINE, path.c_str(), value, RRF_RT_REG_SZ, NULL, text.data(), &size) != ERROR_SUCCESS)
+				return {};
+
+			text.resize(std::find(text.begin(), text.end(), 0) - text.begin());
+			return text;
+		}
+
+		// strings hashed with their length so adjacent values can not run into each other
+		inline uint64_t fnv1a_string(const tstring& text, uint64_t hash)
+		{
+			uint64_t size = text.size();
+			hash = fnv1a(&size, sizeof(size), hash);
+			return fnv1a(text.data(), text.size() * sizeof(TCHAR), hash);
+		}
+	}
+
+	//=========================================================================
+	// identity of the adapter and monitor pair a mode list belongs to. the
+	// ids cover which adapter and monitor, the DriverVersion and DriverDate
+	// of the adapter's video key change with a driver update, the edid
+	// manufacturer and product code with a different panel on the same
+	// connector. targets come from detail::get_display_targets, monitors
+	// off an active path go without edid ids
+	//=========================================================================
+	inline uint64_t get_mode_probe_fingerprint(const DisplayTree& tree, tstring_view device_name, const std::vector<detail::DisplayTarget>& targets)
+	{
+		auto adapter = tree.find_adapter(device_name);
+		auto monitor = tree.find_monitor(device_name);
+		DisplayId ids[] = { adapter ? adapter->id : detail::make_display_id(device_name), monitor ? monitor->id : 0 };
+		auto hash = detail::fnv1a(ids, sizeof(ids));
+
+		tstring_view video_key = adapter ? detail::machine_subkey(adapter->device.DeviceKey) : tstring_view();
+		hash = detail::fnv1a_string(detail::read_machine_string(video_key, TEXT("DriverVersion")), hash);
+		hash = detail::fnv1a_string(detail::read_machine_string(video_key, TEXT("DriverDate")), hash);
+
+		uint32_t edid[] = { 0, 0 };
+		for (const auto& target : targets)
+		{
+			if (monitor && target.edid_ids_valid && detail::equal_display_path(target.device_path, monitor->device.DeviceID))
+			{
+				edid[0] = target.edid_manufacture_id;
+				edid[1] = target.edid_product_code_id;
+				break;
+			}
+		}
+
+		return detail::fnv1a(edid, sizeof(edid), hash);
+	}
+
+	inline uint64_t get_mode_probe_fingerprint(const DisplayTree& tree, tstring_view device_name)
+	{
+		return get_mode_probe_fingerprint(tree, device_name, detail::get_display_targets());
+	}
+
+	inline uint64_t get_mode_probe_fingerprint(tstring_view device_name)
+	{
+		return get_mode_probe_fingerprint(get_display_tree(), device_name);
+	}
+
+	//=========================================================================
+	// CDS_TEST results per fingerprint and mode, safe to share between the
+	// prober threads and consumers
+	//=========================================================================
+	class ModeProbeCache
+	{
+	public:
+		// empty if mode was never tested on this hardware
+		std::optional<bool> known_good(uint64_t fingerprint, const DEVMODE& dm) const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto it = results_.find(key(fingerprint, detail::mode_probe_key(dm)));
+			if (it == results_.end())
+				return {};
+
+			return it->second.result == DISP_CHANGE_SUCCESSFUL;
+		}
+
+		bool tested(uint64_t fingerprint, const DEVMODE& dm) const
+		{
+			return known_good(fingerprint, dm).has_value();
+		}
+
+		void record(uint64_t fingerprint, const DEVMODE& dm, LONG result)
+		{
+			detail::ModeProbeRecord record;
+			record.fingerprint = fingerprint;
+			record.mode = detail::mode_probe_key(dm);
+			record.result = result;
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			results_[key(record.fingerprint, record.mode)] = record;
+		}
+
+		//==================================================================
+		// modes that passed CDS_TEST, in their original order. untested
+		// modes are kept when keep_untested is set
+		//==================================================================
+		std::vector<DEVMODE> filter_known_good(uint64_t fingerprint, const std::vector<DEVMODE>& modes, bool keep_untested = false) const
+		{
+			std::vector<DEVMODE> good;
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (const auto& dm : modes)
+			{
+				auto it = results_.find(key(fingerprint, detail::mode_probe_key(dm)));
+				if (it == results_.end() ? keep_untested : it->second.result == DISP_CHANGE_SUCCESSFUL)
+					good.push_back(dm);
+			}
+
+			return good;
+		}
+
+		size_t size() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return results_.size();
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			results_.clear();
+		}
+
+		// write through a temporary file so a crash never leaves a torn cache
+		bool save(const tstring& path) const
+		{
+			std::vector<unsigned char> payload;
+			detail::ModeProbeHeader header;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (const auto& entry : results_)
+					detail::append_bytes(payload, &entry.second, 1);
+				header.record_count = results_.size();
+			}
+			header.payload_hash = detail::fnv1a(payload.data(), payload.size());
+
+			auto temp_path = path + TEXT(".tmp");
+			HANDLE file = CreateFile(temp_path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			DWORD written = 0;
+			bool ok = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header);
+			ok = ok && WriteFile(file, payload.data(), static_cast<DWORD>(payload.size()), &written, NULL) && written == payload.size();
+			CloseHandle(file);
+
+			if (ok && MoveFileEx(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+				return true;
+
+			DeleteFile(temp_path.c_str());
+			return false;
+		}
+
+		// merge results from path, false if missing or corrupt
+		bool load(const tstring& path)
+		{
+			detail::MappedFile file(path);
+			detail::ModeProbeHeader header;
+			if (file.data() == nullptr || file.size() < sizeof(header))
+				return false;
+
+			std::memcpy(&header, file.data(), sizeof(header));
+			auto payload = file.data() + sizeof(header);
+			auto payload_size = file.size() - sizeof(header);
+			if (header.magic != detail::Mode_Probe_Magic || header.version != detail::Mode_Probe_Version ||
+				payload_size != header.record_count * sizeof(detail::ModeProbeRecord) ||
+				detail::fnv1a(payload, payload_size) != header.payload_hash)
+				return false;
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (uint64_t i = 0; i < header.record_count; ++i)
+			{
+				detail::ModeProbeRecord record;
+				std::memcpy(&record, payload + i * sizeof(record), sizeof(record));
+				results_[key(record.fingerprint, record.mode)] = record;
+			}
+
+			return true;
+		}
+
+	private:
+		static uint64_t key(uint64_t fingerprint, uint64_t mode)
+		{
+			return detail::fnv1a(&mode, sizeof(mode), fingerprint);
+		}
+
+		mutable std::mutex mutex_;
+		std::unordered_map<uint64_t, detail::ModeProbeRecord> results_;
+	};
+
+	//=========================================================================
+	// win32 calls made by ModeProber, tests can substitute a backend that
+	// rejects modes or adds latency
+	//=========================================================================
+	struct Win32ModeProbeBackend
+	{
+		LONG test_mode(tstring_view device_name, DEVMODE& dm) const
+		{
+			detail::DeviceNameBuffer name(device_name);
+			return detail::display_api.change_display_settings_ex(name.c_str(), &dm, NULL, CDS_TEST, NULL);
+		}
+	};
+
+	struct ModeProbeTarget
+	{
+		tstring device_name;
+		uint64_t fingerprint = 0;
+		std::vector<DEVMODE> modes;
+	};
+
+	//=========================================================================
+	// every monitor with its fingerprint and enumerated modes
+	//=========================================================================
+	inline std::vector<ModeProbeTarget> get_mode_probe_targets()
+	{
+		auto tree = get_display_tree();
+		auto display_targets = detail::get_display_targets();
+
+		std::vector<ModeProbeTarget> targets;
+		for (const auto& mi : get_all_monitor_info())
+		{
+			ModeProbeTarget target;
+			target.device_name = mi.szDevice;
+			target.fingerprint = get_mode_probe_fingerprint(tree, mi.szDevice, display_targets);
+			target.modes = get_monitor_display_settings(mi.szDevice);
+			targets.push_back(std::move(target));
+		}
+
+		return targets;
+	}
+
+	//=========================================================================
+	// CDS_TEST every mode not already in the cache on background threads,
+	// at most max_concurrency tests run at once. modes of all monitors are
+	// interleaved so every monitor's results fill in together
+	//=========================================================================
+	template <typename Backend = Win32ModeProbeBackend>
+	class BasicModeProber
+	{
+	public:
+		explicit BasicModeProber(ModeProbeCache& cache, unsigned max_concurrency = 2, Backend backend = Backend())
+			: cache_(cache), max_concurrency_((std::max)(max_concurrency, 1u)), backend_(backend)
+		{
+		}
+
+		~BasicModeProber()
+		{
+			cancel();
+			wait();
+		}
+
+		BasicModeProber(const BasicModeProber&) = delete;
+		BasicModeProber& operator=(const BasicModeProber&) = delete;
+
+		//==================================================================
+		// queue untested modes of targets and start probing, returns how
+		// many modes were queued. waits for any earlier run first
+		//==================================================================
+		size_t start(std::vector<ModeProbeTarget> targets)
+		{
+			wait();
+
+			targets_ = std::move(targets);
+			jobs_.clear();
+			next_.store(0);
+			probed_.store(0);
+			cancelled_.store(false);
+
+			size_t longest = 0;
+			for (const auto& target : targets_)
+				longest = (std::max)(longest, target.modes.size());
+
+			for (size_t m = 0; m < longest; ++m)
+			{
+				for (size_t t = 0; t < targets_.size(); ++t)
+				{
+					if (m < targets_[t].modes.size() && !cache_.tested(targets_[t].fingerprint, targets_[t].modes[m]))
+						jobs_.push_back(Job{ t, m });
+				}
+			}
+
+			auto threads = (std::min)(static_cast<size_t>(max_concurrency_), jobs_.size());
+			for (size_t i = 0; i < threads; ++i)
+				workers_.emplace_back(&BasicModeProber::run, this);
+
+			return jobs_.size();
+		}
+
+		size_t start()
+		{
+			return start(get_mode_probe_targets());
+		}
+
+		void wait()
+		{
+			for (auto& worker : workers_)
+				worker.join();
+			workers_.clear();
+		}
+
+		// tests already running finish, the rest are skipped
+		void cancel() { cancelled_.store(true); }
+
+		bool done() const { return probed_.load() >= jobs_.size() || cancelled_.load(); }
+		size_t probed() const { return probed_.load(); }
+		size_t total() const { return jobs_.size(); }
+
+	private:
+		struct Job
+		{
+			size_t target;
+			size_t mode;
+		};
+
+		void run()
+		{
+			while (!cancelled_.load())
+			{
+				auto i = next_.fetch_add(1);
+				if (i >= jobs_.size())
+					return;
+
+				const auto& target = targets_[jobs_[i].target];
+				const auto& dm = target.modes[jobs_[i].mode];
+
+				DEVMODE test_dm = dm;
+				auto result = backend_.test_mode(target.device_name, test_dm);
+				cache_.record(target.fingerprint, dm, result);
+				probed_.fetch_add(1);
+			}
+		}
+
+		ModeProbeCache& cache_;
+		unsigned max_concurrency_;
+		Backend backend_;
+		std::vector<ModeProbeTarget> targets_;
+		std::vector<Job> jobs_;
+		std::vector<std::thread> workers_;
+		std::atomic<size_t> next_{ 0 };
+		std::atomic<size_t> probed_{ 0 };
+		std::atomic<bool> cancelled_{ false };
+	};
+
+	using ModeProber = BasicModeProber<>;
+}
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef WUTIL_MODE_SELECT_INCLUDED
+#define WUTIL_MODE_SELECT_INCLUDED
+
+#include "wutil.h"
+
+#include <cmath>
+#include <numeric>
+
+namespace wutil
+{
+	// frames per second as numerator / denominator, e.g. 24000 / 1001
+	struct ContentRate
+	{
+		uint32_t numerator = 60;
+		uint32_t denominator = 1;
+
+		double fps() const { return static_cast<double>(numerator) / denominator; }
+	};
+
+	//=========================================================================
+	// content rate from fps, ntsc rates such as 23.976 and 59.94 become
+	// their exact n * 1000 / 1001 form
+	//=========================================================================
+	inline ContentRate make_content_rate(double fps)
+	{
+		if (fps <= 0.0)
+			return ContentRate{};
+
+		auto ntsc = std::lround(fps * 1001.0 / 1000.0);
+		if (ntsc > 0 && std::abs(fps - ntsc * 1000.0 / 1001.0) < 0.005 && std::abs(fps - static_cast<double>(ntsc)) > 0.005)
+			return ContentRate{ static_cast<uint32_t>(ntsc * 1000), 1001 };
+
+		auto millis = std::lround(fps * 1000.0);
+		auto divisor = std::gcd(millis, 1000l);
+		return ContentRate{ static_cast<uint32_t>(millis / divisor), static_cast<uint32_t>(1000 / divisor) };
+	}
+
+	struct ModeRequirements
+	{
+		DWORD min_width = 0;
+		DWORD min_height = 0;
+		// 0 for no limit
+		DWORD max_width = 0;
+		DWORD max_height = 0;
+		DWORD min_bits_per_pel = 0;
+		bool allow_interlaced = false;
+	};
+
+	struct ModeChoice
+	{
+		DEVMODE mode = {};
+		DISPLAYCONFIG_RATIONAL refresh = {};
+		// refreshes per content frame when a multiple within Cadence_Tolerance, 0 otherwise
+		uint32_t multiple = 0;
+		// mean difference between a frame's time on screen and its ideal duration, for a
+		// multiple the drift of the k refreshes against the frame period
+		int64_t judder_ns = 0;
+		// index into the mode list the choice was made from
+		size_t index = 0;
+	};
+
+	namespace detail
+	{
+		// k refreshes may differ from the frame period by this fraction and still count as a multiple
+		constexpr double Cadence_Tolerance = 0.001;
+
+		//=====================================================================
+		// exact refresh of a mode, windows reports the ntsc refreshes 23.976,
+		// 29.97, 47.952, 59.94 and 119.88 truncated, those become
+		// n * 1000 / 1001. 71, 95, 143 and 239 hz are real panel rates and
+		// are kept as they are
+		//=====================================================================
+		inline DISPLAYCONFIG_RATIONAL mode_refresh(const DEVMODE& dm)
+		{
+			auto hz = dm.dmDisplayFrequency;
+			if (hz <= 1)
+				return DISPLAYCONFIG_RATIONAL{ 0, 1 };
+
+			switch (hz)
+			{
+			case 23:
+			case 29:
+			case 47:
+			case 59:
+			case 119:
+				return DISPLAYCONFIG_RATIONAL{ static_cast<UINT32>((hz + 1) * 1000), 1001 };
+			}
+
+			return DISPLAYCONFIG_RATIONAL{ static_cast<UINT32>(hz), 1 };
+		}
+
+		//=====================================================================
+		// refreshes per content frame if k refreshes last the frame period
+		// within Cadence_Tolerance, 0 otherwise. measured refreshes such as
+		// 59940 / 1000 or 143998 / 1000 are never an exact ratio of the
+		// content rate but play without visible judder
+		//=====================================================================
+		inline uint32_t cadence_multiple(DISPLAYCONFIG_RATIONAL refresh, const ContentRate& rate)
+		{
+			double hz = static_cast<double>(refresh.Numerator) / refresh.Denominator;
+			auto k = std::llround(hz / rate.fps());
+			if (k < 1 || k > UINT32_MAX)
+				return 0;
+
+			if (std::abs(static_cast<double>(k) * rate.fps() / hz - 1.0) >= Cadence_Tolerance)
+				return 0;
+
+			return static_cast<uint32_t>(k);
+		}
+
+		// difference between k refreshes and the frame period in ns
+		inline int64_t cadence_drift_ns(DISPLAYCONFIG_RATIONAL refresh, const ContentRate& rate, uint32_t multiple)
+		{
+			double hz = static_cast<double>(refresh.Numerator) / refresh.Denominator;
+			return std::llround(std::abs(multiple / hz - 1.0 / rate.fps()) * 1e9);
+		}
+
+		// frames hold k or k + 1 refreshes, mean error of the cadence in ns
+		inline int64_t cadence_judder_ns(DISPLAYCONFIG_RATIONAL refresh, const ContentRate& rate)
+		{
+			double hz = static_cast<double>(refresh.Numerator) / refresh.Denominator;
+			double ratio = hz / rate.fps();
+			double fraction = ratio - std::floor(ratio);
+			return std::llround(2.0 * fraction * (1.0 - fraction) / hz * 1e9);
+		}
+
+		inline bool meets_requirements(const DEVMODE& dm, const ModeRequirements& req)
+		{
+			if (dm.dmPelsWidth < req.min_width || dm.dmPelsHeight < req.min_height)
+				return false;
+			if (req.max_width != 0 && dm.dmPelsWidth > req.max_width)
+				return false;
+			if (req.max_height != 0 && dm.dmPelsHeight > req.max_height)
+				return false;
+			if (dm.dmBitsPerPel < req.min_bits_per_pel)
+				return false;
+			if (!req.allow_interlaced && (dm.dmDisplayFlags & DM_INTERLACED))
+				return false;
+
+			return true;
+		}
+
+		// true if a should be picked over b
+		inline bool better_choice(const ModeChoice& a, const ModeChoice& b)
+		{
+			bool a_exact = a.multiple != 0;
+			bool b_exact = b.multiple != 0;
+			if (a_exact != b_exact)
+				return a_exact;
+			if (a.judder_ns != b.judder_ns)
+				return a.judder_ns < b.judder_ns;
+
+			auto a_area = static_cast<uint64_t>(a.mode.dmPelsWidth) * a.mode.dmPelsHeight;
+			auto b_area = static_cast<uint64_t>(b.mode.dmPelsWidth) * b.mode.dmPelsHeight;
+			if (a_area != b_area)
+				return a_area > b_area;
+			if (a.mode.dmBitsPerPel != b.mode.dmBitsPerPel)
+				return a.mode.dmBitsPerPel > b.mode.dmBitsPerPel;
+
+			// higher refresh repeats each frame more often and flickers less
+			return static_cast<uint64_t>(a.refresh.Numerator) * b.refresh.Denominator >
+				static_cast<uint64_t>(b.refresh.Numerator) * a.refresh.Denominator;
+		}
+	}
+
+	//=========================================================================
+	// best mode in modes for content at rate. refreshes that are an integer
+	// multiple of the rate within Cadence_Tolerance come first, then least
+	// judder, then resolution and bit depth. current_refresh, when known, is
+	// the exact refresh of modes[0], e.g. from get_refresh_timing
+	//=========================================================================
+	inline std::optional<ModeChoice> select_mode_for_content(const std::vector<DEVMODE>& modes, const ContentRate& rate,
+		const ModeRequirements& requirements = {}, std::optional<DISPLAYCONFIG_RATIONAL> current_refresh = {})
+	{
+		if (rate.numerator == 0 || rate.denominator == 0)
+			return {};
+
+		std::optional<ModeChoice> best;
+		for (size_t i = 0; i < modes.size(); ++i)
+		{
+			const auto& dm = modes[i];
+			if (!detail::meets_requirements(dm, requirements))
+				continue;
+
+			ModeChoice choice;
+			choice.mode = dm;
+			choice.index = i;
+			choice.refresh = detail::mode_refresh(dm);
+			if (i == 0 && current_refresh && current_refresh->Numerator != 0 && current_refresh->Denominator != 0)
+				choice.refresh = *current_refresh;
+
+			if (choice.refresh.Numerator == 0)
+				continue;
+
+			choice.multiple = detail::cadence_multiple(choice.refresh, rate);
+			if (choice.multiple != 0)
+				choice.judder_ns = detail::cadence_drift_ns(choice.refresh, rate, choice.multiple);
+			else
+				choice.judder_ns = detail::cadence_judder_ns(choice.refresh, rate);
+
+			if (!best || detail::better_choice(choice, *best))
+				best = choice;
+		}
+
+		return best;
+	}
+
+	//=========================================================================
+	// best mode of monitor for content at rate, exact timing of the current
+	// mode is used when display config is available
+	//=========================================================================
+	inline std::optional<ModeChoice> select_mode_for_content(tstring_view device_name, const ContentRate& rate, const ModeRequirements& requirements = {})
+	{
+		auto modes = get_monitor_display_settings(device_name);
+
+		std::optional<DISPLAYCONFIG_RATIONAL> current_refresh;
+		auto mi = get_monitor_info(device_name);
+		if (mi)
+		{
+			auto timing = get_refresh_timing(*mi);
+			if (timing)
+				current_refresh = timing->vsync_frequency;
+		}
+
+		return select_mode_for_content(modes, rate, requirements, current_refresh);
+	}
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef WUTIL_NC_HITTEST_INCLUDED
+#define WUTIL_NC_HITTEST_INCLUDED
+
+#include "wutil.h"
+
+namespace wutil
+{
+	//=========================================================================
+	// custom frame geometry at one dpi, caption and buttons sit directly
+	// below the top resize border with buttons right aligned inside the
+	// right resize border, close first
+	//=========================================================================
+	struct FrameGeometry
+	{
+		UINT dpi = detail::Default_DPI;
+		int border_x = 0;
+		int border_y = 0;
+		int caption_height = 0;
+		int button_width = 0;
+		int button_height = 0;
+	};
+
+	namespace detail
+	{
+		static const int Frame_Button_Count = 3;
+	}
+
+	inline FrameGeometry make_frame_geometry(SystemMetricsCache& metrics, UINT dpi)
+	{
+		FrameGeometry geometry;
+		geometry.dpi = dpi;
+
+		auto padding = metrics.system_metric(SM_CXPADDEDBORDER, dpi);
+		geometry.border_x = metrics.system_metric(SM_CXFRAME, dpi) + padding;
+		geometry.border_y = metrics.system_metric(SM_CYFRAME, dpi) + padding;
+		geometry.caption_height = metrics.system_metric(SM_CYCAPTION, dpi);
+		geometry.button_width = metrics.system_metric(SM_CXSIZE, dpi);
+		geometry.button_height = (std::min)(metrics.system_metric(SM_CYSIZE, dpi), geometry.caption_height);
+
+		return geometry;
+	}
+
+	//=========================================================================
+	// hit test a point relative to the window's top left corner. maximized
+	// windows have no resize borders, their border strips are client area
+	//=========================================================================
+	inline LRESULT nc_hit_test(const FrameGeometry& geometry, POINT pt, SIZE window, bool maximized)
+	{
+		if (pt.x < 0 || pt.y < 0 || pt.x >= window.cx || pt.y >= window.cy)
+			return HTNOWHERE;
+
+		if (!maximized)
+		{
+			static const LRESULT borders[3][3] = {
+				{ HTTOPLEFT, HTTOP, HTTOPRIGHT },
+				{ HTLEFT, HTCLIENT, HTRIGHT },
+				{ HTBOTTOMLEFT, HTBOTTOM, HTBOTTOMRIGHT }
+			};
+
+			int row = pt.y < geometry.border_y ? 0 : (pt.y >= window.cy - geometry.border_y ? 2 : 1);
+			int column = pt.x < geometry.border_x ? 0 : (pt.x >= window.cx - geometry.border_x ? 2 : 1);
+			if (row != 1 || column != 1)
+				return borders[row][column];
+		}
+
+		int caption_y = pt.y - geometry.border_y;
+		if (caption_y < 0 || caption_y >= geometry.caption_height)
+			return HTCLIENT;
+
+		int from_right = window.cx - geometry.border_x - pt.x;
+		if (caption_y < geometry.button_height && from_right > 0)
+		{
+			if (from_right <= geometry.button_width)
+				return HTCLOSE;
+			if (from_right <= geometry.button_width * 2)
+				return HTMAXBUTTON;
+			if (from_right <= geometry.button_width * detail::Frame_Button_Count)
+				return HTMINBUTTON;
+		}
+
+		return HTCAPTION;
+	}
+
+	//=========================================================================
+	// reference hit test, rebuilds every region as a rect from the system
+	// metrics and tests them in priority order. slow, for checking
+	// nc_hit_test and for frames that are not on the hot path
+	//=========================================================================
+	inline LRESULT nc_hit_test_reference(SystemMetricsCache& metrics, UINT dpi, POINT pt, SIZE window, bool maximized)
+	{
+		RECT window_rect = { 0, 0, window.cx, window.cy };
+		if (!PtInRect(&window_rect, pt))
+			return HTNOWHERE;
+
+		auto padding = metrics.system_metric(SM_CXPADDEDBORDER, dpi);
+		int bx = metrics.system_metric(SM_CXFRAME, dpi) + padding;
+		int by = metrics.system_metric(SM_CYFRAME, dpi) + padding;
+		int caption = metrics.system_metric(SM_CYCAPTION, dpi);
+		int button_w = metrics.system_metric(SM_CXSIZE, dpi);
+		int button_h = (std::min)(metrics.system_metric(SM_CYSIZE, dpi), caption);
+
+		struct Region
+		{
+			RECT rect;
+			LRESULT code;
+		};
+
+		std::vector<Region> regions;
+		if (!maximized)
+		{
+			regions.push_back({ { 0, 0, bx, by }, HTTOPLEFT });
+			regions.push_back({ { window.cx - bx, 0, window.cx, by }, HTTOPRIGHT });
+			regions.push_back({ { 0, window.cy - by, bx, window.cy }, HTBOTTOMLEFT });
+			regions.push_back({ { window.cx - bx, window.cy - by, window.cx, window.cy }, HTBOTTOMRIGHT });
+			regions.push_back({ { 0, 0, window.cx, by }, HTTOP });
+			regions.push_back({ { 0, window.cy - by, window.cx, window.cy }, HTBOTTOM });
+			regions.push_back({ { 0, 0, bx, window.cy }, HTLEFT });
+			regions.push_back({ { window.cx - bx, 0, window.cx, window.cy }, HTRIGHT });
+		}
+
+		LONG right = window.cx - bx;
+		LRESULT buttons[detail::Frame_Button_Count] = { HTCLOSE, HTMAXBUTTON, HTMINBUTTON };
+		for (int i = 0; i < detail::Frame_Button_Count; ++i)
+		{
+			RECT button = { right - button_w * (i + 1), by, right - button_w * i, by + button_h };
+			regions.push_back({ button, buttons[i] });
+		}
+
+		regions.push_back({ { 0, by, window.cx, by + caption }, HTCAPTION });
+
+		for (const auto& region : regions)
+		{
+			if (PtInRect(&region.rect, pt))
+				return region.code;
+		}
+
+		return HTCLIENT;
+	}
+
+	//=========================================================================
+	// WM_NCHITTEST for custom frames, geometry is computed once per dpi
+	// from the metrics cache and dropped with it on WM_SETTINGCHANGE
+	//=========================================================================
+	class NcHitTester
+	{
+	public:
+		explicit NcHitTester(SystemMetricsCache& metrics)
+			: metrics_(metrics)
+		{
+		}
+
+		// reference stays valid until the next new dpi or invalidation
+		const FrameGeometry& geometry(UINT dpi)
+		{
+			for (const auto& geometry : geometries_)
+			{
+				if (geometry.dpi == dpi)
+					return geometry;
+			}
+
+			geometries_.push_back(make_frame_geometry(metrics_, dpi));
+			return geometries_.back();
+		}
+
+		LRESULT hit_test(UINT dpi, POINT pt, SIZE window, bool maximized)
+		{
+			return nc_hit_test(geometry(dpi), pt, window, maximized);
+		}
+
+		// lparam is the screen point of WM_NCHITTEST
+		LRESULT hit_test(HWND hwnd, LPARAM lparam)
+		{
+			RECT rect;
+			if (!GetWindowRect(hwnd, &rect))
+				return HTNOWHERE;
+
+			POINT pt = { static_cast<short>(LOWORD(lparam)) - rect.left, static_cast<short>(HIWORD(lparam)) - rect.top };
+			SIZE window = { rect.right - rect.left, rect.bottom - rect.top };
+			return hit_test(get_dpi(hwnd), pt, window, IsZoomed(hwnd) != FALSE);
+		}
+
+		// returns true if the message invalidated cached geometry
+		bool handle_message(UINT message)
+		{
+			if (!metrics_.handle_message(message))
+				return false;
+
+			geometries_.clear();
+			return true;
+		}
+
+	private:
+		SystemMetricsCache& metrics_;
+		std::vector<FrameGeometry> geometries_;
+	};
+}
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef WUTIL_RCU_INCLUDED
+#define WUTIL_RCU_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace wutil
+{
+	namespace detail
+	{
+		static const size_t Max_Rcu_Threads = 128;
+
+		inline std::atomic<bool> rcu_thread_index_used[Max_Rcu_Threads];
+
+		//=====================================================================
+		// small per thread index shared by all publishers, released when the
+		// thread exits. threads past Max_Rcu_Threads get Max_Rcu_Threads
+		//=====================================================================
+		struct RcuThreadIndex
+		{
+			size_t index = Max_Rcu_Threads;
+
+			RcuThreadIndex()
+			{
+				for (size_t i = 0; i < Max_Rcu_Threads; ++i)
+				{
+					bool expected = false;
+					if (rcu_thread_index_used[i].compare_exchange_strong(expected, true))
+					{
+						index = i;
+						return;
+					}
+				}
+			}
+
+			~RcuThreadIndex()
+			{
+				if (index < Max_Rcu_Threads)
+					rcu_thread_index_used[index].store(false);
+			}
+		};
+
+		inline size_t rcu_thread_index()
+		{
+			thread_local RcuThreadIndex thread_index;
+			return thread_index.index;
+		}
+
+		// own cache line per thread so readers never share a written line
+		struct alignas(64) RcuReaderSlot
+		{
+			std::atomic<uint64_t> epoch{ 0 };
+			uint32_t nesting = 0;
+		};
+	}
+
+	//=========================================================================
+	// publishes an immutable T to any number of reader threads. readers pin
+	// the current value with read(), which never locks and only writes to
+	// the reader's own slot. publish() swaps in a new value atomically and
+	// frees old ones once no reader can see them
+	//=========================================================================
+	template <typename T>
+	class RcuPublisher
+	{
+	public:
+		class ReadGuard
+		{
+		public:
+			ReadGuard(ReadGuard&& other) noexcept
+				: publisher_(other.publisher_), slot_(other.slot_), value_(other.value_)
+			{
+				other.publisher_ = nullptr;
+			}
+
+			ReadGuard(const ReadGuard&) = delete;
+			ReadGuard& operator=(const ReadGuard&) = delete;
+			ReadGuard& operator=(ReadGuard&&) = delete;
+
+			~ReadGuard()
+			{
+				if (publisher_ != nullptr)
+					publisher_->exit_read(slot_);
+			}
+
+			const T& operator*() const { return *value_; }
+			const T* operator->() const { return value_; }
+			const T* get() const { return value_; }
+
+		private:
+			friend class RcuPublisher;
+
+			ReadGuard(const RcuPublisher* publisher, size_t slot, const T* value)
+				: publisher_(publisher), slot_(slot), value_(value)
+			{
+			}
+
+			const RcuPublisher* publisher_;
+			size_t slot_;
+			const T* value_;
+		};
+
+		explicit RcuPublisher(T value)
+			: current_(new T(std::move(value)))
+		{
+		}
+
+		// no reader may outlive the publisher
+		~RcuPublisher()
+		{
+			delete current_.load();
+			for (auto& retired : retired_)
+				delete retired.value;
+		}
+
+		RcuPublisher(const RcuPublisher&) = delete;
+		RcuPublisher& operator=(const RcuPublisher&) = delete;
+
+		//==================================================================
+		// pin current value until the guard is destroyed, safe to nest
+		//==================================================================
+		ReadGuard read() const
+		{
+			auto slot = detail::rcu_thread_index();
+			if (slot == detail::Max_Rcu_Threads)
+			{
+				// out of slots, any overflow reader holds off all reclamation
+				overflow_readers_.fetch_add(1);
+				return ReadGuard(this, slot, current_.load());
+			}
+
+			auto& reader = slots_[slot];
+			if (reader.nesting++ == 0)
+				reader.epoch.store(global_epoch_.load());
+
+			return ReadGuard(this, slot, current_.load());
+		}
+
+		//==================================================================
+		// replace value, writers are serialized against each other
+		//==================================================================
+		void publish(T value)
+		{
+			auto next = new T(std::move(value));
+
+			std::lock_guard<std::mutex> lock(writer_mutex_);
+			auto previous = current_.exchange(next);
+			auto retire_epoch = global_epoch_.fetch_add(1) + 1;
+			retired_.push_back(Retired{ previous, retire_epoch });
+
+			reclaim_locked();
+		}
+
+		// free retired values no reader can still hold, returns how many remain
+		size_t reclaim()
+		{
+			std::lock_guard<std::mutex> lock(writer_mutex_);
+			reclaim_locked();
+			return retired_.size();
+		}
+
+	private:
+		struct Retired
+		{
+			const T* value;
+			uint64_t epoch;
+		};
+
+		void exit_read(size_t slot) const
+		{
+			if (slot == detail::Max_Rcu_Threads)
+			{
+				overflow_readers_.fetch_sub(1);
+				return;
+			}
+
+			auto& reader = slots_[slot];
+			if (--reader.nesting == 0)
+				reader.epoch.store(0);
+		}
+
+		void reclaim_locked()
+		{
+			if (overflow_readers_.load() != 0)
+				return;
+
+			// oldest epoch any reader entered with, readers in it may hold anything retired after it
+			uint64_t oldest_reader = UINT64_MAX;
+			for (const auto& reader : slots_)
+			{
+				auto epoch = reader.epoch.load();
+				if (epoch != 0 && epoch < oldest_reader)
+					oldest_reader = epoch;
+			}
+
+			auto keep = std::remove_if(retired_.begin(), retired_.end(), [oldest_reader](const Retired& retired)
+			{
+				if (retired.epoch > oldest_reader)
+					return false;
+
+				delete retired.value;
+				return true;
+			});
+			retired_.erase(keep, retired_.end());
+		}
+
+		std::atomic<const T*> current_;
+		std::atomic<uint64_t> global_epoch_{ 1 };
+		mutable detail::RcuReaderSlot slots_[detail::Max_Rcu_Threads];
+		mutable std::atomic<size_t> overflow_readers_{ 0 };
+
+		std::mutex writer_mutex_;
+		std::vector<Retired> retired_;
+	};
+}
+
+#endif
@@ -0,0 +1,546 @@
+#ifndef WUTIL_SHARED_SEQLOCK_INCLUDED
+#define WUTIL_SHARED_SEQLOCK_INCLUDED
+
+// one writer and any number of readers of a named shared memory region.
+// windows maps it through CreateFileMapping and wakes readers with named
+// events, posix through shm_open with readers waiting on the sequence word
+// itself, so the broker logic builds and is tested everywhere. readers map
+// the region read only on both
+
+#include "bytes.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <algorithm>
+
+#if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
+#ifndef OS_WIN
+#define OS_WIN
+#endif
+#endif
+
+#ifdef OS_WIN
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <Windows.h>
+
+#else
+
+#include <bit>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <ctime>
+#endif
+
+#endif
+
+namespace wutil
+{
+	namespace detail
+	{
+#ifdef OS_WIN
+		// e.g. TEXT("Local\\wutil_topology")
+		using SharedName = std::basic_string<TCHAR>;
+#else
+		// e.g. "/wutil_topology"
+		using SharedName = std::string;
+#endif
+
+		static const uint32_t Seqlock_Magic = 0x4c535557; // "WUSL"
+		static const uint32_t Seqlock_Version = 2;
+		static const uint32_t Seqlock_Infinite = 0xFFFFFFFF;
+		// a reader giving up means the writer is stuck mid write
+		static const int Seqlock_Read_Retries = 1000;
+		// waits recheck the generation at least this often, so a missed wake
+		// up costs one slice instead of the rest of the wait
+		static const uint32_t Seqlock_Wait_Slice_Ms = 10;
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock sequence must be lock free to live in shared memory");
+
+		//=====================================================================
+		// start of the shared region, the payload follows in 8 byte words.
+		// sequence is odd while the writer writes, the generation of the
+		// published payload is sequence / 2. payload_size and the payload
+		// are only valid between two equal even reads of sequence. both
+		// sides access the payload through relaxed atomics, so a read racing
+		// a write is a retry and not a data race
+		//=====================================================================
+		struct alignas(64) SeqlockHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t layout_hash;
+			uint64_t capacity;
+			std::atomic<uint64_t> sequence;
+			std::atomic<uint64_t> payload_size;
+			uint32_t writer_pid;
+		};
+
+		inline size_t seqlock_words(size_t size)
+		{
+			return (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		}
+
+		inline size_t seqlock_region_size(size_t capacity)
+		{
+			return sizeof(SeqlockHeader) + seqlock_words(capacity) * sizeof(uint64_t);
+		}
+
+		inline uint64_t* seqlock_payload(SeqlockHeader* header)
+		{
+			return reinterpret_cast<uint64_t*>(header + 1);
+		}
+
+		inline uint32_t current_process_id()
+		{
+#ifdef OS_WIN
+			return GetCurrentProcessId();
+#else
+			return static_cast<uint32_t>(getpid());
+#endif
+		}
+
+#ifdef OS_WIN
+		inline SharedName seqlock_event_name(const SharedName& name, uint64_t generation)
+		{
+			return name + ((generation & 1) ? TEXT("_odd") : TEXT("_even"));
+		}
+#else
+		//=====================================================================
+		// readers sleep on the low half of sequence, which changes with
+		// every write. the futex compares before sleeping, so a publish
+		// between the generation check and the wait returns at once. the
+		// futexes are shared ones, they work on the readers' read only
+		// mappings. without futexes readers poll within the wait slice
+		//=====================================================================
+		inline uint32_t* seqlock_futex(SeqlockHeader* header)
+		{
+			static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t));
+			auto word = reinterpret_cast<uint32_t*>(&header->sequence);
+			return std::endian::native == std::endian::big ? word + 1 : word;
+		}
+
+		inline void seqlock_wake(SeqlockHeader* header)
+		{
+#ifdef __linux__
+			syscall(SYS_futex, seqlock_futex(header), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+			(void)header;
+#endif
+		}
+
+		inline void seqlock_sleep(SeqlockHeader* header, uint64_t sequence, uint32_t timeout_ms)
+		{
+#ifdef __linux__
+			timespec timeout = {};
+			timeout.tv_sec = static_cast<time_t>(timeout_ms / 1000);
+			timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000;
+			syscall(SYS_futex, seqlock_futex(header), FUTEX_WAIT, static_cast<uint32_t>(sequence), &timeout, nullptr, 0);
+#else
+			(void)header;
+			(void)sequence;
+			std::this_thread::sleep_for(std::chrono::milliseconds((std::min)(timeout_ms, 1u)));
+#endif
+		}
+#endif
+
+		//=====================================================================
+		// a mapped region, the handles differ between the two backends
+		//=====================================================================
+		struct SharedMapping
+		{
+			SeqlockHeader* header = nullptr;
+			size_t size = 0;
+#ifdef OS_WIN
+			HANDLE mapping = NULL;
+			HANDLE events[2] = { NULL, NULL };
+#endif
+
+			void close()
+			{
+#ifdef OS_WIN
+				for (auto& event : events)
+				{
+					if (event != NULL)
+						CloseHandle(event);
+					event = NULL;
+				}
+
+				if (header != nullptr)
+					UnmapViewOfFile(header);
+				if (mapping != NULL)
+					CloseHandle(mapping);
+				mapping = NULL;
+#else
+				if (header != nullptr)
+					munmap(header, size);
+#endif
+				header = nullptr;
+				size = 0;
+			}
+		};
+	}
+
+	//=========================================================================
+	// the writing side, only one per name. a restarted writer keeps counting
+	// from the last generation. capacity and layout_hash must match between
+	// writer and readers, layout_hash describes what the payload holds
+	//=========================================================================
+	class SharedSeqlockWriter
+	{
+	public:
+		SharedSeqlockWriter(detail::SharedName name, size_t capacity, uint64_t layout_hash)
+			: name_(std::move(name)), capacity_(capacity)
+		{
+			auto region_size = detail::seqlock_region_size(capacity);
+
+#ifdef OS_WIN
+			auto& m = mapping_;
+			m.mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, static_cast<DWORD>(region_size), name_.c_str());
+			if (m.mapping == NULL)
+				return;
+
+			m.header = static_cast<detail::SeqlockHeader*>(MapViewOfFile(m.mapping, FILE_MAP_WRITE, 0, 0, region_size));
+			m.size = region_size;
+			for (uint64_t i = 0; i < 2; ++i)
+				m.events[i] = CreateEvent(NULL, TRUE, FALSE, detail::seqlock_event_name(name_, i).c_str());
+
+			if (m.header == nullptr || m.events[0] == NULL || m.events[1] == NULL)
+			{
+				m.close();
+				return;
+			}
+
+			auto header = m.header;
+			bool fresh = header->magic != detail::Seqlock_Magic;
+#else
+			int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0600);
+			if (fd < 0)
+				return;
+
+			struct stat status = {};
+			bool fresh = fstat(fd, &status) == 0 && status.st_size == 0;
+			if ((fresh && ftruncate(fd, static_cast<off_t>(region_size)) != 0) || (!fresh && static_cast<size_t>(status.st_size) < region_size))
+			{
+				::close(fd);
+				return;
+			}
+
+			auto view = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (view == MAP_FAILED)
+				return;
+
+			mapping_.header = static_cast<detail::SeqlockHeader*>(view);
+			mapping_.size = region_size;
+			auto header = mapping_.header;
+			fresh = fresh || header->magic != detail::Seqlock_Magic;
+#endif
+
+			if (fresh)
+			{
+				header->version = detail::Seqlock_Version;
+				header->layout_hash = layout_hash;
+				header->capacity = capacity;
+				header->sequence.store(0, std::memory_order_relaxed);
+				header->payload_size.store(0, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				header->magic = detail::Seqlock_Magic;
+			}
+			else if (header->version != detail::Seqlock_Version || header->layout_hash != layout_hash || header->capacity != capacity)
+			{
+				// left behind by a writer built with another layout
+				mapping_.close();
+				return;
+			}
+			else if (header->sequence.load(std::memory_order_relaxed) & 1)
+			{
+				// previous writer died mid write
+				header->sequence.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			header->writer_pid = detail::current_process_id();
+		}
+
+		~SharedSeqlockWriter()
+		{
+			mapping_.close();
+		}
+
+		SharedSeqlockWriter(const SharedSeqlockWriter&) = delete;
+		SharedSeqlockWriter& operator=(const SharedSeqlockWriter&) = delete;
+
+		bool is_open() const { return mapping_.header != nullptr; }
+		size_t capacity() const { return capacity_; }
+
+		// copy size bytes of data in and wake readers, false if over capacity
+		bool publish(const void* data, size_t size)
+		{
+			auto header = mapping_.header;
+			if (header == nullptr || size > capacity_)
+				return false;
+
+			auto sequence = header->sequence.load(std::memory_order_relaxed);
+#ifdef OS_WIN
+			auto generation = sequence / 2 + 1;
+			ResetEvent(mapping_.events[(generation + 1) & 1]);
+#endif
+
+			header->sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			header->payload_size.store(size, std::memory_order_relaxed);
+			auto words = detail::seqlock_payload(header);
+			auto bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0, count = detail::seqlock_words(size); i < count; ++i)
+			{
+				uint64_t word = 0;
+				std::memcpy(&word, bytes + i * sizeof(word), (std::min)(sizeof(word), size - i * sizeof(word)));
+				std::atomic_ref<uint64_t>(words[i]).store(word, std::memory_order_relaxed);
+			}
+
+			header->sequence.store(sequence + 2, std::memory_order_release);
+
+#ifdef OS_WIN
+			SetEvent(mapping_.events[generation & 1]);
+#else
+			detail::seqlock_wake(header);
+#endif
+			return true;
+		}
+
+		uint64_t generation() const
+		{
+			return mapping_.header == nullptr ? 0 : mapping_.header->sequence.load(std::memory_order_acquire) / 2;
+		}
+
+		//==================================================================
+		// posix regions outlive their writer until unlinked, windows ones
+		// go away with the last handle so there is nothing to remove
+		//==================================================================
+		static void remove(const detail::SharedName& name)
+		{
+#ifdef OS_WIN
+			(void)name;
+#else
+			shm_unlink(name.c_str());
+#endif
+		}
+
+	private:
+		detail::SharedName name_;
+		size_t capacity_ = 0;
+		detail::SharedMapping mapping_;
+	};
+
+	//=========================================================================
+	// the reading side. reads never block the writer, a read racing a write
+	// retries
+	//=========================================================================
+	class SharedSeqlockReader
+	{
+	public:
+		SharedSeqlockReader(detail::SharedName name, uint64_t layout_hash)
+			: name_(std::move(name)), layout_hash_(layout_hash)
+		{
+			open();
+		}
+
+		~SharedSeqlockReader()
+		{
+			mapping_.close();
+		}
+
+		SharedSeqlockReader(const SharedSeqlockReader&) = delete;
+		SharedSeqlockReader& operator=(const SharedSeqlockReader&) = delete;
+
+		//==================================================================
+		// map the region, false until a writer with the same layout has
+		// created it. read and wait call this themselves while unmapped
+		//==================================================================
+		bool open()
+		{
+			if (mapping_.header != nullptr)
+				return true;
+
+#ifdef OS_WIN
+			auto& m = mapping_;
+			m.mapping = OpenFileMapping(FILE_MAP_READ, FALSE, name_.c_str());
+			if (m.mapping == NULL)
+				return false;
+
+			m.header = static_cast<detail::SeqlockHeader*>(MapViewOfFile(m.mapping, FILE_MAP_READ, 0, 0, 0));
+			for (uint64_t i = 0; i < 2; ++i)
+				m.events[i] = OpenEvent(SYNCHRONIZE, FALSE, detail::seqlock_event_name(name_, i).c_str());
+
+			MEMORY_BASIC_INFORMATION info = {};
+			if (m.header != nullptr && VirtualQuery(m.header, &info, sizeof(info)) != 0)
+				m.size = info.RegionSize;
+
+			if (m.events[0] == NULL || m.events[1] == NULL || !valid_header())
+			{
+				m.close();
+				return false;
+			}
+#else
+			int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+			if (fd < 0)
+				return false;
+
+			struct stat status = {};
+			if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(detail::SeqlockHeader))
+			{
+				::close(fd);
+				return false;
+			}
+
+			auto view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (view == MAP_FAILED)
+				return false;
+
+			mapping_.header = static_cast<detail::SeqlockHeader*>(view);
+			mapping_.size = static_cast<size_t>(status.st_size);
+			if (!valid_header())
+			{
+				mapping_.close();
+				return false;
+			}
+#endif
+			return true;
+		}
+
+		// 0 until the first publish
+		uint64_t generation()
+		{
+			if (!open())
+				return 0;
+
+			return mapping_.header->sequence.load(std::memory_order_acquire) / 2;
+		}
+
+		//==================================================================
+		// copy the latest payload, false if nothing was published yet or
+		// the writer stalled mid write. out_generation is the generation
+		// that was read
+		//==================================================================
+		bool read(std::vector<unsigned char>& out_payload, uint64_t* out_generation = nullptr)
+		{
+			if (!open())
+				return false;
+
+			auto header = mapping_.header;
+			auto words = detail::seqlock_payload(header);
+			for (int attempt = 0; attempt < detail::Seqlock_Read_Retries; ++attempt)
+			{
+				auto before = header->sequence.load(std::memory_order_acquire);
+				if (before == 0)
+					return false;
+				if (before & 1)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				// may be torn, clamped before copying and validated after
+				auto size = (std::min)(static_cast<size_t>(header->payload_size.load(std::memory_order_relaxed)), capacity_);
+				auto count = detail::seqlock_words(size);
+				staging_.resize(count);
+				for (size_t i = 0; i < count; ++i)
+					staging_[i] = std::atomic_ref<uint64_t>(words[i]).load(std::memory_order_relaxed);
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (header->sequence.load(std::memory_order_relaxed) != before)
+					continue;
+
+				out_payload.resize(size);
+				if (size > 0)
+					std::memcpy(out_payload.data(), staging_.data(), size);
+				if (out_generation != nullptr)
+					*out_generation = before / 2;
+				return true;
+			}
+
+			return false;
+		}
+
+		//==================================================================
+		// block until a generation after last_generation is published or
+		// timeout_ms passes, true if there is a newer generation. the wait
+		// goes in slices that recheck the generation, a publish slipping in
+		// between the check and the wait is seen within one slice
+		//==================================================================
+		bool wait(uint64_t last_generation, uint32_t timeout_ms = detail::Seqlock_Infinite)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (;;)
+			{
+				if (!open())
+					return false;
+
+				if (generation() != last_generation)
+					return true;
+
+				uint32_t slice = detail::Seqlock_Wait_Slice_Ms;
+				if (timeout_ms != detail::Seqlock_Infinite)
+				{
+					auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+					if (elapsed >= timeout_ms)
+						return false;
+					slice = (std::min)(slice, static_cast<uint32_t>(timeout_ms - elapsed));
+				}
+
+				wait_slice(last_generation, slice);
+			}
+		}
+
+	private:
+		bool valid_header()
+		{
+			auto header = mapping_.header;
+			if (header == nullptr || mapping_.size < sizeof(detail::SeqlockHeader) ||
+				header->magic != detail::Seqlock_Magic || header->version != detail::Seqlock_Version ||
+				header->layout_hash != layout_hash_ || mapping_.size < detail::seqlock_region_size(static_cast<size_t>(header->capacity)))
+				return false;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			capacity_ = static_cast<size_t>(header->capacity);
+			return true;
+		}
+
+		void wait_slice(uint64_t last_generation, uint32_t slice_ms)
+		{
+#ifdef OS_WIN
+			WaitForSingleObject(mapping_.events[(last_generation + 1) & 1], slice_ms);
+#else
+			auto header = mapping_.header;
+			auto sequence = header->sequence.load(std::memory_order_acquire);
+			if (sequence / 2 == last_generation)
+				detail::seqlock_sleep(header, sequence, slice_ms);
+#endif
+		}
+
+		detail::SharedName name_;
+		uint64_t layout_hash_ = 0;
+		size_t capacity_ = 0;
+		detail::SharedMapping mapping_;
+
+		// reused between reads, copied out only after a clean read
+		std::vector<uint64_t> staging_;
+	};
+}
+
+#endif
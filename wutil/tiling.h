@@ -0,0 +1,326 @@
+#ifndef WUTIL_TILING_INCLUDED
+#define WUTIL_TILING_INCLUDED
+
+#include "wutil.h"
+
+#include <cmath>
+#include <span>
+
+namespace wutil
+{
+	// physical work area, e.g. MONITORINFOEX::rcWork, and its dpi
+	struct TileMonitor
+	{
+		RECT work = {};
+		UINT dpi = detail::Default_DPI;
+	};
+
+	struct TileConstraints
+	{
+		// logical, scaled to the dpi of the monitor the window lands on
+		SIZE min_size = {};
+		// share of the row relative to its neighbours, 0 counts as 1
+		uint32_t weight = 1;
+		// index into the monitor list, -1 lets the solver choose
+		int pinned_monitor = -1;
+	};
+
+	//=========================================================================
+	// tiles windows over monitor work areas. unpinned windows go to the
+	// monitor with the least weight per area, each monitor is then split
+	// into rows of near square cells. widths follow weight, heights and
+	// widths never drop below a window's minimum unless the monitor is too
+	// small for all minimums. no allocations once reserve has been called
+	// with the largest counts used
+	//=========================================================================
+	class TilingSolver
+	{
+	public:
+		// gutter is logical and scaled per monitor dpi
+		explicit TilingSolver(int gutter = 8) : gutter_(gutter) {}
+
+		void set_gutter(int gutter) { gutter_ = gutter; }
+
+		void reserve(size_t windows, size_t monitors)
+		{
+			assignment_.reserve(windows);
+			order_.reserve(windows);
+			weights_.reserve(windows);
+			mins_.reserve(windows);
+			sizes_.reserve(windows);
+			fixed_.reserve(windows);
+			row_heights_.reserve(windows);
+			monitor_weight_.reserve(monitors);
+			monitor_start_.reserve(monitors + 1);
+			monitor_fill_.reserve(monitors);
+		}
+
+		//==================================================================
+		// place every window, rects must be as long as windows. returns
+		// how many rows and windows got less than their minimum size
+		//==================================================================
+		size_t solve(std::span<const TileMonitor> monitors, std::span<const TileConstraints> windows, std::span<RECT> rects)
+		{
+			if (monitors.empty())
+				return 0;
+
+			assignment_.resize(windows.size());
+			monitor_weight_.assign(monitors.size(), 0);
+			for (size_t i = 0; i < windows.size(); ++i)
+			{
+				int pinned = windows[i].pinned_monitor;
+				if (pinned >= 0 && static_cast<size_t>(pinned) < monitors.size())
+					place(i, pinned, windows);
+			}
+
+			for (size_t i = 0; i < windows.size(); ++i)
+			{
+				int pinned = windows[i].pinned_monitor;
+				if (pinned < 0 || static_cast<size_t>(pinned) >= monitors.size())
+					place(i, least_loaded(monitors), windows);
+			}
+
+			group(monitors.size());
+
+			size_t unmet = 0;
+			for (size_t m = 0; m < monitors.size(); ++m)
+				unmet += layout_monitor(m, monitors, windows, rects);
+
+			return unmet;
+		}
+
+		//==================================================================
+		// re-layout one monitor after its work area or dpi changed,
+		// assignments are kept
+		//==================================================================
+		size_t resolve_monitor(size_t monitor, std::span<const TileMonitor> monitors, std::span<const TileConstraints> windows, std::span<RECT> rects)
+		{
+			if (monitor >= monitors.size() || monitor + 1 >= monitor_start_.size() || assignment_.size() != windows.size())
+				return solve(monitors, windows, rects);
+
+			return layout_monitor(monitor, monitors, windows, rects);
+		}
+
+		//==================================================================
+		// re-layout after one window's constraints changed. the window only
+		// moves when its pin now names another monitor, then both monitors
+		// are re-laid out
+		//==================================================================
+		size_t update_window(size_t window, std::span<const TileMonitor> monitors, std::span<const TileConstraints> windows, std::span<RECT> rects)
+		{
+			if (window >= windows.size() || assignment_.size() != windows.size() || monitor_start_.size() != monitors.size() + 1)
+				return solve(monitors, windows, rects);
+
+			int current = assignment_[window];
+			int pinned = windows[window].pinned_monitor;
+			if (pinned < 0 || static_cast<size_t>(pinned) >= monitors.size() || pinned == current)
+				return layout_monitor(current, monitors, windows, rects);
+
+			assignment_[window] = pinned;
+			group(monitors.size());
+			return layout_monitor(current, monitors, windows, rects) + layout_monitor(pinned, monitors, windows, rects);
+		}
+
+		// monitor window was placed on by the last solve
+		int monitor_of(size_t window) const
+		{
+			return window < assignment_.size() ? assignment_[window] : -1;
+		}
+
+	private:
+		static int64_t window_weight(const TileConstraints& constraints)
+		{
+			return constraints.weight == 0 ? 1 : constraints.weight;
+		}
+
+		void place(size_t window, int monitor, std::span<const TileConstraints> windows)
+		{
+			assignment_[window] = monitor;
+			monitor_weight_[monitor] += window_weight(windows[window]);
+		}
+
+		int least_loaded(std::span<const TileMonitor> monitors) const
+		{
+			// compare weight_a / area_a < weight_b / area_b without dividing
+			int best = 0;
+			for (size_t m = 1; m < monitors.size(); ++m)
+			{
+				if (monitor_weight_[m] * area(monitors[best]) < monitor_weight_[best] * area(monitors[m]))
+					best = static_cast<int>(m);
+			}
+
+			return best;
+		}
+
+		static int64_t area(const TileMonitor& monitor)
+		{
+			int64_t w = (std::max)(monitor.work.right - monitor.work.left, static_cast<LONG>(1));
+			int64_t h = (std::max)(monitor.work.bottom - monitor.work.top, static_cast<LONG>(1));
+			return w * h;
+		}
+
+		// counting sort of windows by monitor, window order kept within a monitor
+		void group(size_t monitor_count)
+		{
+			monitor_start_.assign(monitor_count + 1, 0);
+			for (auto monitor : assignment_)
+				++monitor_start_[monitor + 1];
+			for (size_t m = 0; m < monitor_count; ++m)
+				monitor_start_[m + 1] += monitor_start_[m];
+
+			order_.resize(assignment_.size());
+			monitor_fill_.assign(monitor_start_.begin(), monitor_start_.end() - 1);
+			for (size_t i = 0; i < assignment_.size(); ++i)
+				order_[monitor_fill_[assignment_[i]]++] = i;
+		}
+
+		//==================================================================
+		// split total between count items by weight with per item minimum,
+		// sizes sum to exactly total. returns how many got less than min
+		//==================================================================
+		size_t distribute(size_t count, int64_t total, const int64_t* weights, const int64_t* mins, int64_t* sizes)
+		{
+			total = (std::max)(total, static_cast<int64_t>(0));
+
+			int64_t min_total = 0;
+			for (size_t i = 0; i < count; ++i)
+				min_total += mins[i];
+
+			if (min_total >= total && min_total > 0)
+			{
+				// not enough room, shrink minimums proportionally
+				int64_t acc = 0, previous = 0;
+				size_t unmet = 0;
+				for (size_t i = 0; i < count; ++i)
+				{
+					acc += mins[i];
+					int64_t edge = total * acc / min_total;
+					sizes[i] = edge - previous;
+					previous = edge;
+					if (sizes[i] < mins[i])
+						++unmet;
+				}
+				return unmet;
+			}
+
+			// fix items whose share falls under their minimum until none do
+			fixed_.assign(count, 0);
+			int64_t free_total = total;
+			int64_t free_weight = 0;
+			for (size_t i = 0; i < count; ++i)
+				free_weight += weights[i];
+
+			bool changed = true;
+			while (changed && free_weight > 0)
+			{
+				changed = false;
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (fixed_[i] || free_total * weights[i] >= mins[i] * free_weight)
+						continue;
+
+					fixed_[i] = 1;
+					sizes[i] = mins[i];
+					free_total -= mins[i];
+					free_weight -= weights[i];
+					changed = true;
+				}
+			}
+
+			int64_t acc = 0, previous = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (fixed_[i])
+					continue;
+
+				acc += weights[i];
+				int64_t edge = free_weight > 0 ? free_total * acc / free_weight : 0;
+				sizes[i] = edge - previous;
+				previous = edge;
+			}
+
+			return 0;
+		}
+
+		size_t layout_monitor(size_t monitor, std::span<const TileMonitor> monitors, std::span<const TileConstraints> windows, std::span<RECT> rects)
+		{
+			size_t first = monitor_start_[monitor];
+			size_t count = monitor_start_[monitor + 1] - first;
+			if (count == 0)
+				return 0;
+
+			const auto& work = monitors[monitor].work;
+			auto dpi = monitors[monitor].dpi;
+			int64_t gutter = scale_value(gutter_, dpi);
+			int64_t width = work.right - work.left;
+			int64_t height = work.bottom - work.top;
+
+			// near square cells, columns ~ sqrt(count * width / height)
+			auto columns = static_cast<size_t>(std::lround(std::sqrt(static_cast<double>(count) * (std::max)(width, static_cast<int64_t>(1)) / (std::max)(height, static_cast<int64_t>(1)))));
+			columns = (std::min)((std::max)(columns, static_cast<size_t>(1)), count);
+			size_t rows = (count + columns - 1) / columns;
+			size_t base = count / rows;
+			size_t extra = count % rows;
+
+			// row heights, every row weighs the same and needs its tallest minimum
+			weights_.assign(rows, 1);
+			mins_.assign(rows, 0);
+			size_t index = first;
+			for (size_t r = 0; r < rows; ++r)
+			{
+				size_t in_row = base + (r < extra ? 1 : 0);
+				for (size_t c = 0; c < in_row; ++c, ++index)
+					mins_[r] = (std::max)(mins_[r], static_cast<int64_t>(scale_value(windows[order_[index]].min_size.cy, dpi)));
+			}
+
+			row_heights_.resize(rows);
+			size_t unmet = distribute(rows, height - gutter * static_cast<int64_t>(rows + 1), weights_.data(), mins_.data(), row_heights_.data());
+
+			index = first;
+			int64_t top = work.top + gutter;
+			for (size_t r = 0; r < rows; ++r)
+			{
+				size_t in_row = base + (r < extra ? 1 : 0);
+				weights_.resize(in_row);
+				mins_.resize(in_row);
+				sizes_.resize(in_row);
+				for (size_t c = 0; c < in_row; ++c)
+				{
+					const auto& constraints = windows[order_[index + c]];
+					weights_[c] = window_weight(constraints);
+					mins_[c] = scale_value(constraints.min_size.cx, dpi);
+				}
+
+				unmet += distribute(in_row, width - gutter * static_cast<int64_t>(in_row + 1), weights_.data(), mins_.data(), sizes_.data());
+
+				int64_t left = work.left + gutter;
+				for (size_t c = 0; c < in_row; ++c, ++index)
+				{
+					rects[order_[index]] = RECT{ static_cast<LONG>(left), static_cast<LONG>(top),
+						static_cast<LONG>(left + sizes_[c]), static_cast<LONG>(top + row_heights_[r]) };
+					left += sizes_[c] + gutter;
+				}
+
+				top += row_heights_[r] + gutter;
+			}
+
+			return unmet;
+		}
+
+		int gutter_ = 8;
+		std::vector<int> assignment_;
+		std::vector<size_t> order_;
+		std::vector<size_t> monitor_start_;
+		std::vector<size_t> monitor_fill_;
+		std::vector<int64_t> monitor_weight_;
+
+		// scratch, sized by reserve so solves do not allocate
+		std::vector<int64_t> weights_;
+		std::vector<int64_t> mins_;
+		std::vector<int64_t> sizes_;
+		std::vector<int64_t> row_heights_;
+		std::vector<uint8_t> fixed_;
+	};
+}
+
+#endif
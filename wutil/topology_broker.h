@@ -0,0 +1,242 @@
+#ifndef WUTIL_TOPOLOGY_BROKER_INCLUDED
+#define WUTIL_TOPOLOGY_BROKER_INCLUDED
+
+#include "wutil.h"
+#include "topology_snapshot.h"
+#include "shared_seqlock.h"
+
+#include <cstring>
+
+namespace wutil
+{
+	namespace detail
+	{
+		static const uint32_t Broker_Version = 2;
+		static const size_t Broker_Max_Devices = 32;
+		static const size_t Broker_Max_Monitors = 16;
+		static const size_t Broker_Max_Modes = 4096;
+
+		//=====================================================================
+		// payload published through the seqlock: the counts, then devices,
+		// monitors, monitor records and modes packed back to back
+		//=====================================================================
+		struct BrokerCounts
+		{
+			uint32_t device_count;
+			uint32_t monitor_count;
+			uint32_t mode_count;
+			uint32_t reserved;
+		};
+
+		inline size_t broker_capacity()
+		{
+			return sizeof(BrokerCounts) + Broker_Max_Devices * sizeof(DISPLAY_DEVICE) +
+				Broker_Max_Monitors * (sizeof(MONITORINFOEX) + sizeof(SnapshotMonitor)) + Broker_Max_Modes * sizeof(SnapshotMode);
+		}
+
+		// a unicode reader never decodes what an ansi publisher wrote
+		inline uint64_t broker_layout_hash()
+		{
+			const uint64_t layout[] = { Broker_Version, sizeof(DISPLAY_DEVICE), sizeof(MONITORINFOEX), sizeof(SnapshotMonitor), sizeof(SnapshotMode) };
+			return fnv1a(layout, sizeof(layout));
+		}
+	}
+
+	//=========================================================================
+	// publishes the topology of this session into named shared memory so
+	// other processes read it instead of enumerating themselves. only one
+	// publisher per name, readers use TopologyBrokerReader
+	//=========================================================================
+	class TopologyBroker
+	{
+	public:
+		explicit TopologyBroker(tstring name = TEXT("Local\\wutil_topology"))
+			: writer_(std::move(name), detail::broker_capacity(), detail::broker_layout_hash())
+		{
+		}
+
+		bool is_open() const { return writer_.is_open(); }
+
+		//==================================================================
+		// publish topology and wake readers, false if it exceeds the
+		// fixed capacity of the region or its per monitor vectors do not
+		// match the monitors. topology can come from anywhere, e.g. a
+		// simulated topology when testing readers
+		//==================================================================
+		bool publish(const Topology& topology)
+		{
+			auto monitor_count = topology.monitors.size();
+			if (!writer_.is_open() || topology.devices.size() > detail::Broker_Max_Devices || monitor_count > detail::Broker_Max_Monitors ||
+				topology.ids.size() != monitor_count || topology.dpis.size() != monitor_count || topology.modes.size() != monitor_count)
+				return false;
+
+			size_t mode_count = 0;
+			for (const auto& monitor_modes : topology.modes)
+				mode_count += monitor_modes.size();
+			if (mode_count > detail::Broker_Max_Modes)
+				return false;
+
+			detail::BrokerCounts counts = { static_cast<uint32_t>(topology.devices.size()), static_cast<uint32_t>(monitor_count), static_cast<uint32_t>(mode_count), 0 };
+			payload_.clear();
+			detail::append_bytes(payload_, &counts, 1);
+			detail::append_bytes(payload_, topology.devices.data(), topology.devices.size());
+			detail::append_bytes(payload_, topology.monitors.data(), monitor_count);
+
+			for (size_t i = 0; i < monitor_count; ++i)
+			{
+				detail::SnapshotMonitor record = { topology.ids[i], topology.dpis[i], static_cast<uint32_t>(topology.modes[i].size()) };
+				detail::append_bytes(payload_, &record, 1);
+			}
+
+			for (const auto& monitor_modes : topology.modes)
+			{
+				for (const auto& dm : monitor_modes)
+				{
+					auto mode = detail::to_snapshot_mode(dm);
+					detail::append_bytes(payload_, &mode, 1);
+				}
+			}
+
+			return writer_.publish(payload_.data(), payload_.size());
+		}
+
+		bool publish()
+		{
+			return publish(get_topology());
+		}
+
+		uint64_t generation() const
+		{
+			return writer_.generation();
+		}
+
+		// forward window messages, republishes on display changes
+		bool handle_message(UINT msg)
+		{
+			if (msg != WM_DISPLAYCHANGE)
+				return false;
+
+			return publish();
+		}
+
+	private:
+		SharedSeqlockWriter writer_;
+		// reused between publishes
+		std::vector<unsigned char> payload_;
+	};
+
+	//=========================================================================
+	// read only view of a TopologyBroker region in another process. reads
+	// never block the publisher, a read racing a publish retries
+	//=========================================================================
+	class TopologyBrokerReader
+	{
+	public:
+		explicit TopologyBrokerReader(tstring name = TEXT("Local\\wutil_topology"))
+			: reader_(std::move(name), detail::broker_layout_hash())
+		{
+		}
+
+		// map the region, false until a publisher has created it
+		bool open()
+		{
+			return reader_.open();
+		}
+
+		// 0 until the first publish
+		uint64_t generation()
+		{
+			return reader_.generation();
+		}
+
+		//==================================================================
+		// copy the latest topology, false if nothing was published yet or
+		// the publisher stalled mid write. out_generation is the generation
+		// that was read
+		//==================================================================
+		bool read(Topology& out_topology, uint64_t* out_generation = nullptr)
+		{
+			uint64_t generation = 0;
+			if (!reader_.read(payload_, &generation) || !decode(out_topology))
+				return false;
+
+			if (out_generation != nullptr)
+				*out_generation = generation;
+			return true;
+		}
+
+		//==================================================================
+		// block until a generation after last_generation is published or
+		// timeout_ms passes, true if there is a newer generation
+		//==================================================================
+		bool wait(uint64_t last_generation, DWORD timeout_ms = INFINITE)
+		{
+			return reader_.wait(last_generation, timeout_ms);
+		}
+
+	private:
+		template <typename T>
+		bool take(size_t& offset, size_t count, std::vector<T>& out) const
+		{
+			if (count > (payload_.size() - offset) / sizeof(T))
+				return false;
+
+			out.resize(count);
+			if (count > 0)
+				std::memcpy(out.data(), payload_.data() + offset, count * sizeof(T));
+			offset += count * sizeof(T);
+			return true;
+		}
+
+		bool decode(Topology& out_topology)
+		{
+			detail::BrokerCounts counts = {};
+			if (payload_.size() < sizeof(counts))
+				return false;
+
+			std::memcpy(&counts, payload_.data(), sizeof(counts));
+			size_t offset = sizeof(counts);
+			if (counts.device_count > detail::Broker_Max_Devices || counts.monitor_count > detail::Broker_Max_Monitors || counts.mode_count > detail::Broker_Max_Modes)
+				return false;
+
+			Topology topology;
+			if (!take(offset, counts.device_count, topology.devices) || !take(offset, counts.monitor_count, topology.monitors) ||
+				!take(offset, counts.monitor_count, records_) || !take(offset, counts.mode_count, modes_) || offset != payload_.size())
+				return false;
+
+			size_t modes_left = modes_.size();
+			for (const auto& record : records_)
+			{
+				if (record.mode_count > modes_left)
+					return false;
+				modes_left -= record.mode_count;
+			}
+
+			if (modes_left != 0)
+				return false;
+
+			size_t mode = 0;
+			for (size_t i = 0; i < records_.size(); ++i)
+			{
+				topology.ids.push_back(records_[i].id);
+				topology.dpis.push_back(records_[i].dpi);
+				topology.modes.emplace_back();
+				topology.modes.back().reserve(records_[i].mode_count);
+				for (uint32_t j = 0; j < records_[i].mode_count; ++j)
+					topology.modes.back().push_back(detail::from_snapshot_mode(modes_[mode++], topology.monitors[i].szDevice));
+			}
+
+			out_topology = std::move(topology);
+			return true;
+		}
+
+		SharedSeqlockReader reader_;
+
+		// staging reused between reads, decoded only after a clean copy
+		std::vector<unsigned char> payload_;
+		std::vector<detail::SnapshotMonitor> records_;
+		std::vector<detail::SnapshotMode> modes_;
+	};
+}
+
+#endif
@@ -0,0 +1,320 @@
+#ifndef WUTIL_TOPOLOGY_DIFF_INCLUDED
+#define WUTIL_TOPOLOGY_DIFF_INCLUDED
+
+#include "wutil.h"
+
+#include <unordered_map>
+
+namespace wutil
+{
+	enum MonitorChangeFlags : uint32_t
+	{
+		Monitor_Added = 1 << 0,
+		Monitor_Removed = 1 << 1,
+		// rcMonitor origin changed
+		Monitor_Moved = 1 << 2,
+		// current resolution, depth, frequency or orientation changed
+		Monitor_Remoded = 1 << 3,
+		Monitor_Dpi_Changed = 1 << 4,
+		// taskbar or appbars changed rcWork
+		Monitor_Work_Area_Changed = 1 << 5,
+		Monitor_Primary_Changed = 1 << 6
+	};
+
+	struct MonitorChange
+	{
+		DisplayId id = 0;
+		uint32_t flags = 0;
+		// SIZE_MAX when the monitor is absent from that topology
+		size_t previous_index = SIZE_MAX;
+		size_t current_index = SIZE_MAX;
+	};
+
+	struct TopologyDiff
+	{
+		// monitors with at least one flag set, unchanged monitors are left out
+		std::vector<MonitorChange> changes;
+
+		bool empty() const { return changes.empty(); }
+
+		// first change with id, monitors of identical hardware share an id and may have one each
+		const MonitorChange* find(DisplayId id) const
+		{
+			for (const auto& change : changes)
+			{
+				if (change.id == id)
+					return &change;
+			}
+
+			return nullptr;
+		}
+
+		// change of the monitor at previous_index in the previous topology
+		const MonitorChange* find(DisplayId id, size_t previous_index) const
+		{
+			for (const auto& change : changes)
+			{
+				if (change.id == id && change.previous_index == previous_index)
+					return &change;
+			}
+
+			return nullptr;
+		}
+
+		// flags of every change with id
+		uint32_t flags(DisplayId id) const
+		{
+			uint32_t flags = 0;
+			for (const auto& change : changes)
+			{
+				if (change.id == id)
+					flags |= change.flags;
+			}
+
+			return flags;
+		}
+	};
+
+	namespace detail
+	{
+		inline bool same_current_mode(const Topology& a, size_t ai, const Topology& b, size_t bi)
+		{
+			bool a_empty = ai >= a.modes.size() || a.modes[ai].empty();
+			bool b_empty = bi >= b.modes.size() || b.modes[bi].empty();
+			if (a_empty || b_empty)
+				return a_empty == b_empty;
+
+			// get_monitor_display_settings puts the current mode first
+			const auto& ma = a.modes[ai].front();
+			const auto& mb = b.modes[bi].front();
+			return ma.dmPelsWidth == mb.dmPelsWidth &&
+				ma.dmPelsHeight == mb.dmPelsHeight &&
+				ma.dmBitsPerPel == mb.dmBitsPerPel &&
+				ma.dmDisplayFrequency == mb.dmDisplayFrequency &&
+				ma.dmDisplayFlags == mb.dmDisplayFlags &&
+				ma.dmDisplayOrientation == mb.dmDisplayOrientation;
+		}
+
+		inline UINT topology_dpi(const Topology& topology, size_t i)
+		{
+			return i < topology.dpis.size() ? topology.dpis[i] : Default_DPI;
+		}
+	}
+
+	//=========================================================================
+	// compare two topologies by monitor id. monitors sharing an id, i.e.
+	// identical hardware without serial numbers, pair up in enumeration order
+	//=========================================================================
+	inline TopologyDiff diff_topology(const Topology& previous, const Topology& current)
+	{
+		TopologyDiff diff;
+
+		std::unordered_multimap<DisplayId, size_t> previous_index;
+		for (size_t i = 0; i < previous.ids.size(); ++i)
+			previous_index.emplace(previous.ids[i], i);
+
+		std::vector<bool> matched(previous.ids.size(), false);
+		for (size_t ci = 0; ci < current.ids.size(); ++ci)
+		{
+			MonitorChange change;
+			change.id = current.ids[ci];
+			change.current_index = ci;
+
+			// lowest unmatched index with this id
+			auto range = previous_index.equal_range(change.id);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (!matched[it->second] && it->second < change.previous_index)
+					change.previous_index = it->second;
+			}
+
+			if (change.previous_index == SIZE_MAX)
+			{
+				change.flags = Monitor_Added;
+				diff.changes.push_back(change);
+				continue;
+			}
+
+			auto pi = change.previous_index;
+			matched[pi] = true;
+
+			const auto& pm = previous.monitors[pi];
+			const auto& cm = current.monitors[ci];
+			if (pm.rcMonitor.left != cm.rcMonitor.left || pm.rcMonitor.top != cm.rcMonitor.top)
+				change.flags |= Monitor_Moved;
+			if (!detail::same_current_mode(previous, pi, current, ci) ||
+				pm.rcMonitor.right - pm.rcMonitor.left != cm.rcMonitor.right - cm.rcMonitor.left ||
+				pm.rcMonitor.bottom - pm.rcMonitor.top != cm.rcMonitor.bottom - cm.rcMonitor.top)
+				change.flags |= Monitor_Remoded;
+			if (detail::topology_dpi(previous, pi) != detail::topology_dpi(current, ci))
+				change.flags |= Monitor_Dpi_Changed;
+			if (!EqualRect(&pm.rcWork, &cm.rcWork))
+				change.flags |= Monitor_Work_Area_Changed;
+			if ((pm.dwFlags & MONITORINFOF_PRIMARY) != (cm.dwFlags & MONITORINFOF_PRIMARY))
+				change.flags |= Monitor_Primary_Changed;
+
+			if (change.flags != 0)
+				diff.changes.push_back(change);
+		}
+
+		for (size_t pi = 0; pi < previous.ids.size(); ++pi)
+		{
+			if (matched[pi])
+				continue;
+
+			MonitorChange change;
+			change.id = previous.ids[pi];
+			change.flags = Monitor_Removed;
+			change.previous_index = pi;
+			diff.changes.push_back(change);
+		}
+
+		return diff;
+	}
+
+	//=========================================================================
+	// windows and the monitor each one is laid out for, so a topology diff
+	// can name only the windows that need to re-layout. monitors of
+	// identical hardware share an id, windows registered against a topology
+	// also keep the monitor's index in it and are matched to the change of
+	// that monitor only. windows registered by id alone are affected by the
+	// changes of every monitor with their id
+	//=========================================================================
+	class WindowRegistry
+	{
+	public:
+		// monitor taken from where the window currently is
+		void add(HWND hwnd)
+		{
+			add(hwnd, window_monitor_id(hwnd));
+		}
+
+		// monitor and its index taken from topology, the one diffs will be taken against
+		void add(HWND hwnd, const Topology& topology)
+		{
+			windows_[hwnd] = window_monitor(hwnd, topology);
+		}
+
+		void add(HWND hwnd, DisplayId monitor, size_t index = SIZE_MAX)
+		{
+			windows_[hwnd] = WindowMonitor{ monitor, index };
+		}
+
+		void remove(HWND hwnd)
+		{
+			windows_.erase(hwnd);
+		}
+
+		//==================================================================
+		// call after the window re-layouts or on WM_DPICHANGED, returns
+		// true if the monitor changed. a move between monitors sharing an
+		// id is only seen through the overload taking the topology
+		//==================================================================
+		bool update(HWND hwnd)
+		{
+			auto it = windows_.find(hwnd);
+			if (it == windows_.end())
+				return false;
+
+			auto monitor = window_monitor_id(hwnd);
+			if (monitor == it->second.id)
+				return false;
+
+			it->second = WindowMonitor{ monitor, SIZE_MAX };
+			return true;
+		}
+
+		// with the topology the next diff is taken against, after a re-layout or on WM_DISPLAYCHANGE
+		bool update(HWND hwnd, const Topology& topology)
+		{
+			auto it = windows_.find(hwnd);
+			if (it == windows_.end())
+				return false;
+
+			auto monitor = window_monitor(hwnd, topology);
+			if (monitor.id == it->second.id && monitor.index == it->second.index)
+				return false;
+
+			it->second = monitor;
+			return true;
+		}
+
+		std::optional<DisplayId> monitor(HWND hwnd) const
+		{
+			auto it = windows_.find(hwnd);
+			if (it == windows_.end())
+				return {};
+
+			return it->second.id;
+		}
+
+		// windows on any monitor in diff, in no particular order
+		std::vector<HWND> affected(const TopologyDiff& diff, uint32_t flags = UINT32_MAX) const
+		{
+			std::vector<HWND> windows;
+			for (const auto& [hwnd, monitor] : windows_)
+			{
+				uint32_t changed = 0;
+				if (monitor.index != SIZE_MAX)
+				{
+					auto change = diff.find(monitor.id, monitor.index);
+					changed = change != nullptr ? change->flags : 0;
+				}
+				else
+				{
+					changed = diff.flags(monitor.id);
+				}
+
+				if ((changed & flags) != 0)
+					windows.push_back(hwnd);
+			}
+
+			return windows;
+		}
+
+		size_t size() const { return windows_.size(); }
+
+	private:
+		struct WindowMonitor
+		{
+			DisplayId id = 0;
+			// index in the topology the window was registered against, SIZE_MAX if unknown
+			size_t index = SIZE_MAX;
+		};
+
+		static bool window_monitor_info(HWND hwnd, MONITORINFOEX& mi)
+		{
+			mi.cbSize = sizeof(mi);
+			return detail::display_api.get_monitor_info(detail::display_api.monitor_from_window(hwnd, MONITOR_DEFAULTTONEAREST), &mi) != 0;
+		}
+
+		static DisplayId window_monitor_id(HWND hwnd)
+		{
+			MONITORINFOEX mi;
+			if (!window_monitor_info(hwnd, mi))
+				return 0;
+
+			return get_monitor_id(mi.szDevice);
+		}
+
+		// by gdi name, which unlike the id is unique within a topology
+		static WindowMonitor window_monitor(HWND hwnd, const Topology& topology)
+		{
+			MONITORINFOEX mi;
+			if (!window_monitor_info(hwnd, mi))
+				return WindowMonitor{};
+
+			for (size_t i = 0; i < topology.monitors.size() && i < topology.ids.size(); ++i)
+			{
+				if (tstring_view(topology.monitors[i].szDevice) == mi.szDevice)
+					return WindowMonitor{ topology.ids[i], i };
+			}
+
+			return WindowMonitor{ get_monitor_id(mi.szDevice), SIZE_MAX };
+		}
+
+		std::unordered_map<HWND, WindowMonitor> windows_;
+	};
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef WUTIL_TOPOLOGY_RCU_INCLUDED
+#define WUTIL_TOPOLOGY_RCU_INCLUDED
+
+#include "wutil.h"
+#include "rcu.h"
+
+namespace wutil
+{
+	//=========================================================================
+	// the current topology for any number of reader threads, see
+	// RcuPublisher
+	//=========================================================================
+	class TopologyPublisher : public RcuPublisher<Topology>
+	{
+	public:
+		using RcuPublisher<Topology>::RcuPublisher;
+
+		// re-enumerate and publish
+		void refresh()
+		{
+			publish(get_topology());
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,451 @@
+#ifndef WUTIL_TOPOLOGY_SNAPSHOT_INCLUDED
+#define WUTIL_TOPOLOGY_SNAPSHOT_INCLUDED
+
+#include "wutil.h"
+
+#include <future>
+#include <cstring>
+#include <memory>
+#include <span>
+
+namespace wutil
+{
+	namespace detail
+	{
+		static const uint32_t Snapshot_Magic = 0x53545557; // "WUTS"
+		static const uint32_t Snapshot_Version = 2;
+
+		struct SnapshotHeader
+		{
+			uint32_t magic = Snapshot_Magic;
+			uint32_t version = Snapshot_Version;
+			// guards against reading a snapshot written by an ansi build from a unicode build
+			uint32_t display_device_size = sizeof(DISPLAY_DEVICE);
+			uint32_t monitor_info_size = sizeof(MONITORINFOEX);
+			uint64_t fingerprint = 0;
+			uint32_t device_count = 0;
+			uint32_t monitor_count = 0;
+			uint32_t mode_count = 0;
+			uint32_t reserved = 0;
+			uint64_t payload_size = 0;
+			uint64_t payload_hash = 0;
+		};
+
+		// the fields of DEVMODE that enumeration fills in, a fraction of its size
+		struct SnapshotMode
+		{
+			uint32_t fields;
+			uint32_t bits_per_pixel;
+			uint32_t pixel_width;
+			uint32_t pixel_height;
+			uint32_t display_flags;
+			uint32_t display_frequency;
+			uint32_t display_orientation;
+			int32_t position_x;
+			int32_t position_y;
+		};
+
+		struct SnapshotMonitor
+		{
+			DisplayId id;
+			uint32_t dpi;
+			uint32_t mode_count;
+		};
+
+		// snapshots are read in place, every array has to start aligned
+		static_assert(sizeof(SnapshotHeader) % alignof(SnapshotMonitor) == 0 && sizeof(DISPLAY_DEVICE) % alignof(SnapshotMonitor) == 0 &&
+			sizeof(MONITORINFOEX) % alignof(SnapshotMonitor) == 0 && sizeof(SnapshotMonitor) % alignof(SnapshotMode) == 0,
+			"snapshot records must stay aligned in the mapped file");
+
+		inline SnapshotMode to_snapshot_mode(const DEVMODE& dm)
+		{
+			return SnapshotMode{ dm.dmFields, dm.dmBitsPerPel, dm.dmPelsWidth, dm.dmPelsHeight, dm.dmDisplayFlags,
+				dm.dmDisplayFrequency, dm.dmDisplayOrientation, dm.dmPosition.x, dm.dmPosition.y };
+		}
+
+		inline DEVMODE from_snapshot_mode(const SnapshotMode& sm, const TCHAR* device_name)
+		{
+			DEVMODE dm = {};
+			dm.dmSize = sizeof(dm);
+			lstrcpyn(dm.dmDeviceName, device_name, CCHDEVICENAME);
+			dm.dmFields = sm.fields;
+			dm.dmBitsPerPel = sm.bits_per_pixel;
+			dm.dmPelsWidth = sm.pixel_width;
+			dm.dmPelsHeight = sm.pixel_height;
+			dm.dmDisplayFlags = sm.display_flags;
+			dm.dmDisplayFrequency = sm.display_frequency;
+			dm.dmDisplayOrientation = sm.display_orientation;
+			dm.dmPosition.x = sm.position_x;
+			dm.dmPosition.y = sm.position_y;
+
+			return dm;
+		}
+
+		//==================================================================
+		// read only view of a whole file, unmapped on destruction
+		//==================================================================
+		class MappedFile
+		{
+		public:
+			explicit MappedFile(const tstring& path)
+			{
+				file_ = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+				if (file_ == INVALID_HANDLE_VALUE)
+					return;
+
+				LARGE_INTEGER file_size = {};
+				if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0)
+					return;
+
+				mapping_ = CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+				if (mapping_ == NULL)
+					return;
+
+				view_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+				if (view_ != NULL)
+					size_ = static_cast<size_t>(file_size.QuadPart);
+			}
+
+			~MappedFile()
+			{
+				if (view_ != NULL)
+					UnmapViewOfFile(view_);
+				if (mapping_ != NULL)
+					CloseHandle(mapping_);
+				if (file_ != INVALID_HANDLE_VALUE)
+					CloseHandle(file_);
+			}
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			const unsigned char* data() const { return static_cast<const unsigned char*>(view_); }
+			size_t size() const { return size_; }
+
+		private:
+			HANDLE file_ = INVALID_HANDLE_VALUE;
+			HANDLE mapping_ = NULL;
+			LPVOID view_ = NULL;
+			size_t size_ = 0;
+		};
+
+		inline bool same_display_device(const DISPLAY_DEVICE& a, const DISPLAY_DEVICE& b)
+		{
+			return a.StateFlags == b.StateFlags &&
+				lstrcmp(a.DeviceName, b.DeviceName) == 0 &&
+				lstrcmp(a.DeviceID, b.DeviceID) == 0;
+		}
+
+		inline bool same_monitor_info(const MONITORINFOEX& a, const MONITORINFOEX& b)
+		{
+			return EqualRect(&a.rcMonitor, &b.rcMonitor) &&
+				EqualRect(&a.rcWork, &b.rcWork) &&
+				a.dwFlags == b.dwFlags &&
+				lstrcmp(a.szDevice, b.szDevice) == 0;
+		}
+	}
+
+	enum class SnapshotStatus
+	{
+		Loaded,
+		Missing,
+		Corrupt,
+		Stale
+	};
+
+	//==========================================================================
+	// fingerprint of adapters and attached monitors, changes when an adapter,
+	// driver or monitor is swapped. far cheaper than enumerating modes
+	//==========================================================================
+	inline uint64_t get_display_fingerprint()
+	{
+		uint64_t hash = detail::Fnv_Offset_Basis;
+
+		DISPLAY_DEVICE adapter;
+		adapter.cb = sizeof(adapter);
+		for (DWORD i = 0; detail::display_api.enum_display_devices(NULL, i, &adapter, 0); ++i)
+		{
+			hash = detail::fnv1a(adapter.DeviceID, sizeof(adapter.DeviceID), hash);
+			hash = detail::fnv1a(adapter.DeviceKey, sizeof(adapter.DeviceKey), hash);
+			hash = detail::fnv1a(adapter.DeviceString, sizeof(adapter.DeviceString), hash);
+			hash = detail::fnv1a(&adapter.StateFlags, sizeof(adapter.StateFlags), hash);
+
+			DISPLAY_DEVICE monitor;
+			monitor.cb = sizeof(monitor);
+			for (DWORD j = 0; detail::display_api.enum_display_devices(adapter.DeviceName, j, &monitor, 0); ++j)
+				hash = detail::fnv1a(monitor.DeviceID, sizeof(monitor.DeviceID), hash);
+		}
+
+		return hash;
+	}
+
+	//==========================================================================
+	// write topology to a versioned binary snapshot, the file is replaced
+	// atomically so readers never observe a partial snapshot
+	//==========================================================================
+	inline bool write_topology_snapshot(const tstring& path, uint64_t fingerprint, const Topology& topology)
+	{
+		detail::SnapshotHeader header;
+		header.fingerprint = fingerprint;
+		header.device_count = static_cast<uint32_t>(topology.devices.size());
+		header.monitor_count = static_cast<uint32_t>(topology.monitors.size());
+
+		std::vector<unsigned char> payload;
+		detail::append_bytes(payload, topology.devices.data(), topology.devices.size());
+		detail::append_bytes(payload, topology.monitors.data(), topology.monitors.size());
+
+		for (size_t i = 0; i < topology.monitors.size(); ++i)
+		{
+			detail::SnapshotMonitor sm{ topology.ids[i], topology.dpis[i], static_cast<uint32_t>(topology.modes[i].size()) };
+			detail::append_bytes(payload, &sm, 1);
+			header.mode_count += sm.mode_count;
+		}
+
+		for (const auto& monitor_modes : topology.modes)
+		{
+			for (const auto& dm : monitor_modes)
+			{
+				auto sm = detail::to_snapshot_mode(dm);
+				detail::append_bytes(payload, &sm, 1);
+			}
+		}
+
+		header.payload_size = payload.size();
+		header.payload_hash = detail::fnv1a(payload.data(), payload.size());
+
+		auto temp_path = path + TEXT(".tmp");
+		HANDLE file = CreateFile(temp_path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		DWORD written = 0;
+		bool ok = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header);
+		ok = ok && WriteFile(file, payload.data(), static_cast<DWORD>(payload.size()), &written, NULL) && written == payload.size();
+		CloseHandle(file);
+
+		if (ok && MoveFileEx(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+			return true;
+
+		DeleteFile(temp_path.c_str());
+		return false;
+	}
+
+	//==========================================================================
+	// a snapshot read in place from its mapped file. opening checks the
+	// header and hash but copies nothing, the accessors read the mapping
+	// and DEVMODEs are only built by mode() and to_topology(). spans stay
+	// valid as long as the view
+	//==========================================================================
+	class TopologySnapshotView
+	{
+	public:
+		//==================================================================
+		// rejects files that are truncated, fail the hash check or were
+		// written for other hardware
+		//==================================================================
+		SnapshotStatus open(const tstring& path, uint64_t fingerprint)
+		{
+			*this = {};
+			auto file = std::make_unique<detail::MappedFile>(path);
+			if (file->data() == nullptr)
+				return SnapshotStatus::Missing;
+
+			detail::SnapshotHeader header;
+			if (file->size() < sizeof(header))
+				return SnapshotStatus::Corrupt;
+
+			std::memcpy(&header, file->data(), sizeof(header));
+			if (header.magic != detail::Snapshot_Magic ||
+				header.display_device_size != sizeof(DISPLAY_DEVICE) ||
+				header.monitor_info_size != sizeof(MONITORINFOEX))
+				return SnapshotStatus::Corrupt;
+
+			// older format versions are treated like a hardware change and rebuilt
+			if (header.version != detail::Snapshot_Version || header.fingerprint != fingerprint)
+				return SnapshotStatus::Stale;
+
+			uint64_t expected_size = uint64_t(header.device_count) * sizeof(DISPLAY_DEVICE) +
+				uint64_t(header.monitor_count) * (sizeof(MONITORINFOEX) + sizeof(detail::SnapshotMonitor)) +
+				uint64_t(header.mode_count) * sizeof(detail::SnapshotMode);
+
+			auto payload = file->data() + sizeof(header);
+			if (header.payload_size != expected_size ||
+				header.payload_size != file->size() - sizeof(header) ||
+				header.payload_hash != detail::fnv1a(payload, static_cast<size_t>(header.payload_size)))
+				return SnapshotStatus::Corrupt;
+
+			// the mapping is page aligned and every record size keeps the next array aligned
+			devices_ = { reinterpret_cast<const DISPLAY_DEVICE*>(payload), header.device_count };
+			payload += devices_.size_bytes();
+			monitors_ = { reinterpret_cast<const MONITORINFOEX*>(payload), header.monitor_count };
+			payload += monitors_.size_bytes();
+			records_ = { reinterpret_cast<const detail::SnapshotMonitor*>(payload), header.monitor_count };
+			payload += records_.size_bytes();
+			modes_ = { reinterpret_cast<const detail::SnapshotMode*>(payload), header.mode_count };
+
+			uint64_t modes_left = header.mode_count;
+			for (const auto& record : records_)
+			{
+				if (record.mode_count > modes_left)
+				{
+					*this = {};
+					return SnapshotStatus::Corrupt;
+				}
+
+				modes_left -= record.mode_count;
+			}
+
+			if (modes_left != 0)
+			{
+				*this = {};
+				return SnapshotStatus::Corrupt;
+			}
+
+			file_ = std::move(file);
+			return SnapshotStatus::Loaded;
+		}
+
+		bool is_open() const { return file_ != nullptr; }
+
+		std::span<const DISPLAY_DEVICE> devices() const { return devices_; }
+		std::span<const MONITORINFOEX> monitors() const { return monitors_; }
+		DisplayId id(size_t monitor) const { return records_[monitor].id; }
+		UINT dpi(size_t monitor) const { return records_[monitor].dpi; }
+
+		// modes of one monitor as stored, a fraction of the size of DEVMODE
+		std::span<const detail::SnapshotMode> modes(size_t monitor) const
+		{
+			size_t first = 0;
+			for (size_t i = 0; i < monitor; ++i)
+				first += records_[i].mode_count;
+
+			return modes_.subspan(first, records_[monitor].mode_count);
+		}
+
+		DEVMODE mode(size_t monitor, size_t index) const
+		{
+			return detail::from_snapshot_mode(modes(monitor)[index], monitors_[monitor].szDevice);
+		}
+
+		// copies everything out, for callers that keep a Topology
+		Topology to_topology() const
+		{
+			Topology topology;
+			topology.devices.assign(devices_.begin(), devices_.end());
+			topology.monitors.assign(monitors_.begin(), monitors_.end());
+
+			size_t mode = 0;
+			for (size_t i = 0; i < records_.size(); ++i)
+			{
+				topology.ids.push_back(records_[i].id);
+				topology.dpis.push_back(records_[i].dpi);
+				topology.modes.emplace_back();
+				topology.modes.back().reserve(records_[i].mode_count);
+				for (uint32_t j = 0; j < records_[i].mode_count; ++j)
+					topology.modes.back().push_back(detail::from_snapshot_mode(modes_[mode++], monitors_[i].szDevice));
+			}
+
+			return topology;
+		}
+
+		// compared in place, nothing is decoded
+		bool matches(const Topology& topology) const
+		{
+			if (topology.devices.size() != devices_.size() || topology.monitors.size() != monitors_.size() ||
+				topology.ids.size() != records_.size() || topology.dpis.size() != records_.size() || topology.modes.size() != records_.size())
+				return false;
+
+			for (size_t i = 0; i < devices_.size(); ++i)
+			{
+				if (!detail::same_display_device(devices_[i], topology.devices[i]))
+					return false;
+			}
+
+			size_t mode = 0;
+			for (size_t i = 0; i < records_.size(); ++i)
+			{
+				if (!detail::same_monitor_info(monitors_[i], topology.monitors[i]) || records_[i].id != topology.ids[i] ||
+					records_[i].dpi != topology.dpis[i] || records_[i].mode_count != topology.modes[i].size())
+					return false;
+
+				for (const auto& dm : topology.modes[i])
+				{
+					auto sm = detail::to_snapshot_mode(dm);
+					if (std::memcmp(&sm, &modes_[mode++], sizeof(sm)) != 0)
+						return false;
+				}
+			}
+
+			return true;
+		}
+
+	private:
+		std::unique_ptr<detail::MappedFile> file_;
+		std::span<const DISPLAY_DEVICE> devices_;
+		std::span<const MONITORINFOEX> monitors_;
+		std::span<const detail::SnapshotMonitor> records_;
+		std::span<const detail::SnapshotMode> modes_;
+	};
+
+	// decode a snapshot into topology, see TopologySnapshotView::open
+	inline SnapshotStatus read_topology_snapshot(const tstring& path, uint64_t fingerprint, Topology& out_topology)
+	{
+		TopologySnapshotView view;
+		auto status = view.open(path, fingerprint);
+		if (status == SnapshotStatus::Loaded)
+			out_topology = view.to_topology();
+
+		return status;
+	}
+
+	//==========================================================================
+	// topology for startup, taken from snapshot when it matches the hardware.
+	// validation re-enumerates in the background and yields the fresh
+	// topology if the snapshot turned out to be out of date, nullopt if not.
+	// it compares against the mapped snapshot in place and enumerates in
+	// the dpi context of the thread that called load_topology_warm, so a
+	// per monitor aware caller is not validated with virtualized rects
+	//==========================================================================
+	struct WarmTopology
+	{
+		Topology topology;
+		SnapshotStatus status = SnapshotStatus::Missing;
+		std::future<std::optional<Topology>> validation;
+	};
+
+	inline WarmTopology load_topology_warm(const tstring& path)
+	{
+		WarmTopology warm;
+		auto fingerprint = get_display_fingerprint();
+		auto snapshot = std::make_shared<TopologySnapshotView>();
+		warm.status = snapshot->open(path, fingerprint);
+
+		if (warm.status != SnapshotStatus::Loaded)
+		{
+			warm.topology = get_topology();
+			write_topology_snapshot(path, fingerprint, warm.topology);
+			return warm;
+		}
+
+		warm.topology = snapshot->to_topology();
+		warm.validation = std::async(std::launch::async, [path, fingerprint, snapshot = std::move(snapshot), context = get_thread_dpi_context()]() mutable -> std::optional<Topology>
+		{
+			std::optional<ScopedDpiContext> scoped;
+			if (context != NULL)
+				scoped.emplace(context);
+
+			auto live = get_topology();
+			if (snapshot->matches(live))
+				return {};
+
+			// the open mapping would make replacing the file fail
+			snapshot.reset();
+			write_topology_snapshot(path, fingerprint, live);
+			return live;
+		});
+
+		return warm;
+	}
+}
+
+#endif
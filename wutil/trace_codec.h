@@ -0,0 +1,375 @@
+#ifndef WUTIL_TRACE_CODEC_INCLUDED
+#define WUTIL_TRACE_CODEC_INCLUDED
+
+// no windows dependencies, traces encode, decode and replay anywhere.
+// display_trace.h hooks the windows calls up to them
+
+#include "bytes.h"
+
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+
+namespace wutil
+{
+	enum class TraceCall : uint16_t
+	{
+		Enum_Display_Devices,
+		Enum_Display_Monitors,
+		Get_Monitor_Info,
+		Enum_Display_Settings_Ex,
+		Change_Display_Settings_Ex,
+		Monitor_From_Window,
+		Monitor_From_Rect,
+		Monitor_From_Point,
+		Get_Dpi_For_Window,
+		Get_Dpi_For_Monitor,
+		Get_Display_Config_Buffer_Sizes,
+		Query_Display_Config,
+		Display_Config_Get_Device_Info,
+		System_Parameters_Info,
+		System_Parameters_Info_For_Dpi,
+		Reg_Get_Value,
+		Count
+	};
+
+	namespace detail
+	{
+		static const uint32_t Trace_Magic = 0x54445557; // "WUDT"
+		static const uint32_t Trace_Version = 2;
+
+		struct TraceHeader
+		{
+			uint32_t magic = Trace_Magic;
+			uint32_t version = Trace_Version;
+			// a trace only replays in a build with the same struct layouts
+			uint64_t layout_hash = 0;
+			uint64_t record_count = 0;
+			uint64_t payload_size = 0;
+			uint64_t payload_hash = 0;
+		};
+
+		// followed by args_size bytes of arguments and out_size bytes of output
+		struct TraceRecord
+		{
+			uint16_t call;
+			uint16_t args_size;
+			uint32_t out_size;
+			int64_t result;
+			uint64_t duration_ns;
+		};
+
+		//=====================================================================
+		// arguments that identify a call, handles are stored by value since
+		// replay hands back the recorded handles
+		//=====================================================================
+		class TraceArgs
+		{
+		public:
+			template <typename T>
+			TraceArgs& add(const T& value)
+			{
+				static_assert(std::is_trivially_copyable_v<T>);
+				if (size_ + sizeof(T) <= sizeof(bytes_))
+				{
+					std::memcpy(bytes_ + size_, &value, sizeof(T));
+					size_ += sizeof(T);
+				}
+				return *this;
+			}
+
+			TraceArgs& add_handle(const void* handle)
+			{
+				return add(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle)));
+			}
+
+			template <typename Char>
+			TraceArgs& add_string(const Char* text)
+			{
+				if (text == nullptr)
+					return add(Char(0));
+
+				for (; *text != 0; ++text)
+					add(*text);
+				return add(Char(0));
+			}
+
+			const unsigned char* data() const { return bytes_; }
+			uint16_t size() const { return static_cast<uint16_t>(size_); }
+
+		private:
+			unsigned char bytes_[512];
+			size_t size_ = 0;
+		};
+
+		inline uint64_t trace_key(TraceCall call, const unsigned char* args, size_t args_size)
+		{
+			auto id = static_cast<uint16_t>(call);
+			return fnv1a(args, args_size, fnv1a(&id, sizeof(id)));
+		}
+
+		inline uint64_t trace_now_ns()
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+	}
+
+	//=========================================================================
+	// calls with their arguments, results, output and duration in the order
+	// they were made. layout_hash identifies the struct layouts of the build
+	// that recorded them
+	//=========================================================================
+	class TraceLog
+	{
+	public:
+		explicit TraceLog(uint64_t layout_hash = 0) : layout_hash_(layout_hash) {}
+
+		// start_ns from detail::trace_now_ns when the call began
+		void append(TraceCall call, const detail::TraceArgs& args, int64_t result, uint64_t start_ns, const void* out, size_t out_size)
+		{
+			detail::TraceRecord record;
+			record.call = static_cast<uint16_t>(call);
+			record.args_size = args.size();
+			record.out_size = static_cast<uint32_t>(out_size);
+			record.result = result;
+			record.duration_ns = detail::trace_now_ns() - start_ns;
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			detail::append_bytes(payload_, &record, 1);
+			detail::append_bytes(payload_, args.data(), args.size());
+			detail::append_bytes(payload_, static_cast<const unsigned char*>(out), out_size);
+			++record_count_;
+		}
+
+		size_t record_count() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return record_count_;
+		}
+
+		// header and payload as written to a trace file
+		std::vector<unsigned char> encode() const
+		{
+			detail::TraceHeader header;
+			header.layout_hash = layout_hash_;
+
+			std::vector<unsigned char> bytes;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				header.record_count = record_count_;
+				header.payload_size = payload_.size();
+				header.payload_hash = detail::fnv1a(payload_.data(), payload_.size());
+				bytes.reserve(sizeof(header) + payload_.size());
+				detail::append_bytes(bytes, &header, 1);
+				bytes.insert(bytes.end(), payload_.begin(), payload_.end());
+			}
+
+			return bytes;
+		}
+
+		// written through a temporary file so a reader never sees half a trace
+		bool save(const std::filesystem::path& path) const
+		{
+			auto bytes = encode();
+			auto temp_path = path;
+			temp_path += ".tmp";
+
+			{
+				std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+				file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+				if (!file.good())
+					return false;
+			}
+
+			std::error_code error;
+			std::filesystem::rename(temp_path, path, error);
+			if (!error)
+				return true;
+
+			std::filesystem::remove(temp_path, error);
+			return false;
+		}
+
+	private:
+		uint64_t layout_hash_ = 0;
+
+		mutable std::mutex mutex_;
+		std::vector<unsigned char> payload_;
+		size_t record_count_ = 0;
+	};
+
+	//=========================================================================
+	// answers calls from a recorded trace. calls are matched by arguments,
+	// a call made several times with the same arguments gets the recorded
+	// results in order and then repeats the last one
+	//=========================================================================
+	class TraceReplay
+	{
+	public:
+		struct Entry
+		{
+			int64_t result = 0;
+			uint64_t duration_ns = 0;
+			std::vector<unsigned char> out;
+		};
+
+		TraceReplay()
+		{
+			std::fill(std::begin(first_of_call_), std::end(first_of_call_), SIZE_MAX);
+		}
+
+		TraceReplay(const TraceReplay&) = delete;
+		TraceReplay& operator=(const TraceReplay&) = delete;
+
+		// false if missing, corrupt or recorded by a build with other layouts
+		bool load(const std::filesystem::path& path, uint64_t layout_hash)
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file)
+				return false;
+
+			std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			return decode(bytes.data(), bytes.size(), layout_hash);
+		}
+
+		bool decode(const unsigned char* data, size_t size, uint64_t layout_hash)
+		{
+			detail::TraceHeader header;
+			if (data == nullptr || size < sizeof(header))
+				return false;
+
+			std::memcpy(&header, data, sizeof(header));
+			auto payload = data + sizeof(header);
+			if (header.magic != detail::Trace_Magic || header.version != detail::Trace_Version ||
+				header.layout_hash != layout_hash || header.payload_size != size - sizeof(header) ||
+				header.payload_hash != detail::fnv1a(payload, static_cast<size_t>(header.payload_size)))
+				return false;
+
+			std::vector<Entry> entries;
+			std::unordered_map<uint64_t, Sequence> sequences;
+			size_t first_of_call[static_cast<size_t>(TraceCall::Count)];
+			std::fill(std::begin(first_of_call), std::end(first_of_call), SIZE_MAX);
+
+			size_t offset = 0;
+			for (uint64_t i = 0; i < header.record_count; ++i)
+			{
+				detail::TraceRecord record;
+				if (header.payload_size - offset < sizeof(record))
+					return false;
+
+				std::memcpy(&record, payload + offset, sizeof(record));
+				offset += sizeof(record);
+				if (record.call >= static_cast<uint16_t>(TraceCall::Count) || header.payload_size - offset < uint64_t(record.args_size) + record.out_size)
+					return false;
+
+				auto key = detail::trace_key(static_cast<TraceCall>(record.call), payload + offset, record.args_size);
+				offset += record.args_size;
+
+				Entry entry;
+				entry.result = record.result;
+				entry.duration_ns = record.duration_ns;
+				entry.out.assign(payload + offset, payload + offset + record.out_size);
+				offset += record.out_size;
+
+				sequences[key].entries.push_back(entries.size());
+				if (first_of_call[record.call] == SIZE_MAX)
+					first_of_call[record.call] = entries.size();
+				entries.push_back(std::move(entry));
+			}
+
+			if (offset != header.payload_size)
+				return false;
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			entries_ = std::move(entries);
+			sequences_ = std::move(sequences);
+			std::copy(std::begin(first_of_call), std::end(first_of_call), first_of_call_);
+			misses_ = 0;
+			return true;
+		}
+
+		//==================================================================
+		// null if the call is not in the trace. with fall_back such a call
+		// gets the first recorded result of the same function instead, for
+		// arguments like window handles that differ between runs, and it
+		// still counts as a miss since the answer is a guess
+		//==================================================================
+		const Entry* lookup(TraceCall call, const detail::TraceArgs& args, bool fall_back)
+		{
+			const Entry* entry = nullptr;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				auto it = sequences_.find(detail::trace_key(call, args.data(), args.size()));
+				if (it != sequences_.end())
+				{
+					auto& sequence = it->second;
+					entry = &entries_[sequence.entries[(std::min)(sequence.next, sequence.entries.size() - 1)]];
+					if (sequence.next < sequence.entries.size())
+						++sequence.next;
+				}
+				else
+				{
+					++misses_;
+					if (fall_back && first_of_call_[static_cast<size_t>(call)] != SIZE_MAX)
+						entry = &entries_[first_of_call_[static_cast<size_t>(call)]];
+				}
+			}
+
+			// with replay timings each call takes as long as it did when recorded, for benchmarks
+			if (entry != nullptr && replay_timings_)
+			{
+				auto until = detail::trace_now_ns() + entry->duration_ns;
+				while (detail::trace_now_ns() < until)
+					;
+			}
+
+			return entry;
+		}
+
+		void set_replay_timings(bool replay_timings) { replay_timings_ = replay_timings; }
+
+		// restart every call sequence from its first recorded result, misses keep counting until the next decode
+		void rewind()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (auto& sequence : sequences_)
+				sequence.second.next = 0;
+		}
+
+		size_t record_count() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return entries_.size();
+		}
+
+		size_t misses() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return misses_;
+		}
+
+	private:
+		struct Sequence
+		{
+			std::vector<size_t> entries;
+			size_t next = 0;
+		};
+
+		bool replay_timings_ = false;
+
+		mutable std::mutex mutex_;
+		std::vector<Entry> entries_;
+		std::unordered_map<uint64_t, Sequence> sequences_;
+		size_t first_of_call_[static_cast<size_t>(TraceCall::Count)];
+		size_t misses_ = 0;
+	};
+}
+
+#endif
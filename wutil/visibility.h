@@ -0,0 +1,331 @@
+#ifndef WUTIL_VISIBILITY_INCLUDED
+#define WUTIL_VISIBILITY_INCLUDED
+
+#include "wutil.h"
+
+#include <dwmapi.h>
+
+#include <atomic>
+#include <cstring>
+
+namespace wutil
+{
+	enum class RenderBudget : uint8_t
+	{
+		Full,
+		Reduced,
+		Paused
+	};
+
+	// GUID_CONSOLE_DISPLAY_STATE values
+	enum class DisplayPower
+	{
+		Off = 0,
+		On = 1,
+		Dimmed = 2
+	};
+
+	struct VisibilityState
+	{
+		bool visible = true;
+		bool minimized = false;
+		// false once MonitorFromWindow finds no monitor, e.g. disconnected
+		bool on_monitor = true;
+		DisplayPower power = DisplayPower::On;
+		// share of the window on its monitor not covered by windows above it
+		int visible_percent = 100;
+	};
+
+	//=========================================================================
+	// budget for a window state, reduced_below is the visible percentage
+	// under which a partly covered window renders at reduced rate
+	//=========================================================================
+	inline RenderBudget render_budget(const VisibilityState& state, int reduced_below = 25)
+	{
+		if (!state.visible || state.minimized || !state.on_monitor || state.power == DisplayPower::Off || state.visible_percent <= 0)
+			return RenderBudget::Paused;
+
+		if (state.power == DisplayPower::Dimmed || state.visible_percent < reduced_below)
+			return RenderBudget::Reduced;
+
+		return RenderBudget::Full;
+	}
+
+	namespace detail
+	{
+		typedef HRESULT(WINAPI * DwmGetWindowAttributeProc)(HWND, DWORD, PVOID, DWORD);
+
+		// loaded on first use so dwmapi need not be linked, null where dwm is missing
+		inline DwmGetWindowAttributeProc dwm_get_window_attribute()
+		{
+			static const DwmGetWindowAttributeProc proc = []()
+			{
+				HMODULE dwmapi = LoadLibrary(TEXT("Dwmapi"));
+				return dwmapi != NULL ? reinterpret_cast<DwmGetWindowAttributeProc>(GetProcAddress(dwmapi, "DwmGetWindowAttribute")) : nullptr;
+			}();
+
+			return proc;
+		}
+
+		//=====================================================================
+		// coarse occlusion over the window queries of a backend: subtracts
+		// the rects of visible windows above hwnd in z order from its rect
+		// clipped to the monitor. layered windows count as opaque. cloaked
+		// windows, e.g. on another virtual desktop or suspended store apps,
+		// are visible to IsWindowVisible but not on screen, they cover
+		// nothing and a cloaked hwnd is not visible at all
+		//=====================================================================
+		template <typename Windows>
+		int visible_percent(const Windows& windows, HWND hwnd, const RECT& monitor_rect)
+		{
+			RECT rect;
+			if (windows.is_cloaked(hwnd) || !windows.window_rect(hwnd, rect) || !IntersectRect(&rect, &rect, &monitor_rect))
+				return 0;
+
+			auto total = static_cast<int64_t>(rect.right - rect.left) * (rect.bottom - rect.top);
+			HRGN visible = CreateRectRgnIndirect(&rect);
+			int complexity = SIMPLEREGION;
+			for (HWND above = windows.above(hwnd); above != NULL && complexity != NULLREGION; above = windows.above(above))
+			{
+				RECT above_rect;
+				if (!windows.is_visible(above) || windows.is_minimized(above) || windows.is_cloaked(above) || !windows.window_rect(above, above_rect))
+					continue;
+
+				HRGN covered = CreateRectRgnIndirect(&above_rect);
+				complexity = CombineRgn(visible, visible, covered, RGN_DIFF);
+				DeleteObject(covered);
+			}
+
+			int64_t area = 0;
+			if (complexity != NULLREGION)
+			{
+				std::vector<char> buffer(GetRegionData(visible, 0, NULL));
+				auto data = reinterpret_cast<RGNDATA*>(buffer.data());
+				if (!buffer.empty() && GetRegionData(visible, static_cast<DWORD>(buffer.size()), data))
+				{
+					auto rects = reinterpret_cast<const RECT*>(data->Buffer);
+					for (DWORD i = 0; i < data->rdh.nCount; ++i)
+						area += static_cast<int64_t>(rects[i].right - rects[i].left) * (rects[i].bottom - rects[i].top);
+				}
+			}
+			DeleteObject(visible);
+
+			return total == 0 ? 0 : static_cast<int>(area * 100 / total);
+		}
+	}
+
+	//=========================================================================
+	// win32 queries made by VisibilityTracker, tests can substitute a
+	// backend scripting window and monitor states with the same members
+	//=========================================================================
+	struct Win32VisibilityBackend
+	{
+		bool is_visible(HWND hwnd) const { return IsWindowVisible(hwnd) != FALSE; }
+		bool is_minimized(HWND hwnd) const { return IsIconic(hwnd) != FALSE; }
+		HMONITOR monitor(HWND hwnd) const { return detail::display_api.monitor_from_window(hwnd, MONITOR_DEFAULTTONULL); }
+
+		bool is_cloaked(HWND hwnd) const
+		{
+			auto get_attribute = detail::dwm_get_window_attribute();
+			DWORD cloaked = 0;
+			return get_attribute != nullptr && SUCCEEDED(get_attribute(hwnd, DWMWA_CLOAKED, &cloaked, sizeof(cloaked))) && cloaked != 0;
+		}
+
+		bool window_rect(HWND hwnd, RECT& rect) const { return GetWindowRect(hwnd, &rect) != FALSE; }
+
+		// next window above hwnd in z order, NULL at the top
+		HWND above(HWND hwnd) const { return GetWindow(hwnd, GW_HWNDPREV); }
+
+		int visible_percent(HWND hwnd, HMONITOR hmonitor) const
+		{
+			MONITORINFO mi;
+			mi.cbSize = sizeof(mi);
+			if (!detail::display_api.get_monitor_info(hmonitor, &mi))
+				return 0;
+
+			return detail::visible_percent(*this, hwnd, mi.rcMonitor);
+		}
+	};
+
+	//=========================================================================
+	// tracks placement, monitor, display power and occlusion of windows and
+	// publishes a render budget per window. budgets live in fixed slots, a
+	// render thread keeps its slot index and reads with budget() which is a
+	// single atomic load. everything else belongs to the ui thread.
+	// covering windows of other processes send no message, call update()
+	// on a timer to pick those up
+	//=========================================================================
+	template <typename Backend = Win32VisibilityBackend>
+	class BasicVisibilityTracker
+	{
+	public:
+		static const size_t No_Slot = SIZE_MAX;
+
+		explicit BasicVisibilityTracker(size_t capacity = 32, Backend backend = Backend())
+			: slots_(new Slot[capacity]), capacity_(capacity), backend_(backend)
+		{
+		}
+
+		~BasicVisibilityTracker()
+		{
+			if (power_notify_ != NULL)
+				UnregisterPowerSettingNotification(power_notify_);
+		}
+
+		BasicVisibilityTracker(const BasicVisibilityTracker&) = delete;
+		BasicVisibilityTracker& operator=(const BasicVisibilityTracker&) = delete;
+
+		// receive display power changes as WM_POWERBROADCAST on hwnd
+		bool register_power_notifications(HWND hwnd)
+		{
+			if (power_notify_ == NULL)
+				power_notify_ = RegisterPowerSettingNotification(hwnd, &GUID_CONSOLE_DISPLAY_STATE, DEVICE_NOTIFY_WINDOW_HANDLE);
+
+			return power_notify_ != NULL;
+		}
+
+		// returns the slot for hwnd or No_Slot when full
+		size_t add(HWND hwnd)
+		{
+			auto existing = find(hwnd);
+			if (existing != No_Slot)
+				return existing;
+
+			for (size_t i = 0; i < capacity_; ++i)
+			{
+				if (slots_[i].hwnd == NULL)
+				{
+					slots_[i].hwnd = hwnd;
+					evaluate(slots_[i]);
+					return i;
+				}
+			}
+
+			return No_Slot;
+		}
+
+		void remove(HWND hwnd)
+		{
+			auto slot = find(hwnd);
+			if (slot == No_Slot)
+				return;
+
+			slots_[slot].hwnd = NULL;
+			slots_[slot].budget.store(RenderBudget::Full, std::memory_order_release);
+		}
+
+		size_t find(HWND hwnd) const
+		{
+			for (size_t i = 0; i < capacity_; ++i)
+			{
+				if (slots_[i].hwnd == hwnd && hwnd != NULL)
+					return i;
+			}
+
+			return No_Slot;
+		}
+
+		// any thread, no system calls
+		RenderBudget budget(size_t slot) const
+		{
+			if (slot >= capacity_)
+				return RenderBudget::Full;
+
+			return slots_[slot].budget.load(std::memory_order_acquire);
+		}
+
+		const VisibilityState& state(size_t slot) const { return slots_[slot].state; }
+
+		// re-evaluate every tracked window
+		void update()
+		{
+			for (size_t i = 0; i < capacity_; ++i)
+			{
+				if (slots_[i].hwnd != NULL)
+					evaluate(slots_[i]);
+			}
+		}
+
+		void set_display_power(DisplayPower power)
+		{
+			power_ = power;
+			update();
+		}
+
+		DisplayPower display_power() const { return power_; }
+
+		void set_reduced_below(int percent) { reduced_below_ = percent; }
+
+		//==================================================================
+		// forward window messages, returns true when budgets were
+		// re-evaluated. a move or resize of one window can cover another
+		// so every tracked window is re-evaluated
+		//==================================================================
+		bool handle_message(UINT msg, WPARAM wparam, LPARAM lparam)
+		{
+			switch (msg)
+			{
+			case WM_SIZE:
+			case WM_WINDOWPOSCHANGED:
+			case WM_DISPLAYCHANGE:
+				update();
+				return true;
+			case WM_POWERBROADCAST:
+			{
+				if (wparam != PBT_POWERSETTINGCHANGE)
+					return false;
+
+				auto setting = reinterpret_cast<const POWERBROADCAST_SETTING*>(lparam);
+				if (setting == nullptr || !IsEqualGUID(setting->PowerSetting, GUID_CONSOLE_DISPLAY_STATE) || setting->DataLength < sizeof(DWORD))
+					return false;
+
+				DWORD value;
+				std::memcpy(&value, setting->Data, sizeof(value));
+				set_display_power(static_cast<DisplayPower>(value));
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+
+	private:
+		// own cache line so render threads polling budgets never share a written line
+		struct alignas(64) Slot
+		{
+			HWND hwnd = NULL;
+			VisibilityState state;
+			std::atomic<RenderBudget> budget{ RenderBudget::Full };
+		};
+
+		void evaluate(Slot& slot)
+		{
+			VisibilityState state;
+			state.power = power_;
+			state.visible = backend_.is_visible(slot.hwnd);
+			state.minimized = backend_.is_minimized(slot.hwnd);
+
+			auto hmonitor = backend_.monitor(slot.hwnd);
+			state.on_monitor = hmonitor != NULL;
+
+			// occlusion is the expensive query, skip it when already paused
+			state.visible_percent = 0;
+			if (state.visible && !state.minimized && state.on_monitor && state.power != DisplayPower::Off)
+				state.visible_percent = backend_.visible_percent(slot.hwnd, hmonitor);
+
+			slot.state = state;
+			slot.budget.store(render_budget(state, reduced_below_), std::memory_order_release);
+		}
+
+		std::unique_ptr<Slot[]> slots_;
+		size_t capacity_ = 0;
+		Backend backend_;
+		DisplayPower power_ = DisplayPower::On;
+		int reduced_below_ = 25;
+		HPOWERNOTIFY power_notify_ = NULL;
+	};
+
+	using VisibilityTracker = BasicVisibilityTracker<>;
+}
+
+#endif
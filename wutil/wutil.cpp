@@ -0,0 +1,13 @@
+//=============================================================================
+// the compiled library. build with WUTIL_LIB defined, and define it for
+// every translation unit using the library as well
+//=============================================================================
+
+#ifndef WUTIL_LIB
+#error "wutil.cpp is only built as part of the static library, define WUTIL_LIB"
+#endif
+
+#include "wutil.h"
+#include "wutil_impl.h"
+#include "win_utils.h"
+#include "win_utils_impl.h"
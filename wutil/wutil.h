@@ -2,6 +2,9 @@
 #define WUTIL_INCLUDED
 
 #include <optional>
+#include <cstdint>
+
+#include "bytes.h"
 
 #if defined(WIN32) || defined(_WIN32) || defined(_WIN64)
 #define OS_WIN
@@ -36,6 +39,10 @@ typedef enum DPI_AWARENESS {
 
 #endif
 
+#ifndef DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2
+#define DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2 ((DPI_AWARENESS_CONTEXT)-4)
+#endif
+
 #ifndef WM_DPICHANGED
 #define WM_DPICHANGED  0x02E0
 #endif
@@ -74,7 +81,29 @@ typedef enum MONITOR_DPI_TYPE {
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+#ifdef WUTIL_TRACK_ALLOCATIONS
+#include "alloc_tracker.h"
+#elif !defined(WUTIL_ALLOC_SCOPE)
+#define WUTIL_ALLOC_SCOPE(api)
+#endif
+
+// WUTIL_LIB links the compiled library and leaves only declarations here,
+// otherwise every function is inline and the library is header only
+#ifndef WUTIL_API
+#ifdef WUTIL_LIB
+#define WUTIL_API
+#else
+#define WUTIL_API inline
+#endif
+#endif
 
 namespace wutil
 {
@@ -85,23 +114,58 @@ namespace wutil
 		typedef BOOL(WINAPI * EnableNonClientDpiScalingProc)(HWND);
 		typedef UINT(WINAPI * GetDpiForWindowProc)(HWND);
 		typedef BOOL(WINAPI * AreDpiAwarenessContextsEqualProc)(DPI_AWARENESS_CONTEXT, DPI_AWARENESS_CONTEXT);
+		typedef DPI_AWARENESS(WINAPI * GetAwarenessFromDpiAwarenessContextProc)(DPI_AWARENESS_CONTEXT);
 		typedef BOOL(WINAPI * SystemParametersInfoForDpiProc)(UINT, UINT, PVOID, UINT, UINT);
+		typedef int(WINAPI * GetSystemMetricsForDpiProc)(int, UINT);
+
+		// Windows 7
+		typedef LONG(WINAPI * GetDisplayConfigBufferSizesProc)(UINT32, UINT32*, UINT32*);
+		typedef LONG(WINAPI * QueryDisplayConfigProc)(UINT32, UINT32*, DISPLAYCONFIG_PATH_INFO*, UINT32*, DISPLAYCONFIG_MODE_INFO*, DISPLAYCONFIG_TOPOLOGY_ID*);
+		typedef LONG(WINAPI * DisplayConfigGetDeviceInfoProc)(DISPLAYCONFIG_DEVICE_INFO_HEADER*);
 
 		typedef HRESULT(WINAPI * SetProcessDpiAwarenessProc)(PROCESS_DPI_AWARENESS);
 		typedef HRESULT(WINAPI * GetProcessDpiAwarenessProc)(HANDLE, PROCESS_DPI_AWARENESS*);
 		typedef HRESULT(WINAPI * GetDpiForMonitorProc)(HMONITOR, MONITOR_DPI_TYPE, UINT*, UINT*);
 
 		// functions dependent on windows version may not be available
-		static SetThreadDpiAwarenessContextProc set_thread_dpi_awareness_context;
-		static GetThreadDpiAwarenessContextProc get_thread_dpi_awareness_context;
-		static EnableNonClientDpiScalingProc enable_nonclient_dpi_scaling;
-		static GetDpiForWindowProc get_dpi_for_window;
-		static AreDpiAwarenessContextsEqualProc are_dpi_awareness_contexts_equal;
-		static SystemParametersInfoForDpiProc system_parameters_info_for_dpi;
-
-		static SetProcessDpiAwarenessProc set_process_dpi_awareness;
-		static GetProcessDpiAwarenessProc get_process_dpi_awareness;
-		static GetDpiForMonitorProc get_dpi_for_monitor;
+		inline SetThreadDpiAwarenessContextProc set_thread_dpi_awareness_context;
+		inline GetThreadDpiAwarenessContextProc get_thread_dpi_awareness_context;
+		inline EnableNonClientDpiScalingProc enable_nonclient_dpi_scaling;
+		inline GetDpiForWindowProc get_dpi_for_window;
+		inline AreDpiAwarenessContextsEqualProc are_dpi_awareness_contexts_equal;
+		inline GetAwarenessFromDpiAwarenessContextProc get_awareness_from_dpi_awareness_context;
+		inline GetSystemMetricsForDpiProc get_system_metrics_for_dpi;
+
+		inline SetProcessDpiAwarenessProc set_process_dpi_awareness;
+		inline GetProcessDpiAwarenessProc get_process_dpi_awareness;
+		inline GetDpiForMonitorProc get_dpi_for_monitor;
+
+		//=====================================================================
+		// display queries and changes made by this library, swapped out by
+		// display_trace.h to record calls or replay a recorded trace
+		//=====================================================================
+		struct DisplayApi
+		{
+			BOOL(WINAPI* enum_display_devices)(LPCTSTR, DWORD, DISPLAY_DEVICE*, DWORD) = EnumDisplayDevices;
+			BOOL(WINAPI* enum_display_monitors)(HDC, LPCRECT, MONITORENUMPROC, LPARAM) = EnumDisplayMonitors;
+			BOOL(WINAPI* get_monitor_info)(HMONITOR, LPMONITORINFO) = GetMonitorInfo;
+			BOOL(WINAPI* enum_display_settings_ex)(LPCTSTR, DWORD, DEVMODE*, DWORD) = EnumDisplaySettingsEx;
+			LONG(WINAPI* change_display_settings_ex)(LPCTSTR, DEVMODE*, HWND, DWORD, LPVOID) = ChangeDisplaySettingsEx;
+			HMONITOR(WINAPI* monitor_from_window)(HWND, DWORD) = MonitorFromWindow;
+			HMONITOR(WINAPI* monitor_from_rect)(LPCRECT, DWORD) = MonitorFromRect;
+			HMONITOR(WINAPI* monitor_from_point)(POINT, DWORD) = MonitorFromPoint;
+			BOOL(WINAPI* system_parameters_info)(UINT, UINT, PVOID, UINT) = SystemParametersInfo;
+			// adapter driver values under the video keys of DISPLAY_DEVICE::DeviceKey
+			LONG(WINAPI* reg_get_value)(HKEY, LPCTSTR, LPCTSTR, DWORD, LPDWORD, PVOID, LPDWORD) = RegGetValue;
+
+			// loaded with the user32 symbols, null where windows lacks them
+			SystemParametersInfoForDpiProc system_parameters_info_for_dpi = nullptr;
+			GetDisplayConfigBufferSizesProc get_display_config_buffer_sizes = nullptr;
+			QueryDisplayConfigProc query_display_config = nullptr;
+			DisplayConfigGetDeviceInfoProc display_config_get_device_info = nullptr;
+		};
+
+		inline DisplayApi display_api;
 
 		static const int Default_DPI = 96;
 
@@ -109,75 +173,80 @@ namespace wutil
 		static const int SYMBOLS_LOADED_AND_FOUND = 1;
 		static const int SYMBOLS_LOADED_AND_NOT_FOUND = 2;
 
+		//=====================================================================
+		// thread dpi context as last seen by this library. GetThreadDpiAwarenessContext
+		// reads the thread without entering the kernel and returns the same
+		// handle for the same context, so every use compares it against
+		// thread_context and a change made outside this library is noticed
+		//=====================================================================
+		struct ThreadDpiCache
+		{
+			// handle returned by GetThreadDpiAwarenessContext, nullptr if not yet known
+			DPI_AWARENESS_CONTEXT thread_context = nullptr;
+			// awareness of thread_context
+			DPI_AWARENESS awareness = DPI_AWARENESS_INVALID;
+			// context last passed to SetThreadDpiAwarenessContext, which left thread_context behind
+			DPI_AWARENESS_CONTEXT requested_context = nullptr;
+		};
+
+		inline thread_local ThreadDpiCache thread_dpi_cache;
+
 		//=========================================================================
 		// dynamically load dpi functions to support older windows versions
 		//===========================================================================
-		int load_shcore_symbols()
-		{
-			static int symbol_status = SYMBOLS_NOT_LOADED;
+		WUTIL_API int load_shcore_symbols();
+		WUTIL_API int load_user32_symbols();
 
-			if (symbol_status > SYMBOLS_NOT_LOADED)
-				return symbol_status;
-
-			HMODULE shcore = LoadLibrary(TEXT("Shcore"));
-			set_process_dpi_awareness = reinterpret_cast<detail::SetProcessDpiAwarenessProc>(GetProcAddress(shcore, "SetProcessDpiAwareness"));
-			get_process_dpi_awareness = reinterpret_cast<detail::GetProcessDpiAwarenessProc>(GetProcAddress(shcore, "GetProcessDpiAwareness"));
-			get_dpi_for_monitor = reinterpret_cast<detail::GetDpiForMonitorProc>(GetProcAddress(shcore, "GetDpiForMonitor"));
+		//===========================================================================
+		// thread dpi context helpers, user32 symbols must be loaded
+		//===========================================================================
+		WUTIL_API DPI_AWARENESS current_thread_dpi_awareness();
+		WUTIL_API bool set_thread_dpi_context(DPI_AWARENESS_CONTEXT context);
+	}
 
-			if (set_process_dpi_awareness)
-				symbol_status = SYMBOLS_LOADED_AND_FOUND;
-			else
-				symbol_status = SYMBOLS_LOADED_AND_NOT_FOUND;
+	using tstring = std::basic_string<TCHAR>;
+	using tstring_view = std::basic_string_view<TCHAR>;
+	using tstringstream = std::basic_stringstream<TCHAR>;
 
-			return symbol_status;
-		}
+	// stable across reboots and DISPLAYn reshuffles, derived from device interface paths
+	using DisplayId = uint64_t;
 
-		int load_user32_symbols()
+	namespace detail
+	{
+		//=====================================================================
+		// null terminated copy of a device name on the stack, for passing
+		// string views to win32
+		//=====================================================================
+		class DeviceNameBuffer
 		{
-			static int symbol_status = SYMBOLS_NOT_LOADED;
-
-			if (symbol_status > SYMBOLS_NOT_LOADED)
-				return symbol_status;
-
-			HMODULE user32 = LoadLibrary(TEXT("User32"));
-			set_thread_dpi_awareness_context = reinterpret_cast<detail::SetThreadDpiAwarenessContextProc>(GetProcAddress(user32, "SetThreadDpiAwarenessContext"));
-			get_thread_dpi_awareness_context = reinterpret_cast<detail::GetThreadDpiAwarenessContextProc>(GetProcAddress(user32, "GetThreadDpiAwarenessContext"));
-			enable_nonclient_dpi_scaling = reinterpret_cast<detail::EnableNonClientDpiScalingProc>(GetProcAddress(user32, "EnableNonClientDpiScaling"));
-			get_dpi_for_window = reinterpret_cast<detail::GetDpiForWindowProc>(GetProcAddress(user32, "GetDpiForWindow"));
-			are_dpi_awareness_contexts_equal = reinterpret_cast<detail::AreDpiAwarenessContextsEqualProc>(GetProcAddress(user32, "AreDpiAwarenessContextsEqual"));
-			system_parameters_info_for_dpi = reinterpret_cast<detail::SystemParametersInfoForDpiProc>(GetProcAddress(user32, "SystemParametersInfoForDpi"));
-
-			if (set_thread_dpi_awareness_context)
-				symbol_status = SYMBOLS_LOADED_AND_FOUND;
-			else
-				symbol_status = SYMBOLS_LOADED_AND_NOT_FOUND;
-
-			return symbol_status;
-		}
+		public:
+			DeviceNameBuffer()
+			{
+				name_[0] = 0;
+			}
 
-		//======================================================
-		// win32 callback functions
-		//======================================================
-		BOOL CALLBACK monitor_info_enum_proc(HMONITOR hmonitor, HDC hdc_monitor, LPRECT lprc_monitor, LPARAM dw_data)
-		{
-			auto monitor_vec = reinterpret_cast<std::vector<MONITORINFOEX>*>(dw_data);
-			if (monitor_vec == nullptr)
-				return false;
+			explicit DeviceNameBuffer(tstring_view name)
+			{
+				auto length = (std::min)(name.size(), static_cast<size_t>(CCHDEVICENAME - 1));
+				name.copy(name_, length);
+				name_[length] = 0;
+			}
 
-			MONITORINFOEX mi{};
-			mi.cbSize = sizeof(mi);
-			GetMonitorInfo(hmonitor, &mi);
-			monitor_vec->push_back(mi);
+			const TCHAR* c_str() const { return name_; }
 
-			if (mi.dwFlags & MONITORINFOF_PRIMARY)
-				std::swap(monitor_vec->back(), monitor_vec->front());
+		private:
+			TCHAR name_[CCHDEVICENAME];
+		};
 
-			return true;
-		}
+		// hashes characters rather than bytes so ansi and unicode builds agree
+		WUTIL_API DisplayId make_display_id(tstring_view name, uint64_t hash = Fnv_Offset_Basis);
 	}
-	
-	using tstring = std::basic_string<TCHAR>;
-	using tstringstream = std::basic_stringstream<TCHAR>;
+
+	//==========================================================================
+	// return stable id of the first monitor attached to a gdi device name,
+	// hashed from its device interface path
+	//==========================================================================
+	WUTIL_API DisplayId get_monitor_id(tstring_view device_name);
 
 	struct WindowInfo
 	{
@@ -187,421 +256,417 @@ namespace wutil
 		LONG ex_style = 0;
 	};
 
-	//=============================================================================
-	// return container of all display devices, first item will be primary device
-	//=============================================================================
-	std::vector<DISPLAY_DEVICE> get_all_display_devices()
+	//=========================================================================
+	// set thread dpi awareness context for the lifetime of the object,
+	// previous context is restored on destruction
+	//=========================================================================
+	class ScopedDpiContext
 	{
-		std::vector<DISPLAY_DEVICE> ddevs;
+	public:
+		explicit ScopedDpiContext(DPI_AWARENESS_CONTEXT context);
+		~ScopedDpiContext();
 
-		DISPLAY_DEVICE d;
-		d.cb = sizeof(d);
+		ScopedDpiContext(const ScopedDpiContext&) = delete;
+		ScopedDpiContext& operator=(const ScopedDpiContext&) = delete;
 
-		int device_num = 0;
-		while (EnumDisplayDevices(NULL, device_num, &d, 0))
-		{
-			ddevs.push_back(d);
-			++device_num;
+		// false if thread dpi contexts are unsupported or context was rejected
+		bool applied() const { return applied_; }
 
-			if (d.StateFlags & DISPLAY_DEVICE_PRIMARY_DEVICE)
-				std::swap(ddevs.back(), ddevs.front());
-		}
+	private:
+		DPI_AWARENESS_CONTEXT previous_context_ = NULL;
+		bool applied_ = false;
+	};
 
-		return ddevs;
-	}
+	//==========================================================================
+	// forget the cached thread dpi context. changes made without going
+	// through this library are noticed anyway, this only forces a requery
+	//==========================================================================
+	WUTIL_API void invalidate_dpi_context_cache();
 
 	//==========================================================================
-	// return container of all monitor info, first item will be primary monitor
+	// dpi context of the calling thread, NULL where thread contexts are not
+	// supported. hand it to ScopedDpiContext on a worker thread so the
+	// worker measures monitors the way the caller does
 	//==========================================================================
-	std::vector<MONITORINFOEX> get_all_monitor_info()
-	{
-		std::vector<MONITORINFOEX> info_vec;
-		EnumDisplayMonitors(NULL, NULL, detail::monitor_info_enum_proc, reinterpret_cast<LPARAM>(&info_vec));
+	WUTIL_API DPI_AWARENESS_CONTEXT get_thread_dpi_context();
 
-		return info_vec;
-	}
+	//=============================================================================
+	// return container of all display devices, first item will be primary device
+	//=============================================================================
+	// fills the caller's vector, a reused vector makes repeated calls allocation free
+	WUTIL_API void get_all_display_devices(std::vector<DISPLAY_DEVICE>& ddevs);
+	WUTIL_API std::vector<DISPLAY_DEVICE> get_all_display_devices();
+
+	//==========================================================================
+	// return container of all monitor info, first item will be primary monitor
+	//==========================================================================
+	// fills the caller's vector, a reused vector makes repeated calls allocation free
+	WUTIL_API void get_all_monitor_info(std::vector<MONITORINFOEX>& info_vec);
+	WUTIL_API std::vector<MONITORINFOEX> get_all_monitor_info();
 
 	//=============================================================
 	// return monitor info for given device name
 	//=============================================================
-	std::optional<MONITORINFOEX> get_monitor_info(const tstring& device_name)
-	{
-		std::vector<MONITORINFOEX> info_vec;
-		EnumDisplayMonitors(NULL, NULL, detail::monitor_info_enum_proc, reinterpret_cast<LPARAM>(&info_vec));
-
-		for (const auto& mi : info_vec)
-		{
-			if (device_name.compare(mi.szDevice) == 0)
-				return mi;
-		}
-
-		return {};
-	}
+	WUTIL_API std::optional<MONITORINFOEX> get_monitor_info(tstring_view device_name);
 
 	//==========================================================
 	// return container of all display settings for monitor,
 	// first item will be current display settings
 	//===========================================================
-	std::vector<DEVMODE> get_monitor_display_settings(const tstring& device_name)
+	// fills the caller's vector, a reused vector makes repeated calls allocation free
+	WUTIL_API void get_monitor_display_settings(tstring_view device_name, std::vector<DEVMODE>& disp_vec);
+	WUTIL_API std::vector<DEVMODE> get_monitor_display_settings(tstring_view device_name);
+
+	namespace detail
 	{
-		DEVMODE dm;
-		dm.dmSize = sizeof(dm);
-		dm.dmDriverExtra = 0;
+		struct Win32ModeEnumerator
+		{
+			BOOL operator()(const TCHAR* device_name, DWORD index, DEVMODE* dm, DWORD flags) const;
+		};
 
-		std::vector<DEVMODE> disp_vec;
-		int i = 0;
-		while (EnumDisplaySettingsEx(device_name.c_str(), i, &dm, 0))
+		// predicate of a range over every mode
+		struct AnyDisplayMode
 		{
-			disp_vec.push_back(dm);
-			++i;
-		}
+			bool operator()(const DEVMODE&) const { return true; }
+		};
+	}
 
-		EnumDisplaySettingsEx(device_name.c_str(), ENUM_CURRENT_SETTINGS, &dm, 0);
-		for (int i = 0; i < disp_vec.size(); ++i)
+	//==========================================================================
+	// input range over the modes of a monitor in driver order, flags as for
+	// EnumDisplaySettingsEx, only those matching predicate. a mode is
+	// fetched when first dereferenced or compared against end, so stopping
+	// early costs no further driver calls. iterators own the enumeration,
+	// each begin starts over and the range is borrowed, so an iterator
+	// returned by std::ranges::find_if(display_modes(name), is_144hz) stays
+	// valid. std::views::filter looks for the next match as soon as it is
+	// incremented, filter | take(n) enumerates past the n-th match. pass the
+	// predicate to the range instead, it skips modes only when the next one
+	// is needed
+	//==========================================================================
+	template <typename Enumerator = detail::Win32ModeEnumerator, typename Predicate = detail::AnyDisplayMode>
+	class BasicDisplayModeRange : public std::ranges::view_interface<BasicDisplayModeRange<Enumerator, Predicate>>
+	{
+	public:
+		class iterator
 		{
-			// orientation and position appear to only be set for ENUM_CURRENT_SETTINGS
-			if (disp_vec[i].dmBitsPerPel == dm.dmBitsPerPel &&
-				disp_vec[i].dmPelsWidth == dm.dmPelsWidth &&
-				disp_vec[i].dmPelsHeight == dm.dmPelsHeight &&
-				disp_vec[i].dmDisplayFlags == dm.dmDisplayFlags &&
-				//disp_vec[i].dmDisplayOrientation == dm.dmDisplayOrientation && 
-				//disp_vec[i].dmPosition.x == dm.dmPosition.x &&
-				//disp_vec[i].dmPosition.y == dm.dmPosition.y &&
-				disp_vec[i].dmDisplayFrequency == dm.dmDisplayFrequency)
+		public:
+			using value_type = DEVMODE;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+
+			explicit iterator(const BasicDisplayModeRange& range)
+				: name_(range.name_), flags_(range.flags_), enumerator_(range.enumerator_), predicate_(range.predicate_)
+			{
+				dm_.dmSize = sizeof(dm_);
+				dm_.dmDriverExtra = 0;
+			}
+
+			const DEVMODE& operator*() const
 			{
-				std::swap(disp_vec[i], disp_vec[0]);
-				break;
+				fetch();
+				return dm_;
 			}
 
+			const DEVMODE* operator->() const { return &**this; }
+
+			// past the current match, which is only looked for when needed
+			iterator& operator++()
+			{
+				if (fetched_)
+				{
+					++index_;
+					fetched_ = false;
+				}
+				else
+				{
+					++skip_;
+				}
+
+				return *this;
+			}
+
+			void operator++(int) { ++*this; }
+
+			friend bool operator==(const iterator& it, std::default_sentinel_t)
+			{
+				return !it.fetch();
+			}
+
+			// driver calls made by this iterator so far
+			DWORD calls() const { return calls_; }
+
+		private:
+			// false once the driver runs out of modes
+			bool fetch() const
+			{
+				while (!fetched_ && !done_)
+				{
+					++calls_;
+					dm_.dmSize = sizeof(dm_);
+					dm_.dmDriverExtra = 0;
+					if (!enumerator_(name_.c_str(), index_, &dm_, flags_))
+					{
+						done_ = true;
+						break;
+					}
+
+					if (predicate_(std::as_const(dm_)))
+					{
+						if (skip_ == 0)
+						{
+							fetched_ = true;
+							break;
+						}
+
+						--skip_;
+					}
+
+					++index_;
+				}
+
+				return !done_;
+			}
+
+			detail::DeviceNameBuffer name_;
+			DWORD flags_ = 0;
+			Enumerator enumerator_;
+			Predicate predicate_;
+			mutable DEVMODE dm_ = {};
+			mutable DWORD index_ = 0;
+			// matches to pass over before the next fetch stops
+			mutable DWORD skip_ = 0;
+			mutable DWORD calls_ = 0;
+			mutable bool fetched_ = false;
+			mutable bool done_ = false;
+		};
+
+		BasicDisplayModeRange(tstring_view device_name, DWORD flags = 0, Enumerator enumerator = Enumerator(), Predicate predicate = Predicate())
+			: name_(device_name), flags_(flags), enumerator_(enumerator), predicate_(predicate)
+		{
 		}
 
-		return disp_vec;
+		iterator begin() const { return iterator(*this); }
+		std::default_sentinel_t end() const { return std::default_sentinel; }
+
+	private:
+		detail::DeviceNameBuffer name_;
+		DWORD flags_ = 0;
+		Enumerator enumerator_;
+		Predicate predicate_;
+	};
+
+	using DisplayModeRange = BasicDisplayModeRange<>;
+
+	//==========================================================================
+	// lazy modes of a monitor, e.g. the first 144hz mode without enumerating
+	// the rest: std::ranges::find_if(display_modes(name), is_144hz), or the
+	// first two: display_modes(name, 0, is_144hz) | std::views::take(2)
+	//==========================================================================
+	WUTIL_API DisplayModeRange display_modes(tstring_view device_name, DWORD flags = 0);
+
+	template <typename Predicate>
+	BasicDisplayModeRange<detail::Win32ModeEnumerator, Predicate> display_modes(tstring_view device_name, DWORD flags, Predicate predicate)
+	{
+		return BasicDisplayModeRange<detail::Win32ModeEnumerator, Predicate>(device_name, flags, detail::Win32ModeEnumerator(), predicate);
 	}
 
 	//================================================================
 	// set window as fullscreen, change to monitor dimensions
 	//================================================================
-	std::optional<WindowInfo> set_window_fullscreen(HWND hwnd, const MONITORINFOEX& mi)
-	{
-		WindowInfo saved_window_info;
-		saved_window_info.style = GetWindowLong(hwnd, GWL_STYLE);
-		saved_window_info.ex_style = GetWindowLong(hwnd, GWL_EXSTYLE);
-		GetWindowPlacement(hwnd, &saved_window_info.placement);
-		GetWindowRect(hwnd, &saved_window_info.rect);
-
-		WINDOWPLACEMENT fullscreen_placement = saved_window_info.placement;
-		fullscreen_placement.showCmd = SW_SHOWNORMAL;
-		fullscreen_placement.rcNormalPosition = { mi.rcMonitor.left,
-			mi.rcMonitor.top,
-			mi.rcMonitor.right - mi.rcMonitor.left,
-			mi.rcMonitor.bottom - mi.rcMonitor.top };
-
-		LONG res = 0;
-		res += SetWindowLong(hwnd, GWL_STYLE, saved_window_info.style & ~(WS_CAPTION | WS_THICKFRAME));
-		res += SetWindowLong(hwnd, GWL_EXSTYLE, saved_window_info.ex_style & ~(WS_EX_DLGMODALFRAME |
-			WS_EX_WINDOWEDGE | WS_EX_CLIENTEDGE | WS_EX_STATICEDGE));
-		res += SetWindowPlacement(hwnd, &fullscreen_placement);
-
-		if (res == 0)
-			return {};
-		else
-			return saved_window_info;
-	}
+	WUTIL_API std::optional<WindowInfo> set_window_fullscreen(HWND hwnd, const MONITORINFOEX& mi);
 
 	//===================================================================
 	// set window as fullscreen, change to nearest monitor dimensions
 	//===================================================================
-	std::optional<WindowInfo> set_window_fullscreen(HWND hwnd)
-	{
-		WindowInfo saved_window_info;
-		saved_window_info.style = GetWindowLong(hwnd, GWL_STYLE);
-		saved_window_info.ex_style = GetWindowLong(hwnd, GWL_EXSTYLE);
-		GetWindowPlacement(hwnd, &saved_window_info.placement);
-		GetWindowRect(hwnd, &saved_window_info.rect);
-
-		MONITORINFOEX mi;
-		mi.cbSize = sizeof(mi);
-		auto hmonitor = MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST);
-		if (GetMonitorInfo(hmonitor, &mi) == 0)
-			return {};
-
-		WINDOWPLACEMENT fullscreen_placement = saved_window_info.placement;
-		fullscreen_placement.showCmd = SW_SHOWNORMAL;
-		fullscreen_placement.rcNormalPosition = { mi.rcMonitor.left,
-			mi.rcMonitor.top,
-			mi.rcMonitor.right - mi.rcMonitor.left,
-			mi.rcMonitor.bottom - mi.rcMonitor.top };
-
-		LONG res = 0;
-		res += SetWindowLong(hwnd, GWL_STYLE, saved_window_info.style & ~(WS_CAPTION | WS_THICKFRAME));
-		res += SetWindowLong(hwnd, GWL_EXSTYLE, saved_window_info.ex_style & ~(WS_EX_DLGMODALFRAME |
-			WS_EX_WINDOWEDGE | WS_EX_CLIENTEDGE | WS_EX_STATICEDGE));
-		res += SetWindowPlacement(hwnd, &fullscreen_placement);
-
-		if (res == 0)
-			return {};
-		else
-			return saved_window_info;
-	}
+	WUTIL_API std::optional<WindowInfo> set_window_fullscreen(HWND hwnd);
 
 	//====================================================
 	// set window to given settings
 	//======================================================
-	bool set_window_to(HWND hwnd, const WindowInfo& wi)
-	{
-		LONG res = 0;
-		res += SetWindowLong(hwnd, GWL_STYLE, wi.style);
-		res += SetWindowLong(hwnd, GWL_EXSTYLE, wi.ex_style);
-		res += SetWindowPlacement(hwnd, &wi.placement);
-
-		if (res == 0)
-			return false;
-		else
-			return true;
-	}
+	WUTIL_API bool set_window_to(HWND hwnd, const WindowInfo& wi);
 
 	//====================================================================
 	// change display settings, enable fullscreen flag
 	//====================================================================
-	std::optional<MONITORINFOEX> changes_display_settings_fullscreen(const tstring& device_name, DEVMODE& dev_mode)
-	{
-		auto res = ChangeDisplaySettingsEx(device_name.c_str(), &dev_mode, NULL, CDS_FULLSCREEN, NULL);
-		if (res == DISP_CHANGE_SUCCESSFUL)
-			return get_monitor_info(device_name);
-		else
-			return {};
-	}
+	WUTIL_API std::optional<MONITORINFOEX> changes_display_settings_fullscreen(tstring_view device_name, DEVMODE& dev_mode);
 
 	//=====================================================
 	// reset display settings to previously saved
 	//======================================================
-	bool reset_display_settings_fullscreen(const tstring& device_name)
-	{
-		auto res = ChangeDisplaySettingsEx(device_name.c_str(), NULL, NULL, 0, NULL);
-		if (res == DISP_CHANGE_SUCCESSFUL)
-			return true;
-		else
-			return false;
-	}
+	WUTIL_API bool reset_display_settings_fullscreen(tstring_view device_name);
 
 	//============================================
-	// get dpi from window
+	// get dpi from window, point or monitor
 	//===========================================
-	UINT get_dpi(HWND hwnd)
-	{
-		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			return detail::get_dpi_for_window(hwnd);
-		}
-		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto hmonitor = MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST);
-			UINT dpi_x = 0, dpi_y = 0;
-			auto hr = detail::get_dpi_for_monitor(hmonitor, MDT_EFFECTIVE_DPI, &dpi_x, &dpi_y);
-			if (hr == S_OK)
-				return dpi_x;
-			else
-				return detail::Default_DPI;
-		}
-		else
-			return detail::Default_DPI;
-	}
+	WUTIL_API UINT get_dpi(HWND hwnd);
+	WUTIL_API UINT get_dpi(const POINT& point);
+	WUTIL_API UINT get_dpi(HMONITOR hmonitor);
 
-	//======================================
-	// get dpi from point
-	//=======================================
-	UINT get_dpi(const POINT& point)
+	//==========================================================================
+	// exact refresh and scanline timing of the signal driving a monitor
+	//==========================================================================
+	struct RefreshTiming
 	{
-		if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto hmonitor = MonitorFromPoint(point, MONITOR_DEFAULTTONEAREST);
-			UINT dpi_x = 0, dpi_y = 0;
-			auto hr = detail::get_dpi_for_monitor(hmonitor, MDT_EFFECTIVE_DPI, &dpi_x, &dpi_y);
-			if (hr == S_OK)
-				return dpi_x;
-			else
-				return detail::Default_DPI;
-		}
-		else
-			return detail::Default_DPI;
-	}
+		DISPLAYCONFIG_RATIONAL vsync_frequency = {};
+		DISPLAYCONFIG_RATIONAL hsync_frequency = {};
+		UINT64 pixel_rate = 0;
+		DISPLAYCONFIG_2DREGION active_size = {};
+		DISPLAYCONFIG_2DREGION total_size = {};
+		DISPLAYCONFIG_SCANLINE_ORDERING scanline_ordering = DISPLAYCONFIG_SCANLINE_ORDERING_UNSPECIFIED;
+		UINT64 vsync_interval_ns = 0;
+		UINT64 scanline_interval_ns = 0;
+
+		double refresh_hz() const;
+		UINT32 vblank_lines() const;
+	};
 
-	//===============================================
-	// enable per monitor awareness
-	//================================================
-	bool enable_per_monitor_dpi_aware()
+	namespace detail
 	{
-		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto previous_context_ = detail::set_thread_dpi_awareness_context(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE);
-			auto current_context = detail::get_thread_dpi_awareness_context();
+		// period of a rational frequency in nanoseconds, rounded to nearest
+		WUTIL_API UINT64 period_ns(const DISPLAYCONFIG_RATIONAL& frequency);
 
-			if (detail::are_dpi_awareness_contexts_equal(current_context, DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE))
-				return true;
-			else
-				return false;
+		// display config reports gdi names in utf-16 regardless of the character set
+		WUTIL_API bool equal_device_name(const WCHAR* wide_name, const TCHAR* name);
 
-		}
-		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto result = detail::set_process_dpi_awareness(PROCESS_PER_MONITOR_DPI_AWARE);
-
-			PROCESS_DPI_AWARENESS current_awareness;
-			detail::get_process_dpi_awareness(NULL, &current_awareness);
+		WUTIL_API RefreshTiming make_refresh_timing(const DISPLAYCONFIG_PATH_INFO& path, const std::vector<DISPLAYCONFIG_MODE_INFO>& modes);
 
-			if (current_awareness == PROCESS_PER_MONITOR_DPI_AWARE)
-				return true;
-			else
-				return false;
-		}
-		else
-		{
-			return false;
-		}
+		//======================================================================
+		// query active display paths, retried while the topology changes
+		// between sizing the buffers and filling them
+		//======================================================================
+		WUTIL_API bool query_active_display_paths(std::vector<DISPLAYCONFIG_PATH_INFO>& paths, std::vector<DISPLAYCONFIG_MODE_INFO>& modes);
 	}
 
-	//================================================
-	// enable system awareness
-	//===============================================
-	bool enable_system_dpi_aware()
-	{
-		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto previous_context_ = detail::set_thread_dpi_awareness_context(DPI_AWARENESS_CONTEXT_SYSTEM_AWARE);
-			auto current_context = detail::get_thread_dpi_awareness_context();
-
-			if (detail::are_dpi_awareness_contexts_equal(current_context, DPI_AWARENESS_CONTEXT_SYSTEM_AWARE))
-				return true;
-			else
-				return false;
-
-		}
-		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto result = detail::set_process_dpi_awareness(PROCESS_SYSTEM_DPI_AWARE);
-
-			PROCESS_DPI_AWARENESS current_awareness;
-			detail::get_process_dpi_awareness(NULL, &current_awareness);
+	//==========================================================================
+	// return refresh timing for every monitor, indexed like
+	// get_all_monitor_info
+	//==========================================================================
+	WUTIL_API std::vector<std::optional<RefreshTiming>> get_all_refresh_timing(const std::vector<MONITORINFOEX>& monitors);
 
-			if (current_awareness == PROCESS_SYSTEM_DPI_AWARE)
-				return true;
-			else
-				return false;
-		}
-		else
-		{
-			return false;
-		}
-	}
+	//==========================================================================
+	// return exact refresh timing of the signal driving monitor, empty if
+	// display config is unavailable or monitor has no active path
+	//==========================================================================
+	WUTIL_API std::optional<RefreshTiming> get_refresh_timing(const MONITORINFOEX& mi);
 
-	//===========================================
-	// enable unaware
-	//==========================================
-	bool enable_dpi_unaware()
+	//==========================================================================
+	// display devices, monitors and their dpi and display modes in one place,
+	// ids, dpis and modes are indexed like monitors
+	//==========================================================================
+	struct Topology
 	{
-		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto previous_context_ = detail::set_thread_dpi_awareness_context(DPI_AWARENESS_CONTEXT_UNAWARE);
-			auto current_context = detail::get_thread_dpi_awareness_context();
-
-			if (detail::are_dpi_awareness_contexts_equal(current_context, DPI_AWARENESS_CONTEXT_UNAWARE))
-				return true;
-			else
-				return false;
-
-		}
-		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto result = detail::set_process_dpi_awareness(PROCESS_DPI_UNAWARE);
+		std::vector<DISPLAY_DEVICE> devices;
+		std::vector<MONITORINFOEX> monitors;
+		std::vector<DisplayId> ids;
+		std::vector<UINT> dpis;
+		std::vector<std::vector<DEVMODE>> modes;
+	};
 
-			PROCESS_DPI_AWARENESS current_awareness;
-			detail::get_process_dpi_awareness(NULL, &current_awareness);
+	//==========================================================================
+	// enumerate full topology, first monitor will be primary monitor
+	//==========================================================================
+	WUTIL_API Topology get_topology();
 
-			if (current_awareness == PROCESS_DPI_UNAWARE)
-				return true;
-			else
-				return false;
-		}
-		else
-		{
-			return false;
-		}
-	}
+	//===============================================
+	// enable per monitor, system or no awareness
+	//================================================
+	WUTIL_API bool enable_per_monitor_dpi_aware();
+	WUTIL_API bool enable_system_dpi_aware();
+	WUTIL_API bool enable_dpi_unaware();
 
 	//===================================================
-	// is dpi awareness enabled
+	// enable automatic non client area scaling, call
+	// from WM_NCCREATE of a per monitor aware window
 	//===================================================
-	bool is_dpi_aware()
-	{
-		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			auto current_context = detail::get_thread_dpi_awareness_context();
-			if (detail::are_dpi_awareness_contexts_equal(current_context, DPI_AWARENESS_CONTEXT_UNAWARE))
-				return false;
-			else
-				return true;
-
-		}
-		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
-		{
-			PROCESS_DPI_AWARENESS current_awareness;
-			detail::get_process_dpi_awareness(NULL, &current_awareness);
+	WUTIL_API bool enable_non_client_dpi_scaling(HWND hwnd);
 
-			if (current_awareness == PROCESS_DPI_UNAWARE)
-				return false;
-			else
-				return true;
-		}
-		else
-		{
-			return false;
-		}
-	}
+	//===================================================
+	// query dpi awareness
+	//===================================================
+	WUTIL_API bool is_dpi_aware();
+	WUTIL_API bool is_per_monitor_dpi_aware();
+	WUTIL_API bool is_system_dpi_aware();
+	WUTIL_API bool is_dpi_unaware();
 
 	//==================================================
 	// dpi scaling helper functions
 	//==================================================
-	int scale_value(int value, UINT dpi)
+	WUTIL_API int scale_value(int value, UINT dpi);
+	WUTIL_API RECT scale_rect(const RECT& rect, UINT dpi);
+	WUTIL_API POINT scale_point(const POINT& point, UINT dpi);
+	WUTIL_API HFONT scale_font(const HFONT hfont, UINT dpi);
+
+	namespace detail
 	{
-		auto dpi_scale_ = MulDiv(dpi, 100, detail::Default_DPI);
-		return MulDiv(value, dpi_scale_, 100);
+		//=====================================================================
+		// system metrics that GetSystemMetricsForDpi scales with dpi
+		//=====================================================================
+		WUTIL_API bool is_dpi_scaled_metric(int index);
+
+		WUTIL_API void scale_log_font(LOGFONT& log_font, UINT dpi, UINT base_dpi);
+
+		//=====================================================================
+		// SystemParametersInfoForDpi only exists as W and fills the W
+		// structs, these copy its output into the TCHAR ones. the sizes in
+		// to are kept
+		//=====================================================================
+		WUTIL_API void copy_log_font(const LOGFONTW& from, LOGFONT& to);
+		WUTIL_API void copy_non_client_metrics(const NONCLIENTMETRICSW& from, NONCLIENTMETRICS& to);
+		WUTIL_API void copy_icon_metrics(const ICONMETRICSW& from, ICONMETRICS& to);
 	}
 
-	RECT scale_rect(const RECT& rect, UINT dpi)
+	//===========================================================================
+	// per dpi cache of non client metrics, icon metrics, icon title font and
+	// system metrics. entries are filled once per dpi and dropped on
+	// WM_SETTINGCHANGE, references returned stay valid until then
+	//===========================================================================
+	class SystemMetricsCache
 	{
-		auto dpi_scale_ = MulDiv(dpi, 100, detail::Default_DPI);
+	public:
+		const NONCLIENTMETRICS& non_client_metrics(UINT dpi) { return entry_for(dpi).non_client; }
+		const ICONMETRICS& icon_metrics(UINT dpi) { return entry_for(dpi).icon; }
+		const LOGFONT& icon_title_font(UINT dpi) { return entry_for(dpi).icon_title_font; }
 
-		auto scaled_rect = rect;
-		scaled_rect.bottom = MulDiv(scaled_rect.bottom, dpi_scale_, 100);
-		scaled_rect.top = MulDiv(scaled_rect.top, dpi_scale_, 100);
-		scaled_rect.left = MulDiv(scaled_rect.left, dpi_scale_, 100);
-		scaled_rect.right = MulDiv(scaled_rect.right, dpi_scale_, 100);
+		int system_metric(int index, UINT dpi);
 
-		return scaled_rect;
-	}
+		// returns true if the message invalidated the cache
+		bool handle_message(UINT message);
 
-	POINT scale_point(const POINT& point, UINT dpi)
-	{
-		auto dpi_scale_ = MulDiv(dpi, 100, detail::Default_DPI);
+		void invalidate();
 
-		auto scaled_point = point;
-		scaled_point.x = MulDiv(scaled_point.x, dpi_scale_, 100);
-		scaled_point.y = MulDiv(scaled_point.y, dpi_scale_, 100);
+		size_t hits() const { return hits_; }
+		size_t misses() const { return misses_; }
+		double hit_rate() const;
 
-		return scaled_point;
-	}
+	private:
+		struct Entry
+		{
+			UINT dpi = 0;
+			NONCLIENTMETRICS non_client = {};
+			ICONMETRICS icon = {};
+			LOGFONT icon_title_font = {};
+			int system_metrics[SM_CMETRICS] = {};
+		};
 
-	HFONT scale_font(const HFONT hfont, UINT dpi)
-	{
-		LOGFONT log_font;
-		GetObject(hfont, sizeof(log_font), &log_font);
+		Entry& entry_for(UINT dpi);
 
-		log_font.lfHeight = -1 * scale_value(abs(log_font.lfHeight), dpi);
-		auto scaled_font = CreateFontIndirect(&log_font);
+		// older systems only report metrics for the system dpi, scale from there
+		static void fill_scaled(Entry& entry, UINT dpi);
 
-		return scaled_font;
-	}
-	
+		std::vector<std::unique_ptr<Entry>> entries_;
+		size_t hits_ = 0;
+		size_t misses_ = 0;
+	};
 }
 
-#endif
\ No newline at end of file
+// iterators own the enumeration, they outlive the range they came from
+template <typename Enumerator, typename Predicate>
+inline constexpr bool std::ranges::enable_borrowed_range<wutil::BasicDisplayModeRange<Enumerator, Predicate>> = true;
+
+// header only unless linking the static library
+#ifndef WUTIL_LIB
+#include "wutil_impl.h"
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+//=============================================================================
+// c++20 module interface of the compiled library. importing wutil instead of
+// including wutil.h parses Windows.h once, when the module is built, rather
+// than in every translation unit. macros such as the DPI_AWARENESS_CONTEXT
+// values do not cross module boundaries, include Windows.h for those
+//=============================================================================
+
+module;
+
+#include "wutil.h"
+
+export module wutil;
+
+// win32 types in the api, exported under their A/W names where the sdk maps them
+export using ::RECT;
+export using ::POINT;
+export using ::HWND;
+export using ::HMONITOR;
+export using ::HFONT;
+export using ::UINT;
+export using ::DWORD;
+export using ::LONG;
+export using ::TCHAR;
+export using ::DPI_AWARENESS_CONTEXT;
+export using ::DEVMODE;
+export using ::DISPLAY_DEVICE;
+export using ::MONITORINFOEX;
+export using ::WINDOWPLACEMENT;
+export using ::LOGFONT;
+export using ::NONCLIENTMETRICS;
+export using ::ICONMETRICS;
+export using ::DISPLAYCONFIG_RATIONAL;
+
+export namespace wutil
+{
+	using wutil::tstring;
+	using wutil::tstring_view;
+	using wutil::tstringstream;
+	using wutil::DisplayId;
+	using wutil::WindowInfo;
+	using wutil::ScopedDpiContext;
+	using wutil::RefreshTiming;
+	using wutil::Topology;
+	using wutil::SystemMetricsCache;
+	using wutil::BasicDisplayModeRange;
+	using wutil::DisplayModeRange;
+
+	using wutil::get_monitor_id;
+	using wutil::invalidate_dpi_context_cache;
+	using wutil::get_thread_dpi_context;
+	using wutil::get_all_display_devices;
+	using wutil::get_all_monitor_info;
+	using wutil::get_monitor_info;
+	using wutil::get_monitor_display_settings;
+	using wutil::display_modes;
+	using wutil::set_window_fullscreen;
+	using wutil::set_window_to;
+	using wutil::changes_display_settings_fullscreen;
+	using wutil::reset_display_settings_fullscreen;
+	using wutil::get_dpi;
+	using wutil::get_all_refresh_timing;
+	using wutil::get_refresh_timing;
+	using wutil::get_topology;
+	using wutil::enable_per_monitor_dpi_aware;
+	using wutil::enable_system_dpi_aware;
+	using wutil::enable_dpi_unaware;
+	using wutil::enable_non_client_dpi_scaling;
+	using wutil::is_dpi_aware;
+	using wutil::is_per_monitor_dpi_aware;
+	using wutil::is_system_dpi_aware;
+	using wutil::is_dpi_unaware;
+	using wutil::scale_value;
+	using wutil::scale_rect;
+	using wutil::scale_point;
+	using wutil::scale_font;
+}
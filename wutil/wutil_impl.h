@@ -0,0 +1,1019 @@
+#ifndef WUTIL_IMPL_INCLUDED
+#define WUTIL_IMPL_INCLUDED
+
+//=============================================================================
+// definitions of everything declared in wutil.h. included by wutil.h for
+// header only use, or compiled once into the static library by wutil.cpp
+// when WUTIL_LIB is defined
+//=============================================================================
+
+#include "wutil.h"
+
+namespace wutil
+{
+	namespace detail
+	{
+		WUTIL_API int load_shcore_symbols()
+		{
+			static int symbol_status = SYMBOLS_NOT_LOADED;
+
+			if (symbol_status > SYMBOLS_NOT_LOADED)
+				return symbol_status;
+
+			HMODULE shcore = LoadLibrary(TEXT("Shcore"));
+			set_process_dpi_awareness = reinterpret_cast<detail::SetProcessDpiAwarenessProc>(GetProcAddress(shcore, "SetProcessDpiAwareness"));
+			get_process_dpi_awareness = reinterpret_cast<detail::GetProcessDpiAwarenessProc>(GetProcAddress(shcore, "GetProcessDpiAwareness"));
+			get_dpi_for_monitor = reinterpret_cast<detail::GetDpiForMonitorProc>(GetProcAddress(shcore, "GetDpiForMonitor"));
+
+			if (set_process_dpi_awareness)
+				symbol_status = SYMBOLS_LOADED_AND_FOUND;
+			else
+				symbol_status = SYMBOLS_LOADED_AND_NOT_FOUND;
+
+			return symbol_status;
+		}
+
+		WUTIL_API int load_user32_symbols()
+		{
+			static int symbol_status = SYMBOLS_NOT_LOADED;
+
+			if (symbol_status > SYMBOLS_NOT_LOADED)
+				return symbol_status;
+
+			HMODULE user32 = LoadLibrary(TEXT("User32"));
+			set_thread_dpi_awareness_context = reinterpret_cast<detail::SetThreadDpiAwarenessContextProc>(GetProcAddress(user32, "SetThreadDpiAwarenessContext"));
+			get_thread_dpi_awareness_context = reinterpret_cast<detail::GetThreadDpiAwarenessContextProc>(GetProcAddress(user32, "GetThreadDpiAwarenessContext"));
+			enable_nonclient_dpi_scaling = reinterpret_cast<detail::EnableNonClientDpiScalingProc>(GetProcAddress(user32, "EnableNonClientDpiScaling"));
+			get_dpi_for_window = reinterpret_cast<detail::GetDpiForWindowProc>(GetProcAddress(user32, "GetDpiForWindow"));
+			are_dpi_awareness_contexts_equal = reinterpret_cast<detail::AreDpiAwarenessContextsEqualProc>(GetProcAddress(user32, "AreDpiAwarenessContextsEqual"));
+			get_awareness_from_dpi_awareness_context = reinterpret_cast<detail::GetAwarenessFromDpiAwarenessContextProc>(GetProcAddress(user32, "GetAwarenessFromDpiAwarenessContext"));
+			display_api.system_parameters_info_for_dpi = reinterpret_cast<detail::SystemParametersInfoForDpiProc>(GetProcAddress(user32, "SystemParametersInfoForDpi"));
+			get_system_metrics_for_dpi = reinterpret_cast<detail::GetSystemMetricsForDpiProc>(GetProcAddress(user32, "GetSystemMetricsForDpi"));
+			display_api.get_display_config_buffer_sizes = reinterpret_cast<detail::GetDisplayConfigBufferSizesProc>(GetProcAddress(user32, "GetDisplayConfigBufferSizes"));
+			display_api.query_display_config = reinterpret_cast<detail::QueryDisplayConfigProc>(GetProcAddress(user32, "QueryDisplayConfig"));
+			display_api.display_config_get_device_info = reinterpret_cast<detail::DisplayConfigGetDeviceInfoProc>(GetProcAddress(user32, "DisplayConfigGetDeviceInfo"));
+
+			if (set_thread_dpi_awareness_context)
+				symbol_status = SYMBOLS_LOADED_AND_FOUND;
+			else
+				symbol_status = SYMBOLS_LOADED_AND_NOT_FOUND;
+
+			return symbol_status;
+		}
+
+		WUTIL_API DPI_AWARENESS current_thread_dpi_awareness()
+		{
+			auto& cache = thread_dpi_cache;
+			auto thread_context = get_thread_dpi_awareness_context();
+			if (thread_context == cache.thread_context)
+				return cache.awareness;
+
+			// per monitor v2 and any future per monitor context report per monitor awareness
+			cache.thread_context = thread_context;
+			cache.awareness = get_awareness_from_dpi_awareness_context(thread_context);
+			cache.requested_context = nullptr;
+			return cache.awareness;
+		}
+
+		WUTIL_API bool set_thread_dpi_context(DPI_AWARENESS_CONTEXT context)
+		{
+			auto& cache = thread_dpi_cache;
+			if (context == cache.requested_context && get_thread_dpi_awareness_context() == cache.thread_context)
+				return true;
+
+			// returns null and leaves the thread untouched if context is invalid
+			if (set_thread_dpi_awareness_context(context) == NULL)
+				return false;
+
+			cache.thread_context = get_thread_dpi_awareness_context();
+			cache.awareness = get_awareness_from_dpi_awareness_context(cache.thread_context);
+			cache.requested_context = context;
+			return true;
+		}
+
+		WUTIL_API BOOL CALLBACK monitor_info_enum_proc(HMONITOR hmonitor, HDC hdc_monitor, LPRECT lprc_monitor, LPARAM dw_data)
+		{
+			auto monitor_vec = reinterpret_cast<std::vector<MONITORINFOEX>*>(dw_data);
+			if (monitor_vec == nullptr)
+				return false;
+
+			MONITORINFOEX mi{};
+			mi.cbSize = sizeof(mi);
+			detail::display_api.get_monitor_info(hmonitor, &mi);
+			monitor_vec->push_back(mi);
+
+			if (mi.dwFlags & MONITORINFOF_PRIMARY)
+				std::swap(monitor_vec->back(), monitor_vec->front());
+
+			return true;
+		}
+
+		struct MonitorSearch
+		{
+			const TCHAR* device_name;
+			MONITORINFOEX* out_info;
+			bool found;
+		};
+
+		// stops enumeration at the first monitor named device_name
+		WUTIL_API BOOL CALLBACK monitor_search_enum_proc(HMONITOR hmonitor, HDC hdc_monitor, LPRECT lprc_monitor, LPARAM dw_data)
+		{
+			auto search = reinterpret_cast<MonitorSearch*>(dw_data);
+			if (search == nullptr)
+				return false;
+
+			search->out_info->cbSize = sizeof(MONITORINFOEX);
+			if (!detail::display_api.get_monitor_info(hmonitor, search->out_info) || lstrcmp(search->out_info->szDevice, search->device_name) != 0)
+				return true;
+
+			search->found = true;
+			return false;
+		}
+
+		WUTIL_API DisplayId make_display_id(tstring_view name, uint64_t hash)
+		{
+			for (auto c : name)
+			{
+				auto wide = static_cast<uint16_t>(static_cast<std::make_unsigned_t<TCHAR>>(c));
+				hash = fnv1a(&wide, sizeof(wide), hash);
+			}
+
+			return hash;
+		}
+	}
+
+	WUTIL_API DisplayId get_monitor_id(tstring_view device_name)
+	{
+		WUTIL_ALLOC_SCOPE("get_monitor_id");
+		detail::DeviceNameBuffer name(device_name);
+
+		DISPLAY_DEVICE monitor;
+		monitor.cb = sizeof(monitor);
+		if (detail::display_api.enum_display_devices(name.c_str(), 0, &monitor, EDD_GET_DEVICE_INTERFACE_NAME))
+			return detail::make_display_id(monitor.DeviceID[0] != 0 ? monitor.DeviceID : monitor.DeviceName);
+
+		// no monitor reported, the gdi name is the best identity left
+		return detail::make_display_id(device_name);
+	}
+
+	WUTIL_API ScopedDpiContext::ScopedDpiContext(DPI_AWARENESS_CONTEXT context)
+	{
+		if (detail::load_user32_symbols() != detail::SYMBOLS_LOADED_AND_FOUND)
+			return;
+
+		auto& cache = detail::thread_dpi_cache;
+		auto thread_context = detail::get_thread_dpi_awareness_context();
+		if (context == cache.requested_context && thread_context == cache.thread_context)
+		{
+			applied_ = true;
+			return;
+		}
+
+		previous_context_ = detail::set_thread_dpi_awareness_context(context);
+		if (previous_context_ != NULL)
+		{
+			cache.thread_context = detail::get_thread_dpi_awareness_context();
+			cache.awareness = detail::get_awareness_from_dpi_awareness_context(cache.thread_context);
+			cache.requested_context = context;
+			applied_ = true;
+		}
+	}
+
+	WUTIL_API ScopedDpiContext::~ScopedDpiContext()
+	{
+		if (previous_context_ == NULL)
+			return;
+
+		// the thread context handle of the restored context is picked up by the next query
+		detail::set_thread_dpi_awareness_context(previous_context_);
+	}
+
+	WUTIL_API void invalidate_dpi_context_cache()
+	{
+		detail::thread_dpi_cache = {};
+	}
+
+	WUTIL_API DPI_AWARENESS_CONTEXT get_thread_dpi_context()
+	{
+		if (detail::load_user32_symbols() != detail::SYMBOLS_LOADED_AND_FOUND)
+			return NULL;
+
+		return detail::get_thread_dpi_awareness_context();
+	}
+
+	// fills the caller's vector, a reused vector makes repeated calls allocation free
+	WUTIL_API void get_all_display_devices(std::vector<DISPLAY_DEVICE>& ddevs)
+	{
+		WUTIL_ALLOC_SCOPE("get_all_display_devices");
+		ddevs.clear();
+
+		DISPLAY_DEVICE d;
+		d.cb = sizeof(d);
+
+		int device_num = 0;
+		while (detail::display_api.enum_display_devices(NULL, device_num, &d, 0))
+		{
+			ddevs.push_back(d);
+			++device_num;
+
+			if (d.StateFlags & DISPLAY_DEVICE_PRIMARY_DEVICE)
+				std::swap(ddevs.back(), ddevs.front());
+		}
+	}
+
+	WUTIL_API std::vector<DISPLAY_DEVICE> get_all_display_devices()
+	{
+		std::vector<DISPLAY_DEVICE> ddevs;
+		get_all_display_devices(ddevs);
+
+		return ddevs;
+	}
+
+	// fills the caller's vector, a reused vector makes repeated calls allocation free
+	WUTIL_API void get_all_monitor_info(std::vector<MONITORINFOEX>& info_vec)
+	{
+		WUTIL_ALLOC_SCOPE("get_all_monitor_info");
+		info_vec.clear();
+		detail::display_api.enum_display_monitors(NULL, NULL, detail::monitor_info_enum_proc, reinterpret_cast<LPARAM>(&info_vec));
+	}
+
+	WUTIL_API std::vector<MONITORINFOEX> get_all_monitor_info()
+	{
+		std::vector<MONITORINFOEX> info_vec;
+		get_all_monitor_info(info_vec);
+
+		return info_vec;
+	}
+
+	WUTIL_API std::optional<MONITORINFOEX> get_monitor_info(tstring_view device_name)
+	{
+		WUTIL_ALLOC_SCOPE("get_monitor_info");
+		detail::DeviceNameBuffer name(device_name);
+
+		MONITORINFOEX mi{};
+		detail::MonitorSearch search{ name.c_str(), &mi, false };
+		detail::display_api.enum_display_monitors(NULL, NULL, detail::monitor_search_enum_proc, reinterpret_cast<LPARAM>(&search));
+
+		if (!search.found)
+			return {};
+
+		return mi;
+	}
+
+	// fills the caller's vector, a reused vector makes repeated calls allocation free
+	WUTIL_API void get_monitor_display_settings(tstring_view device_name, std::vector<DEVMODE>& disp_vec)
+	{
+		WUTIL_ALLOC_SCOPE("get_monitor_display_settings");
+		detail::DeviceNameBuffer name(device_name);
+
+		DEVMODE dm;
+		dm.dmSize = sizeof(dm);
+		dm.dmDriverExtra = 0;
+
+		disp_vec.clear();
+		int i = 0;
+		while (detail::display_api.enum_display_settings_ex(name.c_str(), i, &dm, 0))
+		{
+			disp_vec.push_back(dm);
+			++i;
+		}
+
+		detail::display_api.enum_display_settings_ex(name.c_str(), ENUM_CURRENT_SETTINGS, &dm, 0);
+		for (int i = 0; i < disp_vec.size(); ++i)
+		{
+			// orientation and position appear to only be set for ENUM_CURRENT_SETTINGS
+			if (disp_vec[i].dmBitsPerPel == dm.dmBitsPerPel &&
+				disp_vec[i].dmPelsWidth == dm.dmPelsWidth &&
+				disp_vec[i].dmPelsHeight == dm.dmPelsHeight &&
+				disp_vec[i].dmDisplayFlags == dm.dmDisplayFlags &&
+				//disp_vec[i].dmDisplayOrientation == dm.dmDisplayOrientation && 
+				//disp_vec[i].dmPosition.x == dm.dmPosition.x &&
+				//disp_vec[i].dmPosition.y == dm.dmPosition.y &&
+				disp_vec[i].dmDisplayFrequency == dm.dmDisplayFrequency)
+			{
+				std::swap(disp_vec[i], disp_vec[0]);
+				break;
+			}
+
+		}
+	}
+
+	WUTIL_API std::vector<DEVMODE> get_monitor_display_settings(tstring_view device_name)
+	{
+		std::vector<DEVMODE> disp_vec;
+		get_monitor_display_settings(device_name, disp_vec);
+
+		return disp_vec;
+	}
+
+	namespace detail
+	{
+		WUTIL_API BOOL Win32ModeEnumerator::operator()(const TCHAR* device_name, DWORD index, DEVMODE* dm, DWORD flags) const
+		{
+			return detail::display_api.enum_display_settings_ex(device_name, index, dm, flags);
+		}
+	}
+
+	WUTIL_API DisplayModeRange display_modes(tstring_view device_name, DWORD flags)
+	{
+		return DisplayModeRange(device_name, flags);
+	}
+
+	WUTIL_API std::optional<WindowInfo> set_window_fullscreen(HWND hwnd, const MONITORINFOEX& mi)
+	{
+		WindowInfo saved_window_info;
+		saved_window_info.style = GetWindowLong(hwnd, GWL_STYLE);
+		saved_window_info.ex_style = GetWindowLong(hwnd, GWL_EXSTYLE);
+		GetWindowPlacement(hwnd, &saved_window_info.placement);
+		GetWindowRect(hwnd, &saved_window_info.rect);
+
+		WINDOWPLACEMENT fullscreen_placement = saved_window_info.placement;
+		fullscreen_placement.showCmd = SW_SHOWNORMAL;
+		fullscreen_placement.rcNormalPosition = { mi.rcMonitor.left,
+			mi.rcMonitor.top,
+			mi.rcMonitor.right - mi.rcMonitor.left,
+			mi.rcMonitor.bottom - mi.rcMonitor.top };
+
+		LONG res = 0;
+		res += SetWindowLong(hwnd, GWL_STYLE, saved_window_info.style & ~(WS_CAPTION | WS_THICKFRAME));
+		res += SetWindowLong(hwnd, GWL_EXSTYLE, saved_window_info.ex_style & ~(WS_EX_DLGMODALFRAME |
+			WS_EX_WINDOWEDGE | WS_EX_CLIENTEDGE | WS_EX_STATICEDGE));
+		res += SetWindowPlacement(hwnd, &fullscreen_placement);
+
+		if (res == 0)
+			return {};
+		else
+			return saved_window_info;
+	}
+
+	WUTIL_API std::optional<WindowInfo> set_window_fullscreen(HWND hwnd)
+	{
+		WindowInfo saved_window_info;
+		saved_window_info.style = GetWindowLong(hwnd, GWL_STYLE);
+		saved_window_info.ex_style = GetWindowLong(hwnd, GWL_EXSTYLE);
+		GetWindowPlacement(hwnd, &saved_window_info.placement);
+		GetWindowRect(hwnd, &saved_window_info.rect);
+
+		MONITORINFOEX mi;
+		mi.cbSize = sizeof(mi);
+		auto hmonitor = detail::display_api.monitor_from_window(hwnd, MONITOR_DEFAULTTONEAREST);
+		if (detail::display_api.get_monitor_info(hmonitor, &mi) == 0)
+			return {};
+
+		WINDOWPLACEMENT fullscreen_placement = saved_window_info.placement;
+		fullscreen_placement.showCmd = SW_SHOWNORMAL;
+		fullscreen_placement.rcNormalPosition = { mi.rcMonitor.left,
+			mi.rcMonitor.top,
+			mi.rcMonitor.right - mi.rcMonitor.left,
+			mi.rcMonitor.bottom - mi.rcMonitor.top };
+
+		LONG res = 0;
+		res += SetWindowLong(hwnd, GWL_STYLE, saved_window_info.style & ~(WS_CAPTION | WS_THICKFRAME));
+		res += SetWindowLong(hwnd, GWL_EXSTYLE, saved_window_info.ex_style & ~(WS_EX_DLGMODALFRAME |
+			WS_EX_WINDOWEDGE | WS_EX_CLIENTEDGE | WS_EX_STATICEDGE));
+		res += SetWindowPlacement(hwnd, &fullscreen_placement);
+
+		if (res == 0)
+			return {};
+		else
+			return saved_window_info;
+	}
+
+	WUTIL_API bool set_window_to(HWND hwnd, const WindowInfo& wi)
+	{
+		LONG res = 0;
+		res += SetWindowLong(hwnd, GWL_STYLE, wi.style);
+		res += SetWindowLong(hwnd, GWL_EXSTYLE, wi.ex_style);
+		res += SetWindowPlacement(hwnd, &wi.placement);
+
+		if (res == 0)
+			return false;
+		else
+			return true;
+	}
+
+	WUTIL_API std::optional<MONITORINFOEX> changes_display_settings_fullscreen(tstring_view device_name, DEVMODE& dev_mode)
+	{
+		detail::DeviceNameBuffer name(device_name);
+		auto res = detail::display_api.change_display_settings_ex(name.c_str(), &dev_mode, NULL, CDS_FULLSCREEN, NULL);
+		if (res == DISP_CHANGE_SUCCESSFUL)
+			return get_monitor_info(device_name);
+		else
+			return {};
+	}
+
+	WUTIL_API bool reset_display_settings_fullscreen(tstring_view device_name)
+	{
+		detail::DeviceNameBuffer name(device_name);
+		auto res = detail::display_api.change_display_settings_ex(name.c_str(), NULL, NULL, 0, NULL);
+		if (res == DISP_CHANGE_SUCCESSFUL)
+			return true;
+		else
+			return false;
+	}
+
+	WUTIL_API UINT get_dpi(HWND hwnd)
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			return detail::get_dpi_for_window(hwnd);
+		}
+		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			auto hmonitor = detail::display_api.monitor_from_window(hwnd, MONITOR_DEFAULTTONEAREST);
+			UINT dpi_x = 0, dpi_y = 0;
+			auto hr = detail::get_dpi_for_monitor(hmonitor, MDT_EFFECTIVE_DPI, &dpi_x, &dpi_y);
+			if (hr == S_OK)
+				return dpi_x;
+			else
+				return detail::Default_DPI;
+		}
+		else
+			return detail::Default_DPI;
+	}
+
+	WUTIL_API UINT get_dpi(const POINT& point)
+	{
+		if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			auto hmonitor = detail::display_api.monitor_from_point(point, MONITOR_DEFAULTTONEAREST);
+			UINT dpi_x = 0, dpi_y = 0;
+			auto hr = detail::get_dpi_for_monitor(hmonitor, MDT_EFFECTIVE_DPI, &dpi_x, &dpi_y);
+			if (hr == S_OK)
+				return dpi_x;
+			else
+				return detail::Default_DPI;
+		}
+		else
+			return detail::Default_DPI;
+	}
+
+	WUTIL_API UINT get_dpi(HMONITOR hmonitor)
+	{
+		if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			UINT dpi_x = 0, dpi_y = 0;
+			auto hr = detail::get_dpi_for_monitor(hmonitor, MDT_EFFECTIVE_DPI, &dpi_x, &dpi_y);
+			if (hr == S_OK)
+				return dpi_x;
+			else
+				return detail::Default_DPI;
+		}
+		else
+			return detail::Default_DPI;
+	}
+
+	WUTIL_API double RefreshTiming::refresh_hz() const
+	{
+		if (vsync_frequency.Denominator == 0)
+			return 0.0;
+
+		return static_cast<double>(vsync_frequency.Numerator) / static_cast<double>(vsync_frequency.Denominator);
+	}
+
+	WUTIL_API UINT32 RefreshTiming::vblank_lines() const
+	{
+		return total_size.cy > active_size.cy ? total_size.cy - active_size.cy : 0;
+	}
+
+	namespace detail
+	{
+		// period of a rational frequency in nanoseconds, rounded to nearest
+		WUTIL_API UINT64 period_ns(const DISPLAYCONFIG_RATIONAL& frequency)
+		{
+			if (frequency.Numerator == 0)
+				return 0;
+
+			return (1000000000ull * frequency.Denominator + frequency.Numerator / 2) / frequency.Numerator;
+		}
+
+		// display config reports gdi names in utf-16 regardless of the character set
+		WUTIL_API bool equal_device_name(const WCHAR* wide_name, const TCHAR* name)
+		{
+			// bounds first, a full length name has no terminator to stop at
+			int i = 0;
+			for (; i < CCHDEVICENAME && wide_name[i] != 0 && name[i] != 0; ++i)
+			{
+				if (wide_name[i] != static_cast<WCHAR>(name[i]))
+					return false;
+			}
+
+			return i == CCHDEVICENAME || wide_name[i] == static_cast<WCHAR>(name[i]);
+		}
+
+		WUTIL_API RefreshTiming make_refresh_timing(const DISPLAYCONFIG_PATH_INFO& path, const std::vector<DISPLAYCONFIG_MODE_INFO>& modes)
+		{
+			RefreshTiming timing;
+			auto mode_index = path.targetInfo.modeInfoIdx;
+
+			if (mode_index != DISPLAYCONFIG_PATH_MODE_IDX_INVALID && mode_index < modes.size() &&
+				modes[mode_index].infoType == DISPLAYCONFIG_MODE_INFO_TYPE_TARGET)
+			{
+				const auto& signal = modes[mode_index].targetMode.targetVideoSignalInfo;
+				timing.vsync_frequency = signal.vSyncFreq;
+				timing.hsync_frequency = signal.hSyncFreq;
+				timing.pixel_rate = signal.pixelRate;
+				timing.active_size = signal.activeSize;
+				timing.total_size = signal.totalSize;
+				timing.scanline_ordering = signal.scanLineOrdering;
+			}
+			else
+			{
+				// no target mode, the path still carries the refresh rational
+				timing.vsync_frequency = path.targetInfo.refreshRate;
+				timing.scanline_ordering = path.targetInfo.scanLineOrdering;
+			}
+
+			timing.vsync_interval_ns = period_ns(timing.vsync_frequency);
+			timing.scanline_interval_ns = period_ns(timing.hsync_frequency);
+
+			return timing;
+		}
+
+		WUTIL_API bool query_active_display_paths(std::vector<DISPLAYCONFIG_PATH_INFO>& paths, std::vector<DISPLAYCONFIG_MODE_INFO>& modes)
+		{
+			load_user32_symbols();
+			if (!display_api.get_display_config_buffer_sizes || !display_api.query_display_config || !display_api.display_config_get_device_info)
+				return false;
+
+			LONG result = ERROR_INSUFFICIENT_BUFFER;
+			while (result == ERROR_INSUFFICIENT_BUFFER)
+			{
+				UINT32 path_count = 0, mode_count = 0;
+				if (display_api.get_display_config_buffer_sizes(QDC_ONLY_ACTIVE_PATHS, &path_count, &mode_count) != ERROR_SUCCESS)
+					return false;
+
+				paths.resize(path_count);
+				modes.resize(mode_count);
+				result = display_api.query_display_config(QDC_ONLY_ACTIVE_PATHS, &path_count, paths.data(), &mode_count, modes.data(), NULL);
+				paths.resize(path_count);
+				modes.resize(mode_count);
+			}
+
+			return result == ERROR_SUCCESS;
+		}
+	}
+
+	WUTIL_API std::vector<std::optional<RefreshTiming>> get_all_refresh_timing(const std::vector<MONITORINFOEX>& monitors)
+	{
+		std::vector<std::optional<RefreshTiming>> timings(monitors.size());
+
+		std::vector<DISPLAYCONFIG_PATH_INFO> paths;
+		std::vector<DISPLAYCONFIG_MODE_INFO> modes;
+		if (!detail::query_active_display_paths(paths, modes))
+			return timings;
+
+		for (const auto& path : paths)
+		{
+			DISPLAYCONFIG_SOURCE_DEVICE_NAME source_name = {};
+			source_name.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_SOURCE_NAME;
+			source_name.header.size = sizeof(source_name);
+			source_name.header.adapterId = path.sourceInfo.adapterId;
+			source_name.header.id = path.sourceInfo.id;
+
+			if (detail::display_api.display_config_get_device_info(&source_name.header) != ERROR_SUCCESS)
+				continue;
+
+			for (size_t i = 0; i < monitors.size(); ++i)
+			{
+				// cloned monitors share a source, first path wins like gdi does
+				if (!timings[i] && detail::equal_device_name(source_name.viewGdiDeviceName, monitors[i].szDevice))
+					timings[i] = detail::make_refresh_timing(path, modes);
+			}
+		}
+
+		return timings;
+	}
+
+	WUTIL_API std::optional<RefreshTiming> get_refresh_timing(const MONITORINFOEX& mi)
+	{
+		return get_all_refresh_timing({ mi }).front();
+	}
+
+	WUTIL_API Topology get_topology()
+	{
+		Topology topology;
+		topology.devices = get_all_display_devices();
+		topology.monitors = get_all_monitor_info();
+
+		for (const auto& mi : topology.monitors)
+		{
+			topology.ids.push_back(get_monitor_id(mi.szDevice));
+			topology.dpis.push_back(get_dpi(detail::display_api.monitor_from_rect(&mi.rcMonitor, MONITOR_DEFAULTTONEAREST)));
+			topology.modes.push_back(get_monitor_display_settings(mi.szDevice));
+		}
+
+		return topology;
+	}
+
+	WUTIL_API bool enable_per_monitor_dpi_aware()
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			return detail::set_thread_dpi_context(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE);
+		}
+		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			auto result = detail::set_process_dpi_awareness(PROCESS_PER_MONITOR_DPI_AWARE);
+
+			PROCESS_DPI_AWARENESS current_awareness;
+			detail::get_process_dpi_awareness(NULL, &current_awareness);
+
+			if (current_awareness == PROCESS_PER_MONITOR_DPI_AWARE)
+				return true;
+			else
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	WUTIL_API bool enable_system_dpi_aware()
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			return detail::set_thread_dpi_context(DPI_AWARENESS_CONTEXT_SYSTEM_AWARE);
+		}
+		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			auto result = detail::set_process_dpi_awareness(PROCESS_SYSTEM_DPI_AWARE);
+
+			PROCESS_DPI_AWARENESS current_awareness;
+			detail::get_process_dpi_awareness(NULL, &current_awareness);
+
+			if (current_awareness == PROCESS_SYSTEM_DPI_AWARE)
+				return true;
+			else
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	WUTIL_API bool enable_dpi_unaware()
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			return detail::set_thread_dpi_context(DPI_AWARENESS_CONTEXT_UNAWARE);
+		}
+		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			auto result = detail::set_process_dpi_awareness(PROCESS_DPI_UNAWARE);
+
+			PROCESS_DPI_AWARENESS current_awareness;
+			detail::get_process_dpi_awareness(NULL, &current_awareness);
+
+			if (current_awareness == PROCESS_DPI_UNAWARE)
+				return true;
+			else
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	WUTIL_API bool enable_non_client_dpi_scaling(HWND hwnd)
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND && detail::enable_nonclient_dpi_scaling)
+		{
+			if (detail::enable_nonclient_dpi_scaling(hwnd))
+				return true;
+			else
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	WUTIL_API bool is_dpi_aware()
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			return detail::current_thread_dpi_awareness() != DPI_AWARENESS_UNAWARE;
+		}
+		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			PROCESS_DPI_AWARENESS current_awareness;
+			detail::get_process_dpi_awareness(NULL, &current_awareness);
+
+			if (current_awareness == PROCESS_DPI_UNAWARE)
+				return false;
+			else
+				return true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	WUTIL_API bool is_per_monitor_dpi_aware()
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			return detail::current_thread_dpi_awareness() == DPI_AWARENESS_PER_MONITOR_AWARE;
+		}
+		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			PROCESS_DPI_AWARENESS current_awareness;
+			detail::get_process_dpi_awareness(NULL, &current_awareness);
+
+			if (current_awareness == PROCESS_PER_MONITOR_DPI_AWARE)
+				return true;
+			else
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	WUTIL_API bool is_system_dpi_aware()
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			return detail::current_thread_dpi_awareness() == DPI_AWARENESS_SYSTEM_AWARE;
+		}
+		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			PROCESS_DPI_AWARENESS current_awareness;
+			detail::get_process_dpi_awareness(NULL, &current_awareness);
+
+			if (current_awareness == PROCESS_SYSTEM_DPI_AWARE)
+				return true;
+			else
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	WUTIL_API bool is_dpi_unaware()
+	{
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			return detail::current_thread_dpi_awareness() == DPI_AWARENESS_UNAWARE;
+		}
+		else if (detail::load_shcore_symbols() == detail::SYMBOLS_LOADED_AND_FOUND)
+		{
+			PROCESS_DPI_AWARENESS current_awareness;
+			detail::get_process_dpi_awareness(NULL, &current_awareness);
+
+			if (current_awareness == PROCESS_DPI_UNAWARE)
+				return true;
+			else
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	WUTIL_API int scale_value(int value, UINT dpi)
+	{
+		auto dpi_scale_ = MulDiv(dpi, 100, detail::Default_DPI);
+		return MulDiv(value, dpi_scale_, 100);
+	}
+
+	WUTIL_API RECT scale_rect(const RECT& rect, UINT dpi)
+	{
+		auto dpi_scale_ = MulDiv(dpi, 100, detail::Default_DPI);
+
+		auto scaled_rect = rect;
+		scaled_rect.bottom = MulDiv(scaled_rect.bottom, dpi_scale_, 100);
+		scaled_rect.top = MulDiv(scaled_rect.top, dpi_scale_, 100);
+		scaled_rect.left = MulDiv(scaled_rect.left, dpi_scale_, 100);
+		scaled_rect.right = MulDiv(scaled_rect.right, dpi_scale_, 100);
+
+		return scaled_rect;
+	}
+
+	WUTIL_API POINT scale_point(const POINT& point, UINT dpi)
+	{
+		auto dpi_scale_ = MulDiv(dpi, 100, detail::Default_DPI);
+
+		auto scaled_point = point;
+		scaled_point.x = MulDiv(scaled_point.x, dpi_scale_, 100);
+		scaled_point.y = MulDiv(scaled_point.y, dpi_scale_, 100);
+
+		return scaled_point;
+	}
+
+	WUTIL_API HFONT scale_font(const HFONT hfont, UINT dpi)
+	{
+		LOGFONT log_font;
+		GetObject(hfont, sizeof(log_font), &log_font);
+
+		log_font.lfHeight = -1 * scale_value(abs(log_font.lfHeight), dpi);
+		auto scaled_font = CreateFontIndirect(&log_font);
+
+		return scaled_font;
+	}
+
+	namespace detail
+	{
+		WUTIL_API bool is_dpi_scaled_metric(int index)
+		{
+			switch (index)
+			{
+			case SM_CXVSCROLL: case SM_CYHSCROLL: case SM_CYCAPTION: case SM_CXBORDER: case SM_CYBORDER:
+			case SM_CXDLGFRAME: case SM_CYDLGFRAME: case SM_CYVTHUMB: case SM_CXHTHUMB: case SM_CXICON:
+			case SM_CYICON: case SM_CXCURSOR: case SM_CYCURSOR: case SM_CYMENU: case SM_CYVSCROLL:
+			case SM_CXHSCROLL: case SM_CXMIN: case SM_CYMIN: case SM_CXSIZE: case SM_CYSIZE:
+			case SM_CXFRAME: case SM_CYFRAME: case SM_CXMINTRACK: case SM_CYMINTRACK: case SM_CXICONSPACING:
+			case SM_CYICONSPACING: case SM_CXEDGE: case SM_CYEDGE: case SM_CXMINSPACING: case SM_CYMINSPACING:
+			case SM_CXSMICON: case SM_CYSMICON: case SM_CYSMCAPTION: case SM_CXSMSIZE: case SM_CYSMSIZE:
+			case SM_CXMENUSIZE: case SM_CYMENUSIZE: case SM_CXMINIMIZED: case SM_CYMINIMIZED: case SM_CXMENUCHECK:
+			case SM_CYMENUCHECK: case SM_CXFOCUSBORDER: case SM_CYFOCUSBORDER: case SM_CXPADDEDBORDER:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		WUTIL_API void scale_log_font(LOGFONT& log_font, UINT dpi, UINT base_dpi)
+		{
+			log_font.lfHeight = MulDiv(log_font.lfHeight, dpi, base_dpi);
+			log_font.lfWidth = MulDiv(log_font.lfWidth, dpi, base_dpi);
+		}
+
+		WUTIL_API void copy_log_font(const LOGFONTW& from, LOGFONT& to)
+		{
+#ifdef UNICODE
+			to = from;
+#else
+			to.lfHeight = from.lfHeight;
+			to.lfWidth = from.lfWidth;
+			to.lfEscapement = from.lfEscapement;
+			to.lfOrientation = from.lfOrientation;
+			to.lfWeight = from.lfWeight;
+			to.lfItalic = from.lfItalic;
+			to.lfUnderline = from.lfUnderline;
+			to.lfStrikeOut = from.lfStrikeOut;
+			to.lfCharSet = from.lfCharSet;
+			to.lfOutPrecision = from.lfOutPrecision;
+			to.lfClipPrecision = from.lfClipPrecision;
+			to.lfQuality = from.lfQuality;
+			to.lfPitchAndFamily = from.lfPitchAndFamily;
+			if (WideCharToMultiByte(CP_ACP, 0, from.lfFaceName, -1, to.lfFaceName, LF_FACESIZE, NULL, NULL) == 0)
+				to.lfFaceName[0] = 0;
+			to.lfFaceName[LF_FACESIZE - 1] = 0;
+#endif
+		}
+
+		WUTIL_API void copy_non_client_metrics(const NONCLIENTMETRICSW& from, NONCLIENTMETRICS& to)
+		{
+			to.iBorderWidth = from.iBorderWidth;
+			to.iScrollWidth = from.iScrollWidth;
+			to.iScrollHeight = from.iScrollHeight;
+			to.iCaptionWidth = from.iCaptionWidth;
+			to.iCaptionHeight = from.iCaptionHeight;
+			copy_log_font(from.lfCaptionFont, to.lfCaptionFont);
+			to.iSmCaptionWidth = from.iSmCaptionWidth;
+			to.iSmCaptionHeight = from.iSmCaptionHeight;
+			copy_log_font(from.lfSmCaptionFont, to.lfSmCaptionFont);
+			to.iMenuWidth = from.iMenuWidth;
+			to.iMenuHeight = from.iMenuHeight;
+			copy_log_font(from.lfMenuFont, to.lfMenuFont);
+			copy_log_font(from.lfStatusFont, to.lfStatusFont);
+			copy_log_font(from.lfMessageFont, to.lfMessageFont);
+			to.iPaddedBorderWidth = from.iPaddedBorderWidth;
+		}
+
+		WUTIL_API void copy_icon_metrics(const ICONMETRICSW& from, ICONMETRICS& to)
+		{
+			to.iHorzSpacing = from.iHorzSpacing;
+			to.iVertSpacing = from.iVertSpacing;
+			to.iTitleWrap = from.iTitleWrap;
+			copy_log_font(from.lfFont, to.lfFont);
+		}
+	}
+
+	WUTIL_API int SystemMetricsCache::system_metric(int index, UINT dpi)
+	{
+		// indices past SM_CMETRICS are flags and counts, not worth caching
+		if (index < 0 || index >= SM_CMETRICS)
+			return GetSystemMetrics(index);
+
+		return entry_for(dpi).system_metrics[index];
+	}
+
+	WUTIL_API bool SystemMetricsCache::handle_message(UINT message)
+	{
+		if (message != WM_SETTINGCHANGE)
+			return false;
+
+		invalidate();
+		return true;
+	}
+
+	WUTIL_API void SystemMetricsCache::invalidate()
+	{
+		entries_.clear();
+	}
+
+	WUTIL_API double SystemMetricsCache::hit_rate() const
+	{
+		auto total = hits_ + misses_;
+		return total == 0 ? 0.0 : static_cast<double>(hits_) / static_cast<double>(total);
+	}
+
+	WUTIL_API SystemMetricsCache::Entry& SystemMetricsCache::entry_for(UINT dpi)
+	{
+		for (auto& entry : entries_)
+		{
+			if (entry->dpi == dpi)
+			{
+				++hits_;
+				return *entry;
+			}
+		}
+
+		++misses_;
+		entries_.push_back(std::make_unique<Entry>());
+		auto& entry = *entries_.back();
+		entry.dpi = dpi;
+		entry.non_client.cbSize = sizeof(entry.non_client);
+		entry.icon.cbSize = sizeof(entry.icon);
+
+		if (detail::load_user32_symbols() == detail::SYMBOLS_LOADED_AND_FOUND &&
+			detail::display_api.system_parameters_info_for_dpi && detail::get_system_metrics_for_dpi)
+		{
+			// W only, an ansi build must not hand it the A structs
+			NONCLIENTMETRICSW non_client = {};
+			non_client.cbSize = sizeof(non_client);
+			ICONMETRICSW icon = {};
+			icon.cbSize = sizeof(icon);
+			LOGFONTW icon_title_font = {};
+
+			if (detail::display_api.system_parameters_info_for_dpi(SPI_GETNONCLIENTMETRICS, sizeof(non_client), &non_client, 0, dpi))
+				detail::copy_non_client_metrics(non_client, entry.non_client);
+			if (detail::display_api.system_parameters_info_for_dpi(SPI_GETICONMETRICS, sizeof(icon), &icon, 0, dpi))
+				detail::copy_icon_metrics(icon, entry.icon);
+			if (detail::display_api.system_parameters_info_for_dpi(SPI_GETICONTITLELOGFONT, sizeof(icon_title_font), &icon_title_font, 0, dpi))
+				detail::copy_log_font(icon_title_font, entry.icon_title_font);
+
+			for (int i = 0; i < SM_CMETRICS; ++i)
+				entry.system_metrics[i] = detail::get_system_metrics_for_dpi(i, dpi);
+		}
+		else
+		{
+			fill_scaled(entry, dpi);
+		}
+
+		return entry;
+	}
+
+	WUTIL_API void SystemMetricsCache::fill_scaled(Entry& entry, UINT dpi)
+	{
+		HDC screen_dc = GetDC(NULL);
+		UINT base_dpi = screen_dc ? GetDeviceCaps(screen_dc, LOGPIXELSY) : detail::Default_DPI;
+		ReleaseDC(NULL, screen_dc);
+		if (base_dpi == 0)
+			base_dpi = detail::Default_DPI;
+
+		detail::display_api.system_parameters_info(SPI_GETNONCLIENTMETRICS, sizeof(entry.non_client), &entry.non_client, 0);
+		detail::display_api.system_parameters_info(SPI_GETICONMETRICS, sizeof(entry.icon), &entry.icon, 0);
+		detail::display_api.system_parameters_info(SPI_GETICONTITLELOGFONT, sizeof(entry.icon_title_font), &entry.icon_title_font, 0);
+
+		for (int i = 0; i < SM_CMETRICS; ++i)
+		{
+			entry.system_metrics[i] = GetSystemMetrics(i);
+			if (detail::is_dpi_scaled_metric(i))
+				entry.system_metrics[i] = MulDiv(entry.system_metrics[i], dpi, base_dpi);
+		}
+
+		if (dpi == base_dpi)
+			return;
+
+		auto& ncm = entry.non_client;
+		for (int* value : { &ncm.iBorderWidth, &ncm.iScrollWidth, &ncm.iScrollHeight, &ncm.iCaptionWidth, &ncm.iCaptionHeight,
+			&ncm.iSmCaptionWidth, &ncm.iSmCaptionHeight, &ncm.iMenuWidth, &ncm.iMenuHeight, &ncm.iPaddedBorderWidth })
+		{
+			*value = MulDiv(*value, dpi, base_dpi);
+		}
+
+		for (LOGFONT* log_font : { &ncm.lfCaptionFont, &ncm.lfSmCaptionFont, &ncm.lfMenuFont, &ncm.lfStatusFont, &ncm.lfMessageFont,
+			&entry.icon.lfFont, &entry.icon_title_font })
+		{
+			detail::scale_log_font(*log_font, dpi, base_dpi);
+		}
+
+		entry.icon.iHorzSpacing = MulDiv(entry.icon.iHorzSpacing, dpi, base_dpi);
+		entry.icon.iVertSpacing = MulDiv(entry.icon.iVertSpacing, dpi, base_dpi);
+	}
+}
+
+#endif